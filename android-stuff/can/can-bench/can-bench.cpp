@@ -0,0 +1,771 @@
+#include <linux/can.h>
+#include <net/if.h>
+
+#include <endian.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "async_log.h"
+#include "can_gateway.h"
+#include "can_log.h"
+#include "dbc_parser.h"
+#include "event_loop.h"
+#include "latency_histogram.h"
+#include "message_decoder.h"
+#include "property_sink.h"
+#include "publisher.h"
+#include "realtime.h"
+#include "signal_database.h"
+#include "socket_can.h"
+#include "vehicle_signals.h"
+
+// Throughput and latency benchmark of the gateway pipeline:
+//
+//   sender thread --vcan--> SocketCan -> decode -> Publisher -> BenchSink
+//
+// With --log the frames come from a recorded candump log instead (see
+// CanGateway::ReplayLog), decoded with VehicleSignals or --dbc, which profiles
+// decoding and publishing without a bus.
+//
+// Every frame carries its send time (CLOCK_REALTIME, ns since the start of the
+// run) split into two 31-bit signals, so the decoder and the sink can measure
+// send->decode and send->publish latency without sharing any state with the
+// sender. Results are written as JSON so runs of different builds can be diffed.
+//
+// The gateway threads can run in real-time mode (see realtime.h); with
+// --compare-rt every rate is run once as plain CFS threads and once in
+// real-time mode, and the jitter of both is reported side by side.
+
+using namespace tcc::aaos::can;
+
+constexpr static char TAG[] = "CAN_BENCH";
+// Below this much time to the next frame the sender spins instead of sleeping
+constexpr static int64_t SPIN_NS = 50'000;
+// The pipeline is considered drained once no frame arrived for this long
+constexpr static int64_t DRAIN_IDLE_NS = 200'000'000;
+// ID used for --noise frames; never part of the mix, so the kernel filter drops it
+constexpr static canid_t NOISE_CAN_ID = 0x7ff;
+// Benchmark-only vendor INT32_VEC properties, one per mix entry. They only
+// ever reach BenchSink, never the VHAL.
+constexpr static int32_t BENCH_PROPERTY_BASE = 0x1f00 + 0x20000000 + 0x01000000 + 0x00410000;
+constexpr static int TIMESTAMP_BITS = 31;
+constexpr static uint64_t TIMESTAMP_MASK = (uint64_t{1} << TIMESTAMP_BITS) - 1;
+
+struct MixEntry {
+    canid_t can_id;
+    unsigned weight;
+};
+
+struct Options {
+    std::string interface = "vcan0";
+    double rate = 10'000;      // Frames per second
+    double duration_s = 5;
+    std::vector<MixEntry> mix = {{0x100, 1}};
+    unsigned noise_percent = 0;
+    double sweep_max = 0;      // 0: single run at rate
+    double sweep_step = 0;
+    std::string output;        // JSON destination, stdout when empty
+    std::string log;           // Replay this log instead of sending on vcan
+    std::string dbc;           // Decoder for --log, VehicleSignals when empty
+    double speed = 0;          // --log replay speed, 0 = as fast as possible
+    unsigned passes = 1;       // Times the log is replayed
+    RxBackend backend = RxBackend::SOCKET;
+    RealtimeConfig realtime;   // Gateway thread scheduling (--rx-priority=... --mlock)
+    bool compare_rt = false;   // Run every rate as CFS and in real-time mode
+    int rcvbuf_kib = 0;        // Gateway socket receive buffer, 0 = kernel default
+    bool batch_decode = false; // --log: CanGateway::SetBatchDecode()
+    DecodeKernel batch_kernel = BestKernel();
+};
+
+// --compare-rt without any real-time option
+constexpr static int DEFAULT_RX_PRIORITY = 50;
+
+struct LogResult {
+    CanLogFormat format;
+    double elapsed_s;
+    uint64_t frames;
+    uint64_t decoded;
+    uint64_t skipped;
+    uint64_t values;
+    uint64_t transactions;
+};
+
+struct LatencySummary {
+    uint64_t count;
+    double p50_us;
+    double p90_us;
+    double p99_us;
+    double p999_us;
+    double max_us;
+    double jitter_us; // p99.9 - p50: how far the slow frames trail the typical one
+};
+
+struct RunResult {
+    std::string scheduling; // DescribeRealtime() of the gateway threads
+    double target_fps;
+    double send_s;
+    uint64_t sent;
+    uint64_t noise_sent;
+    uint64_t send_stalls;  // Writes refused with ENOBUFS and retried
+    uint64_t received;     // Frames read by the gateway
+    uint64_t decoded;
+    uint64_t rx_queue_drops;
+    uint64_t publisher_drops;
+    uint64_t lost;         // Sent but neither received nor reported dropped
+    uint64_t values;
+    uint64_t transactions;
+    LatencySummary rx;
+    LatencySummary end_to_end;
+
+    uint64_t Drops() const { return rx_queue_drops + publisher_drops + lost; }
+};
+
+static int64_t MonotonicNowNs() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1'000'000'000 + now.tv_nsec;
+}
+
+static LatencySummary Summarize(LatencyHistogram const& histogram) {
+    auto us = [](int64_t ns) { return static_cast<double>(ns) / 1000.0; };
+    if (histogram.Count() == 0) {
+        return {};
+    }
+    return LatencySummary{histogram.Count(), us(histogram.Percentile(50)), us(histogram.Percentile(90)),
+                          us(histogram.Percentile(99)), us(histogram.Percentile(99.9)), us(histogram.Max()),
+                          us(histogram.Percentile(99.9) - histogram.Percentile(50))};
+}
+
+// Decodes like the wrapped database and records send->decode latency of every
+// frame. Only called from the reader thread.
+class TimestampingDecoder : public MessageDecoder {
+public:
+    TimestampingDecoder(MessageDecoder const& decoder, int64_t epoch_ns) : decoder_(decoder), epoch_ns_(epoch_ns) {}
+
+    size_t Decode(canfd_frame const& frame, DecodedSamples &out) const override {
+        size_t count = decoder_.Decode(frame, out);
+        if (count == 0) {
+            return 0;
+        }
+        uint64_t sent = static_cast<uint64_t>(out[0].values[0]) | static_cast<uint64_t>(out[0].values[1]) << TIMESTAMP_BITS;
+        rx_latency_.Record(RealtimeNowNs() - epoch_ns_ - static_cast<int64_t>(sent));
+        return count;
+    }
+    MessageInfo const* Messages() const override { return decoder_.Messages(); }
+    size_t MessageCount() const override { return decoder_.MessageCount(); }
+    std::vector<can_filter> Filters() const override { return decoder_.Filters(); }
+
+    LatencyHistogram const& Latency() const { return rx_latency_; }
+
+private:
+    MessageDecoder const& decoder_;
+    int64_t epoch_ns_;
+    mutable LatencyHistogram rx_latency_;
+};
+
+// Records send->publish latency of every value when its transaction is
+// flushed, the point where a real sink would hand it to the VHAL.
+class BenchSink : public PropertySink {
+public:
+    // timestamped: values carry a send time (vcan runs); otherwise they are only counted
+    BenchSink(int64_t epoch_ns, bool timestamped) : epoch_ns_(epoch_ns), timestamped_(timestamped) {
+        pending_.reserve(Publisher::MAX_PUBLISH_BATCH);
+    }
+
+    std::vector<float> MaxSampleRates(std::vector<int32_t> const& prop_ids) override {
+        // Unlimited: the benchmark measures the pipeline, not the rate caps
+        return std::vector<float>(prop_ids.size(), 0.0f);
+    }
+
+    void Add(PropertyValue const& value) override {
+        if (!timestamped_ || value.count < 2) {
+            pending_.push_back(-1);
+            return;
+        }
+        uint64_t sent = static_cast<uint32_t>(value.int32_values[0]) |
+                        static_cast<uint64_t>(static_cast<uint32_t>(value.int32_values[1])) << TIMESTAMP_BITS;
+        pending_.push_back(static_cast<int64_t>(sent));
+    }
+
+    size_t Pending() const override { return pending_.size(); }
+
+    bool Flush() override {
+        if (pending_.empty()) {
+            return true;
+        }
+        int64_t now_ns = RealtimeNowNs() - epoch_ns_;
+        for (int64_t sent_ns : pending_) {
+            if (sent_ns >= 0) {
+                latency_.Record(now_ns - sent_ns);
+            }
+        }
+        values_.fetch_add(pending_.size(), std::memory_order_relaxed);
+        transactions_.fetch_add(1, std::memory_order_relaxed);
+        pending_.clear();
+        return true;
+    }
+
+    SinkStats Stats() const override {
+        return SinkStats{transactions_.load(std::memory_order_relaxed), values_.load(std::memory_order_relaxed),
+                         0, 0};
+    }
+
+    // Only valid once the publisher thread has stopped
+    LatencyHistogram const& Latency() const { return latency_; }
+
+private:
+    int64_t epoch_ns_;
+    bool timestamped_;
+    std::vector<int64_t> pending_; // Send time of each value, -1 when unknown
+    LatencyHistogram latency_;
+    std::atomic<uint64_t> values_{0};
+    std::atomic<uint64_t> transactions_{0};
+};
+
+// One message per mix entry holding the send timestamp, published as its own property
+static DbcFile BenchDatabase(std::vector<MixEntry> const& mix) {
+    DbcFile file;
+    for (size_t i = 0; i < mix.size(); i++) {
+        DbcMessage message;
+        message.can_id = mix[i].can_id > CAN_SFF_MASK ? mix[i].can_id | CAN_EFF_FLAG : mix[i].can_id;
+        message.name = "Bench" + std::to_string(i);
+        message.dlc = CAN_MAX_DLEN;
+        for (int part = 0; part < 2; part++) {
+            DbcSignal signal;
+            signal.name = part == 0 ? "SendTimeLow" : "SendTimeHigh";
+            signal.start_bit = static_cast<uint16_t>(part * TIMESTAMP_BITS);
+            signal.length = TIMESTAMP_BITS;
+            signal.byte_order = ByteOrder::LITTLE_ENDIAN_ORDER;
+            signal.type = ValueType::UNSIGNED;
+            signal.prop_id = BENCH_PROPERTY_BASE + static_cast<int32_t>(i);
+            message.signals.push_back(signal);
+        }
+        file.messages.push_back(message);
+    }
+    return file;
+}
+
+// Smooth weighted round robin: the mix entry index to send in each slot
+static std::vector<size_t> BuildSchedule(std::vector<MixEntry> const& mix) {
+    unsigned total = 0;
+    for (MixEntry const& entry : mix) {
+        total += entry.weight;
+    }
+    std::vector<size_t> schedule;
+    std::vector<int64_t> current(mix.size(), 0);
+    for (unsigned slot = 0; slot < total; slot++) {
+        size_t best = 0;
+        for (size_t i = 0; i < mix.size(); i++) {
+            current[i] += mix[i].weight;
+            if (current[i] > current[best]) {
+                best = i;
+            }
+        }
+        current[best] -= total;
+        schedule.push_back(best);
+    }
+    return schedule;
+}
+
+class Sender {
+public:
+    Sender(SocketCan &bus, Options const& options, int64_t epoch_ns)
+            : bus_(bus), options_(options), schedule_(BuildSchedule(options.mix)), epoch_ns_(epoch_ns) {}
+
+    // Sends at rate for options.duration_s, on absolute deadlines so
+    // a late frame does not shift the ones after it
+    bool Run(double rate) {
+        int64_t period_ns = static_cast<int64_t>(1e9 / rate);
+        int64_t start_ns = MonotonicNowNs();
+        int64_t end_ns = start_ns + static_cast<int64_t>(options_.duration_s * 1e9);
+        int64_t next_ns = start_ns;
+        unsigned noise_credit = 0;
+        size_t slot = 0;
+
+        while (next_ns < end_ns) {
+            WaitUntil(next_ns);
+            can_frame frame = {};
+            noise_credit += options_.noise_percent;
+            bool noise = noise_credit >= 100;
+            if (noise) {
+                noise_credit -= 100;
+                frame.can_id = NOISE_CAN_ID;
+            } else {
+                frame.can_id = options_.mix[schedule_[slot]].can_id;
+                slot = (slot + 1) % schedule_.size();
+            }
+            if (frame.can_id > CAN_SFF_MASK) {
+                frame.can_id |= CAN_EFF_FLAG;
+            }
+            frame.can_dlc = CAN_MAX_DLEN;
+            uint64_t sent = static_cast<uint64_t>(RealtimeNowNs() - epoch_ns_);
+            uint64_t word = htole64((sent & TIMESTAMP_MASK) | ((sent >> TIMESTAMP_BITS) & TIMESTAMP_MASK) << TIMESTAMP_BITS);
+            std::memcpy(frame.data, &word, sizeof(word));
+
+            if (!Write(frame)) {
+                return false;
+            }
+            (noise ? noise_sent_ : sent_)++;
+            next_ns += period_ns;
+        }
+        send_ns_ = MonotonicNowNs() - start_ns;
+        return true;
+    }
+
+    uint64_t Sent() const { return sent_; }
+    uint64_t NoiseSent() const { return noise_sent_; }
+    uint64_t Stalls() const { return stalls_; }
+    int64_t SendNs() const { return send_ns_; }
+
+private:
+    static void WaitUntil(int64_t deadline_ns) {
+        int64_t remaining_ns = deadline_ns - MonotonicNowNs();
+        if (remaining_ns > SPIN_NS) {
+            int64_t wake_ns = deadline_ns - SPIN_NS;
+            timespec wake = {static_cast<time_t>(wake_ns / 1'000'000'000), static_cast<long>(wake_ns % 1'000'000'000)};
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, nullptr);
+        }
+        while (MonotonicNowNs() < deadline_ns) {
+        }
+    }
+
+    // Retries while the interface TX queue is full; the achieved rate then
+    // falls behind the target and the report shows it
+    bool Write(can_frame const& frame) {
+        while (write(bus_.GetFd(), &frame, sizeof(frame)) < 0) {
+            if (errno != ENOBUFS && errno != EAGAIN) {
+                std::fprintf(stderr, "%s: write failed: %s\n", TAG, std::strerror(errno));
+                return false;
+            }
+            stalls_++;
+            sched_yield();
+        }
+        return true;
+    }
+
+    SocketCan &bus_;
+    Options const& options_;
+    std::vector<size_t> schedule_;
+    int64_t epoch_ns_;
+    uint64_t sent_ = 0;
+    uint64_t noise_sent_ = 0;
+    uint64_t stalls_ = 0;
+    int64_t send_ns_ = 0;
+};
+
+static bool RunOnce(Options const& options, RealtimeConfig const& realtime, SignalDatabase const& database,
+                    double rate, RunResult &result) {
+    result = {};
+    result.scheduling = DescribeRealtime(realtime);
+    if (realtime.lock_memory && !LockMemory()) {
+        return false;
+    }
+    int64_t epoch_ns = RealtimeNowNs();
+    TimestampingDecoder decoder(database, epoch_ns);
+    BenchSink sink(epoch_ns, true);
+    Publisher publisher(sink, decoder.Messages(), decoder.MessageCount(), 0);
+    publisher.SetThreadConfig(realtime.publisher);
+    if (!publisher.Init()) {
+        return false;
+    }
+    publisher.Start();
+
+    EventLoop loop;
+    if (!loop.Init()) {
+        return false;
+    }
+    CanGateway gateway(loop, decoder, publisher);
+    gateway.SetSocketBuffers(options.rcvbuf_kib * 1024, 0);
+    if (!gateway.AddInterface(options.interface, options.backend)) {
+        return false;
+    }
+    std::thread reader([&loop, &realtime] {
+        ApplyThreadConfig(realtime.rx, "can-rx");
+        loop.Run();
+    });
+
+    SocketCan bus(options.interface);
+    bool sent = bus.Init();
+    Sender sender(bus, options, epoch_ns);
+    sent = sent && sender.Run(rate);
+
+    // Let the pipeline catch up: stop once nothing arrived for DRAIN_IDLE_NS
+    uint64_t last_frames = gateway.Stats().frames;
+    int64_t idle_since_ns = MonotonicNowNs();
+    while (MonotonicNowNs() - idle_since_ns < DRAIN_IDLE_NS) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        uint64_t frames = gateway.Stats().frames;
+        if (frames != last_frames) {
+            last_frames = frames;
+            idle_since_ns = MonotonicNowNs();
+        }
+    }
+    loop.Stop();
+    reader.join();
+    publisher.Stop();
+    if (realtime.lock_memory) {
+        UnlockMemory();
+    }
+    if (!sent) {
+        return false;
+    }
+
+    GatewayStats gateway_stats = gateway.Stats();
+    PublisherStats publisher_stats = publisher.Stats();
+    SinkStats sink_stats = sink.Stats();
+    result.target_fps = rate;
+    result.send_s = static_cast<double>(sender.SendNs()) / 1e9;
+    result.sent = sender.Sent();
+    result.noise_sent = sender.NoiseSent();
+    result.send_stalls = sender.Stalls();
+    result.received = gateway_stats.frames;
+    result.decoded = gateway_stats.decoded;
+    result.rx_queue_drops = gateway_stats.rx_queue_drops;
+    result.publisher_drops = publisher_stats.dropped;
+    uint64_t accounted = gateway_stats.frames + gateway_stats.rx_queue_drops;
+    result.lost = result.sent > accounted ? result.sent - accounted : 0;
+    result.values = sink_stats.values;
+    result.transactions = sink_stats.transactions;
+    result.rx = Summarize(decoder.Latency());
+    result.end_to_end = Summarize(sink.Latency());
+    return true;
+}
+
+static bool RunLog(Options const& options, MessageDecoder const& decoder, LogResult &result) {
+    CanLogReader log;
+    if (!log.Open(options.log)) {
+        return false;
+    }
+    BenchSink sink(RealtimeNowNs(), false);
+    Publisher publisher(sink, decoder.Messages(), decoder.MessageCount(), 0);
+    if (!publisher.Init()) {
+        return false;
+    }
+    publisher.Start();
+    // The loop is never run: ReplayLog drives the gateway from this thread
+    EventLoop loop;
+    CanGateway gateway(loop, decoder, publisher);
+    gateway.SetBatchDecode(options.batch_decode, options.batch_kernel);
+
+    int64_t start_ns = MonotonicNowNs();
+    for (unsigned pass = 0; pass < options.passes; pass++) {
+        log.Rewind();
+        gateway.ReplayLog(log, options.speed);
+    }
+    publisher.Stop();
+    int64_t elapsed_ns = MonotonicNowNs() - start_ns;
+
+    GatewayStats gateway_stats = gateway.Stats();
+    SinkStats sink_stats = sink.Stats();
+    result.format = log.Format();
+    result.elapsed_s = static_cast<double>(elapsed_ns) / 1e9;
+    result.frames = gateway_stats.frames;
+    result.decoded = gateway_stats.decoded;
+    result.skipped = log.Stats().skipped;
+    result.values = sink_stats.values;
+    result.transactions = sink_stats.transactions;
+    return true;
+}
+
+static void WriteLatency(FILE *out, char const* name, LatencySummary const& latency, bool last) {
+    std::fprintf(out,
+                 "        \"%s\": {\"count\": %" PRIu64 ", \"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, "
+                 "\"p99_9\": %.1f, \"max\": %.1f, \"jitter\": %.1f}%s\n",
+                 name, latency.count, latency.p50_us, latency.p90_us, latency.p99_us, latency.p999_us,
+                 latency.max_us, latency.jitter_us, last ? "" : ",");
+}
+
+// Enough about the build to tell apart results of different builds
+static void WriteBuild(FILE *out) {
+#ifdef NDEBUG
+    bool assertions = false;
+#else
+    bool assertions = true;
+#endif
+#ifdef __OPTIMIZE__
+    bool optimized = true;
+#else
+    bool optimized = false;
+#endif
+    std::fprintf(out, "  \"build\": {\"compiler\": \"%s\", \"optimized\": %s, \"assertions\": %s, \"log_min_level\": %d},\n",
+                 __VERSION__, optimized ? "true" : "false", assertions ? "true" : "false", CAN_LOG_MIN_LEVEL);
+}
+
+static void WriteLogJson(FILE *out, Options const& options, LogResult const& result) {
+    double elapsed_s = result.elapsed_s > 0 ? result.elapsed_s : 1;
+    std::fprintf(out, "{\n  \"benchmark\": \"can-bench\",\n  \"mode\": \"log\",\n");
+    WriteBuild(out);
+    std::fprintf(out,
+                 "  \"config\": {\"log\": \"%s\", \"format\": \"%s\", \"decoder\": \"%s\", \"speed\": %.3f, "
+                 "\"passes\": %u, \"batch_kernel\": \"%s\"},\n",
+                 options.log.c_str(), result.format == CanLogFormat::BINARY ? "binary" : "ascii",
+                 options.dbc.empty() ? "VehicleSignals" : options.dbc.c_str(), options.speed, options.passes,
+                 options.batch_decode ? KernelName(options.batch_kernel) : "none");
+    std::fprintf(out,
+                 "  \"result\": {\"elapsed_s\": %.6f, \"frames\": %" PRIu64 ", \"decoded\": %" PRIu64
+                 ", \"skipped\": %" PRIu64 ", \"fps\": %.1f, \"values\": %" PRIu64 ", \"transactions\": %" PRIu64
+                 "}\n}\n",
+                 result.elapsed_s, result.frames, result.decoded, result.skipped,
+                 static_cast<double>(result.frames) / elapsed_s, result.values, result.transactions);
+}
+
+static void WriteJson(FILE *out, Options const& options, std::vector<RunResult> const& runs) {
+    double max_sustained = 0;
+    for (RunResult const& run : runs) {
+        if (run.Drops() == 0 && run.target_fps > max_sustained) {
+            max_sustained = run.target_fps;
+        }
+    }
+
+    std::fprintf(out, "{\n  \"benchmark\": \"can-bench\",\n  \"mode\": \"vcan\",\n");
+    WriteBuild(out);
+    std::fprintf(out,
+                 "  \"config\": {\"interface\": \"%s\", \"backend\": \"%s\", \"duration_s\": %.3f, "
+                 "\"noise_percent\": %u, \"rcvbuf_kib\": %d, \"mix\": [",
+                 options.interface.c_str(), options.backend == RxBackend::PACKET_RING ? "packet_ring" : "socket",
+                 options.duration_s, options.noise_percent, options.rcvbuf_kib);
+    for (size_t i = 0; i < options.mix.size(); i++) {
+        std::fprintf(out, "%s{\"can_id\": %u, \"weight\": %u}", i == 0 ? "" : ", ",
+                     options.mix[i].can_id, options.mix[i].weight);
+    }
+    std::fprintf(out, "]},\n  \"runs\": [\n");
+    for (size_t i = 0; i < runs.size(); i++) {
+        RunResult const& run = runs[i];
+        double send_s = run.send_s > 0 ? run.send_s : 1;
+        std::fprintf(out, "    {\n");
+        std::fprintf(out, "      \"scheduling\": \"%s\",\n", run.scheduling.c_str());
+        std::fprintf(out, "      \"target_fps\": %.1f, \"send_fps\": %.1f, \"rx_fps\": %.1f,\n", run.target_fps,
+                     static_cast<double>(run.sent + run.noise_sent) / send_s, static_cast<double>(run.received) / send_s);
+        std::fprintf(out,
+                     "      \"sent\": %" PRIu64 ", \"noise_sent\": %" PRIu64 ", \"send_stalls\": %" PRIu64
+                     ", \"received\": %" PRIu64 ", \"decoded\": %" PRIu64 ",\n",
+                     run.sent, run.noise_sent, run.send_stalls, run.received, run.decoded);
+        std::fprintf(out,
+                     "      \"drops\": %" PRIu64 ", \"rx_queue_drops\": %" PRIu64 ", \"publisher_drops\": %" PRIu64
+                     ", \"lost\": %" PRIu64 ",\n",
+                     run.Drops(), run.rx_queue_drops, run.publisher_drops, run.lost);
+        std::fprintf(out, "      \"values\": %" PRIu64 ", \"transactions\": %" PRIu64 ",\n", run.values,
+                     run.transactions);
+        std::fprintf(out, "      \"latency_us\": {\n");
+        WriteLatency(out, "send_to_decode", run.rx, false);
+        WriteLatency(out, "send_to_publish", run.end_to_end, true);
+        std::fprintf(out, "      }\n    }%s\n", i + 1 == runs.size() ? "" : ",");
+    }
+    std::fprintf(out, "  ],\n  \"max_sustained_fps\": %.1f\n}\n", max_sustained);
+}
+
+static bool ParseMix(std::string const& text, std::vector<MixEntry> &mix) {
+    mix.clear();
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find(',', start);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+        std::string item = text.substr(start, end - start);
+        char *rest = nullptr;
+        unsigned long can_id = std::strtoul(item.c_str(), &rest, 0);
+        unsigned long weight = 1;
+        if (*rest == ':') {
+            weight = std::strtoul(rest + 1, &rest, 10);
+        }
+        if (*rest != '\0' || item.empty() || can_id > CAN_EFF_MASK || can_id == NOISE_CAN_ID ||
+            weight == 0 || weight > 1000) {
+            return false;
+        }
+        mix.push_back({static_cast<canid_t>(can_id), static_cast<unsigned>(weight)});
+        start = end + 1;
+    }
+    return !mix.empty();
+}
+
+static void Usage() {
+    std::fprintf(stderr,
+                 "Usage: can-bench [--rate=<fps>] [--duration=<s>] [--mix=<id>[:<weight>],...]\n"
+                 "                 [--noise=<percent>] [--sweep=<max fps>] [--step=<fps>]\n"
+                 "                 [--rx-ring] [--rx-priority=<1-99>] [--publisher-priority=<1-99>]\n"
+                 "                 [--rx-cpu=<n>] [--publisher-cpu=<n>] [--prefault-stack=<KiB>] [--mlock]\n"
+                 "                 [--compare-rt] [--rcvbuf=<KiB>] [--output=<file.json>] [interface]\n"
+                 "       can-bench --log=<candump.log|.bin> [--dbc=<file.dbc>] [--speed=<x>]\n"
+                 "                 [--passes=<n>] [--batch-decode[=<kernel>]] [--output=<file.json>]\n"
+                 "Sends timestamped frames on interface (default vcan0) through the gateway\n"
+                 "pipeline and reports throughput, drops and latency as JSON. With --sweep the\n"
+                 "rate is raised by --step until frames are dropped or <max fps> is reached.\n"
+                 "--rx-ring reads through the PF_PACKET ring instead of a CAN_RAW socket.\n"
+                 "The real-time options schedule the gateway threads as can2vhal does;\n"
+                 "--compare-rt runs every rate with and without them (default: RX thread\n"
+                 "SCHED_FIFO 50 and --mlock) and reports the latency jitter of both.\n"
+                 "--rcvbuf sizes the gateway socket receive buffer (SO_RCVBUFFORCE when\n"
+                 "permitted); sweep it to find the smallest size without rx_queue_drops.\n"
+                 "With --log a recorded log is decoded and published instead, as fast as\n"
+                 "possible (--speed=0, default) or at <x> times its original timing.\n"
+                 "--batch-decode decodes it with the batch decoder instead of frame by frame,\n"
+                 "with the widest kernel of the CPU or <kernel> (scalar, sse2, avx2, neon).\n");
+}
+
+static bool ParseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&arg](char const* option) -> char const* {
+            size_t length = std::strlen(option);
+            return arg.compare(0, length, option) == 0 ? arg.c_str() + length : nullptr;
+        };
+        char const* v;
+        bool valid = true;
+        if (ParseRealtimeOption(arg, options.realtime, valid)) {
+            if (!valid) {
+                return false;
+            }
+        } else if (arg == "--compare-rt") {
+            options.compare_rt = true;
+        } else if ((v = value("--rate=")) != nullptr) {
+            options.rate = std::atof(v);
+        } else if ((v = value("--duration=")) != nullptr) {
+            options.duration_s = std::atof(v);
+        } else if ((v = value("--mix=")) != nullptr) {
+            if (!ParseMix(v, options.mix)) {
+                return false;
+            }
+        } else if ((v = value("--noise=")) != nullptr) {
+            options.noise_percent = static_cast<unsigned>(std::atoi(v));
+        } else if ((v = value("--sweep=")) != nullptr) {
+            options.sweep_max = std::atof(v);
+        } else if ((v = value("--step=")) != nullptr) {
+            options.sweep_step = std::atof(v);
+        } else if ((v = value("--output=")) != nullptr) {
+            options.output = v;
+        } else if ((v = value("--log=")) != nullptr) {
+            options.log = v;
+        } else if ((v = value("--dbc=")) != nullptr) {
+            options.dbc = v;
+        } else if ((v = value("--speed=")) != nullptr) {
+            options.speed = std::atof(v);
+        } else if ((v = value("--passes=")) != nullptr) {
+            options.passes = static_cast<unsigned>(std::atoi(v));
+        } else if ((v = value("--rcvbuf=")) != nullptr) {
+            int bytes = 0;
+            if (!ParseBufferSizeOption(v, bytes)) {
+                return false;
+            }
+            options.rcvbuf_kib = bytes / 1024;
+        } else if (arg == "--batch-decode") {
+            options.batch_decode = true;
+        } else if ((v = value("--batch-decode=")) != nullptr) {
+            options.batch_decode = true;
+            if (!ParseKernelName(v, options.batch_kernel) || !KernelSupported(options.batch_kernel)) {
+                return false;
+            }
+        } else if (arg == "--rx-ring") {
+            options.backend = RxBackend::PACKET_RING;
+        } else if (arg.rfind("--", 0) == 0) {
+            return false;
+        } else {
+            options.interface = arg;
+        }
+    }
+    if (options.sweep_max > 0 && options.sweep_step <= 0) {
+        options.sweep_step = options.rate;
+    }
+    if (options.compare_rt && options.realtime.IsDefault()) {
+        options.realtime.rx.fifo_priority = DEFAULT_RX_PRIORITY;
+        options.realtime.lock_memory = true;
+    }
+    return options.rate > 0 && options.duration_s > 0 && options.noise_percent < 100 && options.speed >= 0 &&
+           options.passes > 0;
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        Usage();
+        return 2;
+    }
+    FILE *out = nullptr;
+    auto open_output = [&options, &out] {
+        out = options.output.empty() ? stdout : std::fopen(options.output.c_str(), "w");
+        if (out == nullptr) {
+            std::fprintf(stderr, "%s: cannot write %s\n", TAG, options.output.c_str());
+        }
+        return out != nullptr;
+    };
+
+    if (!options.log.empty()) {
+        SignalDatabase database;
+        StaticDecoder<VehicleSignals> static_decoder;
+        if (!options.dbc.empty() && !database.Load(options.dbc, "")) {
+            std::fprintf(stderr, "%s: failed to load %s\n", TAG, options.dbc.c_str());
+            return 1;
+        }
+        MessageDecoder const& decoder =
+                options.dbc.empty() ? static_cast<MessageDecoder const&>(static_decoder) : database;
+        LogResult result = {};
+        if (!RunLog(options, decoder, result) || !open_output()) {
+            return 1;
+        }
+        WriteLogJson(out, options, result);
+        if (out != stdout) {
+            std::fclose(out);
+        }
+        return 0;
+    }
+
+    if (if_nametoindex(options.interface.c_str()) == 0) {
+        std::fprintf(stderr, "%s: interface %s not found\n", TAG, options.interface.c_str());
+        return 1;
+    }
+
+    SignalDatabase database;
+    if (!database.Build(BenchDatabase(options.mix))) {
+        std::fprintf(stderr, "%s: invalid frame mix\n", TAG);
+        return 1;
+    }
+
+    // --compare-rt: the same rate as plain CFS threads, then in real-time mode
+    std::vector<RealtimeConfig> modes;
+    if (options.compare_rt) {
+        modes.push_back(RealtimeConfig{});
+    }
+    modes.push_back(options.realtime);
+
+    std::vector<RunResult> runs;
+    double rate = options.rate;
+    bool dropped = false;
+    do {
+        for (RealtimeConfig const& realtime : modes) {
+            RunResult result;
+            if (!RunOnce(options, realtime, database, rate, result)) {
+                std::fprintf(stderr, "%s: run at %.0f fps (%s) failed\n", TAG, rate, result.scheduling.c_str());
+                return 1;
+            }
+            runs.push_back(result);
+            std::fprintf(stderr,
+                         "%s: %.0f fps (%s): received %" PRIu64 "/%" PRIu64 ", drops %" PRIu64
+                         ", send->publish p50 %.1f us, jitter %.1f us\n",
+                         TAG, rate, result.scheduling.c_str(), result.received, result.sent, result.Drops(),
+                         result.end_to_end.p50_us, result.end_to_end.jitter_us);
+            dropped = dropped || result.Drops() > 0;
+        }
+        rate += options.sweep_step;
+    } while (!dropped && options.sweep_max > 0 && rate <= options.sweep_max);
+
+    if (!open_output()) {
+        return 1;
+    }
+    WriteJson(out, options, runs);
+    if (out != stdout) {
+        std::fclose(out);
+    }
+    return 0;
+}
@@ -12,55 +12,59 @@
 #include <memory>
 #include <iostream>
 #include <iomanip>
+#include <array>
+#include <vector>
+#include <string>
+#include <unordered_map>
 #include <endian.h>
 
 #include <aidl/android/hardware/automotive/vehicle/BnVehicle.h>
 #include <AidlVhalClient.h>
 
-#include "SocketCan.h"
-#define DEBUG_SOCKET_CAN
-#include "Logging.h"
+#include "socket_can.h"
+#include "event_loop.h"
+#include "vehicle_signals.h"
+#include "logging.h"
 #include <byteswap.h>
 
 constexpr static char AIDL_VHAL_SERVICE[] = "android.hardware.automotive.vehicle.IVehicle/default";
 constexpr static char TAG[] = "VHAL_SOCKET";
 
-constexpr static int TEMPERATURE_CAN_ID = 0x124;
-constexpr static int PROP_INFO_TEMPERATURE = 291508224;
-constexpr static int PROP_FAULT_CODE_TEMPERATURE = 286265345;
-
-constexpr static int ACCELEROMETER_CAN_ID = 0x123;
-constexpr static int PROP_INFO_ACCELEROMETER = 289476610;
-constexpr static int PROP_FAULT_CODE_ACCELEROMETER = 286265347;
-
-// 10.0 ºC = 0x00002041 -> Works
-// -273.15 ºC = 0x339388c30000 -> Works
-float BytesToFloat(uint8_t *bytes) {
-    //Funcionou
-    // float f;
-    // uint32_t value = __builtin_bswap32(*(uint32_t *)bytes); // RPI4B é little endian. Essa função converte para big endian
-    // value = htobe32(value); // Converte host byte order para big endian
-    // std::memcpy(&f, &value, sizeof(float));
-    // return f;
-
-    //Funcionou também
-    float f;
-    std::memcpy(&f, bytes, sizeof(float));
-    return f;
-}
+using ::tcc::aaos::can::MessageInfo;
+using ::tcc::aaos::can::PropertyType;
+using ::tcc::aaos::can::VehicleSignals;
 
 using ::android::frameworks::automotive::vhal::IVhalClient;
 using ::android::sp;
 
-int main() {
-    
-    tcc::aaos::can::SocketCan socket_can;
-    if(!socket_can.Init()) {
-        ALOG(LOG_ERROR, TAG, "Failed to initialize CAN interface");
-        std::cout << "Failed to initialize CAN interface" << std::endl;
+int main(int argc, char **argv) {
+
+    // Interfaces CAN: argumentos da linha de comando ou "can0"
+    std::vector<std::string> interfaces(argv + 1, argv + argc);
+    if (interfaces.empty()) {
+        interfaces.push_back("can0");
+    }
+
+    tcc::aaos::can::EventLoop loop;
+    if (!loop.Init()) {
+        ALOG(LOG_ERROR, TAG, "Failed to initialize event loop");
+        std::cout << "Failed to initialize event loop" << std::endl;
         return 1;
     }
 
+    std::vector<std::unique_ptr<tcc::aaos::can::SocketCan>> sockets;
+    for (auto const& interface : interfaces) {
+        auto socket_can = std::make_unique<tcc::aaos::can::SocketCan>(interface);
+        // IDs da tabela de sinais; usados também como CAN_RAW_FILTER
+        socket_can->SetFilters(VehicleSignals::Filters());
+        if (!socket_can->Init() || !socket_can->SetNonBlocking(true)) {
+            ALOG(LOG_ERROR, TAG, "Failed to initialize CAN interface %s", interface.c_str());
+            std::cout << "Failed to initialize CAN interface " << interface << std::endl;
+            return 1;
+        }
+        sockets.push_back(std::move(socket_can));
+    }
+
     ALOG(LOG_VERBOSE, TAG, "CAN interface up");
     std::cout << "CAN interface up" << std::endl;
 
@@ -88,76 +92,87 @@ int main() {
     ALOG(LOG_VERBOSE, TAG, "VHAL client is AIDL");
     std::cout << "VHAL client is AIDL" << std::endl;
 
-    struct can_frame frame;
+    // Um valor de propriedade por entrada da tabela de sinais
+    std::unordered_map<int32_t, std::unique_ptr<::android::frameworks::automotive::vhal::IHalPropValue>> prop_values;
+    for (MessageInfo const& message : VehicleSignals::MESSAGES_INFO) {
+        std::vector<int32_t> prop_ids;
+        for (size_t i = 0; i < message.property_count; i++) {
+            prop_ids.push_back(message.properties[i].prop_id);
+        }
+        if (message.fault != nullptr) {
+            prop_ids.push_back(message.fault->prop_id);
+        }
+        for (int32_t prop_id : prop_ids) {
+            prop_values[prop_id] = vhal_client->createHalPropValue(prop_id);
+            if (prop_values[prop_id] == nullptr) {
+                ALOG(LOG_ERROR, TAG, "Failed to create HAL property value");
+                std::cout << "Failed to create HAL property value" << std::endl;
+                return 1;
+            }
+        }
+    }
 
-    auto acc_axes = vhal_client->createHalPropValue(PROP_INFO_ACCELEROMETER);
-    auto acc_fault = vhal_client->createHalPropValue(PROP_FAULT_CODE_ACCELEROMETER);
-    auto temp = vhal_client->createHalPropValue(PROP_INFO_TEMPERATURE);
-    auto temp_fault = vhal_client->createHalPropValue(PROP_FAULT_CODE_TEMPERATURE);
+    std::array<tcc::aaos::can::CanRxFrame, tcc::aaos::can::MAX_RX_BATCH> rx_batch;
+
+    auto handle_frame = [&](canfd_frame const& frame) {
+        // std::cout << "0x" << std::setfill('0') << std::setw(3) << std::uppercase << std::hex << frame.can_id;
+        // std::cout << "\t[" << static_cast<int>(frame.len) << "]\t";
+        // for (int i = 0; i < frame.len; i++) {
+        //     std::cout << std::setfill('0') << std::setw(2) << static_cast<int>(frame.data[i]);
+        //     (i < frame.len - 1) ? std::cout << " " : std::cout << "";
+        // }
+        // std::cout << std::endl;
+
+        tcc::aaos::can::DecodedSamples samples;
+        size_t sample_count = VehicleSignals::Decode(frame, samples);
+        if (sample_count == 0) {
+            return;
+        }
+        // setValueSync é síncrono: de um frame CAN FD com várias amostras
+        // publica só a mais recente
+        tcc::aaos::can::DecodedFrame const& decoded = samples[sample_count - 1];
+        MessageInfo const& message = VehicleSignals::MESSAGES_INFO[decoded.message];
 
-    if (acc_axes == nullptr || acc_fault == nullptr || temp == nullptr || temp_fault == nullptr) {
-        ALOG(LOG_ERROR, TAG, "Failed to create HAL property value");
-        std::cout << "Failed to create HAL property value" << std::endl;
-        return 1;
-    }
+        for (size_t i = 0; i < message.signal_count; i++) {
+            CAN_LOG(DEBUG, TAG, "%s: %f", message.signals[i].name, decoded.values[i]);
+        }
 
-    int16_t axis_x = 0;
-    int16_t axis_y = 0;
-    int16_t axis_z = 0;
-    float temperature = 0;
-
-    while (1) {
-
-        if(!socket_can.ReadCanMessage(frame)) {
-            ALOG(LOG_ERROR, TAG, "Failed to read CAN message");
-            LOG_CAN_ERROR(TAG, "Failed to read CAN message");
-        } else {
-            // std::cout << "0x" << std::setfill('0') << std::setw(3) << std::uppercase << std::hex << frame.can_id;
-            // std::cout << "\t[" << static_cast<int>(frame.can_dlc) << "]\t";
-            // for (int i = 0; i < frame.can_dlc; i++) {
-            //     std::cout << std::setfill('0') << std::setw(2) << static_cast<int>(frame.data[i]);
-            //     (i < frame.can_dlc - 1) ? std::cout << " " : std::cout << "";
-            // }
-            // std::cout << std::endl;
-
-            switch (frame.can_id) {
-                case ACCELEROMETER_CAN_ID: {
-                    axis_x = (frame.data[0] << 8) | frame.data[1];
-                    axis_y = (frame.data[2] << 8) | frame.data[3];
-                    axis_z = (frame.data[4] << 8) | frame.data[5];
-                    ALOG(LOG_INFO, TAG, "Axis X: %d, Axis Y: %d", axis_x, axis_y);
-                    std::cout << std::dec << "Axis X: " << axis_x << ", Axis Y: " << axis_y << ", Axis Z: " << axis_z << std::endl;
-                    acc_axes->setInt32Values({axis_x, axis_y, axis_z});
-                    vhal_client->setValueSync(*acc_axes);
-
-                    if(axis_x == 0 && axis_y == 0 && axis_z == 0) {
-                        acc_fault->setStringValue("ACC-E1");
-                        vhal_client->setValueSync(*acc_fault);
-                    } else {
-                        acc_fault->setStringValue("ACC-0");
-                        vhal_client->setValueSync(*acc_fault);
-                    }
-                    break;
-                }
-                case TEMPERATURE_CAN_ID: {
-                    temperature = BytesToFloat(frame.data);
-                    ALOG(LOG_INFO, TAG, "Temperature: %f", temperature);
-                    std::cout << std::dec << "Temperature: " << temperature << std::endl;
-                    temp->setFloatValues({temperature});
-                    vhal_client->setValueSync(*temp);
-                    if (temperature <= -273) {
-                        temp_fault->setStringValue("TMP-E1");
-                        vhal_client->setValueSync(*temp_fault);
-                    } else {
-                        temp_fault->setStringValue("TMP-0");
-                        vhal_client->setValueSync(*temp_fault);
-                    }
-                    break;
-                }
-                default:
-                    break;
+        // Leitura de falha do sensor: o valor sentinela é publicado junto com o
+        // código de falha, o app detecta a falha por ele
+        bool fault = message.fault != nullptr && message.fault->IsFault(decoded.values.data(), message.signal_count);
+        for (size_t i = 0; i < message.property_count; i++) {
+            auto const& property = message.properties[i];
+            auto &prop_value = *prop_values[property.prop_id];
+            double const* values = &decoded.values[property.first_signal];
+            if (tcc::aaos::can::TypeOf(property.prop_id) == PropertyType::FLOAT ||
+                tcc::aaos::can::TypeOf(property.prop_id) == PropertyType::FLOAT_VEC) {
+                prop_value.setFloatValues(std::vector<float>(values, values + property.signal_count));
+            } else {
+                prop_value.setInt32Values(std::vector<int32_t>(values, values + property.signal_count));
             }
+            vhal_client->setValueSync(prop_value);
         }
-
+        if (message.fault != nullptr) {
+            auto &fault_value = *prop_values[message.fault->prop_id];
+            fault_value.setStringValue(fault ? message.fault->fault_code : message.fault->ok_code);
+            vhal_client->setValueSync(fault_value);
+        }
+    };
+
+    for (auto &socket_can : sockets) {
+        tcc::aaos::can::SocketCan *bus = socket_can.get();
+        loop.AddFd(bus->GetFd(), [&, bus](uint32_t) {
+            int count = bus->ReadCanMessages(rx_batch.data(), rx_batch.size());
+            if (count < 0) {
+                LOG_CAN_ERROR(TAG, "Failed to read CAN message");
+                return;
+            }
+            for (int i = 0; i < count; i++) {
+                handle_frame(rx_batch[i].frame);
+            }
+        });
     }
+
+    loop.Run();
+    return 0;
 }
\ No newline at end of file
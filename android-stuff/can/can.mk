@@ -1,4 +1,5 @@
 PRODUCT_PACKAGES += \
+	can2vhal \
 	candump \
 	cansend \
 	can-calc-bit-timing \
@@ -27,4 +28,5 @@ PRODUCT_COPY_FILES += \
 	$(LOCAL_PATH)/modules/can-dev.ko:$(TARGET_COPY_OUT_VENDOR)/lib/modules/can-dev.ko \
 	$(LOCAL_PATH)/modules/spi-bcm2835.ko:$(TARGET_COPY_OUT_VENDOR)/lib/modules/spi-bcm2835.ko \
 	$(LOCAL_PATH)/modules/can.ko:$(TARGET_COPY_OUT_VENDOR)/lib/modules/can.ko \
-	$(LOCAL_PATH)/modules/can-raw.ko:$(TARGET_COPY_OUT_VENDOR)/lib/modules/can-raw.ko
+	$(LOCAL_PATH)/modules/can-raw.ko:$(TARGET_COPY_OUT_VENDOR)/lib/modules/can-raw.ko \
+	$(LOCAL_PATH)/signals/vehicle.dbc:$(TARGET_COPY_OUT_VENDOR)/etc/can/vehicle.dbc
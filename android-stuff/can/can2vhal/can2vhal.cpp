@@ -12,47 +12,291 @@
 #include <memory>
 #include <iostream>
 #include <iomanip>
+#include <array>
+#include <vector>
+#include <utility>
+#include <string>
+#include <cstdlib>
+#include <cstring>
 
+#include <aidl/android/hardware/automotive/vehicle/VehicleArea.h>
 #include <aidl/android/hardware/automotive/vehicle/VehicleProperty.h>
+#include <aidl/android/hardware/automotive/vehicle/VehiclePropertyGroup.h>
+#include <aidl/android/hardware/automotive/vehicle/VehiclePropertyType.h>
 #include <VehicleUtils.h>
 #include <aidl/android/hardware/automotive/vehicle/BnVehicle.h>
 #include <AidlVhalClient.h>
 
-#define DEBUG_SOCKET_CAN
 #include "logging.h"
-#include "socket_can.h"
+#include "can_gateway.h"
+#include "can_log.h"
+#include "can_transmitter.h"
+#include "command_encoder.h"
+#include "event_loop.h"
+#include "metrics.h"
+#include "publisher.h"
+#include "realtime.h"
+#include "signal_database.h"
+#include "vehicle_signals.h"
+#include "vhal_command_source.h"
+#include "vhal_property_sink.h"
 
 constexpr static char AIDL_VHAL_SERVICE[] = "android.hardware.automotive.vehicle.IVehicle/default";
 constexpr static char TAG[] = "VHAL_SOCKET";
+constexpr static int64_t LATENCY_REPORT_INTERVAL_NS = 10'000'000'000;
+// Onde o banco DBC compilado é guardado entre reinícios (/vendor é somente leitura)
+constexpr static char DBC_CACHE_DIR[] = "/data/vendor/can2vhal";
+constexpr static char DBC_OPTION[] = "--dbc=";
+constexpr static char DBC_CACHE_OPTION[] = "--dbc-cache=";
+constexpr static char LOG_OPTION[] = "--log=";
+constexpr static char REPLAY_SPEED_OPTION[] = "--replay-speed=";
+constexpr static char RX_RING_OPTION[] = "--rx-ring";
+constexpr static char BATCH_DECODE_OPTION[] = "--batch-decode";
+constexpr static int64_t BUS_STATS_PERIOD_NS = 10'000'000'000;
+// Socket Unix das métricas; --metrics-socket= vazio desliga o servidor
+constexpr static char METRICS_SOCKET[] = "/data/vendor/can2vhal/metrics.sock";
+constexpr static char METRICS_SOCKET_OPTION[] = "--metrics-socket=";
+constexpr static char DUMP_OPTION[] = "--dump";
+constexpr static char RCVBUF_OPTION[] = "--rcvbuf=";
+constexpr static char SNDBUF_OPTION[] = "--sndbuf=";
+constexpr static char ISOTP_OPTION[] = "--isotp=";
+constexpr static char FUSION_OPTION[] = "--fusion=";
+constexpr static char TX_OPTION[] = "--tx=";
 
-constexpr static int TEMPERATURE_CAN_ID = 0x124;
-constexpr static int ACCELEROMETER_CAN_ID = 0x123;
-
+using ::aidl::android::hardware::automotive::vehicle::VehicleArea;
 using ::aidl::android::hardware::automotive::vehicle::VehicleProperty;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropertyGroup;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropertyType;
 using ::android::hardware::automotive::vehicle::toInt;
+using ::tcc::aaos::can::VehicleCommands;
+using ::tcc::aaos::can::VehicleSignals;
 
-// Transforma um array de bytes em um float
-float BytesToFloat(uint8_t *bytes) {
-    float f;
-    std::memcpy(&f, bytes, sizeof(float));
-    return f;
-}
+// A tabela de sinais não depende dos headers do AIDL; garante que os IDs batem
+static_assert(tcc::aaos::can::INFO_TEMPERATURE_DHT22 == toInt(VehicleProperty::INFO_TEMPERATURE_DHT22));
+static_assert(tcc::aaos::can::FAULT_CODE_TEMPERATURE_DHT22 ==
+              toInt(VehicleProperty::FAULT_CODE_TEMPERATURE_DHT22));
+static_assert(tcc::aaos::can::INFO_ACCELEROMETER_MPU6050 ==
+              toInt(VehicleProperty::INFO_ACCELEROMETER_MPU6050));
+static_assert(tcc::aaos::can::FAULT_CODE_ACCELEROMETER_MPU6050 ==
+              toInt(VehicleProperty::FAULT_CODE_ACCELEROMETER_MPU6050));
+// Os CONTROL_* ficam fora do enum (o DefaultConfig.h do patch os declara pelo
+// ID, sem mexer na API AIDL congelada); confere ao menos a composição do ID
+constexpr static int32_t VENDOR_GLOBAL_INT32 = toInt(VehiclePropertyGroup::VENDOR) | toInt(VehicleArea::GLOBAL) |
+                                               toInt(VehiclePropertyType::INT32);
+static_assert(tcc::aaos::can::CONTROL_SELF_TEST == (0x1004 | VENDOR_GLOBAL_INT32));
+static_assert(tcc::aaos::can::CONTROL_SAMPLE_RATE_MPU6050 == (0x1005 | VENDOR_GLOBAL_INT32));
 
 using ::android::frameworks::automotive::vhal::IVhalClient;
 using ::android::sp;
+using ::tcc::aaos::can::DecimationMode;
+
+// Como cada propriedade é reduzida ao seu maxSampleRate e quanto um valor
+// numérico precisa mudar para ser republicado. O acelerômetro usa média para
+// a decimação não gerar aliasing; o DHT22 muda devagar o suficiente para a
+// última leitura ser representativa, e sua resolução é 0.1 ºC. Propriedades
+// fora da tabela usam LATEST sem deadband.
+struct PropertyPolicy {
+    int32_t prop_id;
+    DecimationMode mode;
+    double deadband;
+};
+constexpr static PropertyPolicy PROPERTY_POLICIES[] = {
+    {tcc::aaos::can::INFO_ACCELEROMETER_MPU6050, DecimationMode::AVERAGE, 0},
+    {tcc::aaos::can::INFO_TEMPERATURE_DHT22, DecimationMode::LATEST, 0.1},
+};
+
+// Junção padrão do --fusion: os três eixos do acelerômetro (0x123 e as
+// rajadas 0x125) e a temperatura (0x124), que muda devagar e é enviada com
+// pouca frequência, por isso a janela bem maior
+static tcc::aaos::can::FusionConfig DefaultFusion() {
+    tcc::aaos::can::FusionConfig config;
+    for (uint8_t axis = 0; axis < 3; axis++) {
+        config.inputs.push_back({tcc::aaos::can::INFO_ACCELEROMETER_MPU6050, axis, 20'000'000});
+    }
+    config.inputs.push_back({tcc::aaos::can::INFO_TEMPERATURE_DHT22, 0, 5'000'000'000});
+    return config;
+}
+
+int main(int argc, char **argv) {
 
-int main() {
-    
-    tcc::aaos::can::SocketCan socket_can("can0");
-    // Inicialização do socket CAN
-    if(!socket_can.Init()) {
-        ALOG(LOG_ERROR, TAG, "Failed to initialize socket CAN");
-        std::cout << "Failed to initialize socket CAN" << std::endl;
+    // Uso: can2vhal [--dbc=<arquivo.dbc>] [--dbc-cache=<arquivo>]
+    //                 [--log=<candump.log|.bin> [--replay-speed=<x>]] [--rx-ring] [--batch-decode]
+    //                 [--rcvbuf=<KiB>] [--sndbuf=<KiB>]
+    //                 [--isotp=<if>:<rx_id>:<tx_id>:<msg_id>[:<bs>[:<stmin_us>[:fd]]]...]
+    //                 [--fusion=<período_ms>[:hold|nearest|linear]]
+    //                 [--tx=<if>[:<intervalo_us>[:<rajada>]]]
+    //                 [--metrics-socket=<caminho>] [--dump[=metrics|fusion]] [interface...]
+    // Interfaces CAN atendidas: argumentos da linha de comando ou "can0".
+    // Com --log os frames vêm de um log gravado em vez do barramento:
+    // --replay-speed=1 (padrão) mantém o tempo original, 0 reproduz o mais
+    // rápido possível. --rx-ring lê os barramentos pelo ring PF_PACKET
+    // mapeado em memória em vez de sockets CAN_RAW (barramentos muito carregados).
+    // --batch-decode decodifica cada lote agrupando os frames por ID, com
+    // SIMD (NEON no Pi) sobre os sinais de cada mensagem; mesmo resultado.
+    // Modo tempo real (passado pelo serviço em init.can.rc): --rx-priority=<1-99>,
+    // --publisher-priority=<1-99>, --rx-cpu=<n>, --publisher-cpu=<n>,
+    // --prefault-stack=<KiB> e --mlock; veja realtime.h.
+    // --rcvbuf/--sndbuf dimensionam os buffers dos sockets CAN_RAW (com
+    // CAP_NET_ADMIN acima de net.core.rmem_max); descartes do kernel
+    // aparecem no log e nas métricas (kernel_drops), que servem de base
+    // para o tamanho.
+    // --isotp (repetível) abre um canal ISO-TP: o nó envia em rx_id PDUs
+    // formadas por registros da mensagem msg_id (IDs em hexadecimal), com
+    // controle de fluxo em tx_id, block size bs e separação mínima stmin_us.
+    // Exige CONFIG_CAN_ISOTP no kernel.
+    // --fusion alinha aceleração e temperatura pelo instante de recepção:
+    // a cada período um snapshot com todos os valores no mesmo instante
+    // (interpolação linear por padrão), lido inteiro com --dump=fusion.
+    // --tx liga o caminho inverso: valores que os apps escrevem nas
+    // propriedades CONTROL_* viram frames de comando (VehicleCommands)
+    // enviados em if; não combina com --log. A fila de TX segue a prioridade
+    // de arbitragem do CAN, substitui comandos ainda não enviados do mesmo ID
+    // e limita o ritmo a uma rajada de <rajada> frames seguida de um a cada
+    // <intervalo_us> (padrão 4 e 1000 us), para uma sequência de comandos não
+    // tomar o barramento dos sensores.
+    // Métricas: --metrics-socket=<caminho> (padrão METRICS_SOCKET). Com
+    // "--dump" ou "--dump=metrics" o processo não sobe o gateway: consulta a
+    // instância em execução pelo socket, imprime a resposta e sai.
+    std::vector<std::string> interfaces;
+    std::string dbc_path;
+    std::string dbc_cache_path;
+    std::string log_path;
+    double replay_speed = 1.0;
+    auto rx_backend = tcc::aaos::can::RxBackend::SOCKET;
+    bool batch_decode = false;
+    tcc::aaos::can::RealtimeConfig realtime;
+    std::string metrics_socket = METRICS_SOCKET;
+    std::string dump_command;
+    int receive_buffer = 0;
+    int send_buffer = 0;
+    std::vector<std::pair<std::string, tcc::aaos::can::IsoTpConfig>> isotp_channels;
+    bool fusion_enabled = false;
+    tcc::aaos::can::FusionConfig fusion_config = DefaultFusion();
+    std::string tx_interface;
+    tcc::aaos::can::TxConfig tx_config;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool valid = true;
+        if (tcc::aaos::can::ParseRealtimeOption(arg, realtime, valid)) {
+            if (!valid) {
+                ALOG(LOG_ERROR, TAG, "Invalid option %s", arg.c_str());
+                std::cout << "Invalid option " << arg << std::endl;
+                return 1;
+            }
+        } else if (arg.rfind(DBC_OPTION, 0) == 0) {
+            dbc_path = arg.substr(std::strlen(DBC_OPTION));
+        } else if (arg.rfind(DBC_CACHE_OPTION, 0) == 0) {
+            dbc_cache_path = arg.substr(std::strlen(DBC_CACHE_OPTION));
+        } else if (arg.rfind(LOG_OPTION, 0) == 0) {
+            log_path = arg.substr(std::strlen(LOG_OPTION));
+        } else if (arg.rfind(REPLAY_SPEED_OPTION, 0) == 0) {
+            replay_speed = std::atof(arg.c_str() + std::strlen(REPLAY_SPEED_OPTION));
+        } else if (arg.rfind(METRICS_SOCKET_OPTION, 0) == 0) {
+            metrics_socket = arg.substr(std::strlen(METRICS_SOCKET_OPTION));
+        } else if (arg == DUMP_OPTION) {
+            dump_command = "dump";
+        } else if (arg.rfind(std::string(DUMP_OPTION) + "=", 0) == 0) {
+            dump_command = arg.substr(std::strlen(DUMP_OPTION) + 1);
+        } else if (arg.rfind(ISOTP_OPTION, 0) == 0) {
+            std::string isotp_interface;
+            tcc::aaos::can::IsoTpConfig isotp;
+            if (!tcc::aaos::can::ParseIsoTpOption(arg.substr(std::strlen(ISOTP_OPTION)), isotp_interface, isotp)) {
+                ALOG(LOG_ERROR, TAG, "Invalid option %s", arg.c_str());
+                std::cout << "Invalid option " << arg << std::endl;
+                return 1;
+            }
+            isotp_channels.emplace_back(isotp_interface, isotp);
+        } else if (arg.rfind(FUSION_OPTION, 0) == 0) {
+            if (!tcc::aaos::can::ParseFusionOption(arg.substr(std::strlen(FUSION_OPTION)), fusion_config)) {
+                ALOG(LOG_ERROR, TAG, "Invalid option %s", arg.c_str());
+                std::cout << "Invalid option " << arg << std::endl;
+                return 1;
+            }
+            fusion_enabled = true;
+        } else if (arg.rfind(TX_OPTION, 0) == 0) {
+            if (!tcc::aaos::can::ParseTxOption(arg.substr(std::strlen(TX_OPTION)), tx_interface, tx_config)) {
+                ALOG(LOG_ERROR, TAG, "Invalid option %s", arg.c_str());
+                std::cout << "Invalid option " << arg << std::endl;
+                return 1;
+            }
+        } else if (arg.rfind(RCVBUF_OPTION, 0) == 0) {
+            if (!tcc::aaos::can::ParseBufferSizeOption(arg.substr(std::strlen(RCVBUF_OPTION)), receive_buffer)) {
+                ALOG(LOG_ERROR, TAG, "Invalid option %s", arg.c_str());
+                std::cout << "Invalid option " << arg << std::endl;
+                return 1;
+            }
+        } else if (arg.rfind(SNDBUF_OPTION, 0) == 0) {
+            if (!tcc::aaos::can::ParseBufferSizeOption(arg.substr(std::strlen(SNDBUF_OPTION)), send_buffer)) {
+                ALOG(LOG_ERROR, TAG, "Invalid option %s", arg.c_str());
+                std::cout << "Invalid option " << arg << std::endl;
+                return 1;
+            }
+        } else if (arg == BATCH_DECODE_OPTION) {
+            batch_decode = true;
+        } else if (arg == RX_RING_OPTION) {
+            rx_backend = tcc::aaos::can::RxBackend::PACKET_RING;
+        } else {
+            interfaces.push_back(arg);
+        }
+    }
+    // O replay substitui o barramento; os comandos não teriam para onde ir
+    if (!tx_interface.empty() && !log_path.empty()) {
+        ALOG(LOG_ERROR, TAG, "--tx cannot be combined with --log");
+        std::cout << "--tx cannot be combined with --log" << std::endl;
         return 1;
     }
+    if (interfaces.empty()) {
+        interfaces.push_back("can0");
+    }
 
-    ALOG(LOG_VERBOSE, TAG, "Socket CAN initialized");
-    std::cout << "Socket CAN initialized" << std::endl;
+    if (!dump_command.empty()) {
+        std::string reply;
+        if (!tcc::aaos::can::QueryMetrics(metrics_socket, dump_command, reply)) {
+            std::cout << "can2vhal is not serving metrics on " << metrics_socket << std::endl;
+            return 1;
+        }
+        std::cout << reply;
+        return 0;
+    }
+
+    // Sem --dbc usa a tabela compilada (VehicleSignals); com --dbc carrega o banco em tempo de execução
+    tcc::aaos::can::SignalDatabase database;
+    bool use_database = !dbc_path.empty();
+    if (use_database) {
+        if (dbc_cache_path.empty()) {
+            dbc_cache_path = std::string(DBC_CACHE_DIR) + "/" +
+                             dbc_path.substr(dbc_path.find_last_of('/') + 1) + ".cache";
+        }
+        if (!database.Load(dbc_path, dbc_cache_path)) {
+            ALOG(LOG_ERROR, TAG, "Failed to load DBC %s", dbc_path.c_str());
+            std::cout << "Failed to load DBC " << dbc_path << std::endl;
+            return 1;
+        }
+        std::cout << "DBC " << dbc_path << (database.LoadedFromCache() ? " (cache)" : "") << ": "
+                  << database.MessageCount() << " messages" << std::endl;
+    }
+    tcc::aaos::can::StaticDecoder<VehicleSignals> static_decoder;
+    tcc::aaos::can::MessageDecoder const& decoder =
+            use_database ? static_cast<tcc::aaos::can::MessageDecoder const&>(database) : static_decoder;
+
+    // Com --mlock nenhuma página (inclusive as pilhas das threads criadas
+    // depois) sai da memória; uma falha só é registrada
+    if (realtime.lock_memory) {
+        tcc::aaos::can::LockMemory();
+    }
+    if (!realtime.IsDefault()) {
+        ALOG(LOG_INFO, TAG, "Real-time mode: %s", tcc::aaos::can::DescribeRealtime(realtime).c_str());
+    }
+
+    tcc::aaos::can::EventLoop loop;
+    if (!loop.Init()) {
+        ALOG(LOG_ERROR, TAG, "Failed to initialize event loop");
+        std::cout << "Failed to initialize event loop" << std::endl;
+        return 1;
+    }
+
+    // Threads de binder para receber os resultados assíncronos do setValues
+    ABinderProcess_startThreadPool();
 
     // Criação do cliente VHAL
     std::shared_ptr<IVhalClient> vhal_client = IVhalClient::tryCreateAidlClient(AIDL_VHAL_SERVICE);
@@ -65,70 +309,136 @@ int main() {
     ALOG(LOG_VERBOSE, TAG, "VHAL client created");
     std::cout << "VHAL client created" << std::endl;
 
-    struct can_frame frame;
+    tcc::aaos::can::VhalPropertySink sink(vhal_client, AIDL_VHAL_SERVICE);
+    if (!sink.Init()) {
+        ALOG(LOG_ERROR, TAG, "Failed to connect to %s", AIDL_VHAL_SERVICE);
+        std::cout << "Failed to connect to " << AIDL_VHAL_SERVICE << std::endl;
+        return 1;
+    }
+
+    // Caminho inverso (--tx): a assinatura entrega os valores nas threads de
+    // binder, a fila de TX envia pela thread de leitura. Criado antes do
+    // publicador, cuja thread refaz a assinatura depois de uma reconexão
+    tcc::aaos::can::CommandEncoder command_encoder(VehicleCommands::MESSAGES_INFO, VehicleCommands::MESSAGE_COUNT);
+    std::unique_ptr<tcc::aaos::can::CanTransmitter> transmitter;
+    std::unique_ptr<tcc::aaos::can::VhalCommandSource> commands;
+    if (!tx_interface.empty()) {
+        transmitter = std::make_unique<tcc::aaos::can::CanTransmitter>(loop, tx_interface, tx_config);
+        if (!transmitter->Init()) {
+            ALOG(LOG_ERROR, TAG, "Failed to open %s for transmission", tx_interface.c_str());
+            std::cout << "Failed to open " << tx_interface << " for transmission" << std::endl;
+            return 1;
+        }
+        commands = std::make_unique<tcc::aaos::can::VhalCommandSource>(command_encoder, *transmitter);
+        // hardware.interfaces.patch declara os CONTROL_*; falhar aqui indica um VHAL sem o
+        // patch, e só o caminho inverso fica desligado
+        if (!commands->Subscribe(vhal_client)) {
+            ALOG(LOG_ERROR, TAG, "Commands disabled: cannot subscribe to the CONTROL_* properties");
+        }
+        sink.SetClientCallback([&commands](std::shared_ptr<IVhalClient> const& client) {
+            commands->Subscribe(client);
+        });
+    }
 
-    // Criação dos ponteiros para os valores das propriedades do VHAL
-    auto acc_axes = vhal_client->createHalPropValue(toInt(VehicleProperty::INFO_ACCELEROMETER_MPU6050));
-    auto acc_fault = vhal_client->createHalPropValue(toInt(VehicleProperty::FAULT_CODE_ACCELEROMETER_MPU6050));
-    auto temp = vhal_client->createHalPropValue(toInt(VehicleProperty::INFO_TEMPERATURE_DHT22));
-    auto temp_fault = vhal_client->createHalPropValue(toInt(VehicleProperty::FAULT_CODE_TEMPERATURE_DHT22));
+    // Junção temporal, alimentada pela thread de publicação (que já recebe
+    // todos os frames); criada antes do publicador para sobreviver a ele
+    std::unique_ptr<tcc::aaos::can::FusionStage> fusion;
+    if (fusion_enabled) {
+        fusion = std::make_unique<tcc::aaos::can::FusionStage>(fusion_config, decoder.Messages(),
+                                                               decoder.MessageCount());
+    }
 
-    if (acc_axes == nullptr || acc_fault == nullptr || temp == nullptr || temp_fault == nullptr) {
-        ALOG(LOG_ERROR, TAG, "Failed to create HAL property value");
-        std::cout << "Failed to create HAL property value" << std::endl;
+    // Estágio de publicação: thread própria conversando com o VHAL
+    tcc::aaos::can::Publisher publisher(sink, decoder.Messages(), decoder.MessageCount(),
+                                        LATENCY_REPORT_INTERVAL_NS);
+    for (auto const& policy : PROPERTY_POLICIES) {
+        publisher.SetPolicy(policy.prop_id, policy.mode, policy.deadband);
+    }
+    publisher.SetThreadConfig(realtime.publisher);
+    if (fusion) {
+        publisher.SetFusion(fusion.get());
+    }
+    if (!publisher.Init()) {
+        ALOG(LOG_ERROR, TAG, "Failed to initialize VHAL publisher");
+        std::cout << "Failed to initialize VHAL publisher" << std::endl;
         return 1;
     }
+    publisher.Start();
 
-    int16_t axis_x = 0, axis_y = 0, axis_z = 0;
-    float temperature = 0;
+    // Thread de leitura: um único epoll atende todos os barramentos, apenas
+    // decodifica e enfileira para o publicador
+    tcc::aaos::can::CanGateway gateway(loop, decoder, publisher);
+    gateway.SetSocketBuffers(receive_buffer, send_buffer);
+    gateway.SetBatchDecode(batch_decode);
+    if (!log_path.empty()) {
+        tcc::aaos::can::CanLogReader log;
+        if (!log.Open(log_path)) {
+            std::cout << "Failed to open log " << log_path << std::endl;
+            return 1;
+        }
+        std::cout << "Replaying " << log_path << std::endl;
+        gateway.ReplayLog(log, replay_speed);
+        publisher.Stop();
+        tcc::aaos::can::GatewayStats stats = gateway.Stats();
+        std::cout << "Replayed " << stats.frames << " frames (" << stats.decoded << " decoded, "
+                  << log.Stats().skipped << " lines skipped)" << std::endl;
+        return 0;
+    }
+    for (auto const& interface : interfaces) {
+        if (!gateway.AddInterface(interface, rx_backend)) {
+            ALOG(LOG_ERROR, TAG, "Failed to initialize socket CAN on %s", interface.c_str());
+            std::cout << "Failed to initialize socket CAN on " << interface << std::endl;
+            return 1;
+        }
+    }
 
-    while (1) {
+    for (auto const& [isotp_interface, isotp] : isotp_channels) {
+        if (!gateway.AddIsoTp(isotp_interface, isotp)) {
+            ALOG(LOG_ERROR, TAG, "Failed to open ISO-TP 0x%x on %s", isotp.rx_id, isotp_interface.c_str());
+            std::cout << "Failed to open ISO-TP channel on " << isotp_interface << std::endl;
+            return 1;
+        }
+    }
 
-        if(!socket_can.ReadCanMessage(frame)) {
-            ALOG(LOG_ERROR, TAG, "Failed to read CAN message");
-            std::cout << "Failed to read CAN message" << std::endl;
-        } else {
-            switch (frame.can_id) {
-                case ACCELEROMETER_CAN_ID: {
-                    axis_x = (frame.data[0] << 8) | frame.data[1];
-                    axis_y = (frame.data[2] << 8) | frame.data[3];
-                    axis_z = (frame.data[4] << 8) | frame.data[5];
-
-                    std::cout << std::dec << "Axis X: " << axis_x 
-                                << ", Axis Y: " << axis_y << ", Axis Z: " << axis_z << std::endl;
-
-                    acc_axes->setInt32Values({axis_x, axis_y, axis_z});
-                    vhal_client->setValueSync(*acc_axes);
-
-                    if(axis_x == INT16_MIN && axis_y == INT16_MIN && axis_z == INT16_MIN) {
-                        acc_fault->setStringValue("ACC-E1");
-                        vhal_client->setValueSync(*acc_fault);
-                    } else {
-                        acc_fault->setStringValue("ACC-0");
-                        vhal_client->setValueSync(*acc_fault);
-                    }
-                    break;
-                }
-                case TEMPERATURE_CAN_ID: {
-                    temperature = BytesToFloat(frame.data);
-                    std::cout << std::dec << "Temperature: " << temperature << std::endl;
-
-                    temp->setFloatValues({temperature});
-                    vhal_client->setValueSync(*temp);
-                    
-                    if (temperature <= -273) {
-                        temp_fault->setStringValue("TMP-E1");
-                        vhal_client->setValueSync(*temp_fault);
-                    } else {
-                        temp_fault->setStringValue("TMP-0");
-                        vhal_client->setValueSync(*temp_fault);
-                    }
-                    break;
-                }
-                default:
-                    break;
+    ALOG(LOG_VERBOSE, TAG, "Socket CAN initialized");
+    std::cout << "Socket CAN initialized" << std::endl;
+
+    // Os monitores reiniciam o controlador sozinhos após bus-off; aqui só
+    // fica registrado, a cada 10 s, o estado dos barramentos com erros
+    loop.AddTimer(BUS_STATS_PERIOD_NS, [&gateway] {
+        for (auto const& bus : gateway.GetBusStats()) {
+            if (bus.error_frames == 0 && bus.state == tcc::aaos::can::BusState::ERROR_ACTIVE) {
+                continue;
             }
+            ALOG(LOG_WARN, TAG,
+                 "%s: %s, %llu error frames, %llu bus-off (%llu restarts, %llu failed), "
+                 "%lld ms error-passive, %lld ms bus-off, max recovery %lld us",
+                 bus.interface_name.c_str(), tcc::aaos::can::BusStateName(bus.state),
+                 static_cast<unsigned long long>(bus.error_frames), static_cast<unsigned long long>(bus.bus_offs),
+                 static_cast<unsigned long long>(bus.restarts),
+                 static_cast<unsigned long long>(bus.restart_failures),
+                 static_cast<long long>(bus.error_passive_ns / 1'000'000),
+                 static_cast<long long>(bus.bus_off_ns / 1'000'000),
+                 static_cast<long long>(bus.max_recovery_ns / 1'000));
         }
+    });
 
+    // Métricas servidas por uma thread própria, fora do caminho de RX e publicação
+    std::unique_ptr<tcc::aaos::can::MetricsServer> metrics;
+    if (!metrics_socket.empty()) {
+        metrics = std::make_unique<tcc::aaos::can::MetricsServer>(
+                metrics_socket, tcc::aaos::can::MetricsSources{&gateway, &publisher, &sink, fusion.get(),
+                                                               transmitter.get()});
+        if (metrics->Init()) {
+            metrics->Start();
+        } else {
+            ALOG(LOG_WARN, TAG, "Metrics disabled: cannot serve %s", metrics_socket.c_str());
+            metrics.reset();
+        }
     }
+
+    // A thread principal passa a ser a thread de leitura (RX)
+    tcc::aaos::can::ApplyThreadConfig(realtime.rx, "can-rx");
+    loop.Run();
+    return 0;
 }
@@ -0,0 +1,103 @@
+#include "vhal_command_source.h"
+
+#include <log/log.h>
+
+#include "async_log.h"
+
+namespace tcc::aaos::can {
+
+constexpr static char TAG[] = "VHAL_COMMAND_SOURCE";
+
+using ::aidl::android::hardware::automotive::vehicle::SubscribeOptions;
+using ::android::frameworks::automotive::vhal::HalPropError;
+using ::android::frameworks::automotive::vhal::IHalPropValue;
+using ::android::frameworks::automotive::vhal::ISubscriptionCallback;
+using ::android::frameworks::automotive::vhal::IVhalClient;
+
+class VhalCommandSource::Callback : public ISubscriptionCallback {
+public:
+    explicit Callback(VhalCommandSource &source) : source_(source) {}
+
+    void onPropertyEvent(std::vector<std::unique_ptr<IHalPropValue>> const& values) override {
+        source_.OnValues(values);
+    }
+
+    void onPropertySetError(std::vector<HalPropError> const& errors) override {
+        for (HalPropError const& error : errors) {
+            CAN_LOG(WARN, TAG, "Set of property %d failed with status %d", error.propId,
+                    static_cast<int>(error.status));
+        }
+    }
+
+private:
+    VhalCommandSource &source_;
+};
+
+VhalCommandSource::VhalCommandSource(CommandEncoder &encoder, CanTransmitter &transmitter)
+        : encoder_(encoder),
+          transmitter_(transmitter),
+          callback_(std::make_shared<Callback>(*this)),
+          prop_ids_(encoder.PropIds()) {}
+
+VhalCommandSource::~VhalCommandSource() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (subscription_ != nullptr) {
+        subscription_->unsubscribe(prop_ids_);
+    }
+}
+
+bool VhalCommandSource::Subscribe(std::shared_ptr<IVhalClient> const& vhal_client) {
+    // ON_CHANGE properties: every set is delivered, no sample rate
+    std::vector<SubscribeOptions> options;
+    for (int32_t prop_id : prop_ids_) {
+        SubscribeOptions option;
+        option.propId = prop_id;
+        options.push_back(option);
+    }
+    std::unique_ptr<::android::frameworks::automotive::vhal::ISubscriptionClient> subscription =
+            vhal_client->getSubscriptionClient(callback_);
+    if (subscription == nullptr) {
+        ALOG(LOG_ERROR, TAG, "Failed to create VHAL subscription client");
+        return false;
+    }
+    auto subscribed = subscription->subscribe(options);
+    if (!subscribed.ok()) {
+        ALOG(LOG_ERROR, TAG, "Failed to subscribe to command properties: %s", subscribed.error().message().c_str());
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    subscription_ = std::move(subscription);
+    return true;
+}
+
+void VhalCommandSource::OnValues(std::vector<std::unique_ptr<IHalPropValue>> const& values) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (std::unique_ptr<IHalPropValue> const& value : values) {
+        int32_t prop_id = value->getPropId();
+        std::vector<double> elements;
+        switch (TypeOf(prop_id)) {
+            case PropertyType::INT32:
+            case PropertyType::INT32_VEC:
+                elements.assign(value->getInt32Values().begin(), value->getInt32Values().end());
+                break;
+            case PropertyType::FLOAT:
+            case PropertyType::FLOAT_VEC:
+                elements.assign(value->getFloatValues().begin(), value->getFloatValues().end());
+                break;
+            case PropertyType::STRING:
+                break;
+        }
+        canfd_frame frame;
+        if (!encoder_.Encode(prop_id, elements.data(), elements.size(), frame)) {
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            CAN_LOG(WARN, TAG, "Cannot encode property %d with %zu values", prop_id, elements.size());
+            continue;
+        }
+        if (!transmitter_.Send(frame)) {
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            CAN_LOG(WARN, TAG, "TX queue full, dropping command 0x%x", frame.can_id);
+        }
+    }
+}
+
+}  // namespace tcc::aaos::can
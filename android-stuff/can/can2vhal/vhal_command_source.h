@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <AidlVhalClient.h>
+
+#include "can_transmitter.h"
+#include "command_encoder.h"
+
+namespace tcc::aaos::can {
+
+// Reverse path of the bridge: subscribes to the writable properties of a
+// CommandEncoder and turns every value an app sets into a command frame,
+// queued on a CanTransmitter. Property events arrive on binder threads.
+class VhalCommandSource {
+public:
+    // encoder and transmitter must outlive the source
+    VhalCommandSource(CommandEncoder &encoder, CanTransmitter &transmitter);
+    ~VhalCommandSource();
+
+    // Subscribes on vhal_client, replacing the previous subscription. Call
+    // again with the new client after the VHAL restarted.
+    bool Subscribe(std::shared_ptr<::android::frameworks::automotive::vhal::IVhalClient> const& vhal_client);
+
+    // Property values that could not be encoded or queued
+    uint64_t Rejected() const { return rejected_.load(std::memory_order_relaxed); }
+
+private:
+    class Callback;
+
+    void OnValues(std::vector<std::unique_ptr<::android::frameworks::automotive::vhal::IHalPropValue>> const& values);
+
+    CommandEncoder &encoder_;
+    CanTransmitter &transmitter_;
+    std::shared_ptr<Callback> callback_;
+    std::vector<int32_t> prop_ids_;
+
+    std::mutex mutex_; // Guards encoder_ and subscription_
+    std::unique_ptr<::android::frameworks::automotive::vhal::ISubscriptionClient> subscription_;
+    std::atomic<uint64_t> rejected_{0};
+};
+
+}  // namespace tcc::aaos::can
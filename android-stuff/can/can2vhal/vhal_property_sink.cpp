@@ -0,0 +1,293 @@
+#include "vhal_property_sink.h"
+
+#include <android/binder_manager.h>
+#include <VehicleUtils.h>
+#include <log/log.h>
+
+#include "async_log.h"
+
+namespace tcc::aaos::can {
+
+constexpr static char TAG[] = "VHAL_PROPERTY_SINK";
+
+// How often the watcher asks the service manager for the VHAL after it
+// died. AServiceManager_waitForService would block shutdown.
+constexpr static std::chrono::milliseconds RECONNECT_POLL{20};
+
+using ::aidl::android::hardware::automotive::vehicle::BnVehicleCallback;
+using ::aidl::android::hardware::automotive::vehicle::GetValueResults;
+using ::aidl::android::hardware::automotive::vehicle::IVehicle;
+using ::aidl::android::hardware::automotive::vehicle::SetValueRequest;
+using ::aidl::android::hardware::automotive::vehicle::SetValueRequests;
+using ::aidl::android::hardware::automotive::vehicle::SetValueResults;
+using ::aidl::android::hardware::automotive::vehicle::StatusCode;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropErrors;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropValue;
+using ::aidl::android::hardware::automotive::vehicle::VehiclePropValues;
+using ::android::frameworks::automotive::vhal::IHalPropConfig;
+using ::android::frameworks::automotive::vhal::IHalPropValue;
+using ::android::frameworks::automotive::vhal::IVhalClient;
+using ::android::hardware::automotive::vehicle::fromStableLargeParcelable;
+using ::android::hardware::automotive::vehicle::vectorToStableLargeParcelable;
+
+// Receives the asynchronous per-value results of setValues
+class VhalPropertySink::SetValuesCallback : public BnVehicleCallback {
+public:
+    ndk::ScopedAStatus onGetValues(GetValueResults const&) override {
+        return ndk::ScopedAStatus::ok();
+    }
+
+    ndk::ScopedAStatus onSetValues(SetValueResults const& results) override {
+        auto parcelable = fromStableLargeParcelable(results);
+        if (!parcelable.ok()) {
+            ALOG(LOG_ERROR, TAG, "Failed to parse setValues results");
+            return ndk::ScopedAStatus::ok();
+        }
+        for (auto const& result : parcelable->getObject()->payloads) {
+            if (result.status != StatusCode::OK) {
+                set_errors.fetch_add(1, std::memory_order_relaxed);
+                CAN_LOG(ERROR, TAG, "setValues request %lld failed with status %d",
+                        static_cast<long long>(result.requestId), static_cast<int>(result.status));
+            }
+        }
+        return ndk::ScopedAStatus::ok();
+    }
+
+    ndk::ScopedAStatus onPropertyEvent(VehiclePropValues const&, int32_t) override {
+        return ndk::ScopedAStatus::ok();
+    }
+
+    ndk::ScopedAStatus onPropertySetError(VehiclePropErrors const&) override {
+        return ndk::ScopedAStatus::ok();
+    }
+
+    std::atomic<uint64_t> set_errors{0};
+};
+
+VhalPropertySink::VhalPropertySink(std::shared_ptr<IVhalClient> vhal_client, std::string const& service_name)
+        : vhal_client_(std::move(vhal_client)), service_name_(service_name) {}
+
+VhalPropertySink::~VhalPropertySink() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    changed_.notify_all();
+    if (watcher_.joinable()) {
+        watcher_.join();
+    }
+    if (death_callback_ != nullptr) {
+        vhal_client_->removeOnBinderDiedCallback(death_callback_);
+    }
+}
+
+bool VhalPropertySink::Init() {
+    ndk::SpAIBinder binder(AServiceManager_checkService(service_name_.c_str()));
+    vehicle_ = IVehicle::fromBinder(binder);
+    if (vehicle_ == nullptr) {
+        ALOG(LOG_ERROR, TAG, "Failed to connect to %s", service_name_.c_str());
+        return false;
+    }
+    callback_ = ndk::SharedRefBase::make<SetValuesCallback>();
+    death_callback_ = std::make_shared<IVhalClient::OnBinderDiedCallbackFunc>([this] { OnBinderDied(); });
+    auto linked = vhal_client_->addOnBinderDiedCallback(death_callback_);
+    if (!linked.ok()) {
+        ALOG(LOG_ERROR, TAG, "Failed to register for VHAL death: %s", linked.error().message().c_str());
+        return false;
+    }
+    watcher_ = std::thread([this] { WatchService(); });
+    return true;
+}
+
+void VhalPropertySink::SetReconnectCallback(std::function<void()> callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    reconnected_ = std::move(callback);
+}
+
+void VhalPropertySink::SetClientCallback(std::function<void(std::shared_ptr<IVhalClient> const&)> callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    client_changed_ = std::move(callback);
+}
+
+void VhalPropertySink::OnBinderDied() {
+    if (!connected_.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+    ALOG(LOG_WARN, TAG, "%s died, reconnecting", service_name_.c_str());
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        lost_ = true;
+        lost_since_ = std::chrono::steady_clock::now();
+    }
+    changed_.notify_all();
+}
+
+void VhalPropertySink::WatchService() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        changed_.wait(lock, [this] { return stopping_ || lost_; });
+        if (stopping_) {
+            return;
+        }
+        lock.unlock();
+        // The service manager may still hand out the dead binder for a moment
+        std::shared_ptr<IVhalClient> client;
+        std::shared_ptr<IVehicle> vehicle;
+        ndk::SpAIBinder binder(AServiceManager_checkService(service_name_.c_str()));
+        if (binder.get() != nullptr && AIBinder_isAlive(binder.get())) {
+            vehicle = IVehicle::fromBinder(binder);
+            client = IVhalClient::tryCreateAidlClient(service_name_.c_str());
+        }
+        lock.lock();
+        if (client == nullptr || vehicle == nullptr) {
+            changed_.wait_for(lock, RECONNECT_POLL, [this] { return stopping_; });
+            continue;
+        }
+        lost_ = false;
+        next_client_ = std::move(client);
+        next_vehicle_ = std::move(vehicle);
+        std::function<void()> reconnected = reconnected_;
+        lock.unlock();
+        if (reconnected) {
+            reconnected();
+        }
+        lock.lock();
+    }
+}
+
+bool VhalPropertySink::Reconnect() {
+    std::shared_ptr<IVhalClient> client;
+    std::shared_ptr<IVehicle> vehicle;
+    std::chrono::steady_clock::time_point lost_since;
+    std::function<void(std::shared_ptr<IVhalClient> const&)> client_changed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        client.swap(next_client_);
+        vehicle.swap(next_vehicle_);
+        lost_since = lost_since_;
+        client_changed = client_changed_;
+    }
+    if (client == nullptr) {
+        return false;
+    }
+    vhal_client_->removeOnBinderDiedCallback(death_callback_);
+    vhal_client_ = std::move(client);
+    vehicle_ = std::move(vehicle);
+    // Values built for the old client and requests meant for the dead VHAL
+    prop_values_.clear();
+    pending_.clear();
+    connected_.store(true, std::memory_order_release);
+    auto linked = vhal_client_->addOnBinderDiedCallback(death_callback_);
+    if (!linked.ok()) {
+        // Died again already; the next setValues reports DEAD_OBJECT
+        ALOG(LOG_ERROR, TAG, "Failed to register for VHAL death: %s", linked.error().message().c_str());
+    }
+    reconnects_.fetch_add(1, std::memory_order_relaxed);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - lost_since);
+    ALOG(LOG_INFO, TAG, "Reconnected to %s after %lld ms", service_name_.c_str(),
+         static_cast<long long>(elapsed.count()));
+    if (client_changed) {
+        client_changed(vhal_client_);
+    }
+    return true;
+}
+
+std::vector<float> VhalPropertySink::MaxSampleRates(std::vector<int32_t> const& prop_ids) {
+    std::vector<float> rates(prop_ids.size(), 0);
+    auto configs = vhal_client_->getPropConfigs(prop_ids);
+    if (!configs.ok()) {
+        ALOG(LOG_ERROR, TAG, "Failed to get property configs, publishing without rate limit: %s",
+             configs.error().message().c_str());
+        return rates;
+    }
+    for (std::unique_ptr<IHalPropConfig> const& config : configs.value()) {
+        for (size_t i = 0; i < prop_ids.size(); i++) {
+            if (prop_ids[i] == config->getPropId()) {
+                rates[i] = config->getMaxSampleRate();
+            }
+        }
+    }
+    return rates;
+}
+
+IHalPropValue *VhalPropertySink::ValueFor(int32_t prop_id, int32_t area_id) {
+    int64_t key = (static_cast<int64_t>(prop_id) << 32) | static_cast<uint32_t>(area_id);
+    auto &value = prop_values_[key];
+    if (value == nullptr) {
+        value = vhal_client_->createHalPropValue(prop_id, area_id);
+    }
+    return value.get();
+}
+
+void VhalPropertySink::Add(PropertyValue const& value) {
+    IHalPropValue *prop_value = ValueFor(value.prop_id, value.area_id);
+    if (prop_value == nullptr) {
+        CAN_LOG(ERROR, TAG, "Failed to create HAL property value for %d", value.prop_id);
+        return;
+    }
+    switch (TypeOf(value.prop_id)) {
+        case PropertyType::STRING:
+            prop_value->setStringValue(std::string(value.string_value));
+            break;
+        case PropertyType::INT32:
+        case PropertyType::INT32_VEC:
+            prop_value->setInt32Values(
+                    std::vector<int32_t>(value.int32_values.begin(), value.int32_values.begin() + value.count));
+            break;
+        case PropertyType::FLOAT:
+        case PropertyType::FLOAT_VEC:
+            prop_value->setFloatValues(
+                    std::vector<float>(value.float_values.begin(), value.float_values.begin() + value.count));
+            break;
+    }
+
+    SetValueRequest request;
+    request.requestId = next_request_id_++;
+    request.value = *static_cast<VehiclePropValue const*>(prop_value->toVehiclePropValue());
+    pending_.push_back(std::move(request));
+}
+
+bool VhalPropertySink::Flush() {
+    if (pending_.empty()) {
+        return true;
+    }
+    if (!Connected()) {
+        // The publisher holds its latest values until Reconnect()
+        pending_.clear();
+        return false;
+    }
+    size_t count = pending_.size();
+    SetValueRequests requests;
+    // vectorToStableLargeParcelable consumes the vector; keep its capacity for the next batch
+    std::vector<SetValueRequest> batch;
+    batch.reserve(count);
+    batch.swap(pending_);
+    ndk::ScopedAStatus status = vectorToStableLargeParcelable(std::move(batch), &requests);
+    if (status.isOk()) {
+        status = vehicle_->setValues(callback_, requests);
+    }
+    transactions_.fetch_add(1, std::memory_order_relaxed);
+    values_.fetch_add(count, std::memory_order_relaxed);
+    if (!status.isOk()) {
+        binder_errors_.fetch_add(1, std::memory_order_relaxed);
+        ALOG(LOG_ERROR, TAG, "setValues failed: %s", status.getMessage());
+        if (status.getStatus() == STATUS_DEAD_OBJECT) {
+            // May arrive before the death notification
+            OnBinderDied();
+        }
+        return false;
+    }
+    return true;
+}
+
+SinkStats VhalPropertySink::Stats() const {
+    return SinkStats{
+        transactions_.load(std::memory_order_relaxed),
+        values_.load(std::memory_order_relaxed),
+        binder_errors_.load(std::memory_order_relaxed) +
+                (callback_ ? callback_->set_errors.load(std::memory_order_relaxed) : 0),
+        reconnects_.load(std::memory_order_relaxed),
+    };
+}
+
+}  // namespace tcc::aaos::can
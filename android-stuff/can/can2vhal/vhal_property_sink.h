@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <aidl/android/hardware/automotive/vehicle/BnVehicleCallback.h>
+#include <aidl/android/hardware/automotive/vehicle/IVehicle.h>
+#include <AidlVhalClient.h>
+
+#include "property_sink.h"
+
+namespace tcc::aaos::can {
+
+// PropertySink backed by the VHAL. Max sample rates come from the property
+// configs; updates are collected and sent with one IVehicle::setValues
+// transaction per Flush(). IVhalClient only exposes a single-value setValue,
+// so this talks to the AIDL IVehicle directly. Results arrive asynchronously
+// on a binder thread and are only counted.
+//
+// When the VHAL process dies (binder death notification, or a transaction
+// failing with DEAD_OBJECT) the sink disconnects and a watcher thread polls
+// the service manager until the VHAL is registered again. The new client is
+// handed to the publisher thread through the reconnect callback and adopted
+// in Reconnect(); the publisher then republishes its latest values.
+class VhalPropertySink : public PropertySink {
+public:
+    VhalPropertySink(std::shared_ptr<::android::frameworks::automotive::vhal::IVhalClient> vhal_client,
+                     std::string const& service_name);
+    ~VhalPropertySink() override;
+
+    bool Init();
+
+    std::vector<float> MaxSampleRates(std::vector<int32_t> const& prop_ids) override;
+    void Add(PropertyValue const& value) override;
+    size_t Pending() const override { return pending_.size(); }
+    bool Flush() override;
+    SinkStats Stats() const override;
+
+    bool Connected() const override { return connected_.load(std::memory_order_acquire); }
+    void SetReconnectCallback(std::function<void()> callback) override;
+    bool Reconnect() override;
+    // Called by Reconnect() with the client it adopted, so other users of
+    // the VHAL (subscriptions) can move to it
+    void SetClientCallback(
+            std::function<void(std::shared_ptr<::android::frameworks::automotive::vhal::IVhalClient> const&)> callback);
+
+private:
+    class SetValuesCallback;
+
+    // Reusable value object per property, created on first use
+    ::android::frameworks::automotive::vhal::IHalPropValue *ValueFor(int32_t prop_id, int32_t area_id);
+    // Binder thread (or publisher thread on DEAD_OBJECT): the VHAL is gone
+    void OnBinderDied();
+    // Watcher thread: waits for a disconnection, then for a live VHAL
+    void WatchService();
+
+    std::shared_ptr<::android::frameworks::automotive::vhal::IVhalClient> vhal_client_;
+    std::string service_name_;
+    std::shared_ptr<::aidl::android::hardware::automotive::vehicle::IVehicle> vehicle_;
+    std::shared_ptr<SetValuesCallback> callback_;
+    std::unordered_map<int64_t, std::unique_ptr<::android::frameworks::automotive::vhal::IHalPropValue>>
+            prop_values_;
+    std::vector<::aidl::android::hardware::automotive::vehicle::SetValueRequest> pending_;
+    int64_t next_request_id_ = 0;
+
+    std::atomic<uint64_t> transactions_{0};
+    std::atomic<uint64_t> values_{0};
+    std::atomic<uint64_t> binder_errors_{0};
+
+    std::shared_ptr<::android::frameworks::automotive::vhal::IVhalClient::OnBinderDiedCallbackFunc> death_callback_;
+    std::atomic<bool> connected_{true};
+    std::atomic<uint64_t> reconnects_{0};
+    std::thread watcher_;
+
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    bool stopping_ = false;
+    bool lost_ = false; // Disconnected and no replacement found yet
+    std::chrono::steady_clock::time_point lost_since_;
+    std::function<void()> reconnected_;
+    std::function<void(std::shared_ptr<::android::frameworks::automotive::vhal::IVhalClient> const&)>
+            client_changed_;
+    // Found by the watcher, adopted by Reconnect()
+    std::shared_ptr<::android::frameworks::automotive::vhal::IVhalClient> next_client_;
+    std::shared_ptr<::aidl::android::hardware::automotive::vehicle::IVehicle> next_vehicle_;
+};
+
+}  // namespace tcc::aaos::can
@@ -0,0 +1,123 @@
+#include "async_log.h"
+
+#include <unistd.h>
+
+#ifdef __ANDROID__
+#include <android/log.h>
+#endif
+
+#include <chrono>
+#include <ctime>
+
+namespace tcc::aaos::can {
+
+constexpr static char TAG[] = "ASYNC_LOG";
+// How long the drainer sleeps when the ring is empty
+constexpr static auto DRAIN_INTERVAL = std::chrono::milliseconds(5);
+// Longest formatted message; logcat truncates longer entries anyway
+constexpr static size_t MAX_MESSAGE_SIZE = 1024;
+
+AsyncLog& AsyncLog::Instance() {
+    static AsyncLog *instance = new AsyncLog();
+    return *instance;
+}
+
+AsyncLog::AsyncLog() : mirror_stdout_(isatty(STDOUT_FILENO)) {
+    for (size_t i = 0; i < RING_CAPACITY; i++) {
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    std::thread([this] { Run(); }).detach();
+}
+
+int64_t AsyncLog::NowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+}
+
+AsyncLog::Slot *AsyncLog::Claim(size_t &pos) {
+    pos = enqueue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+        Slot *slot = &slots_[pos & (RING_CAPACITY - 1)];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                return slot;
+            }
+        } else if (diff < 0) {
+            // The drainer has not released this slot yet: the ring is full
+            return nullptr;
+        } else {
+            pos = enqueue_pos_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+size_t AsyncLog::Drain() {
+    size_t drained = 0;
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+        Slot &slot = slots_[pos & (RING_CAPACITY - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != pos + 1) {
+            break;
+        }
+        Emit(slot.record);
+        slot.sequence.store(pos + RING_CAPACITY, std::memory_order_release);
+        pos++;
+        drained++;
+    }
+    dequeue_pos_.store(pos, std::memory_order_release);
+
+    uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+    if (dropped != reported_dropped_) {
+        char message[64];
+        std::snprintf(message, sizeof(message), "%llu log records dropped, ring full",
+                      static_cast<unsigned long long>(dropped - reported_dropped_));
+        Forward(LogLevel::WARN, TAG, message);
+        reported_dropped_ = dropped;
+    }
+    if (drained > 0 && mirror_stdout_) {
+        std::fflush(stdout);
+    }
+    return drained;
+}
+
+void AsyncLog::Forward(LogLevel level, char const* tag, char const* message) {
+#ifdef __ANDROID__
+    __android_log_write(static_cast<int>(level), tag, message);
+#else
+    // Host builds have no logcat; stderr stays separate from the stdout mirror
+    if (!mirror_stdout_) {
+        std::fprintf(stderr, "%c %s: %s\n", "??VDIWE"[static_cast<int>(level)], tag, message);
+    }
+#endif
+}
+
+void AsyncLog::Emit(LogRecord const& record) {
+    char message[MAX_MESSAGE_SIZE];
+    record.format_fn(message, sizeof(message), record.format, record.payload);
+    Forward(record.level, record.tag, message);
+    if (mirror_stdout_) {
+        std::fprintf(stdout, "%lld.%06lld %s: %s\n",
+                     static_cast<long long>(record.timestamp_ns / 1'000'000'000),
+                     static_cast<long long>(record.timestamp_ns % 1'000'000'000 / 1000), record.tag, message);
+    }
+}
+
+void AsyncLog::Run() {
+    while (true) {
+        if (Drain() == 0) {
+            std::this_thread::sleep_for(DRAIN_INTERVAL);
+        }
+    }
+}
+
+void AsyncLog::Flush() {
+    size_t target = enqueue_pos_.load(std::memory_order_acquire);
+    while (dequeue_pos_.load(std::memory_order_acquire) < target) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+}  // namespace tcc::aaos::can
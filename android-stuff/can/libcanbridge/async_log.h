@@ -0,0 +1,206 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+
+// Asynchronous logging for the frame path. A call site costs a level check
+// resolved at compile time, a clock read and a copy of the arguments into a
+// preallocated ring slot: no allocation, no formatting, no syscall. A drainer
+// thread formats the records and forwards them to logcat, or stderr on a
+// host build (and to stdout when it is a terminal).
+//
+//   CAN_LOG(DEBUG, TAG, "0x%03x %s=%g", can_id, name, value);
+//
+// The format is checked like printf. Arguments must be trivially copyable;
+// C strings are copied into the record (truncated when the record is full),
+// so passing std::string::c_str() of a temporary is safe.
+//
+// Levels below CAN_LOG_MIN_LEVEL are removed at compile time, arguments
+// included. Override it from the build, e.g. -DCAN_LOG_MIN_LEVEL=2 to keep
+// VERBOSE records.
+
+#ifndef CAN_LOG_MIN_LEVEL
+#define CAN_LOG_MIN_LEVEL 4 // LogLevel::INFO
+#endif
+
+#define CAN_LOG(level, tag, format, ...)                                                             \
+    do {                                                                                             \
+        if constexpr (static_cast<int>(::tcc::aaos::can::LogLevel::level) >= CAN_LOG_MIN_LEVEL) {   \
+            static_cast<void>(sizeof(::tcc::aaos::can::log_detail::CheckFormat(format, ##__VA_ARGS__))); \
+            ::tcc::aaos::can::AsyncLog::Instance().Write(::tcc::aaos::can::LogLevel::level, tag,     \
+                                                         format, ##__VA_ARGS__);                     \
+        }                                                                                            \
+    } while (0)
+
+namespace tcc::aaos::can {
+
+// Same values as android_LogPriority
+enum class LogLevel : uint8_t {
+    VERBOSE = 2,
+    DEBUG = 3,
+    INFO = 4,
+    WARN = 5,
+    ERROR = 6,
+};
+
+namespace log_detail {
+
+// Never called; gives the compiler a printf signature to check CAN_LOG against
+int CheckFormat(char const* format, ...) __attribute__((format(printf, 1, 2)));
+
+constexpr static size_t PAYLOAD_SIZE = 200;
+
+template <typename T>
+constexpr bool IS_STRING = std::is_same_v<std::decay_t<T>, char const*> || std::is_same_v<std::decay_t<T>, char*>;
+
+// Bytes an argument needs when its string part is empty
+template <typename T>
+constexpr size_t FixedSize() {
+    if constexpr (IS_STRING<T>) {
+        return 2; // Length byte and terminator
+    } else {
+        return sizeof(T);
+    }
+}
+
+template <typename T>
+void Put(uint8_t *&out, size_t &string_budget, T const& value) {
+    if constexpr (IS_STRING<T>) {
+        char const* text = value;
+        if constexpr (!std::is_array_v<T>) {
+            text = value != nullptr ? value : "(null)";
+        }
+        size_t length = std::min({std::strlen(text), string_budget, size_t{255}});
+        *out++ = static_cast<uint8_t>(length);
+        std::memcpy(out, text, length);
+        out[length] = '\0';
+        out += length + 1;
+        string_budget -= length;
+    } else {
+        std::memcpy(out, &value, sizeof(T));
+        out += sizeof(T);
+    }
+}
+
+template <typename T>
+auto Get(uint8_t const*& in) {
+    if constexpr (IS_STRING<T>) {
+        size_t length = *in++;
+        char const* text = reinterpret_cast<char const*>(in);
+        in += length + 1;
+        return text;
+    } else {
+        std::decay_t<T> value;
+        std::memcpy(&value, in, sizeof(value));
+        in += sizeof(value);
+        return value;
+    }
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#pragma GCC diagnostic ignored "-Wformat-security"
+// Instantiated per argument list; the drainer calls it through LogRecord
+template <typename... ARGS>
+int Format(char *buffer, size_t size, char const* format, uint8_t const* payload) {
+    if constexpr (sizeof...(ARGS) == 0) {
+        return std::snprintf(buffer, size, format);
+    } else {
+        // Braced initialization evaluates Get() left to right
+        std::tuple<decltype(Get<ARGS>(payload))...> values{Get<ARGS>(payload)...};
+        return std::apply([&](auto... value) { return std::snprintf(buffer, size, format, value...); },
+                          values);
+    }
+}
+#pragma GCC diagnostic pop
+
+}  // namespace log_detail
+
+struct LogRecord {
+    using FormatFn = int (*)(char *buffer, size_t size, char const* format, uint8_t const* payload);
+
+    int64_t timestamp_ns; // CLOCK_REALTIME at the call site
+    char const* tag;      // String literals, never copied
+    char const* format;
+    FormatFn format_fn;
+    LogLevel level;
+    alignas(8) uint8_t payload[log_detail::PAYLOAD_SIZE];
+};
+
+class AsyncLog {
+public:
+    // Records held between drains; a full ring drops new records, never blocks
+    constexpr static size_t RING_CAPACITY = 1024;
+    static_assert((RING_CAPACITY & (RING_CAPACITY - 1)) == 0, "RING_CAPACITY must be a power of two");
+
+    // Created, with its drainer thread, on first use. Never destroyed, so
+    // threads may keep logging while the process exits.
+    static AsyncLog& Instance();
+
+    template <typename... ARGS>
+    void Write(LogLevel level, char const* tag, char const* format, ARGS const&... args) {
+        static_assert((std::is_trivially_copyable_v<ARGS> && ...),
+                      "CAN_LOG arguments must be trivially copyable; pass std::string as c_str()");
+        constexpr size_t fixed_size = (size_t{0} + ... + log_detail::FixedSize<ARGS>());
+        static_assert(fixed_size <= log_detail::PAYLOAD_SIZE, "Too many CAN_LOG arguments");
+
+        size_t pos;
+        Slot *slot = Claim(pos);
+        if (slot == nullptr) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        LogRecord *record = &slot->record;
+        record->timestamp_ns = NowNs();
+        record->tag = tag;
+        record->format = format;
+        record->format_fn = &log_detail::Format<ARGS...>;
+        record->level = level;
+        if constexpr (sizeof...(ARGS) > 0) {
+            uint8_t *out = record->payload;
+            size_t string_budget = log_detail::PAYLOAD_SIZE - fixed_size;
+            (log_detail::Put(out, string_budget, args), ...);
+        }
+        slot->sequence.store(pos + 1, std::memory_order_release);
+    }
+
+    // Blocks until every record written before the call has been forwarded
+    void Flush();
+
+    uint64_t Dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        LogRecord record;
+    };
+
+    AsyncLog();
+
+    // Reserves the next free slot of the bounded MPMC queue (Vyukov);
+    // nullptr when the ring is full
+    Slot *Claim(size_t &pos);
+    // Forwards every published record; returns how many were drained
+    size_t Drain();
+    void Emit(LogRecord const& record);
+    // Writes one formatted message to logcat (stderr on host builds)
+    void Forward(LogLevel level, char const* tag, char const* message);
+    void Run();
+    static int64_t NowNs();
+
+    Slot slots_[RING_CAPACITY];
+    alignas(64) std::atomic<size_t> enqueue_pos_{0};
+    alignas(64) std::atomic<size_t> dequeue_pos_{0};
+    alignas(64) std::atomic<uint64_t> dropped_{0};
+    uint64_t reported_dropped_ = 0;
+    bool mirror_stdout_;
+};
+
+}  // namespace tcc::aaos::can
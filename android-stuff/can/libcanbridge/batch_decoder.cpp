@@ -0,0 +1,464 @@
+#include "batch_decoder.h"
+
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace tcc::aaos::can {
+
+char const* KernelName(DecodeKernel kernel) {
+    switch (kernel) {
+        case DecodeKernel::SCALAR:
+            return "scalar";
+        case DecodeKernel::SSE2:
+            return "sse2";
+        case DecodeKernel::AVX2:
+            return "avx2";
+        case DecodeKernel::NEON:
+            return "neon";
+    }
+    return "unknown";
+}
+
+bool ParseKernelName(std::string const& name, DecodeKernel &kernel) {
+    for (DecodeKernel candidate : {DecodeKernel::SCALAR, DecodeKernel::SSE2, DecodeKernel::AVX2, DecodeKernel::NEON}) {
+        if (name == KernelName(candidate)) {
+            kernel = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool KernelSupported(DecodeKernel kernel) {
+    switch (kernel) {
+        case DecodeKernel::SCALAR:
+            return true;
+#if defined(__x86_64__)
+        case DecodeKernel::SSE2:
+            return true;
+        case DecodeKernel::AVX2:
+            return __builtin_cpu_supports("avx2");
+#elif defined(__aarch64__)
+        case DecodeKernel::NEON:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+DecodeKernel BestKernel() {
+    for (DecodeKernel kernel : {DecodeKernel::AVX2, DecodeKernel::NEON, DecodeKernel::SSE2}) {
+        if (KernelSupported(kernel)) {
+            return kernel;
+        }
+    }
+    return DecodeKernel::SCALAR;
+}
+
+// Reference conversion of one field; also converts the tail of a column
+// that does not fill a vector
+static double ConvertField(ColumnFormat const& format, uint8_t const* raw) {
+    uint32_t bits = 0;
+    for (size_t b = 0; b < format.width; b++) {
+        size_t shift = format.big_endian ? format.width - 1 - b : b;
+        bits |= static_cast<uint32_t>(raw[b]) << (8 * shift);
+    }
+    double value;
+    if (format.type == ValueType::FLOAT32) {
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        value = f;
+    } else if (format.type == ValueType::SIGNED) {
+        int unused = 32 - 8 * format.width;
+        value = static_cast<double>(static_cast<int32_t>(bits << unused) >> unused);
+    } else {
+        value = static_cast<double>(bits);
+    }
+    return value * format.scale + format.offset;
+}
+
+static size_t ConvertScalar(ColumnFormat const& format, uint8_t const* raw, size_t begin, size_t n, double *out) {
+    for (size_t i = begin; i < n; i++) {
+        out[i] = ConvertField(format, raw + i * format.width);
+    }
+    return n;
+}
+
+#if defined(__x86_64__)
+
+// 8 int16 lanes, byteswapped when big-endian, widened to two int32 vectors
+static inline void WidenSse2(__m128i v, bool is_signed, __m128i &low, __m128i &high) {
+    if (is_signed) {
+        low = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        high = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+    } else {
+        low = _mm_unpacklo_epi16(v, _mm_setzero_si128());
+        high = _mm_unpackhi_epi16(v, _mm_setzero_si128());
+    }
+}
+
+static inline __m128i Swap16Sse2(__m128i v) {
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+// 4 int32 lanes to doubles: value * scale + offset
+static inline void StoreSse2(__m128i v, __m128d scale, __m128d offset, double *out) {
+    __m128d low = _mm_cvtepi32_pd(v);
+    __m128d high = _mm_cvtepi32_pd(_mm_shuffle_epi32(v, 0xEE));
+    _mm_storeu_pd(out, _mm_add_pd(_mm_mul_pd(low, scale), offset));
+    _mm_storeu_pd(out + 2, _mm_add_pd(_mm_mul_pd(high, scale), offset));
+}
+
+static size_t ConvertSse2(ColumnFormat const& format, uint8_t const* raw, size_t n, double *out) {
+    __m128d scale = _mm_set1_pd(format.scale);
+    __m128d offset = _mm_set1_pd(format.offset);
+    bool is_signed = format.type == ValueType::SIGNED;
+    size_t i = 0;
+    if (format.width == 1) {
+        for (; i + 8 <= n; i += 8) {
+            __m128i v = _mm_loadl_epi64(reinterpret_cast<__m128i const*>(raw + i));
+            v = is_signed ? _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8) : _mm_unpacklo_epi8(v, _mm_setzero_si128());
+            __m128i low, high;
+            WidenSse2(v, is_signed, low, high);
+            StoreSse2(low, scale, offset, out + i);
+            StoreSse2(high, scale, offset, out + i + 4);
+        }
+    } else if (format.width == 2) {
+        for (; i + 8 <= n; i += 8) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(raw + i * 2));
+            if (format.big_endian) {
+                v = Swap16Sse2(v);
+            }
+            __m128i low, high;
+            WidenSse2(v, is_signed, low, high);
+            StoreSse2(low, scale, offset, out + i);
+            StoreSse2(high, scale, offset, out + i + 4);
+        }
+    } else if (format.width == 4) {
+        for (; i + 4 <= n; i += 4) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(raw + i * 4));
+            if (format.big_endian) {
+                v = Swap16Sse2(v);
+                v = _mm_or_si128(_mm_slli_epi32(v, 16), _mm_srli_epi32(v, 16));
+            }
+            if (format.type == ValueType::FLOAT32) {
+                __m128 f = _mm_castsi128_ps(v);
+                __m128d low = _mm_cvtps_pd(f);
+                __m128d high = _mm_cvtps_pd(_mm_movehl_ps(f, f));
+                _mm_storeu_pd(out + i, _mm_add_pd(_mm_mul_pd(low, scale), offset));
+                _mm_storeu_pd(out + i + 2, _mm_add_pd(_mm_mul_pd(high, scale), offset));
+            } else if (is_signed) {
+                StoreSse2(v, scale, offset, out + i);
+            } else {
+                // No unsigned conversion: flip the sign bit, convert, add 2^31 back
+                __m128i flipped = _mm_xor_si128(v, _mm_set1_epi32(INT32_MIN));
+                __m128d bias = _mm_set1_pd(2147483648.0);
+                __m128d low = _mm_add_pd(_mm_cvtepi32_pd(flipped), bias);
+                __m128d high = _mm_add_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(flipped, 0xEE)), bias);
+                _mm_storeu_pd(out + i, _mm_add_pd(_mm_mul_pd(low, scale), offset));
+                _mm_storeu_pd(out + i + 2, _mm_add_pd(_mm_mul_pd(high, scale), offset));
+            }
+        }
+    }
+    return ConvertScalar(format, raw, i, n, out);
+}
+
+__attribute__((target("avx2"))) static inline void StoreAvx2(__m128i v, __m256d scale, __m256d offset,
+                                                              double *out) {
+    _mm256_storeu_pd(out, _mm256_add_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(v), scale), offset));
+}
+
+// 8 int32 lanes to doubles
+__attribute__((target("avx2"))) static inline void Store8Avx2(__m256i v, __m256d scale, __m256d offset,
+                                                               double *out) {
+    StoreAvx2(_mm256_castsi256_si128(v), scale, offset, out);
+    StoreAvx2(_mm256_extracti128_si256(v, 1), scale, offset, out + 4);
+}
+
+__attribute__((target("avx2"))) static size_t ConvertAvx2(ColumnFormat const& format, uint8_t const* raw, size_t n,
+                                                           double *out) {
+    __m256d scale = _mm256_set1_pd(format.scale);
+    __m256d offset = _mm256_set1_pd(format.offset);
+    bool is_signed = format.type == ValueType::SIGNED;
+    size_t i = 0;
+    if (format.width == 1) {
+        for (; i + 8 <= n; i += 8) {
+            __m128i v = _mm_loadl_epi64(reinterpret_cast<__m128i const*>(raw + i));
+            Store8Avx2(is_signed ? _mm256_cvtepi8_epi32(v) : _mm256_cvtepu8_epi32(v), scale, offset, out + i);
+        }
+    } else if (format.width == 2) {
+        __m128i swap = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+        for (; i + 8 <= n; i += 8) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(raw + i * 2));
+            if (format.big_endian) {
+                v = _mm_shuffle_epi8(v, swap);
+            }
+            Store8Avx2(is_signed ? _mm256_cvtepi16_epi32(v) : _mm256_cvtepu16_epi32(v), scale, offset, out + i);
+        }
+    } else if (format.width == 4) {
+        __m128i swap = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        for (; i + 4 <= n; i += 4) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(raw + i * 4));
+            if (format.big_endian) {
+                v = _mm_shuffle_epi8(v, swap);
+            }
+            __m256d value;
+            if (format.type == ValueType::FLOAT32) {
+                value = _mm256_cvtps_pd(_mm_castsi128_ps(v));
+            } else if (is_signed) {
+                value = _mm256_cvtepi32_pd(v);
+            } else {
+                value = _mm256_add_pd(_mm256_cvtepi32_pd(_mm_xor_si128(v, _mm_set1_epi32(INT32_MIN))),
+                                      _mm256_set1_pd(2147483648.0));
+            }
+            _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_mul_pd(value, scale), offset));
+        }
+    }
+    return ConvertScalar(format, raw, i, n, out);
+}
+
+#elif defined(__aarch64__)
+
+static inline void StoreNeon(float64x2_t v, float64x2_t scale, float64x2_t offset, double *out) {
+    vst1q_f64(out, vaddq_f64(vmulq_f64(v, scale), offset));
+}
+
+// 4 int32 lanes to doubles
+static inline void Store4Neon(int32x4_t v, float64x2_t scale, float64x2_t offset, double *out) {
+    StoreNeon(vcvtq_f64_s64(vmovl_s32(vget_low_s32(v))), scale, offset, out);
+    StoreNeon(vcvtq_f64_s64(vmovl_high_s32(v)), scale, offset, out + 2);
+}
+
+static inline void Store4Neon(uint32x4_t v, float64x2_t scale, float64x2_t offset, double *out) {
+    StoreNeon(vcvtq_f64_u64(vmovl_u32(vget_low_u32(v))), scale, offset, out);
+    StoreNeon(vcvtq_f64_u64(vmovl_high_u32(v)), scale, offset, out + 2);
+}
+
+// 8 16-bit lanes to doubles
+static inline void Store8Neon(uint16x8_t v, bool is_signed, float64x2_t scale, float64x2_t offset, double *out) {
+    if (is_signed) {
+        int16x8_t s = vreinterpretq_s16_u16(v);
+        Store4Neon(vmovl_s16(vget_low_s16(s)), scale, offset, out);
+        Store4Neon(vmovl_high_s16(s), scale, offset, out + 4);
+    } else {
+        Store4Neon(vmovl_u16(vget_low_u16(v)), scale, offset, out);
+        Store4Neon(vmovl_high_u16(v), scale, offset, out + 4);
+    }
+}
+
+static size_t ConvertNeon(ColumnFormat const& format, uint8_t const* raw, size_t n, double *out) {
+    float64x2_t scale = vdupq_n_f64(format.scale);
+    float64x2_t offset = vdupq_n_f64(format.offset);
+    bool is_signed = format.type == ValueType::SIGNED;
+    size_t i = 0;
+    if (format.width == 1) {
+        for (; i + 8 <= n; i += 8) {
+            uint8x8_t v = vld1_u8(raw + i);
+            uint16x8_t wide = is_signed ? vreinterpretq_u16_s16(vmovl_s8(vreinterpret_s8_u8(v))) : vmovl_u8(v);
+            Store8Neon(wide, is_signed, scale, offset, out + i);
+        }
+    } else if (format.width == 2) {
+        for (; i + 8 <= n; i += 8) {
+            uint8x16_t v = vld1q_u8(raw + i * 2);
+            if (format.big_endian) {
+                v = vrev16q_u8(v);
+            }
+            Store8Neon(vreinterpretq_u16_u8(v), is_signed, scale, offset, out + i);
+        }
+    } else if (format.width == 4) {
+        for (; i + 4 <= n; i += 4) {
+            uint8x16_t v = vld1q_u8(raw + i * 4);
+            if (format.big_endian) {
+                v = vrev32q_u8(v);
+            }
+            if (format.type == ValueType::FLOAT32) {
+                float32x4_t f = vreinterpretq_f32_u8(v);
+                StoreNeon(vcvt_f64_f32(vget_low_f32(f)), scale, offset, out + i);
+                StoreNeon(vcvt_high_f64_f32(f), scale, offset, out + i + 2);
+            } else if (is_signed) {
+                Store4Neon(vreinterpretq_s32_u8(v), scale, offset, out + i);
+            } else {
+                Store4Neon(vreinterpretq_u32_u8(v), scale, offset, out + i);
+            }
+        }
+    }
+    return ConvertScalar(format, raw, i, n, out);
+}
+
+#endif
+
+void ConvertColumn(DecodeKernel kernel, ColumnFormat const& format, uint8_t const* raw, size_t n, double *out) {
+    switch (kernel) {
+#if defined(__x86_64__)
+        case DecodeKernel::SSE2:
+            ConvertSse2(format, raw, n, out);
+            return;
+        case DecodeKernel::AVX2:
+            ConvertAvx2(format, raw, n, out);
+            return;
+#elif defined(__aarch64__)
+        case DecodeKernel::NEON:
+            ConvertNeon(format, raw, n, out);
+            return;
+#endif
+        default:
+            ConvertScalar(format, raw, 0, n, out);
+            return;
+    }
+}
+
+// Column format of a signal that covers whole bytes; false for bit fields
+static bool WholeField(SignalDef const& signal, ColumnFormat &format, uint8_t &offset) {
+    bool sized = signal.type == ValueType::FLOAT32
+                         ? signal.length == 32
+                         : signal.length == 8 || signal.length == 16 || signal.length == 32;
+    // DBC start bits: the LSB for little-endian, the MSB for big-endian
+    int aligned_bit = signal.byte_order == ByteOrder::BIG_ENDIAN_ORDER ? 7 : 0;
+    if (!sized || signal.start_bit % 8 != aligned_bit) {
+        return false;
+    }
+    format = {static_cast<uint8_t>(signal.length / 8), signal.byte_order == ByteOrder::BIG_ENDIAN_ORDER,
+              signal.type, signal.scale, signal.offset};
+    offset = static_cast<uint8_t>(signal.start_bit / 8);
+    return true;
+}
+
+BatchDecoder::BatchDecoder(MessageInfo const* messages, size_t message_count, DecodeKernel kernel)
+        : messages_(messages),
+          kernel_(KernelSupported(kernel) ? kernel : DecodeKernel::SCALAR),
+          plans_(message_count),
+          standard_index_(CAN_SFF_MASK + 1, -1) {
+    for (size_t m = 0; m < message_count; m++) {
+        MessageInfo const& info = messages[m];
+        if (info.can_id & CAN_EFF_FLAG) {
+            extended_index_.emplace_back(info.can_id, static_cast<int16_t>(m));
+        } else {
+            standard_index_[info.can_id & CAN_SFF_MASK] = static_cast<int16_t>(m);
+        }
+        Plan &plan = plans_[m];
+        for (size_t s = 0; s < info.signal_count; s++) {
+            SignalDef const& signal = info.signals[s];
+            Column column = {};
+            column.signal = signal;
+            column.vector = WholeField(signal, column.format, column.offset);
+            int window = signal.Window(info.LastWindow());
+            column.window = static_cast<uint8_t>(window);
+            column.shift = static_cast<uint8_t>(signal.Shift(window));
+            column.sign_shift = signal.type == ValueType::SIGNED ? static_cast<uint8_t>(64 - signal.length) : 0;
+            column.mask = signal.Mask();
+            plan.columns.push_back(column);
+        }
+        plan.records.reserve(MAX_SAMPLES);
+        plan.slots.reserve(MAX_SAMPLES);
+    }
+    touched_.reserve(message_count);
+}
+
+int BatchDecoder::MessageIndexOf(canid_t can_id) const {
+    if (!(can_id & CAN_EFF_FLAG)) {
+        return standard_index_[can_id & CAN_SFF_MASK];
+    }
+    canid_t key = can_id & (CAN_EFF_FLAG | CAN_EFF_MASK);
+    for (auto const& [id, message] : extended_index_) {
+        if (id == key) {
+            return message;
+        }
+    }
+    return -1;
+}
+
+size_t BatchDecoder::Decode(CanRxFrame const* frames, size_t count) {
+    if (count > results_.size()) {
+        count = results_.size();
+    }
+    touched_.clear();
+    size_t used = 0;
+    size_t consumed = 0;
+    // Pass 1: group the records of every frame by message
+    for (; consumed < count; consumed++) {
+        canfd_frame const& frame = frames[consumed].frame;
+        FrameResult &result = results_[consumed];
+        result = {-1, 0, 0};
+        if (frame.can_id & (CAN_RTR_FLAG | CAN_ERR_FLAG)) {
+            continue;
+        }
+        int message = MessageIndexOf(frame.can_id);
+        if (message < 0) {
+            continue;
+        }
+        result.message = static_cast<int16_t>(message);
+        MessageInfo const& info = messages_[message];
+        if (frame.len < info.dlc) {
+            continue;
+        }
+        if (used + info.sample_count > MAX_SAMPLES) {
+            break;
+        }
+        Plan &plan = plans_[message];
+        if (plan.records.empty()) {
+            touched_.push_back(static_cast<uint16_t>(message));
+        }
+        result.count = info.sample_count;
+        result.first = static_cast<uint16_t>(used);
+        for (size_t k = 0; k < info.sample_count; k++) {
+            DecodedFrame &sample = samples_[used];
+            sample.can_id = frame.can_id;
+            sample.message = static_cast<uint16_t>(message);
+            sample.count = static_cast<uint8_t>(info.signal_count);
+            plan.records.push_back(frame.data + k * info.sample_stride);
+            plan.slots.push_back(static_cast<uint16_t>(used));
+            used++;
+        }
+    }
+    // Pass 2: one column at a time per message
+    for (uint16_t message : touched_) {
+        DecodeGroup(message);
+        plans_[message].records.clear();
+        plans_[message].slots.clear();
+    }
+    return consumed;
+}
+
+void BatchDecoder::DecodeGroup(size_t message) {
+    Plan const& plan = plans_[message];
+    size_t n = plan.records.size();
+    for (size_t s = 0; s < plan.columns.size(); s++) {
+        Column const& column = plan.columns[s];
+        if (column.vector) {
+            // Gather the field of every record into one contiguous column
+            size_t width = column.format.width;
+            for (size_t j = 0; j < n; j++) {
+                std::memcpy(&raw_[j * width], plan.records[j] + column.offset, width);
+            }
+            ConvertColumn(kernel_, column.format, raw_.data(), n, values_.data());
+            for (size_t j = 0; j < n; j++) {
+                samples_[plan.slots[j]].values[s] = values_[j];
+            }
+            continue;
+        }
+        for (size_t j = 0; j < n; j++) {
+            uint64_t word = signal_detail::LoadPayload(plan.records[j] + column.window, column.signal.byte_order);
+            uint64_t raw = (word >> column.shift) & column.mask;
+            double value;
+            if (column.signal.type == ValueType::FLOAT32) {
+                uint32_t bits = static_cast<uint32_t>(raw);
+                float f;
+                std::memcpy(&f, &bits, sizeof(f));
+                value = f;
+            } else if (column.signal.type == ValueType::SIGNED) {
+                value = static_cast<double>(static_cast<int64_t>(raw << column.sign_shift) >> column.sign_shift);
+            } else {
+                value = static_cast<double>(raw);
+            }
+            samples_[plan.slots[j]].values[s] = value * column.signal.scale + column.signal.offset;
+        }
+    }
+}
+
+}  // namespace tcc::aaos::can
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "can_signal.h"
+#include "socket_can.h"
+
+namespace tcc::aaos::can {
+
+// Instruction set a column is converted with
+enum class DecodeKernel {
+    SCALAR,
+    SSE2,  // x86-64 baseline
+    AVX2,  // x86-64, detected at run time
+    NEON,  // AArch64 (Cortex-A72 on the Pi)
+};
+
+char const* KernelName(DecodeKernel kernel);
+// Inverse of KernelName(); false for an unknown name
+bool ParseKernelName(std::string const& name, DecodeKernel &kernel);
+// Whether this build and CPU can run kernel
+bool KernelSupported(DecodeKernel kernel);
+// Widest supported kernel
+DecodeKernel BestKernel();
+
+// Layout of a signal that is a whole 1, 2 or 4-byte field: the only kind a
+// column kernel converts. Other signals (bit fields, 64-bit) are extracted
+// one record at a time like SignalDatabase::Decode().
+struct ColumnFormat {
+    uint8_t width; // Bytes: 1, 2 or 4 (FLOAT32 is always 4)
+    bool big_endian;
+    ValueType type;
+    double scale;
+    double offset;
+};
+
+// Converts n fields of format, gathered back to back in wire order at raw,
+// to physical values: byteswap, sign extension or float widening, then
+// value * scale + offset, exactly like the per-frame decoders. Reads
+// width * n bytes of raw.
+void ConvertColumn(DecodeKernel kernel, ColumnFormat const& format, uint8_t const* raw, size_t n, double *out);
+
+// Decodes a batch of frames message by message instead of frame by frame.
+// Frames are grouped by ID, every signal of a group is gathered into one
+// contiguous column (structure of arrays) and converted with a SIMD kernel,
+// and the values are scattered back into samples in frame order. Results
+// match MessageDecoder::Decode() of the same message table.
+class BatchDecoder {
+public:
+    // Samples decoded by one Decode() call; a batch of multi-sample frames
+    // may take several calls
+    constexpr static size_t MAX_SAMPLES = 256;
+
+    // Outcome of one frame of the last Decode()
+    struct FrameResult {
+        int16_t message; // Index into messages, -1 when not in the set (or an error/RTR frame)
+        uint8_t count;   // Samples decoded, 0 when shorter than the message's DLC
+        uint16_t first;  // Index of its first sample in Samples()
+    };
+
+    // messages must outlive the decoder; FrameResult::message and
+    // DecodedFrame::message index it
+    BatchDecoder(MessageInfo const* messages, size_t message_count, DecodeKernel kernel = BestKernel());
+
+    // Decodes the longest prefix of frames, at most MAX_RX_BATCH, whose
+    // samples fit MAX_SAMPLES (at least one frame when count > 0) and
+    // returns its length. Samples get can_id, message, count and values;
+    // the caller stamps the times.
+    size_t Decode(CanRxFrame const* frames, size_t count);
+
+    FrameResult const& Result(size_t frame) const { return results_[frame]; }
+    DecodedFrame *Samples() { return samples_.data(); }
+    DecodeKernel Kernel() const { return kernel_; }
+
+private:
+    // How one signal of a message is decoded
+    struct Column {
+        bool vector;         // Converted by ConvertColumn()
+        ColumnFormat format; // vector: field at byte offset of each record
+        uint8_t offset;
+        // !vector: load-shift-mask like SignalDatabase::PackedSignal
+        uint8_t window;
+        uint8_t shift;
+        uint8_t sign_shift;
+        uint64_t mask;
+        SignalDef signal;
+    };
+    struct Plan {
+        std::vector<Column> columns;
+        // Records of the current batch: sample k of a frame is one record
+        std::vector<uint8_t const*> records;
+        std::vector<uint16_t> slots; // Sample index of each record
+    };
+
+    int MessageIndexOf(canid_t can_id) const;
+    // Converts every column of a message's records into samples_
+    void DecodeGroup(size_t message);
+
+    MessageInfo const* messages_;
+    DecodeKernel kernel_;
+    std::vector<Plan> plans_;
+    std::vector<int16_t> standard_index_; // Message per 11-bit ID, -1 when none
+    std::vector<std::pair<canid_t, int16_t>> extended_index_;
+    std::vector<uint16_t> touched_; // Messages with records in this batch
+
+    std::array<FrameResult, MAX_RX_BATCH> results_;
+    std::array<DecodedFrame, MAX_SAMPLES> samples_;
+    // Column scratch: gathered fields and converted values
+    alignas(32) std::array<uint8_t, MAX_SAMPLES * 4> raw_;
+    alignas(32) std::array<double, MAX_SAMPLES> values_;
+};
+
+}  // namespace tcc::aaos::can
@@ -0,0 +1,28 @@
+#include "buffer_pool.h"
+
+namespace tcc::aaos::can {
+
+BufferPool::BufferPool(size_t buffer_size, size_t count)
+        : buffer_size_(buffer_size), storage_(buffer_size * count) {
+    free_.reserve(count);
+    // Handed out lowest address first
+    for (size_t i = count; i > 0; i--) {
+        free_.push_back(storage_.data() + (i - 1) * buffer_size);
+    }
+}
+
+uint8_t *BufferPool::Acquire() {
+    if (free_.empty()) {
+        exhausted_++;
+        return nullptr;
+    }
+    uint8_t *buffer = free_.back();
+    free_.pop_back();
+    return buffer;
+}
+
+void BufferPool::Release(uint8_t *buffer) {
+    free_.push_back(buffer);
+}
+
+}  // namespace tcc::aaos::can
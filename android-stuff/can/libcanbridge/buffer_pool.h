@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tcc::aaos::can {
+
+// Fixed set of equally sized buffers carved out of one allocation made by
+// the constructor. Acquire() and Release() pop and push a free list, so
+// buffers can be handed around per message without touching the heap. Not
+// thread-safe: one owning thread.
+class BufferPool {
+public:
+    BufferPool(size_t buffer_size, size_t count);
+    BufferPool(BufferPool const&) = delete;
+    BufferPool& operator=(BufferPool const&) = delete;
+
+    // nullptr (counted in Exhausted()) when every buffer is in use
+    uint8_t *Acquire();
+    // buffer must come from Acquire() of this pool
+    void Release(uint8_t *buffer);
+
+    size_t BufferSize() const { return buffer_size_; }
+    size_t Available() const { return free_.size(); }
+    uint64_t Exhausted() const { return exhausted_; }
+
+private:
+    size_t buffer_size_;
+    std::vector<uint8_t> storage_;
+    std::vector<uint8_t *> free_;
+    uint64_t exhausted_ = 0;
+};
+
+}  // namespace tcc::aaos::can
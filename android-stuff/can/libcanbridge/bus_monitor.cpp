@@ -0,0 +1,272 @@
+#include "bus_monitor.h"
+
+#include <net/if.h>
+#include <time.h>
+
+#include "async_log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace tcc::aaos::can {
+
+constexpr static char TAG[] = "BUS_MONITOR";
+
+static int64_t MonotonicNowNs() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1'000'000'000 + now.tv_nsec;
+}
+
+static BusState FromKernelState(can_state state) {
+    switch (state) {
+        case CAN_STATE_ERROR_WARNING:
+            return BusState::ERROR_WARNING;
+        case CAN_STATE_ERROR_PASSIVE:
+            return BusState::ERROR_PASSIVE;
+        case CAN_STATE_BUS_OFF:
+            return BusState::BUS_OFF;
+        default:
+            return BusState::ERROR_ACTIVE;
+    }
+}
+
+char const* BusStateName(BusState state) {
+    switch (state) {
+        case BusState::ERROR_ACTIVE:
+            return "error-active";
+        case BusState::ERROR_WARNING:
+            return "error-warning";
+        case BusState::ERROR_PASSIVE:
+            return "error-passive";
+        case BusState::BUS_OFF:
+            return "bus-off";
+    }
+    return "unknown";
+}
+
+ErrorFrameInfo ClassifyErrorFrame(canfd_frame const& frame) {
+    ErrorFrameInfo info = {};
+    info.classes = frame.can_id & CAN_ERR_MASK;
+    uint8_t const* data = frame.data;
+
+    if (info.classes & CAN_ERR_CRTL) {
+        uint8_t controller = data[1];
+        info.rx_overflow = controller & CAN_ERR_CRTL_RX_OVERFLOW;
+        info.tx_overflow = controller & CAN_ERR_CRTL_TX_OVERFLOW;
+        // Worst state reported wins; ACTIVE is only reported on its own
+        if (controller & (CAN_ERR_CRTL_RX_PASSIVE | CAN_ERR_CRTL_TX_PASSIVE)) {
+            info.has_state = true;
+            info.state = BusState::ERROR_PASSIVE;
+        } else if (controller & (CAN_ERR_CRTL_RX_WARNING | CAN_ERR_CRTL_TX_WARNING)) {
+            info.has_state = true;
+            info.state = BusState::ERROR_WARNING;
+        } else if (controller & CAN_ERR_CRTL_ACTIVE) {
+            info.has_state = true;
+            info.state = BusState::ERROR_ACTIVE;
+        }
+    }
+    if (info.classes & CAN_ERR_RESTARTED) {
+        info.has_state = true;
+        info.state = BusState::ERROR_ACTIVE;
+    }
+    if (info.classes & CAN_ERR_BUSOFF) {
+        info.has_state = true;
+        info.state = BusState::BUS_OFF;
+    }
+    if (info.classes & CAN_ERR_CNT) {
+        info.has_counters = true;
+        info.tx_errors = data[6];
+        info.rx_errors = data[7];
+    }
+    return info;
+}
+
+BusMonitor::BusMonitor(EventLoop &loop, CanLinkControl &link, std::string const& interface_name,
+                       BusRecoveryConfig const& config)
+        : loop_(loop), link_(link), interface_name_(interface_name), config_(config) {
+    stats_.interface_name = interface_name;
+    stats_.state = BusState::ERROR_ACTIVE;
+}
+
+bool BusMonitor::Init() {
+    ifindex_ = static_cast<int>(if_nametoindex(interface_name_.c_str()));
+    if (ifindex_ == 0) {
+        CAN_LOG(ERROR, TAG, "Unknown interface %s", interface_name_.c_str());
+        return false;
+    }
+    // Disarmed until a restart has to be retried
+    retry_timer_ = loop_.AddTimer(0, [this] { OnRetryTimer(); });
+    if (retry_timer_ < 0) {
+        return false;
+    }
+    int64_t now_ns = MonotonicNowNs();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        state_since_ns_ = now_ns;
+    }
+    // The bus may have gone off before we started
+    CanLinkState link_state;
+    if (link_.GetState(ifindex_, link_state) == 0) {
+        SetState(FromKernelState(link_state.state), now_ns);
+        if (link_state.state == CAN_STATE_BUS_OFF) {
+            EnterBusOff();
+        }
+    }
+    return true;
+}
+
+void BusMonitor::OnErrorFrame(canfd_frame const& frame) {
+    ErrorFrameInfo info = ClassifyErrorFrame(frame);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.error_frames++;
+        stats_.tx_timeouts += (info.classes & CAN_ERR_TX_TIMEOUT) != 0;
+        stats_.lost_arbitration += (info.classes & CAN_ERR_LOSTARB) != 0;
+        stats_.controller_errors += (info.classes & CAN_ERR_CRTL) != 0;
+        stats_.protocol_errors += (info.classes & CAN_ERR_PROT) != 0;
+        stats_.transceiver_errors += (info.classes & CAN_ERR_TRX) != 0;
+        stats_.ack_errors += (info.classes & CAN_ERR_ACK) != 0;
+        stats_.bus_errors += (info.classes & CAN_ERR_BUSERROR) != 0;
+        stats_.controller_overflows += info.rx_overflow + info.tx_overflow;
+        if (info.has_counters) {
+            stats_.tx_errors = info.tx_errors;
+            stats_.rx_errors = info.rx_errors;
+        }
+    }
+    if (info.classes & CAN_ERR_TRX) {
+        CAN_LOG(WARN, TAG, "%s: transceiver error 0x%02x", interface_name_.c_str(), frame.data[4]);
+    }
+    if (!info.has_state) {
+        return;
+    }
+    if (info.state == BusState::BUS_OFF) {
+        EnterBusOff();
+    } else if (bus_off_) {
+        Recovered((info.classes & CAN_ERR_RESTARTED) ? "restarted" : "controller state");
+        SetState(info.state, MonotonicNowNs());
+    } else {
+        SetState(info.state, MonotonicNowNs());
+    }
+}
+
+void BusMonitor::SetState(BusState state, int64_t now_ns) {
+    BusState previous;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        previous = stats_.state;
+        if (state == previous) {
+            return;
+        }
+        int64_t elapsed_ns = now_ns - state_since_ns_;
+        if (previous == BusState::ERROR_PASSIVE) {
+            stats_.error_passive_ns += elapsed_ns;
+        } else if (previous == BusState::BUS_OFF) {
+            stats_.bus_off_ns += elapsed_ns;
+        }
+        stats_.error_warnings += state == BusState::ERROR_WARNING;
+        stats_.error_passives += state == BusState::ERROR_PASSIVE;
+        stats_.bus_offs += state == BusState::BUS_OFF;
+        stats_.state = state;
+        state_since_ns_ = now_ns;
+    }
+    if (state == BusState::ERROR_ACTIVE) {
+        CAN_LOG(INFO, TAG, "%s: %s -> %s", interface_name_.c_str(), BusStateName(previous), BusStateName(state));
+    } else {
+        CAN_LOG(WARN, TAG, "%s: %s -> %s", interface_name_.c_str(), BusStateName(previous), BusStateName(state));
+    }
+}
+
+void BusMonitor::EnterBusOff() {
+    if (bus_off_) {
+        return;
+    }
+    int64_t now_ns = MonotonicNowNs();
+    bus_off_ = true;
+    bus_off_since_ns_ = now_ns;
+    backoff_ns_ = config_.initial_backoff_ns;
+    SetState(BusState::BUS_OFF, now_ns);
+    if (config_.auto_restart) {
+        Restart();
+    }
+}
+
+void BusMonitor::Recovered(char const* evidence) {
+    int64_t now_ns = MonotonicNowNs();
+    int64_t recovery_ns = now_ns - bus_off_since_ns_;
+    bus_off_ = false;
+    EventLoop::ArmTimer(retry_timer_, 0);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.last_recovery_ns = recovery_ns;
+        stats_.max_recovery_ns = std::max(stats_.max_recovery_ns, recovery_ns);
+    }
+    SetState(BusState::ERROR_ACTIVE, now_ns);
+    CAN_LOG(INFO, TAG, "%s: recovered from bus-off in %lld us (%s)", interface_name_.c_str(),
+            static_cast<long long>(recovery_ns / 1000), evidence);
+}
+
+void BusMonitor::Restart() {
+    int result = link_.Restart(ifindex_);
+    if (result == -EBUSY) {
+        // The controller already left bus-off (restart-ms, or it recovered
+        // on its own); its next error frame or data frame says how it is
+        CanLinkState link_state;
+        if (link_.GetState(ifindex_, link_state) == 0 && link_state.state != CAN_STATE_BUS_OFF) {
+            Recovered("kernel");
+            return;
+        }
+    } else if (result < 0) {
+        // -EINVAL: restart-ms is set and the kernel restarts on its own
+        // schedule; -EOPNOTSUPP: not a CAN controller. Either way a down/up
+        // cycle reinitializes the controller now.
+        result = link_.CycleLink(ifindex_);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (result == 0) {
+            stats_.restarts++;
+        } else {
+            stats_.restart_failures++;
+        }
+    }
+    if (result < 0) {
+        CAN_LOG(ERROR, TAG, "%s: restart failed: %s", interface_name_.c_str(), strerror(-result));
+    }
+    // Check again after the backoff; a successful restart normally cancels
+    // this through Recovered() long before
+    EventLoop::ArmTimer(retry_timer_, backoff_ns_);
+    backoff_ns_ = std::min(backoff_ns_ * 2, config_.max_backoff_ns);
+}
+
+void BusMonitor::OnRetryTimer() {
+    if (!bus_off_) {
+        return;
+    }
+    CanLinkState link_state;
+    if (link_.GetState(ifindex_, link_state) == 0 && link_state.state != CAN_STATE_BUS_OFF) {
+        Recovered("kernel");
+        return;
+    }
+    Restart();
+}
+
+BusState BusMonitor::State() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_.state;
+}
+
+BusStats BusMonitor::Stats() const {
+    int64_t now_ns = MonotonicNowNs();
+    std::lock_guard<std::mutex> lock(mutex_);
+    BusStats stats = stats_;
+    if (stats.state == BusState::ERROR_PASSIVE) {
+        stats.error_passive_ns += now_ns - state_since_ns_;
+    } else if (stats.state == BusState::BUS_OFF) {
+        stats.bus_off_ns += now_ns - state_since_ns_;
+    }
+    return stats;
+}
+
+}  // namespace tcc::aaos::can
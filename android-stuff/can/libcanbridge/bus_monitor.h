@@ -0,0 +1,133 @@
+#pragma once
+
+#include <linux/can.h>
+#include <linux/can/error.h>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "can_netlink.h"
+#include "event_loop.h"
+
+namespace tcc::aaos::can {
+
+// Fault confinement state of a CAN controller (ISO 11898-1)
+enum class BusState : uint8_t {
+    ERROR_ACTIVE,
+    ERROR_WARNING, // An error counter reached 96
+    ERROR_PASSIVE, // An error counter reached 128: the node may no longer signal errors
+    BUS_OFF,       // TX error counter reached 256: the node is off the bus until restarted
+};
+
+char const* BusStateName(BusState state);
+
+// What one error frame (CAN_ERR_FLAG, see linux/can/error.h) reports
+struct ErrorFrameInfo {
+    uint32_t classes;  // CAN_ERR_TX_TIMEOUT ... CAN_ERR_CNT bits of can_id
+    bool has_state;    // Whether the frame reports a controller state
+    BusState state;
+    bool rx_overflow;  // CAN_ERR_CRTL_RX_OVERFLOW / CAN_ERR_CRTL_TX_OVERFLOW
+    bool tx_overflow;
+    bool has_counters; // CAN_ERR_CNT: TX/RX error counters in data[6..7]
+    uint8_t tx_errors;
+    uint8_t rx_errors;
+};
+
+ErrorFrameInfo ClassifyErrorFrame(canfd_frame const& frame);
+
+struct BusRecoveryConfig {
+    // Restart the interface after bus-off instead of waiting for restart-ms
+    // (or forever, when restart-ms is 0, the driver default)
+    bool auto_restart = true;
+    // The first restart is immediate; while the controller stays bus-off it
+    // is retried after initial_backoff_ns, doubling up to max_backoff_ns
+    int64_t initial_backoff_ns = 1'000'000;
+    int64_t max_backoff_ns = 200'000'000;
+    // CAN_RAW_ERR_FILTER classes delivered as error frames
+    can_err_mask_t error_mask = CAN_ERR_MASK;
+};
+
+struct BusStats {
+    std::string interface_name;
+    BusState state;
+    uint64_t error_frames;
+    // Error frames per class
+    uint64_t tx_timeouts;
+    uint64_t lost_arbitration;
+    uint64_t controller_errors;
+    uint64_t protocol_errors;
+    uint64_t transceiver_errors;
+    uint64_t ack_errors;
+    uint64_t bus_errors;
+    uint64_t controller_overflows; // RX/TX buffer overflows reported by the controller
+    uint8_t tx_errors;             // Last CAN_ERR_CNT error counters
+    uint8_t rx_errors;
+    // State transitions and recovery
+    uint64_t error_warnings;
+    uint64_t error_passives;
+    uint64_t bus_offs;
+    uint64_t restarts;         // Restart requests the kernel accepted
+    uint64_t restart_failures; // Restart requests refused (e.g. no CAP_NET_ADMIN)
+    // Time spent error-passive and bus-off, including the current period
+    int64_t error_passive_ns;
+    int64_t bus_off_ns;
+    // Bus-off to the first sign of a working controller
+    int64_t last_recovery_ns;
+    int64_t max_recovery_ns;
+};
+
+// Watches the error frames of one CAN interface, keeps its fault
+// confinement state and, after bus-off, restarts the interface through
+// CanLinkControl on the loop thread: immediately, then with bounded
+// exponential backoff while the controller stays bus-off. Recovery is
+// confirmed by a CAN_ERR_RESTARTED frame, any received data frame or the
+// kernel reporting the controller error-active again.
+//
+// All On*() calls come from the loop thread; Stats() from any thread.
+class BusMonitor {
+public:
+    // loop and link must outlive the monitor
+    BusMonitor(EventLoop &loop, CanLinkControl &link, std::string const& interface_name,
+               BusRecoveryConfig const& config = {});
+
+    // Resolves the interface and reads its current state
+    bool Init();
+
+    void OnErrorFrame(canfd_frame const& frame);
+    // Data frames arrived: a bus-off controller has been restarted
+    void OnDataFrames() {
+        if (bus_off_) {
+            Recovered("data frame");
+        }
+    }
+
+    BusState State() const;
+    BusStats Stats() const;
+    std::string const& GetInterfaceName() const { return interface_name_; }
+
+private:
+    void SetState(BusState state, int64_t now_ns);
+    void EnterBusOff();
+    void Recovered(char const* evidence);
+    void Restart();
+    void OnRetryTimer();
+
+    EventLoop &loop_;
+    CanLinkControl &link_;
+    std::string interface_name_;
+    BusRecoveryConfig config_;
+    int ifindex_ = 0;
+    int retry_timer_ = -1;
+
+    // Loop thread only
+    bool bus_off_ = false;
+    int64_t bus_off_since_ns_ = 0;
+    int64_t backoff_ns_ = 0;
+
+    mutable std::mutex mutex_;
+    BusStats stats_{};
+    int64_t state_since_ns_ = 0;
+};
+
+}  // namespace tcc::aaos::can
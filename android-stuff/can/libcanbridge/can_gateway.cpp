@@ -0,0 +1,394 @@
+#include "can_gateway.h"
+
+#include "async_log.h"
+
+#include <time.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace tcc::aaos::can {
+
+constexpr static char TAG[] = "CAN_GATEWAY";
+
+static int64_t MonotonicNowNs() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1'000'000'000 + now.tv_nsec;
+}
+
+static void SleepUntil(int64_t monotonic_ns) {
+    timespec until = {static_cast<time_t>(monotonic_ns / 1'000'000'000),
+                      static_cast<long>(monotonic_ns % 1'000'000'000)};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, nullptr) == EINTR) {
+    }
+}
+
+CanGateway::CanGateway(EventLoop &loop, MessageDecoder const& decoder, Publisher &publisher)
+        : loop_(loop), decoder_(decoder), publisher_(publisher), message_counters_(decoder.MessageCount()) {}
+
+void CanGateway::SetBatchDecode(bool enabled, DecodeKernel kernel) {
+    batch_decoder_.reset();
+    if (enabled) {
+        batch_decoder_ = std::make_unique<BatchDecoder>(decoder_.Messages(), decoder_.MessageCount(), kernel);
+        CAN_LOG(INFO, TAG, "Batch decoding with %s kernels", KernelName(batch_decoder_->Kernel()));
+    }
+}
+
+bool CanGateway::AddInterface(std::string const& name, RxBackend backend) {
+    if (backend == RxBackend::PACKET_RING) {
+        return AddRing(name);
+    }
+    auto socket_can = std::make_unique<SocketCan>(name);
+    // A mesma tabela de decodificação gera o CAN_RAW_FILTER do socket
+    socket_can->SetFilters(decoder_.Filters());
+    socket_can->SetErrorMask(recovery_.error_mask);
+    socket_can->SetBufferSizes(receive_buffer_, send_buffer_);
+    if (!socket_can->Init() || !socket_can->SetNonBlocking(true)) {
+        CAN_LOG(ERROR, TAG, "Failed to initialize socket CAN on %s", name.c_str());
+        return false;
+    }
+    if (receive_buffer_ > 0 || send_buffer_ > 0) {
+        CAN_LOG(INFO, TAG, "%s: receive buffer %d bytes, send buffer %d bytes", name.c_str(),
+                socket_can->ReceiveBufferSize(), socket_can->SendBufferSize());
+    }
+    BusMonitor *monitor = AddMonitor(name);
+    SocketCan *bus = socket_can.get();
+    if (!loop_.AddFd(bus->GetFd(), [this, bus, monitor](uint32_t) { OnReadable(*bus, monitor); })) {
+        return false;
+    }
+    sockets_.push_back(std::move(socket_can));
+    return true;
+}
+
+bool CanGateway::AddRing(std::string const& name) {
+    auto ring = std::make_unique<PacketRing>(name);
+    ring->SetFilters(decoder_.Filters());
+    ring->SetErrorMask(recovery_.error_mask);
+    if (!ring->Init()) {
+        CAN_LOG(ERROR, TAG, "Failed to initialize RX ring on %s", name.c_str());
+        return false;
+    }
+    BusMonitor *monitor = AddMonitor(name);
+    PacketRing *bus = ring.get();
+    if (!loop_.AddFd(bus->GetFd(), [this, bus, monitor](uint32_t) { OnRingReadable(*bus, monitor); })) {
+        return false;
+    }
+    rings_.push_back(std::move(ring));
+    return true;
+}
+
+bool CanGateway::AddIsoTp(std::string const& name, IsoTpConfig const& config) {
+    int message = MessageIndexOf(config.message_id);
+    if (message < 0) {
+        CAN_LOG(ERROR, TAG, "ISO-TP message 0x%x is not decoded", config.message_id);
+        return false;
+    }
+    // PDUs are split into records of dlc bytes; fault-only DBC messages
+    // may declare none
+    if (decoder_.Messages()[message].dlc == 0) {
+        CAN_LOG(ERROR, TAG, "ISO-TP message 0x%x has no payload to split PDUs into", config.message_id);
+        return false;
+    }
+    auto socket = std::make_unique<IsoTpSocket>(name, config);
+    if (!socket->Init()) {
+        CAN_LOG(ERROR, TAG, "Failed to initialize ISO-TP 0x%x on %s", config.rx_id, name.c_str());
+        return false;
+    }
+    IsoTpSocket *channel = socket.get();
+    size_t index = static_cast<size_t>(message);
+    if (!loop_.AddFd(channel->GetFd(), [this, channel, index](uint32_t) { OnIsoTpReadable(*channel, index); })) {
+        return false;
+    }
+    isotp_sockets_.push_back(std::move(socket));
+    return true;
+}
+
+BusMonitor *CanGateway::AddMonitor(std::string const& name) {
+    // Without the netlink socket restarts fail and are counted; the error
+    // frames are still classified
+    if (!netlink_open_) {
+        netlink_open_ = netlink_.Open();
+    }
+    auto monitor = std::make_unique<BusMonitor>(loop_, netlink_, name, recovery_);
+    if (!monitor->Init()) {
+        CAN_LOG(WARN, TAG, "No bus monitoring on %s", name.c_str());
+        return nullptr;
+    }
+    monitors_.push_back(std::move(monitor));
+    return monitors_.back().get();
+}
+
+void CanGateway::OnRingReadable(PacketRing &ring, BusMonitor *monitor) {
+    uint64_t decoded = 0;
+    uint64_t errors = 0;
+    size_t count = ring.Poll([this, &decoded, &errors, monitor](canfd_frame const& frame, int64_t rx_ns) {
+        errors += (frame.can_id & CAN_ERR_FLAG) != 0;
+        decoded += Handle(frame, rx_ns, false, monitor);
+    });
+    counters_.frames.Add(count);
+    counters_.decoded.Add(decoded);
+    if (errors > 0) {
+        counters_.error_frames.Add(errors);
+    }
+    if (monitor != nullptr && count > errors) {
+        monitor->OnDataFrames();
+    }
+    if (decoded > 0) {
+        publisher_.Notify();
+    }
+    UpdateDrops();
+}
+
+void CanGateway::OnIsoTpReadable(IsoTpSocket &socket, size_t message) {
+    uint64_t decoded = 0;
+    int count = socket.Poll(pdu_pool_, [this, &decoded, message](uint8_t const* data, size_t length, int64_t rx_ns) {
+        decoded += HandlePdu(data, length, rx_ns, message);
+    });
+    if (count < 0) {
+        counters_.read_errors.Add();
+        return;
+    }
+    counters_.pdus.Add(static_cast<uint64_t>(count));
+    counters_.decoded.Add(decoded);
+}
+
+uint64_t CanGateway::HandlePdu(uint8_t const* data, size_t length, int64_t rx_ns, size_t message) {
+    MessageInfo const& info = decoder_.Messages()[message];
+    size_t records = length / info.dlc;
+    if (records * info.dlc != length) {
+        counters_.decode_failures.Add();
+        message_counters_[message].decode_failures.Add();
+    }
+    // A record holds sample_count samples; the last one arrived with the PDU
+    int64_t record_period_ns = info.sample_period_ns * info.sample_count;
+    canfd_frame frame = {};
+    frame.can_id = info.can_id;
+    frame.len = info.dlc;
+    frame.flags = info.dlc > CAN_MAX_DLEN ? CANFD_FDF : 0;
+    uint64_t decoded = 0;
+    for (size_t r = 0; r < records; r++) {
+        std::memcpy(frame.data, data + r * info.dlc, info.dlc);
+        int64_t record_ns = rx_ns - static_cast<int64_t>(records - 1 - r) * record_period_ns;
+        decoded += Handle(frame, record_ns, false, nullptr);
+        // Lets the publisher drain a long PDU while the rest is decoded
+        if ((r + 1) % MAX_RX_BATCH == 0) {
+            publisher_.Notify();
+        }
+    }
+    publisher_.Notify();
+    return decoded;
+}
+
+void CanGateway::OnReadable(SocketCan &bus, BusMonitor *monitor) {
+    int count = bus.ReadCanMessages(rx_batch_.data(), rx_batch_.size());
+    if (count < 0) {
+        counters_.read_errors.Add();
+        if (errno == ENETDOWN) {
+            // Reported once to every bound socket when the link goes down,
+            // e.g. while BusMonitor cycles it; the socket stays usable
+            CAN_LOG(WARN, TAG, "%s went down", bus.GetInterfaceName().c_str());
+        } else {
+            CAN_LOG(ERROR, TAG, "Failed to read CAN message on %s", bus.GetInterfaceName().c_str());
+        }
+        return;
+    }
+    Process(rx_batch_.data(), static_cast<size_t>(count), false, monitor);
+    // Lost right before this batch: the receive buffer filled up while the
+    // thread was away, e.g. descheduled
+    if (bus.LastBatchDrops() > 0) {
+        CAN_LOG(WARN, TAG, "%s: kernel dropped %u frames (receive buffer %d bytes)",
+                bus.GetInterfaceName().c_str(), bus.LastBatchDrops(), bus.ReceiveBufferSize());
+    }
+    UpdateDrops();
+}
+
+void CanGateway::UpdateDrops() {
+    uint64_t rx_queue_drops = 0;
+    for (auto const& socket_can : sockets_) {
+        rx_queue_drops += socket_can->RxQueueDrops();
+    }
+    for (auto const& ring : rings_) {
+        rx_queue_drops += ring->Drops();
+    }
+    counters_.rx_queue_drops.Set(rx_queue_drops);
+}
+
+int CanGateway::MessageIndexOf(canid_t can_id) const {
+    canid_t key = can_id & (CAN_EFF_FLAG | CAN_EFF_MASK);
+    MessageInfo const* messages = decoder_.Messages();
+    for (size_t i = 0; i < decoder_.MessageCount(); i++) {
+        if (messages[i].can_id == key) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+bool CanGateway::Handle(canfd_frame const& can_frame, int64_t rx_ns, bool lossless, BusMonitor *monitor) {
+    if (can_frame.can_id & CAN_ERR_FLAG) {
+        if (monitor != nullptr) {
+            monitor->OnErrorFrame(can_frame);
+        }
+        return false;
+    }
+    DecodedSamples samples;
+    size_t count = decoder_.Decode(can_frame, samples);
+    if (count == 0) {
+        CountDecodeFailure(can_frame.can_id);
+        return false;
+    }
+    message_counters_[samples[0].message].frames.Add();
+    Publish(samples.data(), count, rx_ns, RealtimeNowNs(), lossless);
+    return true;
+}
+
+void CanGateway::CountDecodeFailure(canid_t can_id) {
+    // Cold path: the socket filters only pass the set's IDs, so this is
+    // mostly a frame shorter than its DLC
+    counters_.decode_failures.Add();
+    int index = MessageIndexOf(can_id);
+    if (index >= 0) {
+        message_counters_[index].frames.Add();
+        message_counters_[index].decode_failures.Add();
+    }
+}
+
+void CanGateway::Publish(DecodedFrame *samples, size_t count, int64_t rx_ns, int64_t decoded_ns, bool lossless) {
+    // The node sends a multi-sample frame right after its last sample
+    int64_t period_ns = decoder_.Messages()[samples[0].message].sample_period_ns;
+    for (size_t i = 0; i < count; i++) {
+        DecodedFrame &frame = samples[i];
+        frame.rx_ns = rx_ns - static_cast<int64_t>(count - 1 - i) * period_ns;
+        frame.decoded_ns = decoded_ns;
+        if (lossless) {
+            publisher_.EnqueueWait(frame);
+        } else {
+            publisher_.Enqueue(frame);
+        }
+    }
+}
+
+uint64_t CanGateway::ProcessBatch(CanRxFrame const* frames, size_t count, bool lossless, BusMonitor *monitor) {
+    uint64_t decoded = 0;
+    size_t done = 0;
+    while (done < count) {
+        size_t taken = batch_decoder_->Decode(frames + done, count - done);
+        int64_t decoded_ns = RealtimeNowNs();
+        for (size_t i = 0; i < taken; i++) {
+            canfd_frame const& frame = frames[done + i].frame;
+            if (frame.can_id & CAN_ERR_FLAG) {
+                if (monitor != nullptr) {
+                    monitor->OnErrorFrame(frame);
+                }
+                continue;
+            }
+            BatchDecoder::FrameResult const& result = batch_decoder_->Result(i);
+            if (result.count == 0) {
+                CountDecodeFailure(frame.can_id);
+                continue;
+            }
+            message_counters_[result.message].frames.Add();
+            Publish(batch_decoder_->Samples() + result.first, result.count, frames[done + i].timestamp_ns,
+                    decoded_ns, lossless);
+            decoded++;
+        }
+        done += taken;
+    }
+    return decoded;
+}
+
+void CanGateway::Process(CanRxFrame const* frames, size_t count, bool lossless, BusMonitor *monitor) {
+    uint64_t decoded = 0;
+    uint64_t errors = 0;
+    for (size_t i = 0; i < count; i++) {
+        errors += (frames[i].frame.can_id & CAN_ERR_FLAG) != 0;
+    }
+    if (batch_decoder_ != nullptr) {
+        decoded = ProcessBatch(frames, count, lossless, monitor);
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            decoded += Handle(frames[i].frame, frames[i].timestamp_ns, lossless, monitor);
+        }
+    }
+    counters_.frames.Add(count);
+    counters_.decoded.Add(decoded);
+    if (errors > 0) {
+        counters_.error_frames.Add(errors);
+    }
+    if (monitor != nullptr && count > errors) {
+        monitor->OnDataFrames();
+    }
+    if (decoded > 0) {
+        publisher_.Notify();
+    }
+}
+
+void CanGateway::ReplayLog(CanLogReader &log, double speed) {
+    int64_t first_ns = 0;
+    int64_t start_ns = 0;
+    bool started = false;
+    size_t count;
+    while ((count = log.Read(replay_batch_.data(), replay_batch_.size())) > 0) {
+        size_t begin = 0;
+        for (size_t i = 0; i < count && speed > 0; i++) {
+            int64_t recorded_ns = replay_batch_[i].timestamp_ns;
+            if (!started) {
+                first_ns = recorded_ns;
+                start_ns = MonotonicNowNs();
+                started = true;
+            }
+            int64_t due_ns = start_ns + static_cast<int64_t>(static_cast<double>(recorded_ns - first_ns) / speed);
+            if (due_ns > MonotonicNowNs()) {
+                // Release what is already due, then wait for this frame
+                Release(begin, i);
+                begin = i;
+                SleepUntil(due_ns);
+            }
+        }
+        Release(begin, count);
+    }
+    publisher_.WaitEmpty();
+}
+
+void CanGateway::Release(size_t begin, size_t end) {
+    int64_t now_ns = RealtimeNowNs();
+    for (size_t i = begin; i < end; i++) {
+        replay_batch_[i].timestamp_ns = now_ns;
+    }
+    Process(&replay_batch_[begin], end - begin, true, nullptr);
+}
+
+GatewayStats CanGateway::Stats() const {
+    return GatewayStats{
+        counters_.frames.Load(),
+        counters_.decoded.Load(),
+        counters_.decode_failures.Load(),
+        counters_.read_errors.Load(),
+        counters_.rx_queue_drops.Load(),
+        counters_.error_frames.Load(),
+        counters_.pdus.Load(),
+    };
+}
+
+std::vector<MessageRxStats> CanGateway::MessageStats() const {
+    std::vector<MessageRxStats> stats;
+    stats.reserve(message_counters_.size());
+    MessageInfo const* messages = decoder_.Messages();
+    for (size_t i = 0; i < message_counters_.size(); i++) {
+        stats.push_back({messages[i].can_id, message_counters_[i].frames.Load(),
+                         message_counters_[i].decode_failures.Load()});
+    }
+    return stats;
+}
+
+std::vector<BusStats> CanGateway::GetBusStats() const {
+    std::vector<BusStats> stats;
+    stats.reserve(monitors_.size());
+    for (auto const& monitor : monitors_) {
+        stats.push_back(monitor->Stats());
+    }
+    return stats;
+}
+
+}  // namespace tcc::aaos::can
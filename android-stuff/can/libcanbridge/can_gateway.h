@@ -0,0 +1,161 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "batch_decoder.h"
+#include "buffer_pool.h"
+#include "bus_monitor.h"
+#include "can_log.h"
+#include "can_netlink.h"
+#include "counter.h"
+#include "event_loop.h"
+#include "isotp_socket.h"
+#include "message_decoder.h"
+#include "packet_ring.h"
+#include "publisher.h"
+#include "socket_can.h"
+
+namespace tcc::aaos::can {
+
+// How frames are read from an interface
+enum class RxBackend {
+    SOCKET,      // CAN_RAW socket, recvmmsg batches (SocketCan)
+    PACKET_RING, // PF_PACKET TPACKET_V3 ring, frames decoded in place (PacketRing)
+};
+
+struct GatewayStats {
+    uint64_t frames;    // Frames read from all interfaces
+    uint64_t decoded;   // Frames the decoder recognized (not samples)
+    uint64_t decode_failures; // Data frames the decoder rejected (unknown ID or short)
+    uint64_t read_errors;
+    uint64_t rx_queue_drops; // Frames the kernel dropped on full socket queues or rings
+    uint64_t error_frames;   // Bus error frames, counted per interface in BusStats
+    uint64_t pdus;           // ISO-TP PDUs received (their records count as decoded frames)
+};
+
+// Frames received for one message of the decoder's set
+struct MessageRxStats {
+    canid_t can_id;
+    uint64_t frames;          // Including the ones that failed to decode
+    uint64_t decode_failures; // Shorter than the message's DLC
+};
+
+// Reader stage of the gateway: one non-blocking SocketCan or PacketRing per
+// interface, all served by the caller's EventLoop. Every wakeup drains a
+// batch of frames, decodes them and hands them to the Publisher. Error
+// frames go to a BusMonitor per interface, which restarts the controller
+// after bus-off. ISO-TP channels deliver whole PDUs whose records go
+// through the same decode path as frames.
+class CanGateway {
+public:
+    // decoder and publisher must outlive the gateway
+    CanGateway(EventLoop &loop, MessageDecoder const& decoder, Publisher &publisher);
+
+    // Applies to interfaces added afterwards
+    void SetBusRecovery(BusRecoveryConfig const& config) { recovery_ = config; }
+    // SocketCan::SetBufferSizes() of the CAN_RAW sockets added afterwards;
+    // 0 keeps the kernel default
+    void SetSocketBuffers(int receive_bytes, int send_bytes) {
+        receive_buffer_ = receive_bytes;
+        send_buffer_ = send_bytes;
+    }
+
+    // Decodes CAN_RAW batches and replayed logs with a BatchDecoder over the
+    // decoder's messages instead of frame by frame; kernel picks its
+    // instruction set. Results are the same either way.
+    void SetBatchDecode(bool enabled, DecodeKernel kernel = BestKernel());
+
+    // Opens name with the decoder's filters and registers it with the loop
+    bool AddInterface(std::string const& name, RxBackend backend = RxBackend::SOCKET);
+    // Opens an ISO-TP channel on name and registers it with the loop.
+    // config.message_id must be in the decoder's set; a PDU is decoded as
+    // back-to-back records of that message's dlc bytes, timestamped as if
+    // the node had sent them one sample period apart ending at the PDU's
+    // arrival. Trailing bytes short of a record count as a decode failure.
+    bool AddIsoTp(std::string const& name, IsoTpConfig const& config);
+
+    // Feeds a recorded log through the same decode and publish path as a
+    // live bus, on the calling thread, and returns once the publisher has
+    // taken every frame. speed 1 keeps the recorded spacing (2 replays twice
+    // as fast); 0 replays as fast as the publisher accepts frames. Replayed
+    // frames are never dropped and are stamped with their release time.
+    void ReplayLog(CanLogReader &log, double speed);
+
+    GatewayStats Stats() const;
+    // One entry per interface, in the order they were added
+    std::vector<BusStats> GetBusStats() const;
+    // One entry per message, in the decoder's order; safe from any thread
+    std::vector<MessageRxStats> MessageStats() const;
+    // Index of the decoder message a data frame with can_id belongs to
+    // (CAN_EFF_FLAG set for 29-bit IDs), -1 when not in the set
+    int MessageIndexOf(canid_t can_id) const;
+
+private:
+    bool AddRing(std::string const& name);
+    // Creates the BusMonitor of an interface that was just opened
+    BusMonitor *AddMonitor(std::string const& name);
+    void OnReadable(SocketCan &bus, BusMonitor *monitor);
+    void OnRingReadable(PacketRing &ring, BusMonitor *monitor);
+    void OnIsoTpReadable(IsoTpSocket &socket, size_t message);
+    // Decodes the records of one PDU; returns the number decoded
+    uint64_t HandlePdu(uint8_t const* data, size_t length, int64_t rx_ns, size_t message);
+    // Decodes one classic or CAN FD frame and hands each of its samples to
+    // the publisher; false when the decoder does not know the frame. Error
+    // frames go to monitor (none for replayed logs).
+    bool Handle(canfd_frame const& can_frame, int64_t rx_ns, bool lossless, BusMonitor *monitor);
+    // Stamps the count samples of one frame received at rx_ns and hands
+    // them to the publisher
+    void Publish(DecodedFrame *samples, size_t count, int64_t rx_ns, int64_t decoded_ns, bool lossless);
+    // Counts a data frame the decoder rejected
+    void CountDecodeFailure(canid_t can_id);
+    // Process() through batch_decoder_; returns the frames decoded
+    uint64_t ProcessBatch(CanRxFrame const* frames, size_t count, bool lossless, BusMonitor *monitor);
+    void UpdateDrops();
+    // Decodes frames and hands them to the publisher; lossless waits for
+    // room in the publisher queue instead of dropping
+    void Process(CanRxFrame const* frames, size_t count, bool lossless, BusMonitor *monitor);
+    // Stamps replay_batch_[begin, end) with the current time and processes it
+    void Release(size_t begin, size_t end);
+
+    EventLoop &loop_;
+    MessageDecoder const& decoder_;
+    Publisher &publisher_;
+    std::vector<std::unique_ptr<SocketCan>> sockets_;
+    std::vector<std::unique_ptr<PacketRing>> rings_;
+    std::vector<std::unique_ptr<IsoTpSocket>> isotp_sockets_;
+    // Receive buffers of every ISO-TP channel; Poll() returns them before
+    // the next channel is served
+    BufferPool pdu_pool_{IsoTpSocket::MAX_PDU_SIZE, IsoTpSocket::MAX_PDU_BATCH};
+    BusRecoveryConfig recovery_;
+    int receive_buffer_ = 0;
+    int send_buffer_ = 0;
+    CanNetlink netlink_;
+    bool netlink_open_ = false;
+    std::vector<std::unique_ptr<BusMonitor>> monitors_;
+    std::array<CanRxFrame, MAX_RX_BATCH> rx_batch_;
+    std::array<CanRxFrame, MAX_RX_BATCH> replay_batch_;
+    std::unique_ptr<BatchDecoder> batch_decoder_; // Only with SetBatchDecode()
+
+    // Written by the loop thread only, read by Stats() and MessageStats()
+    struct alignas(CACHE_LINE_SIZE) RxCounters {
+        LocalCounter frames;
+        LocalCounter decoded;
+        LocalCounter decode_failures;
+        LocalCounter read_errors;
+        LocalCounter rx_queue_drops;
+        LocalCounter error_frames;
+        LocalCounter pdus;
+    };
+    struct alignas(CACHE_LINE_SIZE) MessageCounters {
+        LocalCounter frames;
+        LocalCounter decode_failures;
+    };
+    RxCounters counters_;
+    std::vector<MessageCounters> message_counters_;
+};
+
+}  // namespace tcc::aaos::can
@@ -0,0 +1,377 @@
+#include "can_log.h"
+
+#include <endian.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "async_log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace tcc::aaos::can {
+
+constexpr static char TAG[] = "CAN_LOG";
+
+namespace {
+
+int HexValue(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// Cursor over one line of an ASCII log
+struct LineParser {
+    char const* p;
+    char const* end;
+
+    bool Consume(char c) {
+        if (p < end && *p == c) {
+            p++;
+            return true;
+        }
+        return false;
+    }
+    void SkipSpaces() {
+        while (p < end && (*p == ' ' || *p == '\t')) {
+            p++;
+        }
+    }
+    // Decimal digits; returns the digit count (0 when none)
+    int Decimal(uint64_t &value) {
+        int digits = 0;
+        value = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            value = value * 10 + static_cast<uint64_t>(*p - '0');
+            p++;
+            digits++;
+        }
+        return digits;
+    }
+    int Hex(uint32_t &value) {
+        int digits = 0;
+        value = 0;
+        int v;
+        while (p < end && (v = HexValue(*p)) >= 0) {
+            value = (value << 4) | static_cast<uint32_t>(v);
+            p++;
+            digits++;
+        }
+        return digits;
+    }
+};
+
+}  // namespace
+
+CanLogReader::~CanLogReader() {
+    Unmap();
+}
+
+void CanLogReader::Unmap() {
+    if (mapping_ != nullptr) {
+        munmap(mapping_, mapping_size_);
+        mapping_ = nullptr;
+        mapping_size_ = 0;
+    }
+    data_ = nullptr;
+    size_ = 0;
+}
+
+bool CanLogReader::Open(std::string const& path) {
+    Unmap();
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        CAN_LOG(ERROR, TAG, "Failed to open %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        CAN_LOG(ERROR, TAG, "Failed to stat %s: %s", path.c_str(), strerror(errno));
+        close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    if (size == 0) {
+        close(fd);
+        return Attach("", 0);
+    }
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        CAN_LOG(ERROR, TAG, "Failed to map %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    // The log is read front to back exactly once per pass
+    madvise(mapping, size, MADV_SEQUENTIAL | MADV_WILLNEED);
+    mapping_ = mapping;
+    mapping_size_ = size;
+    if (!Attach(static_cast<char const*>(mapping), size)) {
+        CAN_LOG(ERROR, TAG, "%s is not a supported CAN log", path.c_str());
+        Unmap();
+        return false;
+    }
+    return true;
+}
+
+bool CanLogReader::OpenBuffer(std::string_view text) {
+    Unmap();
+    return Attach(text.data(), text.size());
+}
+
+bool CanLogReader::Attach(char const* data, size_t size) {
+    data_ = data;
+    size_ = size;
+    start_ = 0;
+    format_ = CanLogFormat::ASCII;
+    if (size >= sizeof(BinaryLogHeader) &&
+        std::memcmp(data, BinaryLogHeader::MAGIC, sizeof(BinaryLogHeader::MAGIC)) == 0) {
+        BinaryLogHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        version_ = le32toh(header.version);
+        record_size_ = le32toh(header.record_size);
+        if ((version_ != 1 && version_ != BinaryLogHeader::VERSION) ||
+            record_size_ < sizeof(BinaryLogRecord) + (version_ == 1 ? CAN_MAX_DLEN : 0)) {
+            return false;
+        }
+        format_ = CanLogFormat::BINARY;
+        start_ = sizeof(BinaryLogHeader);
+    }
+    Rewind();
+    return true;
+}
+
+void CanLogReader::Rewind() {
+    pos_ = start_;
+}
+
+size_t CanLogReader::Read(CanRxFrame *frames, size_t max_frames) {
+    size_t count = 0;
+    if (format_ == CanLogFormat::BINARY) {
+        while (count < max_frames && ReadBinary(frames[count])) {
+            count++;
+        }
+    } else {
+        while (count < max_frames && ReadAscii(frames[count])) {
+            count++;
+        }
+    }
+    frames_ += count;
+    return count;
+}
+
+bool CanLogReader::ReadBinary(CanRxFrame &frame) {
+    // Version 1: fixed record_size_ records; version 2: record_size_ bytes
+    // of BinaryLogRecord, then the padded payload
+    size_t header_size = version_ == 1 ? sizeof(BinaryLogRecord) : record_size_;
+    while (pos_ + header_size + CAN_MAX_DLEN <= size_) {
+        BinaryLogRecord record;
+        std::memcpy(&record, data_ + pos_, sizeof(record));
+        size_t payload = version_ == 1 ? CAN_MAX_DLEN : BinaryLogPayloadSize(record.len);
+        size_t record_size = version_ == 1 ? record_size_ : header_size + payload;
+        if (pos_ + record_size > size_) {
+            break;
+        }
+        uint8_t const* data = reinterpret_cast<uint8_t const*>(data_ + pos_ + header_size);
+        pos_ += record_size;
+        bool fd = version_ != 1 && ((record.flags & CANFD_FDF) || record.len > CAN_MAX_DLEN);
+        if (record.len > (fd ? CANFD_MAX_DLEN : CAN_MAX_DLEN) ||
+            (fd && CanFdPaddedLength(record.len) != record.len)) {
+            skipped_++;
+            continue;
+        }
+        frame.frame.can_id = le32toh(record.can_id);
+        frame.frame.len = record.len;
+        frame.frame.flags = fd ? static_cast<uint8_t>(record.flags | CANFD_FDF) : 0;
+        frame.frame.__res0 = 0;
+        frame.frame.__res1 = 0;
+        std::memcpy(frame.frame.data, data, payload);
+        frame.timestamp_ns = static_cast<int64_t>(le64toh(static_cast<uint64_t>(record.timestamp_ns)));
+        frame.ifindex = 0;
+        frame.flags = 0;
+        return true;
+    }
+    if (pos_ < size_) {
+        // Truncated last record
+        skipped_++;
+        pos_ = size_;
+    }
+    return false;
+}
+
+bool CanLogReader::ReadAscii(CanRxFrame &frame) {
+    while (pos_ < size_) {
+        char const* line = data_ + pos_;
+        char const* newline = static_cast<char const*>(std::memchr(line, '\n', size_ - pos_));
+        char const* line_end = newline != nullptr ? newline : data_ + size_;
+        pos_ = static_cast<size_t>(line_end - data_) + (newline != nullptr ? 1 : 0);
+        if (line_end > line && line_end[-1] == '\r') {
+            line_end--;
+        }
+
+        LineParser parser{line, line_end};
+        parser.SkipSpaces();
+        if (parser.p == parser.end) {
+            continue;
+        }
+
+        // (seconds.fraction)
+        uint64_t seconds = 0;
+        uint64_t fraction = 0;
+        int fraction_digits = 0;
+        if (!parser.Consume('(') || parser.Decimal(seconds) == 0 || !parser.Consume('.') ||
+            (fraction_digits = parser.Decimal(fraction)) == 0 || fraction_digits > 9 || !parser.Consume(')')) {
+            skipped_++;
+            continue;
+        }
+        for (int i = fraction_digits; i < 9; i++) {
+            fraction *= 10;
+        }
+
+        // Interface name
+        parser.SkipSpaces();
+        char const* interface = parser.p;
+        while (parser.p < parser.end && *parser.p != ' ' && *parser.p != '\t') {
+            parser.p++;
+        }
+        parser.SkipSpaces();
+        if (parser.p == interface) {
+            skipped_++;
+            continue;
+        }
+
+        // 3 hex digits: standard ID; 8: extended ID or error frame
+        uint32_t can_id = 0;
+        int id_digits = parser.Hex(can_id);
+        if ((id_digits != 3 && id_digits != 8) || !parser.Consume('#')) {
+            skipped_++;
+            continue;
+        }
+        if (id_digits == 8 && (can_id & CAN_ERR_FLAG) == 0) {
+            can_id = (can_id & CAN_EFF_MASK) | CAN_EFF_FLAG;
+        }
+
+        frame.frame = {};
+        bool ok = true;
+        if (parser.Consume('#')) {
+            // CAN FD: "##<flags nibble><data>", a valid FD payload length
+            int flags = parser.p < parser.end ? HexValue(*parser.p++) : -1;
+            uint8_t length = 0;
+            int high;
+            int low;
+            ok = flags >= 0;
+            while (ok && parser.p < parser.end && (high = HexValue(*parser.p)) >= 0) {
+                if (parser.end - parser.p < 2 || (low = HexValue(parser.p[1])) < 0 || length == CANFD_MAX_DLEN) {
+                    ok = false;
+                    break;
+                }
+                frame.frame.data[length++] = static_cast<uint8_t>(high << 4 | low);
+                parser.p += 2;
+                parser.Consume('.');
+            }
+            frame.frame.len = length;
+            frame.frame.flags = static_cast<uint8_t>(CANFD_FDF | (flags & (CANFD_BRS | CANFD_ESI)));
+            ok = ok && CanFdPaddedLength(length) == length;
+        } else if (parser.Consume('R') || parser.Consume('r')) {
+            can_id |= CAN_RTR_FLAG;
+            uint64_t dlc = 0;
+            if (parser.Decimal(dlc) > 1 || dlc > CAN_MAX_DLEN) {
+                ok = false;
+            }
+            frame.frame.len = static_cast<uint8_t>(dlc);
+        } else {
+            uint8_t length = 0;
+            int high;
+            int low;
+            while (ok && parser.p < parser.end && (high = HexValue(*parser.p)) >= 0) {
+                if (parser.end - parser.p < 2 || (low = HexValue(parser.p[1])) < 0 || length == CAN_MAX_DLEN) {
+                    ok = false;
+                    break;
+                }
+                frame.frame.data[length++] = static_cast<uint8_t>(high << 4 | low);
+                parser.p += 2;
+                parser.Consume('.');
+            }
+            frame.frame.len = length;
+            // "_<dlc>": raw DLC 9..15 of an 8-byte classic frame, not kept
+            uint32_t raw_dlc;
+            if (ok && parser.Consume('_') && parser.Hex(raw_dlc) != 1) {
+                ok = false;
+            }
+        }
+        parser.SkipSpaces();
+        if (!ok || parser.p != parser.end) {
+            skipped_++;
+            continue;
+        }
+
+        frame.frame.can_id = can_id;
+        frame.timestamp_ns = static_cast<int64_t>(seconds * 1'000'000'000 + fraction);
+        frame.ifindex = 0;
+        frame.flags = 0;
+        return true;
+    }
+    return false;
+}
+
+CanLogWriter::~CanLogWriter() {
+    Close();
+}
+
+bool CanLogWriter::Open(std::string const& path) {
+    Close();
+    file_ = fopen(path.c_str(), "we");
+    if (file_ == nullptr) {
+        CAN_LOG(ERROR, TAG, "Failed to create %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    failed_ = false;
+    BinaryLogHeader header;
+    std::memcpy(header.magic, BinaryLogHeader::MAGIC, sizeof(header.magic));
+    header.version = htole32(BinaryLogHeader::VERSION);
+    header.record_size = htole32(sizeof(BinaryLogRecord));
+    failed_ = fwrite(&header, sizeof(header), 1, file_) != 1;
+    return !failed_;
+}
+
+bool CanLogWriter::Write(CanRxFrame const& frame) {
+    uint8_t len = std::min<uint8_t>(frame.frame.len, CANFD_MAX_DLEN);
+    bool fd = (frame.frame.flags & CANFD_FDF) || len > CAN_MAX_DLEN;
+    // Record and padded payload in one write
+    uint8_t buffer[sizeof(BinaryLogRecord) + CANFD_MAX_DLEN] = {};
+    BinaryLogRecord record = {};
+    record.timestamp_ns = static_cast<int64_t>(htole64(static_cast<uint64_t>(frame.timestamp_ns)));
+    record.can_id = htole32(frame.frame.can_id);
+    record.len = len;
+    record.flags = fd ? static_cast<uint8_t>(frame.frame.flags | CANFD_FDF) : 0;
+    std::memcpy(buffer, &record, sizeof(record));
+    std::memcpy(buffer + sizeof(record), frame.frame.data, fd ? len : CAN_MAX_DLEN);
+    size_t size = sizeof(record) + BinaryLogPayloadSize(len);
+    if (file_ == nullptr || fwrite(buffer, size, 1, file_) != 1) {
+        failed_ = true;
+    }
+    return !failed_;
+}
+
+bool CanLogWriter::Close() {
+    if (file_ == nullptr) {
+        return !failed_;
+    }
+    if (fclose(file_) != 0) {
+        failed_ = true;
+    }
+    file_ = nullptr;
+    return !failed_;
+}
+
+}  // namespace tcc::aaos::can
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <linux/can.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+#include "socket_can.h"
+
+namespace tcc::aaos::can {
+
+enum class CanLogFormat {
+    ASCII,  // candump -l / canplayer: "(sec.usec) iface id#data" or "id##<flags>data"
+    BINARY, // Binary records, see BinaryLogRecord
+};
+
+// Binary log: a BinaryLogHeader followed by records, little-endian. Unlike
+// the ASCII log every record can be used in place, so replaying it is a
+// memcpy per frame. log2bin converts candump logs to this format.
+//
+// A record is a BinaryLogRecord followed by the payload. Version 1 records
+// are record_size bytes with an 8-byte payload (classic CAN only). Version 2
+// adds CAN FD: the payload is len bytes zero-padded to a multiple of 8, at
+// least 8, so a classic frame is still a 24-byte record laid out as in
+// version 1. The reader accepts both; the writer writes version 2.
+struct BinaryLogHeader {
+    constexpr static char MAGIC[8] = {'C', 'A', 'N', 'B', 'L', 'O', 'G', '\0'};
+    constexpr static uint32_t VERSION = 2;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size; // Version 1: whole record; version 2: sizeof(BinaryLogRecord)
+};
+
+struct BinaryLogRecord {
+    int64_t timestamp_ns; // CLOCK_REALTIME of the capture
+    uint32_t can_id;      // With CAN_EFF_FLAG / CAN_RTR_FLAG / CAN_ERR_FLAG
+    uint8_t len;
+    uint8_t flags; // canfd_frame::flags, CANFD_FDF for CAN FD; 0 in version 1
+    uint8_t reserved[2];
+};
+static_assert(sizeof(BinaryLogHeader) == 16 && sizeof(BinaryLogRecord) == 16,
+              "binary log layout is part of the file format");
+
+// Payload bytes stored after a version 2 record of len bytes
+constexpr size_t BinaryLogPayloadSize(uint8_t len) {
+    return len <= CAN_MAX_DLEN ? CAN_MAX_DLEN : (size_t{len} + 7) & ~size_t{7};
+}
+
+struct CanLogStats {
+    uint64_t frames;  // Frames returned by Read()
+    uint64_t skipped; // Malformed or unsupported lines/records
+};
+
+// Reads a candump log, ASCII or binary, straight from an mmap'd file. The
+// format is detected from the first bytes. Frames come back as CanRxFrame
+// with the recorded timestamp and ifindex 0, so a log can stand in for a
+// live SocketCan.
+class CanLogReader {
+public:
+    CanLogReader() = default;
+    ~CanLogReader();
+    CanLogReader(CanLogReader const&) = delete;
+    CanLogReader& operator=(CanLogReader const&) = delete;
+
+    bool Open(std::string const& path);
+    // Reads an in-memory log; text must outlive the reader
+    bool OpenBuffer(std::string_view text);
+
+    CanLogFormat Format() const { return format_; }
+
+    // Fills up to max_frames frames and returns how many; 0 at the end of the log
+    size_t Read(CanRxFrame *frames, size_t max_frames);
+    // Back to the first frame
+    void Rewind();
+
+    CanLogStats Stats() const { return {frames_, skipped_}; }
+
+private:
+    bool Attach(char const* data, size_t size);
+    bool ReadAscii(CanRxFrame &frame);
+    bool ReadBinary(CanRxFrame &frame);
+    void Unmap();
+
+    char const* data_ = nullptr;
+    size_t size_ = 0;
+    size_t start_ = 0; // Offset of the first record (past the binary header)
+    size_t pos_ = 0;
+    CanLogFormat format_ = CanLogFormat::ASCII;
+    uint32_t version_ = 0;     // Binary logs only
+    size_t record_size_ = 0;   // See BinaryLogHeader::record_size
+    void *mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+    uint64_t frames_ = 0;
+    uint64_t skipped_ = 0;
+};
+
+// Writes binary logs for CanLogReader
+class CanLogWriter {
+public:
+    CanLogWriter() = default;
+    ~CanLogWriter();
+    CanLogWriter(CanLogWriter const&) = delete;
+    CanLogWriter& operator=(CanLogWriter const&) = delete;
+
+    bool Open(std::string const& path);
+    bool Write(CanRxFrame const& frame);
+    // Flushes and closes; returns false if any write failed
+    bool Close();
+
+private:
+    FILE *file_ = nullptr;
+    bool failed_ = false;
+};
+
+}  // namespace tcc::aaos::can
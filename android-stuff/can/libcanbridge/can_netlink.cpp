@@ -0,0 +1,202 @@
+#include "can_netlink.h"
+
+#include <linux/if_link.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "async_log.h"
+
+#include <cerrno>
+#include <cstring>
+
+namespace tcc::aaos::can {
+
+constexpr static char TAG[] = "CAN_NETLINK";
+
+// The kernel answers link requests inline; this only guards against a
+// reply that never comes
+constexpr static int REPLY_TIMEOUT_MS = 100;
+
+namespace {
+
+struct LinkRequest {
+    nlmsghdr header;
+    ifinfomsg info;
+    char attributes[128];
+};
+
+void InitRequest(LinkRequest &request, uint16_t type, uint16_t flags, int ifindex) {
+    std::memset(&request, 0, sizeof(request));
+    request.header.nlmsg_len = NLMSG_LENGTH(sizeof(ifinfomsg));
+    request.header.nlmsg_type = type;
+    request.header.nlmsg_flags = flags;
+    request.info.ifi_family = AF_UNSPEC;
+    request.info.ifi_index = ifindex;
+}
+
+// Appends an attribute; a nested one is closed with EndNested() once its
+// children have been added
+rtattr *AddAttribute(LinkRequest &request, uint16_t type, void const* data, size_t size) {
+    auto *attribute = reinterpret_cast<rtattr *>(reinterpret_cast<char *>(&request) +
+                                                 NLMSG_ALIGN(request.header.nlmsg_len));
+    attribute->rta_type = type;
+    attribute->rta_len = static_cast<unsigned short>(RTA_LENGTH(size));
+    if (size > 0) {
+        std::memcpy(RTA_DATA(attribute), data, size);
+    }
+    request.header.nlmsg_len = NLMSG_ALIGN(request.header.nlmsg_len) + RTA_ALIGN(attribute->rta_len);
+    return attribute;
+}
+
+void EndNested(LinkRequest &request, rtattr *nested) {
+    nested->rta_len = static_cast<unsigned short>(reinterpret_cast<char *>(&request) + request.header.nlmsg_len -
+                                                  reinterpret_cast<char *>(nested));
+}
+
+}  // namespace
+
+CanNetlink::~CanNetlink() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+bool CanNetlink::Open() {
+    fd_ = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd_ < 0) {
+        CAN_LOG(ERROR, TAG, "Failed to open netlink socket: %s", strerror(errno));
+        return false;
+    }
+    timeval timeout = {0, REPLY_TIMEOUT_MS * 1000};
+    setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return true;
+}
+
+int CanNetlink::Transact(void *request, size_t request_size, void *reply, size_t reply_size) {
+    if (fd_ < 0) {
+        return -EBADF;
+    }
+    auto *header = static_cast<nlmsghdr *>(request);
+    header->nlmsg_seq = ++sequence_;
+    sockaddr_nl kernel = {};
+    kernel.nl_family = AF_NETLINK;
+    if (sendto(fd_, request, request_size, 0, reinterpret_cast<sockaddr *>(&kernel), sizeof(kernel)) < 0) {
+        return -errno;
+    }
+
+    alignas(nlmsghdr) char buffer[8192];
+    for (;;) {
+        ssize_t received = recv(fd_, buffer, sizeof(buffer), 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received < 0) {
+            return -errno;
+        }
+        int length = static_cast<int>(received);
+        for (auto *message = reinterpret_cast<nlmsghdr *>(buffer); NLMSG_OK(message, length);
+             message = NLMSG_NEXT(message, length)) {
+            // Replies to an earlier request that timed out are skipped
+            if (message->nlmsg_seq != header->nlmsg_seq) {
+                continue;
+            }
+            if (message->nlmsg_type == NLMSG_ERROR) {
+                // error 0 is the ACK
+                return static_cast<nlmsgerr *>(NLMSG_DATA(message))->error;
+            }
+            if (reply == nullptr) {
+                continue;
+            }
+            if (message->nlmsg_len > reply_size) {
+                return -EMSGSIZE;
+            }
+            std::memcpy(reply, message, message->nlmsg_len);
+            return 0;
+        }
+    }
+}
+
+int CanNetlink::Restart(int ifindex) {
+    LinkRequest request;
+    InitRequest(request, RTM_NEWLINK, NLM_F_REQUEST | NLM_F_ACK, ifindex);
+    rtattr *link_info = AddAttribute(request, IFLA_LINKINFO, nullptr, 0);
+    AddAttribute(request, IFLA_INFO_KIND, "can", 3);
+    rtattr *data = AddAttribute(request, IFLA_INFO_DATA, nullptr, 0);
+    uint32_t restart = 1;
+    AddAttribute(request, IFLA_CAN_RESTART, &restart, sizeof(restart));
+    EndNested(request, data);
+    EndNested(request, link_info);
+    return Transact(&request, request.header.nlmsg_len, nullptr, 0);
+}
+
+int CanNetlink::SetLinkUp(int ifindex, bool up) {
+    LinkRequest request;
+    InitRequest(request, RTM_NEWLINK, NLM_F_REQUEST | NLM_F_ACK, ifindex);
+    request.info.ifi_change = IFF_UP;
+    request.info.ifi_flags = up ? IFF_UP : 0;
+    return Transact(&request, request.header.nlmsg_len, nullptr, 0);
+}
+
+int CanNetlink::CycleLink(int ifindex) {
+    int result = SetLinkUp(ifindex, false);
+    if (result < 0) {
+        return result;
+    }
+    return SetLinkUp(ifindex, true);
+}
+
+int CanNetlink::GetState(int ifindex, CanLinkState &state) {
+    LinkRequest request;
+    InitRequest(request, RTM_GETLINK, NLM_F_REQUEST, ifindex);
+    alignas(nlmsghdr) char reply[8192];
+    int result = Transact(&request, request.header.nlmsg_len, reply, sizeof(reply));
+    if (result < 0) {
+        return result;
+    }
+    auto *message = reinterpret_cast<nlmsghdr *>(reply);
+    if (message->nlmsg_type != RTM_NEWLINK) {
+        return -EPROTO;
+    }
+
+    // IFLA_LINKINFO { IFLA_INFO_DATA { IFLA_CAN_STATE, IFLA_CAN_BERR_COUNTER } }
+    bool found = false;
+    state = {};
+    auto *info = static_cast<ifinfomsg *>(NLMSG_DATA(message));
+    int length = static_cast<int>(message->nlmsg_len - NLMSG_LENGTH(sizeof(*info)));
+    for (rtattr *attribute = IFLA_RTA(info); RTA_OK(attribute, length); attribute = RTA_NEXT(attribute, length)) {
+        if (attribute->rta_type != IFLA_LINKINFO) {
+            continue;
+        }
+        int info_length = static_cast<int>(RTA_PAYLOAD(attribute));
+        for (auto *link = static_cast<rtattr *>(RTA_DATA(attribute)); RTA_OK(link, info_length);
+             link = RTA_NEXT(link, info_length)) {
+            if (link->rta_type != IFLA_INFO_DATA) {
+                continue;
+            }
+            int data_length = static_cast<int>(RTA_PAYLOAD(link));
+            for (auto *data = static_cast<rtattr *>(RTA_DATA(link)); RTA_OK(data, data_length);
+                 data = RTA_NEXT(data, data_length)) {
+                if (data->rta_type == IFLA_CAN_STATE && RTA_PAYLOAD(data) >= sizeof(uint32_t)) {
+                    uint32_t value;
+                    std::memcpy(&value, RTA_DATA(data), sizeof(value));
+                    state.state = static_cast<can_state>(value);
+                    found = true;
+                } else if (data->rta_type == IFLA_CAN_BERR_COUNTER &&
+                           RTA_PAYLOAD(data) >= sizeof(can_berr_counter)) {
+                    can_berr_counter counter;
+                    std::memcpy(&counter, RTA_DATA(data), sizeof(counter));
+                    state.tx_errors = counter.txerr;
+                    state.rx_errors = counter.rxerr;
+                }
+            }
+        }
+    }
+    // vcan and other non-controller links report no CAN state
+    return found ? 0 : -EOPNOTSUPP;
+}
+
+}  // namespace tcc::aaos::can
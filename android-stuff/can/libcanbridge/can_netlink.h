@@ -0,0 +1,61 @@
+#pragma once
+
+#include <linux/can/netlink.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace tcc::aaos::can {
+
+// Controller state as reported by the kernel (IFLA_CAN_STATE and
+// IFLA_CAN_BERR_COUNTER)
+struct CanLinkState {
+    can_state state;
+    uint16_t tx_errors;
+    uint16_t rx_errors;
+};
+
+// Link operations BusMonitor needs to bring a CAN interface back after
+// bus-off. Return 0 or a negative errno.
+class CanLinkControl {
+public:
+    virtual ~CanLinkControl() = default;
+
+    // "ip link set <if> type can restart": leaves bus-off immediately. The
+    // kernel refuses it with -EINVAL when restart-ms is set and with -EBUSY
+    // when the controller is not bus-off.
+    virtual int Restart(int ifindex) = 0;
+    // Administrative down/up: reinitializes the controller whatever its
+    // state or restart-ms; bound sockets stay bound but see ENETDOWN once
+    virtual int CycleLink(int ifindex) = 0;
+    virtual int GetState(int ifindex, CanLinkState &state) = 0;
+};
+
+// CanLinkControl over a NETLINK_ROUTE socket, the same requests iproute2
+// sends. Changing the link needs CAP_NET_ADMIN. Requests are synchronous
+// and the kernel answers them inline, so they are safe on the loop thread.
+class CanNetlink : public CanLinkControl {
+public:
+    CanNetlink() = default;
+    ~CanNetlink() override;
+    CanNetlink(CanNetlink const&) = delete;
+    CanNetlink& operator=(CanNetlink const&) = delete;
+
+    bool Open();
+
+    int Restart(int ifindex) override;
+    int CycleLink(int ifindex) override;
+    int GetState(int ifindex, CanLinkState &state) override;
+
+private:
+    int SetLinkUp(int ifindex, bool up);
+    // Sends request (an nlmsghdr of request_size bytes) and waits for the
+    // reply with its sequence number: the ACK, or the first reply message
+    // copied into reply when it is not null
+    int Transact(void *request, size_t request_size, void *reply, size_t reply_size);
+
+    int fd_ = -1;
+    uint32_t sequence_ = 0;
+};
+
+}  // namespace tcc::aaos::can
@@ -0,0 +1,234 @@
+#include "can_transmitter.h"
+
+#include "async_log.h"
+
+#include <time.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+namespace tcc::aaos::can {
+
+constexpr static char TAG[] = "CAN_TRANSMITTER";
+
+static int64_t MonotonicNowNs() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1'000'000'000 + now.tv_nsec;
+}
+
+TxQueue::TxQueue(TxConfig const& config) : config_(config) {
+    config_.burst = std::max<size_t>(config_.burst, 1);
+    frames_.reserve(config_.queue_limit);
+}
+
+bool TxQueue::Push(canfd_frame const& frame) {
+    for (Entry &entry : frames_) {
+        if (entry.frame.can_id == frame.can_id) {
+            entry.frame = frame;
+            replaced_++;
+            queued_++;
+            return true;
+        }
+    }
+    if (frames_.size() >= config_.queue_limit) {
+        dropped_++;
+        return false;
+    }
+    uint64_t key = ArbitrationKey(frame.can_id);
+    auto position = std::upper_bound(frames_.begin(), frames_.end(), key,
+                                     [](uint64_t k, Entry const& entry) { return k < entry.key; });
+    frames_.insert(position, Entry{key, frame});
+    queued_++;
+    return true;
+}
+
+size_t TxQueue::Allowance(int64_t now_ns) const {
+    if (config_.frame_gap_ns <= 0) {
+        return frames_.size();
+    }
+    int64_t gap = config_.frame_gap_ns;
+    int64_t slack = static_cast<int64_t>(config_.burst) * gap - (std::max(tat_ns_, now_ns) - now_ns);
+    return slack < gap ? 0 : static_cast<size_t>(slack / gap);
+}
+
+size_t TxQueue::Front(int64_t now_ns, canfd_frame *out, size_t max) const {
+    size_t count = std::min({max, frames_.size(), Allowance(now_ns)});
+    for (size_t i = 0; i < count; i++) {
+        out[i] = frames_[i].frame;
+    }
+    return count;
+}
+
+void TxQueue::Consume(size_t count, int64_t now_ns) {
+    count = std::min(count, frames_.size());
+    frames_.erase(frames_.begin(), frames_.begin() + static_cast<ptrdiff_t>(count));
+    Sent(count, now_ns);
+}
+
+size_t TxQueue::Pop(int64_t now_ns, canfd_frame *out, size_t max) {
+    size_t count = Front(now_ns, out, max);
+    frames_.erase(frames_.begin(), frames_.begin() + static_cast<ptrdiff_t>(count));
+    return count;
+}
+
+void TxQueue::Sent(size_t count, int64_t now_ns) {
+    tat_ns_ = std::max(tat_ns_, now_ns) + static_cast<int64_t>(count) * config_.frame_gap_ns;
+    sent_ += count;
+}
+
+void TxQueue::Restore(canfd_frame const* frames, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        bool superseded = std::any_of(frames_.begin(), frames_.end(), [&](Entry const& entry) {
+            return entry.frame.can_id == frames[i].can_id;
+        });
+        if (superseded) {
+            replaced_++;
+            continue;
+        }
+        uint64_t key = ArbitrationKey(frames[i].can_id);
+        auto position = std::upper_bound(frames_.begin(), frames_.end(), key,
+                                         [](uint64_t k, Entry const& entry) { return k < entry.key; });
+        frames_.insert(position, Entry{key, frames[i]});
+    }
+}
+
+int64_t TxQueue::NextDueNs(int64_t now_ns) const {
+    if (frames_.empty()) {
+        return -1;
+    }
+    if (Allowance(now_ns) > 0) {
+        return now_ns;
+    }
+    return tat_ns_ - static_cast<int64_t>(config_.burst - 1) * config_.frame_gap_ns;
+}
+
+TxStats TxQueue::Stats() const {
+    TxStats stats = {};
+    stats.queued = queued_;
+    stats.replaced = replaced_;
+    stats.dropped = dropped_;
+    stats.sent = sent_;
+    stats.depth = frames_.size();
+    return stats;
+}
+
+CanTransmitter::CanTransmitter(EventLoop &loop, std::string const& interface_name, TxConfig const& config)
+        : socket_(interface_name), loop_(loop), queue_(config) {}
+
+bool CanTransmitter::Init() {
+    // An inverted match-all filter: the socket receives nothing, so frames
+    // the node sends never pile up in a queue nobody reads
+    socket_.SetFilters({can_filter{CAN_INV_FILTER, 0}});
+    if (!socket_.Init() || !socket_.SetNonBlocking(true)) {
+        CAN_LOG(ERROR, TAG, "Failed to open %s for transmission", InterfaceName().c_str());
+        return false;
+    }
+    event_fd_ = loop_.AddEvent([this] { Flush(); });
+    timer_fd_ = loop_.AddTimer(0, [this] { Flush(); });
+    return event_fd_ >= 0 && timer_fd_ >= 0;
+}
+
+bool CanTransmitter::Send(canfd_frame const& frame) {
+    bool queued;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queued = queue_.Push(frame);
+    }
+    if (queued) {
+        EventLoop::Notify(event_fd_);
+    }
+    return queued;
+}
+
+void CanTransmitter::Flush() {
+    int64_t now_ns = MonotonicNowNs();
+    size_t count;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        count = queue_.Pop(now_ns, batch_.data(), batch_.size());
+    }
+    // The syscall runs unlocked: Send() from binder threads never waits on the socket
+    int sent = 0;
+    int error = 0;
+    if (count > 0) {
+        sent = socket_.SendCanMessages(batch_.data(), count);
+        error = errno;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool busy = false;
+    if (count > 0) {
+        size_t done = sent > 0 ? static_cast<size_t>(sent) : 0;
+        if (sent > 0) {
+            queue_.Sent(done, now_ns);
+            batches_++;
+        }
+        // A partial batch means the interface queue filled up mid-call
+        if (sent >= 0 || error == ENOBUFS || error == EAGAIN || error == EWOULDBLOCK) {
+            busy = done < count;
+        } else {
+            // E.g. EINVAL for an FD frame on a classic interface, ENETDOWN:
+            // retrying would block every frame behind it
+            CAN_LOG(WARN, TAG, "%s: dropping frame 0x%x: %s", InterfaceName().c_str(), batch_[0].can_id,
+                    strerror(error));
+            done = 1;
+            errors_++;
+        }
+        queue_.Restore(batch_.data() + done, count - done);
+    }
+    if (busy) {
+        busy_++;
+        EventLoop::ArmTimer(timer_fd_, BUSY_RETRY_NS);
+        return;
+    }
+    int64_t due_ns = queue_.NextDueNs(now_ns);
+    if (due_ns < 0) {
+        EventLoop::ArmTimer(timer_fd_, 0);
+        return;
+    }
+    if (due_ns > now_ns) {
+        paced_++;
+    }
+    // A delay of 0 would disarm the timer
+    EventLoop::ArmTimer(timer_fd_, std::max<int64_t>(due_ns - now_ns, 1));
+}
+
+TxStats CanTransmitter::Stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    TxStats stats = queue_.Stats();
+    stats.batches = batches_;
+    stats.paced = paced_;
+    stats.busy = busy_;
+    stats.errors = errors_;
+    return stats;
+}
+
+static bool ParseUnsigned(std::string const& text, unsigned long max, unsigned long &out) {
+    char *end = nullptr;
+    errno = 0;
+    out = std::strtoul(text.c_str(), &end, 10);
+    return errno == 0 && !text.empty() && *end == '\0' && out <= max;
+}
+
+bool ParseTxOption(std::string const& text, std::string &interface, TxConfig &config) {
+    size_t first = text.find(':');
+    size_t second = first == std::string::npos ? std::string::npos : text.find(':', first + 1);
+    std::string name = text.substr(0, first);
+    unsigned long gap_us = static_cast<unsigned long>(config.frame_gap_ns / 1000);
+    unsigned long burst = config.burst;
+    if (name.empty() ||
+        (first != std::string::npos &&
+         !ParseUnsigned(text.substr(first + 1, second == std::string::npos ? std::string::npos : second - first - 1),
+                        1'000'000, gap_us)) ||
+        (second != std::string::npos && (!ParseUnsigned(text.substr(second + 1), 1024, burst) || burst == 0))) {
+        return false;
+    }
+    interface = name;
+    config.frame_gap_ns = static_cast<int64_t>(gap_us) * 1000;
+    config.burst = burst;
+    return true;
+}
+
+}  // namespace tcc::aaos::can
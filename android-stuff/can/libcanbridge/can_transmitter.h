@@ -0,0 +1,139 @@
+#pragma once
+
+#include <linux/can.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "event_loop.h"
+#include "socket_can.h"
+
+namespace tcc::aaos::can {
+
+struct TxConfig {
+    size_t queue_limit = 64; // Frames with distinct IDs waiting at most
+    // Pacing: up to burst frames back to back, then one every
+    // frame_gap_ns. 0 sends as fast as the interface takes them.
+    int64_t frame_gap_ns = 1'000'000;
+    size_t burst = 4;
+};
+
+struct TxStats {
+    uint64_t queued;   // Frames accepted by Push()/Send()
+    uint64_t replaced; // Waiting frames overwritten by a newer one with the same ID
+    uint64_t dropped;  // Frames refused because the queue was full
+    uint64_t sent;
+    uint64_t batches;  // sendmmsg calls that sent at least one frame
+    uint64_t paced;    // Flushes that left frames waiting for the pacing
+    uint64_t busy;     // Flushes that found the interface queue full
+    uint64_t errors;   // Frames discarded after a send error
+    size_t depth;      // Frames waiting now
+};
+
+// Position of id in CAN arbitration: lower wins. The 11 base bits decide
+// first; a standard frame beats an extended one with the same base bits.
+constexpr uint64_t ArbitrationKey(canid_t id) {
+    if (id & CAN_EFF_FLAG) {
+        uint64_t eff = id & CAN_EFF_MASK;
+        return ((eff >> 18) << 19) | (uint64_t{1} << 18) | (eff & 0x3FFFF);
+    }
+    return static_cast<uint64_t>(id & CAN_SFF_MASK) << 19;
+}
+
+// Frames waiting to be sent, highest CAN priority first, released at the
+// pace of a token bucket. A frame for an ID that is already waiting
+// replaces it: a command superseded before it went out is never sent, so a
+// burst of updates costs one frame per ID. Not thread-safe.
+class TxQueue {
+public:
+    explicit TxQueue(TxConfig const& config);
+
+    // False when the queue is full and frame's ID is not already waiting
+    bool Push(canfd_frame const& frame);
+    // Copies up to max of the first waiting frames the pacing allows at
+    // now_ns to out without removing them
+    size_t Front(int64_t now_ns, canfd_frame *out, size_t max) const;
+    // Removes the first count frames, sent at now_ns
+    void Consume(size_t count, int64_t now_ns);
+    // Front() and removal in one step, for a caller that sends the frames
+    // without holding the queue; report the outcome with Sent()/Restore()
+    size_t Pop(int64_t now_ns, canfd_frame *out, size_t max);
+    // Charges count frames sent at now_ns to the pacing
+    void Sent(size_t count, int64_t now_ns);
+    // Puts back popped frames that were not sent. A frame whose ID was
+    // pushed again in the meantime is dropped in favour of the newer one;
+    // the rest may briefly take the queue past its limit.
+    void Restore(canfd_frame const* frames, size_t count);
+    // Earliest time Front() returns a frame; -1 when the queue is empty
+    int64_t NextDueNs(int64_t now_ns) const;
+
+    size_t Depth() const { return frames_.size(); }
+    // Counters kept by the queue: queued, replaced, dropped, sent, depth
+    TxStats Stats() const;
+
+private:
+    struct Entry {
+        uint64_t key;
+        canfd_frame frame;
+    };
+
+    // Frames the pacing allows at now_ns
+    size_t Allowance(int64_t now_ns) const;
+
+    TxConfig config_;
+    std::vector<Entry> frames_; // Sorted by key
+    // Theoretical arrival time of the next frame (GCRA): a frame may go
+    // once now_ns >= tat_ns_ - (burst - 1) * frame_gap_ns
+    int64_t tat_ns_ = 0;
+    uint64_t queued_ = 0;
+    uint64_t replaced_ = 0;
+    uint64_t dropped_ = 0;
+    uint64_t sent_ = 0;
+};
+
+// Transmit stage: frames queued from any thread go out on one interface
+// from the caller's EventLoop through a TxQueue, several per sendmmsg. The
+// socket receives nothing; when the interface queue is full the rest waits
+// for a retry timer.
+class CanTransmitter {
+public:
+    // Retry delay after the interface refused frames
+    constexpr static int64_t BUSY_RETRY_NS = 1'000'000;
+
+    CanTransmitter(EventLoop &loop, std::string const& interface_name, TxConfig const& config = {});
+
+    // Opens the socket and registers it with the loop
+    bool Init();
+    // Any thread: queues frame (see TxQueue::Push()) and wakes the loop
+    bool Send(canfd_frame const& frame);
+
+    TxStats Stats() const;
+    std::string const& InterfaceName() const { return socket_.GetInterfaceName(); }
+
+private:
+    // Loop thread: sends what the pacing allows and arms the timer for the rest
+    void Flush();
+
+    SocketCan socket_;
+    EventLoop &loop_;
+    int event_fd_ = -1;
+    int timer_fd_ = -1;
+
+    mutable std::mutex mutex_; // Guards queue_ and the counters, never held across a syscall
+    TxQueue queue_;
+    std::array<canfd_frame, MAX_TX_BATCH> batch_; // Loop thread only
+    uint64_t batches_ = 0;
+    uint64_t paced_ = 0;
+    uint64_t busy_ = 0;
+    uint64_t errors_ = 0;
+};
+
+// Parses "<interface>[:<frame_gap_us>[:<burst>]]" into interface and the
+// pacing of config. False on malformed input.
+bool ParseTxOption(std::string const& text, std::string &interface, TxConfig &config);
+
+}  // namespace tcc::aaos::can
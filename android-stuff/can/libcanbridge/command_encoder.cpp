@@ -0,0 +1,105 @@
+#include "command_encoder.h"
+
+#include <endian.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "socket_can.h"
+
+namespace tcc::aaos::can {
+
+// Raw field bits of value, masked to the signal's length
+static uint64_t RawValue(SignalDef const& signal, double value) {
+    if (signal.type == ValueType::FLOAT32) {
+        float f = static_cast<float>(value);
+        uint32_t bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+        return bits;
+    }
+    double scaled = std::nearbyint((value - signal.offset) / signal.scale);
+    uint64_t mask = signal.Mask();
+    if (signal.type == ValueType::SIGNED) {
+        // Limits as doubles are exact powers of two, also for 64 bits
+        double half = std::ldexp(1.0, signal.length - 1);
+        if (scaled >= half) {
+            return mask >> 1;
+        }
+        if (scaled < -half) {
+            return (mask >> 1) + 1;
+        }
+        return static_cast<uint64_t>(static_cast<int64_t>(scaled)) & mask;
+    }
+    if (scaled <= 0) {
+        return 0;
+    }
+    if (scaled >= std::ldexp(1.0, signal.length)) {
+        return mask;
+    }
+    return static_cast<uint64_t>(scaled);
+}
+
+bool EncodeMessage(MessageInfo const& info, double const* values, size_t count, canfd_frame &frame) {
+    if (count != info.signal_count || info.sample_count != 1) {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (std::isnan(values[i])) {
+            return false;
+        }
+    }
+    frame = {};
+    frame.can_id = info.can_id;
+    frame.len = info.dlc;
+    frame.flags = info.dlc > CAN_MAX_DLEN ? CANFD_FDF : 0;
+    int last_window = info.LastWindow();
+    for (size_t i = 0; i < count; i++) {
+        SignalDef const& signal = info.signals[i];
+        // Read-modify-write of the same 8-byte window the decoders load
+        int window = signal.Window(last_window);
+        int shift = signal.Shift(window);
+        uint64_t word = signal_detail::LoadPayload(frame.data + window, signal.byte_order);
+        word = (word & ~(signal.Mask() << shift)) | (RawValue(signal, values[i]) << shift);
+        word = signal.byte_order == ByteOrder::BIG_ENDIAN_ORDER ? htobe64(word) : htole64(word);
+        std::memcpy(frame.data + window, &word, sizeof(word));
+    }
+    return true;
+}
+
+CommandEncoder::CommandEncoder(MessageInfo const* messages, size_t message_count)
+        : messages_(messages), values_(message_count) {
+    for (size_t m = 0; m < message_count; m++) {
+        values_[m].fill(0);
+        for (size_t p = 0; p < messages[m].property_count; p++) {
+            routes_[messages[m].properties[p].prop_id] = Route{m, &messages[m].properties[p]};
+        }
+    }
+}
+
+std::vector<int32_t> CommandEncoder::PropIds() const {
+    std::vector<int32_t> prop_ids;
+    for (size_t m = 0; m < values_.size(); m++) {
+        for (size_t p = 0; p < messages_[m].property_count; p++) {
+            prop_ids.push_back(messages_[m].properties[p].prop_id);
+        }
+    }
+    return prop_ids;
+}
+
+bool CommandEncoder::Encode(int32_t prop_id, double const* values, size_t count, canfd_frame &frame) {
+    auto route = routes_.find(prop_id);
+    if (route == routes_.end() || count != route->second.property->signal_count) {
+        return false;
+    }
+    MessageInfo const& info = messages_[route->second.message];
+    std::array<double, MAX_SIGNALS_PER_MESSAGE> updated = values_[route->second.message];
+    std::copy(values, values + count, updated.begin() + route->second.property->first_signal);
+    if (!EncodeMessage(info, updated.data(), info.signal_count, frame)) {
+        return false;
+    }
+    values_[route->second.message] = updated;
+    return true;
+}
+
+}  // namespace tcc::aaos::can
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <linux/can.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "can_signal.h"
+
+namespace tcc::aaos::can {
+
+// Encodes one sample of info into frame, the inverse of the decoders:
+// values[i] (physical, indexed like info.signals) becomes
+// (value - offset) / scale rounded to the nearest integer, saturated to the
+// signal's range, and is stored at its bits in its byte order. Unused
+// payload bytes are 0; frame gets info's ID and DLC, with CANFD_FDF past 8
+// bytes. False when count is not info.signal_count, a value is NaN or the
+// message packs several samples.
+bool EncodeMessage(MessageInfo const& info, double const* values, size_t count, canfd_frame &frame);
+
+// Turns writes of VHAL properties into frames of the messages that carry
+// them. A message may hold several properties; the last value written to
+// each is kept, so the frame for one property also carries the current
+// value of the others (0 until written). Not thread-safe.
+class CommandEncoder {
+public:
+    // messages must outlive the encoder
+    CommandEncoder(MessageInfo const* messages, size_t message_count);
+
+    // Every property that can be encoded
+    std::vector<int32_t> PropIds() const;
+    // Records the count elements of prop_id and encodes its message into
+    // frame. False for an unknown property, an element count that does not
+    // match its PropertyMapping, or a value EncodeMessage() rejects; the
+    // recorded values are then left unchanged.
+    bool Encode(int32_t prop_id, double const* values, size_t count, canfd_frame &frame);
+
+private:
+    struct Route {
+        size_t message;
+        PropertyMapping const* property;
+    };
+
+    MessageInfo const* messages_;
+    std::unordered_map<int32_t, Route> routes_;
+    std::vector<std::array<double, MAX_SIGNALS_PER_MESSAGE>> values_; // Per message
+};
+
+}  // namespace tcc::aaos::can
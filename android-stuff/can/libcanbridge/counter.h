@@ -0,0 +1,30 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace tcc::aaos::can {
+
+constexpr static size_t CACHE_LINE_SIZE = 64;
+
+// Statistics counter owned by one thread. Add() is a relaxed load and store
+// instead of a locked read-modify-write, so counting on the hot path costs a
+// plain increment; any thread may Load() it. Counters written by different
+// threads must live on different cache lines (group them in an
+// alignas(CACHE_LINE_SIZE) block per thread) so reading or updating one
+// never bounces the line of another.
+class LocalCounter {
+public:
+    void Add(uint64_t n = 1) {
+        value_.store(value_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    // For gauges and totals recomputed by their owner
+    void Set(uint64_t value) { value_.store(value, std::memory_order_relaxed); }
+    uint64_t Load() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value_{0};
+};
+
+}  // namespace tcc::aaos::can
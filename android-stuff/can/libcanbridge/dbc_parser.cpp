@@ -0,0 +1,344 @@
+#include "dbc_parser.h"
+
+#include "async_log.h"
+
+#include <cctype>
+#include <cstdlib>
+
+namespace tcc::aaos::can {
+
+constexpr static char TAG[] = "DBC_PARSER";
+
+// DBC message ID of the pseudo message holding signals not assigned to a frame
+constexpr static uint64_t VECTOR_INDEPENDENT_SIG_MSG = 0xC0000000;
+constexpr static uint64_t DBC_EXTENDED_ID_FLAG = 0x80000000;
+
+namespace {
+
+// Tokenizer over one DBC statement
+class Cursor {
+public:
+    explicit Cursor(std::string_view text) : text_(text) {}
+
+    void SkipSpace() {
+        while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_]))) {
+            pos_++;
+        }
+    }
+
+    bool AtEnd() {
+        SkipSpace();
+        return pos_ >= text_.size();
+    }
+
+    bool Peek(char c) {
+        SkipSpace();
+        return pos_ < text_.size() && text_[pos_] == c;
+    }
+
+    bool Expect(char c) {
+        if (!Peek(c)) {
+            return false;
+        }
+        pos_++;
+        return true;
+    }
+
+    // C identifier (DBC names and keywords)
+    bool Ident(std::string_view &out) {
+        SkipSpace();
+        size_t start = pos_;
+        while (pos_ < text_.size() &&
+               (std::isalnum(static_cast<unsigned char>(text_[pos_])) || text_[pos_] == '_')) {
+            pos_++;
+        }
+        out = text_.substr(start, pos_ - start);
+        return !out.empty();
+    }
+
+    bool Number(double &out) {
+        SkipSpace();
+        std::string token;
+        while (pos_ < text_.size() && (std::isalnum(static_cast<unsigned char>(text_[pos_])) ||
+                                       text_[pos_] == '.' || text_[pos_] == '-' || text_[pos_] == '+')) {
+            token.push_back(text_[pos_++]);
+        }
+        char *end = nullptr;
+        out = std::strtod(token.c_str(), &end);
+        return !token.empty() && *end == '\0';
+    }
+
+    bool Unsigned(uint64_t &out) {
+        SkipSpace();
+        size_t start = pos_;
+        out = 0;
+        while (pos_ < text_.size() && std::isdigit(static_cast<unsigned char>(text_[pos_]))) {
+            out = out * 10 + (text_[pos_++] - '0');
+        }
+        return pos_ > start;
+    }
+
+    bool String(std::string &out) {
+        if (!Expect('"')) {
+            return false;
+        }
+        size_t end = text_.find('"', pos_);
+        if (end == std::string_view::npos) {
+            return false;
+        }
+        out.assign(text_.substr(pos_, end - pos_));
+        pos_ = end + 1;
+        return true;
+    }
+
+private:
+    std::string_view text_;
+    size_t pos_ = 0;
+};
+
+// Splits the file into statements: one per line, except that quoted strings
+// (CM_ comments) may span lines
+std::vector<std::pair<size_t, std::string_view>> Statements(std::string_view text) {
+    std::vector<std::pair<size_t, std::string_view>> statements;
+    size_t line = 1;
+    size_t start = 0;
+    size_t start_line = 1;
+    bool quoted = false;
+    for (size_t i = 0; i <= text.size(); i++) {
+        char c = i < text.size() ? text[i] : '\n';
+        if (c == '"') {
+            quoted = !quoted;
+        } else if (c == '\n') {
+            if (!quoted || i == text.size()) {
+                statements.emplace_back(start_line, text.substr(start, i - start));
+                start = i + 1;
+                start_line = line + 1;
+            }
+            line++;
+        }
+    }
+    return statements;
+}
+
+canid_t ToCanId(uint64_t dbc_id) {
+    if (dbc_id & DBC_EXTENDED_ID_FLAG) {
+        return static_cast<canid_t>((dbc_id & CAN_EFF_MASK) | CAN_EFF_FLAG);
+    }
+    return static_cast<canid_t>(dbc_id & CAN_SFF_MASK);
+}
+
+DbcMessage *FindMessage(DbcFile &file, canid_t can_id) {
+    for (DbcMessage &message : file.messages) {
+        if (message.can_id == can_id) {
+            return &message;
+        }
+    }
+    return nullptr;
+}
+
+DbcSignal *FindSignal(DbcFile &file, canid_t can_id, std::string_view name) {
+    DbcMessage *message = FindMessage(file, can_id);
+    if (message == nullptr) {
+        return nullptr;
+    }
+    for (DbcSignal &signal : message->signals) {
+        if (signal.name == name) {
+            return &signal;
+        }
+    }
+    return nullptr;
+}
+
+// BO_ <id> <name>: <dlc> <transmitter>
+bool ParseMessage(Cursor &cursor, DbcFile &file, bool &skipped) {
+    uint64_t id;
+    std::string_view name;
+    uint64_t dlc;
+    if (!cursor.Unsigned(id) || !cursor.Ident(name) || !cursor.Expect(':') || !cursor.Unsigned(dlc)) {
+        return false;
+    }
+    skipped = id == VECTOR_INDEPENDENT_SIG_MSG;
+    if (skipped) {
+        return true;
+    }
+    if (dlc > CANFD_MAX_DLEN) {
+        CAN_LOG(ERROR, TAG, "Message %s: DLC %llu is not a CAN or CAN FD frame",
+                std::string(name).c_str(), static_cast<unsigned long long>(dlc));
+        return false;
+    }
+    DbcMessage message;
+    message.can_id = ToCanId(id);
+    message.name.assign(name);
+    message.dlc = static_cast<uint8_t>(dlc);
+    file.messages.push_back(std::move(message));
+    return true;
+}
+
+// SG_ <name> [M|m<n>] : <start>|<length>@<order><sign> (<scale>,<offset>) [<min>|<max>] "<unit>" <receivers>
+bool ParseSignal(Cursor &cursor, DbcMessage &message) {
+    std::string_view name;
+    if (!cursor.Ident(name)) {
+        return false;
+    }
+    std::string_view multiplexer;
+    if (!cursor.Peek(':') && !cursor.Ident(multiplexer)) {
+        return false;
+    }
+    uint64_t start_bit;
+    uint64_t length;
+    uint64_t order;
+    if (!cursor.Expect(':') || !cursor.Unsigned(start_bit) || !cursor.Expect('|') ||
+        !cursor.Unsigned(length) || !cursor.Expect('@') || !cursor.Unsigned(order)) {
+        return false;
+    }
+    bool is_signed = cursor.Expect('-');
+    if (!is_signed && !cursor.Expect('+')) {
+        return false;
+    }
+    DbcSignal signal;
+    if (!cursor.Expect('(') || !cursor.Number(signal.scale) || !cursor.Expect(',') ||
+        !cursor.Number(signal.offset) || !cursor.Expect(')')) {
+        return false;
+    }
+    if (!multiplexer.empty()) {
+        CAN_LOG(WARN, TAG, "Skipping multiplexed signal %s", std::string(name).c_str());
+        return true;
+    }
+    if (start_bit >= CANFD_MAX_DLEN * 8 || length == 0 || length > 64 || order > 1) {
+        return false;
+    }
+    signal.name.assign(name);
+    signal.start_bit = static_cast<uint16_t>(start_bit);
+    signal.length = static_cast<uint8_t>(length);
+    signal.byte_order = order == 0 ? ByteOrder::BIG_ENDIAN_ORDER : ByteOrder::LITTLE_ENDIAN_ORDER;
+    signal.type = is_signed ? ValueType::SIGNED : ValueType::UNSIGNED;
+    message.signals.push_back(std::move(signal));
+    return true;
+}
+
+// SIG_VALTYPE_ <id> <signal> : <1 = float, 2 = double>;
+bool ParseValueType(Cursor &cursor, DbcFile &file) {
+    uint64_t id;
+    std::string_view name;
+    uint64_t value_type;
+    if (!cursor.Unsigned(id) || !cursor.Ident(name) || !cursor.Expect(':') || !cursor.Unsigned(value_type)) {
+        return false;
+    }
+    DbcSignal *signal = FindSignal(file, ToCanId(id), name);
+    if (signal == nullptr) {
+        return true;
+    }
+    if (value_type != 1 || signal->length != 32) {
+        CAN_LOG(ERROR, TAG, "Signal %s: only 32-bit float values are supported", signal->name.c_str());
+        return false;
+    }
+    signal->type = ValueType::FLOAT32;
+    return true;
+}
+
+// BA_ "<attribute>" [BO_ <id> | SG_ <id> <signal>] <value>;
+bool ParseAttribute(Cursor &cursor, DbcFile &file) {
+    std::string attribute;
+    std::string_view object;
+    if (!cursor.String(attribute) || !cursor.Ident(object)) {
+        // Network-wide attributes carry no object; nothing we use
+        return true;
+    }
+    uint64_t id;
+    if ((object != "BO_" && object != "SG_") || !cursor.Unsigned(id)) {
+        return true;
+    }
+    canid_t can_id = ToCanId(id);
+
+    if (object == "SG_") {
+        std::string_view name;
+        double value;
+        if (!cursor.Ident(name)) {
+            return false;
+        }
+        if (attribute != "VhalProperty") {
+            return true;
+        }
+        DbcSignal *signal = FindSignal(file, can_id, name);
+        if (!cursor.Number(value)) {
+            return false;
+        }
+        if (signal != nullptr) {
+            signal->prop_id = static_cast<int32_t>(value);
+        }
+        return true;
+    }
+
+    DbcMessage *message = FindMessage(file, can_id);
+    if (message == nullptr) {
+        return true;
+    }
+    double value;
+    if (attribute == "VhalFaultProperty") {
+        if (!cursor.Number(value)) {
+            return false;
+        }
+        message->fault_prop_id = static_cast<int32_t>(value);
+    } else if (attribute == "VhalFaultThreshold") {
+        return cursor.Number(message->fault_threshold);
+    } else if (attribute == "VhalSampleCount" || attribute == "VhalSampleStride" ||
+               attribute == "VhalSamplePeriod") {
+        // Range-checked when the database is compiled
+        if (!cursor.Number(value) || value < 0 || value > 1e9) {
+            return false;
+        }
+        if (attribute == "VhalSampleCount") {
+            message->sample_count = static_cast<uint32_t>(value);
+        } else if (attribute == "VhalSampleStride") {
+            message->sample_stride = static_cast<uint32_t>(value);
+        } else {
+            message->sample_period_ns = static_cast<int64_t>(value * 1000);
+        }
+    } else if (attribute == "VhalOkCode") {
+        return cursor.String(message->ok_code);
+    } else if (attribute == "VhalFaultCode") {
+        return cursor.String(message->fault_code);
+    }
+    return true;
+}
+
+}  // namespace
+
+bool ParseDbc(std::string_view text, DbcFile &out) {
+    out.messages.clear();
+    // false after a BO_ that is skipped, so its SG_ lines are dropped too
+    bool in_message = false;
+
+    for (auto const& [line, statement] : Statements(text)) {
+        Cursor cursor(statement);
+        std::string_view keyword;
+        if (!cursor.Ident(keyword)) {
+            continue;
+        }
+        bool ok = true;
+        if (keyword == "BO_") {
+            bool skipped = false;
+            ok = ParseMessage(cursor, out, skipped);
+            in_message = ok && !skipped;
+        } else if (keyword == "SG_") {
+            // An SG_ with nothing after it is the NS_ symbol list
+            if (in_message && !cursor.AtEnd()) {
+                ok = ParseSignal(cursor, out.messages.back());
+            }
+        } else if (keyword == "SIG_VALTYPE_") {
+            ok = cursor.AtEnd() || ParseValueType(cursor, out);
+        } else if (keyword == "BA_") {
+            ok = cursor.AtEnd() || ParseAttribute(cursor, out);
+        } else {
+            in_message = false;
+        }
+        if (!ok) {
+            CAN_LOG(ERROR, TAG, "Invalid DBC statement at line %zu: %s", line,
+                    std::string(statement).c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace tcc::aaos::can
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <linux/can.h>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "can_signal.h"
+
+namespace tcc::aaos::can {
+
+// Subset of the Vector DBC format the gateway understands: BO_, SG_,
+// SIG_VALTYPE_ and the BA_ attributes below. Everything else (nodes, value
+// tables, comments, other attributes) is skipped. Multiplexed signals are
+// ignored.
+//
+// VHAL mapping attributes:
+//   BA_ "VhalProperty" SG_ <id> <signal> <prop_id>;   element of a property;
+//       signals sharing prop_id form one vector value, in definition order
+//   BA_ "VhalFaultProperty" BO_ <id> <prop_id>;       STRING fault property
+//   BA_ "VhalOkCode" BO_ <id> "<code>";
+//   BA_ "VhalFaultCode" BO_ <id> "<code>";
+//   BA_ "VhalFaultThreshold" BO_ <id> <value>;        see FaultCode
+//   BA_ "VhalSampleCount" BO_ <id> <count>;           samples packed per frame,
+//   BA_ "VhalSampleStride" BO_ <id> <bytes>;          see MessageInfo; the SG_
+//   BA_ "VhalSamplePeriod" BO_ <id> <microseconds>;   lines describe sample 0
+//
+// Messages may be CAN FD frames of up to 64 bytes.
+struct DbcSignal {
+    std::string name;
+    uint16_t start_bit = 0;
+    uint8_t length = 0;
+    ByteOrder byte_order = ByteOrder::LITTLE_ENDIAN_ORDER;
+    ValueType type = ValueType::UNSIGNED;
+    double scale = 1.0;
+    double offset = 0.0;
+    int32_t prop_id = 0; // 0 when the signal is not published
+};
+
+struct DbcMessage {
+    canid_t can_id = 0; // CAN_EFF_FLAG set for extended IDs
+    std::string name;
+    uint8_t dlc = 0;
+    std::vector<DbcSignal> signals;
+    int32_t fault_prop_id = 0; // 0 when the message has no fault code
+    std::string ok_code;
+    std::string fault_code;
+    double fault_threshold = 0.0;
+    uint32_t sample_count = 1;
+    uint32_t sample_stride = 0;
+    int64_t sample_period_ns = 0;
+};
+
+struct DbcFile {
+    std::vector<DbcMessage> messages;
+};
+
+// Parses DBC text into out. Logs the offending line and returns false on a
+// syntax error or an unsupported construct in a BO_/SG_ definition.
+bool ParseDbc(std::string_view text, DbcFile &out);
+
+}  // namespace tcc::aaos::can
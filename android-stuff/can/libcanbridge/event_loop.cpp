@@ -0,0 +1,159 @@
+#include "event_loop.h"
+#include "logging.h"
+
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+#define TAG_EVENT_LOOP "EVENT_LOOP"
+
+namespace tcc::aaos::can {
+
+EventLoop::~EventLoop() {
+    for (auto &[fd, handler] : handlers_) {
+        if (handler->owned) {
+            close(fd);
+        }
+    }
+    if (epoll_fd_ >= 0) {
+        close(epoll_fd_);
+    }
+}
+
+bool EventLoop::Init() {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ < 0) {
+        LOG_CAN_ERROR(TAG_EVENT_LOOP, "Failed to create epoll instance");
+        return false;
+    }
+    stop_fd_ = AddEvent([this] { running_ = false; });
+    return stop_fd_ >= 0;
+}
+
+bool EventLoop::Register(int fd, bool owned, FdCallback callback) {
+    auto handler = std::make_unique<Handler>(Handler{fd, owned, std::move(callback)});
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.ptr = handler.get();
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+        LOG_CAN_ERROR(TAG_EVENT_LOOP, "Failed to add fd to epoll");
+        return false;
+    }
+    handlers_[fd] = std::move(handler);
+    return true;
+}
+
+bool EventLoop::AddFd(int fd, FdCallback callback) {
+    return Register(fd, false, std::move(callback));
+}
+
+bool EventLoop::RemoveFd(int fd) {
+    auto it = handlers_.find(fd);
+    if (it == handlers_.end()) {
+        return false;
+    }
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    if (it->second->owned) {
+        close(fd);
+    }
+    it->second->fd = -1;
+    retired_.push_back(std::move(it->second));
+    handlers_.erase(it);
+    return true;
+}
+
+int EventLoop::AddTimer(int64_t period_ns, Callback callback) {
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0) {
+        LOG_CAN_ERROR(TAG_EVENT_LOOP, "Failed to create timerfd");
+        return -1;
+    }
+    itimerspec spec = {};
+    spec.it_interval.tv_sec = period_ns / 1000000000;
+    spec.it_interval.tv_nsec = period_ns % 1000000000;
+    spec.it_value = spec.it_interval;
+    if (timerfd_settime(fd, 0, &spec, nullptr) < 0) {
+        LOG_CAN_ERROR(TAG_EVENT_LOOP, "Failed to arm timerfd");
+        close(fd);
+        return -1;
+    }
+    bool added = Register(fd, true, [fd, callback = std::move(callback)](uint32_t) {
+        uint64_t expirations;
+        if (read(fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+            callback();
+        }
+    });
+    if (!added) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool EventLoop::ArmTimer(int timer_fd, int64_t delay_ns) {
+    itimerspec spec = {};
+    spec.it_value.tv_sec = delay_ns / 1000000000;
+    spec.it_value.tv_nsec = delay_ns % 1000000000;
+    return timerfd_settime(timer_fd, 0, &spec, nullptr) == 0;
+}
+
+int EventLoop::AddEvent(Callback callback) {
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd < 0) {
+        LOG_CAN_ERROR(TAG_EVENT_LOOP, "Failed to create eventfd");
+        return -1;
+    }
+    bool added = Register(fd, true, [fd, callback = std::move(callback)](uint32_t) {
+        uint64_t count;
+        if (read(fd, &count, sizeof(count)) == sizeof(count)) {
+            callback();
+        }
+    });
+    if (!added) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool EventLoop::Notify(int event_fd) {
+    uint64_t one = 1;
+    return write(event_fd, &one, sizeof(one)) == sizeof(one);
+}
+
+bool EventLoop::RunOnce(int timeout_ms) {
+    epoll_event events[MAX_EVENTS];
+    int count = epoll_wait(epoll_fd_, events, MAX_EVENTS, timeout_ms);
+    if (count < 0) {
+        if (errno == EINTR) {
+            return true;
+        }
+        LOG_CAN_ERROR(TAG_EVENT_LOOP, "epoll_wait failed");
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        Handler *handler = static_cast<Handler*>(events[i].data.ptr);
+        if (handler->fd >= 0) {
+            handler->callback(events[i].events);
+        }
+    }
+    retired_.clear();
+    return true;
+}
+
+void EventLoop::Run() {
+    running_ = true;
+    while (running_) {
+        if (!RunOnce(-1)) {
+            break;
+        }
+    }
+}
+
+void EventLoop::Stop() {
+    Notify(stop_fd_);
+}
+
+}  // namespace tcc::aaos::can
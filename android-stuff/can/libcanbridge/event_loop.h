@@ -0,0 +1,69 @@
+#pragma once
+
+#include <sys/epoll.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace tcc::aaos::can {
+
+// Single-threaded epoll loop. CAN sockets, timerfds and eventfds are all
+// serviced from one epoll_wait, so one thread can drive several buses.
+class EventLoop {
+public:
+    using FdCallback = std::function<void(uint32_t events)>;
+    using Callback = std::function<void()>;
+
+    EventLoop() = default;
+    ~EventLoop();
+    EventLoop(EventLoop const&) = delete;
+    EventLoop& operator=(EventLoop const&) = delete;
+
+    bool Init();
+
+    // Calls callback whenever fd is readable. The loop does not own fd.
+    bool AddFd(int fd, FdCallback callback);
+    // Safe to call from inside a callback
+    bool RemoveFd(int fd);
+
+    // Periodic timerfd owned by the loop. Returns the timer fd or -1. A
+    // period of 0 creates the timer disarmed, for use with ArmTimer().
+    int AddTimer(int64_t period_ns, Callback callback);
+    // Fires timer_fd once after delay_ns, replacing any pending expiry; a
+    // delay of 0 disarms it
+    static bool ArmTimer(int timer_fd, int64_t delay_ns);
+
+    // eventfd owned by the loop; callback runs after Notify(fd) from any
+    // thread. Returns the event fd or -1.
+    int AddEvent(Callback callback);
+    static bool Notify(int event_fd);
+
+    // Dispatches events until Stop() is called (from any thread)
+    void Run();
+    // Waits at most timeout_ms for events and dispatches them. Returns false on epoll error.
+    bool RunOnce(int timeout_ms);
+    void Stop();
+
+private:
+    struct Handler {
+        int fd;
+        bool owned;
+        FdCallback callback;
+    };
+
+    bool Register(int fd, bool owned, FdCallback callback);
+
+    constexpr static int MAX_EVENTS = 16;
+
+    int epoll_fd_ = -1;
+    int stop_fd_ = -1;
+    bool running_ = false;
+    std::unordered_map<int, std::unique_ptr<Handler>> handlers_;
+    // Handlers removed while dispatching; freed once the batch is done
+    std::vector<std::unique_ptr<Handler>> retired_;
+};
+
+}  // namespace tcc::aaos::can
@@ -0,0 +1,186 @@
+#include "fusion.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+
+namespace tcc::aaos::can {
+
+FusionStage::FusionStage(FusionConfig const& config, MessageInfo const* messages, size_t message_count)
+        : config_(config), messages_(messages), routes_(message_count) {
+    if (config_.inputs.size() > MAX_FUSION_INPUTS) {
+        config_.inputs.resize(MAX_FUSION_INPUTS);
+    }
+    histories_.resize(config_.inputs.size());
+    // Resolved once, so Add() only walks the routes of the frame's message
+    for (size_t m = 0; m < message_count; m++) {
+        for (size_t p = 0; p < messages[m].property_count; p++) {
+            PropertyMapping const& property = messages[m].properties[p];
+            for (size_t i = 0; i < config_.inputs.size(); i++) {
+                FusionInput const& input = config_.inputs[i];
+                if (input.prop_id == property.prop_id && input.element < property.signal_count) {
+                    routes_[m].push_back({i, static_cast<size_t>(property.first_signal + input.element)});
+                }
+            }
+        }
+    }
+}
+
+void FusionStage::Add(DecodedFrame const& frame) {
+    if (frame.message >= routes_.size() || routes_[frame.message].empty()) {
+        return;
+    }
+    MessageInfo const& message = messages_[frame.message];
+    if (message.fault != nullptr && message.fault->IsFault(frame.values.data(), message.signal_count)) {
+        return;
+    }
+    for (Route const& route : routes_[frame.message]) {
+        Record(route.input, frame.rx_ns, frame.values[route.signal]);
+    }
+    newest_ns_ = std::max(newest_ns_, frame.rx_ns);
+
+    int64_t period_ns = config_.period_ns;
+    if (next_grid_ns_ == 0) {
+        // First grid point after the first sample
+        next_grid_ns_ = (frame.rx_ns / period_ns + 1) * period_ns;
+    }
+    int64_t due_ns = newest_ns_ - config_.delay_ns;
+    if (due_ns - next_grid_ns_ > MAX_CATCH_UP * period_ns) {
+        int64_t resume_ns = (due_ns / period_ns - MAX_CATCH_UP) * period_ns;
+        counters_.skipped.Add(static_cast<uint64_t>((resume_ns - next_grid_ns_) / period_ns));
+        next_grid_ns_ = resume_ns;
+    }
+    while (next_grid_ns_ <= due_ns) {
+        Take(next_grid_ns_);
+        next_grid_ns_ += period_ns;
+    }
+}
+
+void FusionStage::Record(size_t input, int64_t rx_ns, double value) {
+    History &history = histories_[input];
+    if (history.size > 0) {
+        Sample const& newest = history.samples[(history.next + HISTORY - 1) % HISTORY];
+        if (rx_ns < newest.rx_ns) {
+            counters_.late.Add();
+            return;
+        }
+    }
+    history.samples[history.next] = {rx_ns, value};
+    history.next = (history.next + 1) % HISTORY;
+    history.size = std::min(history.size + 1, HISTORY);
+    counters_.samples.Add();
+}
+
+bool FusionStage::ValueAt(size_t input, int64_t t_ns, double &value) const {
+    History const& history = histories_[input];
+    Sample const* before = nullptr;
+    Sample const* after = nullptr;
+    // Newest to oldest: the first sample at or before t ends the search
+    for (size_t k = 1; k <= history.size; k++) {
+        Sample const& sample = history.samples[(history.next + HISTORY - k) % HISTORY];
+        if (sample.rx_ns <= t_ns) {
+            before = &sample;
+            break;
+        }
+        after = &sample;
+    }
+    int64_t window_ns = config_.inputs[input].window_ns;
+    if (before != nullptr && t_ns - before->rx_ns > window_ns) {
+        before = nullptr;
+    }
+    if (after != nullptr && after->rx_ns - t_ns > window_ns) {
+        after = nullptr;
+    }
+    switch (config_.interpolation) {
+        case FusionInterpolation::HOLD:
+            after = nullptr;
+            break;
+        case FusionInterpolation::LINEAR:
+            if (before != nullptr && after != nullptr) {
+                double fraction = static_cast<double>(t_ns - before->rx_ns) /
+                                  static_cast<double>(after->rx_ns - before->rx_ns);
+                value = before->value + (after->value - before->value) * fraction;
+                return true;
+            }
+            break;
+        case FusionInterpolation::NEAREST:
+            break;
+    }
+    if (before != nullptr && (after == nullptr || t_ns - before->rx_ns <= after->rx_ns - t_ns)) {
+        value = before->value;
+        return true;
+    }
+    if (after != nullptr) {
+        value = after->value;
+        return true;
+    }
+    return false;
+}
+
+void FusionStage::Take(int64_t t_ns) {
+    FusionSnapshot snapshot = {};
+    snapshot.timestamp_ns = t_ns;
+    snapshot.count = config_.inputs.size();
+    for (size_t i = 0; i < snapshot.count; i++) {
+        if (ValueAt(i, t_ns, snapshot.values[i])) {
+            snapshot.valid_mask |= 1u << i;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        snapshot.sequence = latest_.sequence + 1;
+        latest_ = snapshot;
+    }
+    counters_.snapshots.Add();
+    taken_.notify_all();
+}
+
+bool FusionStage::Latest(FusionSnapshot &snapshot) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    snapshot = latest_;
+    return latest_.sequence > 0;
+}
+
+bool FusionStage::WaitNext(uint64_t after_sequence, std::chrono::milliseconds timeout,
+                           FusionSnapshot &snapshot) const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!taken_.wait_for(lock, timeout, [this, after_sequence] { return latest_.sequence > after_sequence; })) {
+        return false;
+    }
+    snapshot = latest_;
+    return true;
+}
+
+FusionStats FusionStage::Stats() const {
+    return FusionStats{
+        counters_.samples.Load(),
+        counters_.late.Load(),
+        counters_.snapshots.Load(),
+        counters_.skipped.Load(),
+    };
+}
+
+bool ParseFusionOption(std::string const& text, FusionConfig &config) {
+    char *end = nullptr;
+    errno = 0;
+    double period_ms = std::strtod(text.c_str(), &end);
+    // Also rejects NaN, and periods that would round to a 0 ns grid
+    if (errno != 0 || end == text.c_str() || !(period_ms >= MIN_FUSION_PERIOD_MS) ||
+        period_ms > MAX_FUSION_PERIOD_MS || (*end != ':' && *end != '\0')) {
+        return false;
+    }
+    FusionInterpolation interpolation = FusionInterpolation::LINEAR;
+    std::string mode = *end == ':' ? std::string(end + 1) : std::string();
+    if (mode == "hold") {
+        interpolation = FusionInterpolation::HOLD;
+    } else if (mode == "nearest") {
+        interpolation = FusionInterpolation::NEAREST;
+    } else if (mode != "linear" && !(mode.empty() && *end == '\0')) {
+        return false;
+    }
+    config.period_ns = static_cast<int64_t>(period_ms * 1'000'000);
+    config.interpolation = interpolation;
+    return true;
+}
+
+}  // namespace tcc::aaos::can
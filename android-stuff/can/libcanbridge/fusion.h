@@ -0,0 +1,146 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "can_signal.h"
+#include "counter.h"
+
+namespace tcc::aaos::can {
+
+constexpr static size_t MAX_FUSION_INPUTS = 16;
+
+// How a stream's value at a snapshot time is derived from its samples
+enum class FusionInterpolation {
+    HOLD,    // Latest sample at or before the snapshot time
+    NEAREST, // Closest sample on either side
+    LINEAR,  // Linear between the samples around the snapshot time; the
+             // nearest one when only one side is within the window
+};
+
+// One joined stream: element `element` of property prop_id, whichever
+// message carries it (e.g. AccelX from both 0x123 and the 0x125 bursts)
+struct FusionInput {
+    int32_t prop_id;
+    uint8_t element;
+    int64_t window_ns; // Samples further than this from a snapshot time are not used
+};
+
+struct FusionConfig {
+    std::vector<FusionInput> inputs; // At most MAX_FUSION_INPUTS
+    int64_t period_ns = 10'000'000;  // Snapshot grid, on the RX clock
+    // How far the newest sample must be past a grid point before its
+    // snapshot is taken, so the samples right after it (LINEAR, NEAREST)
+    // have arrived
+    int64_t delay_ns = 20'000'000;
+    FusionInterpolation interpolation = FusionInterpolation::LINEAR;
+};
+
+// Values of every input at one instant. valid_mask bit i is clear when
+// input i had no sample within its window; its value is then 0.
+struct FusionSnapshot {
+    uint64_t sequence;    // 1 for the first snapshot, +1 for each one after
+    int64_t timestamp_ns; // Grid point, CLOCK_REALTIME like DecodedFrame::rx_ns
+    size_t count;         // FusionConfig::inputs.size()
+    uint32_t valid_mask;
+    std::array<double, MAX_FUSION_INPUTS> values;
+
+    bool Valid(size_t input) const { return (valid_mask >> input) & 1; }
+};
+
+struct FusionStats {
+    uint64_t samples;   // Samples that fed an input
+    uint64_t late;      // Samples older than their stream's newest, ignored
+    uint64_t snapshots;
+    uint64_t skipped;   // Grid points skipped after a gap in the traffic
+};
+
+// Windowed join of several decoded signal streams. Samples arrive one
+// stream at a time from the publisher thread; every period_ns of RX time a
+// snapshot aligns all streams to the same instant, so consumers get one
+// coherent record instead of correlating separate property updates.
+//
+// Add() is called by one thread (the publisher). Latest() and WaitNext()
+// may be called from any thread and always return a whole snapshot.
+class FusionStage {
+public:
+    // messages must outlive the stage; DecodedFrame::message indexes it
+    FusionStage(FusionConfig const& config, MessageInfo const* messages, size_t message_count);
+
+    // Feeds every sample of frame that belongs to an input; fault readings
+    // (MessageInfo::fault) are left out. Takes the snapshots it completes.
+    void Add(DecodedFrame const& frame);
+
+    // Newest snapshot; false before the first one
+    bool Latest(FusionSnapshot &snapshot) const;
+    // Waits until a snapshot newer than after_sequence exists and returns
+    // the newest one; false on timeout. Pass the last sequence read so each
+    // snapshot is read once.
+    bool WaitNext(uint64_t after_sequence, std::chrono::milliseconds timeout, FusionSnapshot &snapshot) const;
+
+    FusionConfig const& Config() const { return config_; }
+    FusionStats Stats() const;
+
+private:
+    constexpr static size_t HISTORY = 32;
+    // Grid points taken at most per Add(); after a longer gap the stage
+    // jumps ahead and counts the rest as skipped
+    constexpr static int64_t MAX_CATCH_UP = 64;
+
+    struct Sample {
+        int64_t rx_ns;
+        double value;
+    };
+    // Recent samples of one input, oldest first once full
+    struct History {
+        std::array<Sample, HISTORY> samples;
+        size_t next = 0;
+        size_t size = 0;
+    };
+    // Where input `input` reads its value in frames of one message
+    struct Route {
+        size_t input;
+        size_t signal;
+    };
+
+    void Record(size_t input, int64_t rx_ns, double value);
+    // Value of input at t_ns; false when nothing usable is within its window
+    bool ValueAt(size_t input, int64_t t_ns, double &value) const;
+    void Take(int64_t t_ns);
+
+    FusionConfig config_;
+    MessageInfo const* messages_;
+    std::vector<std::vector<Route>> routes_; // Per message
+    std::vector<History> histories_;         // Per input
+    int64_t newest_ns_ = 0;
+    int64_t next_grid_ns_ = 0;
+    // Written by the Add() thread only
+    struct alignas(CACHE_LINE_SIZE) Counters {
+        LocalCounter samples;
+        LocalCounter late;
+        LocalCounter snapshots;
+        LocalCounter skipped;
+    };
+    Counters counters_;
+
+    mutable std::mutex mutex_;
+    mutable std::condition_variable taken_;
+    FusionSnapshot latest_{};
+};
+
+// Bounds of the --fusion period
+constexpr static double MIN_FUSION_PERIOD_MS = 1;
+constexpr static double MAX_FUSION_PERIOD_MS = 3'600'000;
+
+// Parses "<period_ms>[:<hold|nearest|linear>]" into the period and
+// interpolation of config. False on malformed input or a period outside
+// [MIN_FUSION_PERIOD_MS, MAX_FUSION_PERIOD_MS].
+bool ParseFusionOption(std::string const& text, FusionConfig &config);
+
+}  // namespace tcc::aaos::can
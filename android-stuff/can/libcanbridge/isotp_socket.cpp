@@ -0,0 +1,190 @@
+#include "isotp_socket.h"
+
+#include <linux/can/isotp.h>
+#include <net/if.h>
+#include <unistd.h>
+
+#include "async_log.h"
+#include "socket_can.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace tcc::aaos::can {
+
+constexpr static char TAG[] = "ISOTP";
+
+uint8_t EncodeStMin(uint32_t us) {
+    if (us == 0) {
+        return 0;
+    }
+    // Rounded up: the sender may wait longer than asked, never shorter
+    if (us <= 900) {
+        return static_cast<uint8_t>(0xF0 + (us + 99) / 100);
+    }
+    return static_cast<uint8_t>(std::min<uint32_t>((us + 999) / 1000, 0x7F));
+}
+
+static bool ParseId(std::string const& text, canid_t &id) {
+    char *end = nullptr;
+    errno = 0;
+    unsigned long value = std::strtoul(text.c_str(), &end, 16);
+    if (errno != 0 || text.empty() || *end != '\0' || value > CAN_EFF_MASK) {
+        return false;
+    }
+    id = static_cast<canid_t>(value) | (value > CAN_SFF_MASK ? CAN_EFF_FLAG : 0);
+    return true;
+}
+
+static bool ParseUnsigned(std::string const& text, unsigned long max, unsigned long &out) {
+    char *end = nullptr;
+    errno = 0;
+    out = std::strtoul(text.c_str(), &end, 10);
+    return errno == 0 && !text.empty() && *end == '\0' && out <= max;
+}
+
+bool ParseIsoTpOption(std::string const& text, std::string &interface, IsoTpConfig &config) {
+    std::vector<std::string> fields;
+    size_t start = 0;
+    while (true) {
+        size_t end = text.find(':', start);
+        fields.push_back(text.substr(start, end == std::string::npos ? std::string::npos : end - start));
+        if (end == std::string::npos) {
+            break;
+        }
+        start = end + 1;
+    }
+    if (fields.size() < 4 || fields.size() > 7 || fields[0].empty()) {
+        return false;
+    }
+    IsoTpConfig parsed;
+    unsigned long block_size = 0;
+    unsigned long stmin_us = 0;
+    if (!ParseId(fields[1], parsed.rx_id) || !ParseId(fields[2], parsed.tx_id) ||
+        !ParseId(fields[3], parsed.message_id) ||
+        (fields.size() > 4 && !ParseUnsigned(fields[4], 0xFF, block_size)) ||
+        (fields.size() > 5 && !ParseUnsigned(fields[5], 127'000, stmin_us)) ||
+        (fields.size() > 6 && fields[6] != "fd")) {
+        return false;
+    }
+    parsed.block_size = static_cast<uint8_t>(block_size);
+    parsed.stmin_us = static_cast<uint32_t>(stmin_us);
+    parsed.fd = fields.size() > 6;
+    interface = fields[0];
+    config = parsed;
+    return true;
+}
+
+IsoTpSocket::IsoTpSocket(std::string const& interface_name, IsoTpConfig const& config)
+        : interface_name_(interface_name), config_(config) {}
+
+IsoTpSocket::~IsoTpSocket() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+bool IsoTpSocket::Init() {
+    unsigned int ifindex = if_nametoindex(interface_name_.c_str());
+    if (ifindex == 0) {
+        CAN_LOG(ERROR, TAG, "Unknown interface %s", interface_name_.c_str());
+        return false;
+    }
+    fd_ = socket(PF_CAN, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, CAN_ISOTP);
+    if (fd_ < 0) {
+        CAN_LOG(ERROR, TAG, "Failed to open ISO-TP socket (CONFIG_CAN_ISOTP?): %s", strerror(errno));
+        return false;
+    }
+    can_isotp_fc_options flow_control = {};
+    flow_control.bs = config_.block_size;
+    flow_control.stmin = EncodeStMin(config_.stmin_us);
+    if (setsockopt(fd_, SOL_CAN_ISOTP, CAN_ISOTP_RECV_FC, &flow_control, sizeof(flow_control)) < 0) {
+        CAN_LOG(ERROR, TAG, "Failed to set ISO-TP flow control: %s", strerror(errno));
+        return false;
+    }
+    if (config_.fd) {
+        can_isotp_ll_options link = {};
+        link.mtu = CANFD_MTU;
+        link.tx_dl = CANFD_MAX_DLEN;
+        if (setsockopt(fd_, SOL_CAN_ISOTP, CAN_ISOTP_LL_OPTS, &link, sizeof(link)) < 0) {
+            CAN_LOG(ERROR, TAG, "Failed to enable CAN FD ISO-TP: %s", strerror(errno));
+            return false;
+        }
+    }
+    // Not fatal: Poll() falls back to user-space timestamps
+    int enable = 1;
+    setsockopt(fd_, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable));
+
+    sockaddr_can address = {};
+    address.can_family = AF_CAN;
+    address.can_ifindex = static_cast<int>(ifindex);
+    address.can_addr.tp.rx_id = config_.rx_id;
+    address.can_addr.tp.tx_id = config_.tx_id;
+    if (bind(fd_, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+        CAN_LOG(ERROR, TAG, "Failed to bind ISO-TP socket on %s: %s", interface_name_.c_str(), strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+int IsoTpSocket::Receive(BufferPool &pool) {
+    size_t count = 0;
+    while (count < MAX_PDU_BATCH) {
+        uint8_t *buffer = pool.Acquire();
+        if (buffer == nullptr) {
+            break;
+        }
+        pdus_[count].data = buffer;
+        iov_[count] = {buffer, pool.BufferSize()};
+        msghdr &hdr = msgs_[count].msg_hdr;
+        hdr = {};
+        hdr.msg_iov = &iov_[count];
+        hdr.msg_iovlen = 1;
+        hdr.msg_control = cmsg_[count].data();
+        hdr.msg_controllen = cmsg_[count].size();
+        count++;
+    }
+    if (count == 0) {
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    int received = recvmmsg(fd_, msgs_.data(), count, MSG_DONTWAIT, nullptr);
+    int error = errno;
+    // Unused buffers go straight back
+    for (size_t i = received > 0 ? static_cast<size_t>(received) : 0; i < count; i++) {
+        pool.Release(pdus_[i].data);
+    }
+    if (received < 0) {
+        if (error == EAGAIN || error == EWOULDBLOCK) {
+            return 0;
+        }
+        // E.g. ECOMM or ETIMEDOUT for a PDU whose reception broke off
+        CAN_LOG(WARN, TAG, "%s: ISO-TP receive failed: %s", interface_name_.c_str(), strerror(error));
+        errno = error;
+        return -1;
+    }
+
+    int64_t now_ns = RealtimeNowNs();
+    for (int i = 0; i < received; i++) {
+        msghdr &hdr = msgs_[i].msg_hdr;
+        pdus_[i].length = std::min<size_t>(msgs_[i].msg_len, pool.BufferSize());
+        if (hdr.msg_flags & MSG_TRUNC) {
+            truncated_++;
+        }
+        pdus_[i].rx_ns = now_ns;
+        for (cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                timespec ts;
+                std::memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                pdus_[i].rx_ns = static_cast<int64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+            }
+        }
+    }
+    return received;
+}
+
+}  // namespace tcc::aaos::can
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <linux/can.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "buffer_pool.h"
+#include "socket_can.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace tcc::aaos::can {
+
+// One ISO-TP (ISO 15765-2) receive channel. The sender segments a PDU into
+// a First Frame and Consecutive Frames on rx_id; we answer with Flow Control
+// frames on tx_id, which pace it by block_size and stmin.
+struct IsoTpConfig {
+    canid_t rx_id = 0;      // Frames of the sender (CAN_EFF_FLAG for 29-bit IDs)
+    canid_t tx_id = 0;      // Our flow control frames
+    // Decoder message the PDU is made of: the payload is a run of records of
+    // that message's dlc bytes, each decoded as if it had arrived in a frame
+    canid_t message_id = 0;
+    uint8_t block_size = 0; // Consecutive Frames between Flow Controls; 0 = all at once
+    uint32_t stmin_us = 0;  // Minimum gap we ask the sender to leave between Consecutive Frames
+    bool fd = false;        // CAN FD link layer: 64-byte frames, PDUs past 4095 bytes
+};
+
+// The STmin byte of a Flow Control frame for a gap of at least us
+// microseconds: 0xF1-0xF9 for 100-900 us, 0x00-0x7F for whole milliseconds
+uint8_t EncodeStMin(uint32_t us);
+
+// Parses "<interface>:<rx_id>:<tx_id>:<message_id>[:<block_size>[:<stmin_us>[:fd]]]",
+// IDs in hex (rx/tx IDs above 0x7FF are 29-bit). False on malformed input.
+bool ParseIsoTpOption(std::string const& text, std::string &interface, IsoTpConfig &config);
+
+// Receive backend for PDUs larger than a frame: a kernel CAN_ISOTP socket
+// (CONFIG_CAN_ISOTP, Linux 5.10+) does segmentation, flow control and
+// reassembly, and every recvmmsg returns whole PDUs. Poll() receives them
+// into buffers of a caller-owned BufferPool, so a PDU costs no allocation.
+class IsoTpSocket {
+public:
+    // Largest PDU received whole: the kernel's default max_pdu_size. Longer
+    // ones are truncated and counted in Truncated().
+    constexpr static size_t MAX_PDU_SIZE = 8300;
+    // PDUs received by one Poll(); the pool needs this many buffers
+    constexpr static size_t MAX_PDU_BATCH = 8;
+
+    IsoTpSocket(std::string const& interface_name, IsoTpConfig const& config);
+    ~IsoTpSocket();
+    IsoTpSocket(IsoTpSocket const&) = delete;
+    IsoTpSocket& operator=(IsoTpSocket const&) = delete;
+
+    // Opens a non-blocking socket with the configured flow control and binds it
+    bool Init();
+    int GetFd() const { return fd_; }
+    std::string const& GetInterfaceName() const { return interface_name_; }
+    IsoTpConfig const& Config() const { return config_; }
+
+    // Receives up to MAX_PDU_BATCH reassembled PDUs with one recvmmsg and
+    // calls visit(uint8_t const* data, size_t length, int64_t rx_ns) for
+    // each, rx_ns being the kernel time of its last frame (CLOCK_REALTIME).
+    // The buffers go back to pool when visit returns. Never blocks; returns
+    // the number of PDUs visited, or -1 with errno set.
+    template <typename VISITOR>
+    int Poll(BufferPool &pool, VISITOR &&visit);
+
+    // PDUs longer than the pool buffers, delivered cut short
+    uint64_t Truncated() const { return truncated_; }
+
+private:
+    struct Pdu {
+        uint8_t *data;
+        size_t length;
+        int64_t rx_ns;
+    };
+
+    // Fills pdus_ from the socket; buffers still to be released by the caller
+    int Receive(BufferPool &pool);
+
+    std::string interface_name_;
+    IsoTpConfig config_;
+    int fd_ = -1;
+    uint64_t truncated_ = 0;
+    std::array<Pdu, MAX_PDU_BATCH> pdus_{};
+    // recvmmsg bookkeeping, kept here so Poll() does not allocate
+    std::array<mmsghdr, MAX_PDU_BATCH> msgs_{};
+    std::array<iovec, MAX_PDU_BATCH> iov_{};
+    std::array<CmsgBuffer<CMSG_SPACE(sizeof(timespec))>, MAX_PDU_BATCH> cmsg_{};
+};
+
+template <typename VISITOR>
+int IsoTpSocket::Poll(BufferPool &pool, VISITOR &&visit) {
+    int count = Receive(pool);
+    for (int i = 0; i < count; i++) {
+        visit(static_cast<uint8_t const*>(pdus_[i].data), pdus_[i].length, pdus_[i].rx_ns);
+        pool.Release(pdus_[i].data);
+    }
+    return count;
+}
+
+}  // namespace tcc::aaos::can
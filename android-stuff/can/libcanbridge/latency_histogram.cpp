@@ -0,0 +1,126 @@
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace tcc::aaos::can {
+
+size_t LatencyHistogram::BucketIndex(uint64_t value) {
+    if (value < SUB_BUCKETS) {
+        return value;
+    }
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - SUB_BUCKET_BITS;
+    size_t sub = (value >> shift) & (SUB_BUCKETS - 1);
+    return (shift + 1) * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(size_t index) {
+    size_t group = index / SUB_BUCKETS;
+    size_t sub = index % SUB_BUCKETS;
+    if (group == 0) {
+        return sub;
+    }
+    uint64_t lower = static_cast<uint64_t>(SUB_BUCKETS + sub) << (group - 1);
+    return lower + (uint64_t{1} << (group - 1)) - 1;
+}
+
+void LatencyHistogram::Record(int64_t value_ns) {
+    // Clock steps can make a stage look negative; count it as zero
+    if (value_ns < 0) {
+        value_ns = 0;
+    }
+    buckets_[BucketIndex(static_cast<uint64_t>(value_ns))]++;
+    count_++;
+    max_ = std::max(max_, value_ns);
+}
+
+int64_t LatencyHistogram::Percentile(double percentile) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    uint64_t target = static_cast<uint64_t>(std::ceil(percentile / 100.0 * count_));
+    target = std::clamp<uint64_t>(target, 1, count_);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets_.size(); i++) {
+        seen += buckets_[i];
+        if (seen >= target) {
+            return std::min<int64_t>(BucketUpperBound(i), max_);
+        }
+    }
+    return max_;
+}
+
+void LatencyHistogram::Reset() {
+    buckets_.fill(0);
+    count_ = 0;
+    max_ = 0;
+}
+
+LatencyTracker::LatencyTracker(canid_t const* can_ids, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        stages_[can_ids[i]];
+        totals_[can_ids[i]];
+    }
+}
+
+void LatencyTracker::Record(canid_t can_id, int64_t rx_ns, int64_t decoded_ns,
+                            int64_t publish_start_ns, int64_t published_ns) {
+    auto it = stages_.find(can_id);
+    if (it == stages_.end()) {
+        return;
+    }
+    it->second.rx_to_decode.Record(decoded_ns - rx_ns);
+    it->second.decode_to_publish.Record(publish_start_ns - decoded_ns);
+    it->second.publish.Record(published_ns - publish_start_ns);
+    StageLatency &total = totals_[can_id];
+    total.rx_to_decode.Record(decoded_ns - rx_ns);
+    total.decode_to_publish.Record(publish_start_ns - decoded_ns);
+    total.publish.Record(published_ns - publish_start_ns);
+}
+
+static void AppendStage(std::string &out, char const* name, LatencyHistogram const& histogram) {
+    char line[128];
+    snprintf(line, sizeof(line), "  %-18s p50=%lldus p99=%lldus max=%lldus n=%llu\n", name,
+             static_cast<long long>(histogram.Percentile(50) / 1000),
+             static_cast<long long>(histogram.Percentile(99) / 1000),
+             static_cast<long long>(histogram.Max() / 1000),
+             static_cast<unsigned long long>(histogram.Count()));
+    out += line;
+}
+
+std::string LatencyTracker::Report() {
+    std::string out;
+    for (auto &[can_id, stage] : stages_) {
+        char header[32];
+        snprintf(header, sizeof(header), "0x%03X\n", can_id);
+        out += header;
+        AppendStage(out, "rx->decode", stage.rx_to_decode);
+        AppendStage(out, "decode->publish", stage.decode_to_publish);
+        AppendStage(out, "publish", stage.publish);
+        stage.rx_to_decode.Reset();
+        stage.decode_to_publish.Reset();
+        stage.publish.Reset();
+    }
+    return out;
+}
+
+static LatencyPercentiles PercentilesOf(LatencyHistogram const& histogram) {
+    return LatencyPercentiles{histogram.Count(), histogram.Percentile(50), histogram.Percentile(99),
+                              histogram.Percentile(99.9), histogram.Max()};
+}
+
+std::vector<CanIdLatency> LatencyTracker::Summaries() const {
+    std::vector<CanIdLatency> summaries;
+    summaries.reserve(totals_.size());
+    for (auto const& [can_id, stage] : totals_) {
+        summaries.push_back({can_id, PercentilesOf(stage.rx_to_decode), PercentilesOf(stage.decode_to_publish),
+                             PercentilesOf(stage.publish)});
+    }
+    std::sort(summaries.begin(), summaries.end(),
+              [](CanIdLatency const& a, CanIdLatency const& b) { return a.can_id < b.can_id; });
+    return summaries;
+}
+
+}  // namespace tcc::aaos::can
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <linux/can.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tcc::aaos::can {
+
+// Log-linear latency histogram. Every power of two is split into SUB_BUCKETS
+// linear buckets, so a reported percentile is within 1/SUB_BUCKETS of the real
+// value. Recording is a few integer ops and never allocates.
+class LatencyHistogram {
+public:
+    void Record(int64_t value_ns);
+    // Upper bound of the bucket holding the given percentile (0-100), in ns
+    int64_t Percentile(double percentile) const;
+    int64_t Max() const { return max_; }
+    uint64_t Count() const { return count_; }
+    void Reset();
+
+private:
+    constexpr static int SUB_BUCKET_BITS = 3;
+    constexpr static int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    constexpr static int BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    static size_t BucketIndex(uint64_t value);
+    static uint64_t BucketUpperBound(size_t index);
+
+    std::array<uint32_t, BUCKETS> buckets_{};
+    uint64_t count_ = 0;
+    int64_t max_ = 0;
+};
+
+// Per CAN ID latency of each gateway stage:
+//   rx_to_decode      kernel RX timestamp -> frame decoded
+//   decode_to_publish frame decoded -> VHAL transaction carrying it starts
+//   publish           duration of that VHAL transaction
+struct StageLatency {
+    LatencyHistogram rx_to_decode;
+    LatencyHistogram decode_to_publish;
+    LatencyHistogram publish;
+};
+
+// Percentiles of one stage, in ns
+struct LatencyPercentiles {
+    uint64_t count;
+    int64_t p50_ns;
+    int64_t p99_ns;
+    int64_t p999_ns;
+    int64_t max_ns;
+};
+
+struct CanIdLatency {
+    canid_t can_id;
+    LatencyPercentiles rx_to_decode;
+    LatencyPercentiles decode_to_publish;
+    LatencyPercentiles publish;
+};
+
+class LatencyTracker {
+public:
+    // Histograms are created up front for the given IDs so Record() never allocates
+    LatencyTracker(canid_t const* can_ids, size_t count);
+
+    void Record(canid_t can_id, int64_t rx_ns, int64_t decoded_ns,
+                int64_t publish_start_ns, int64_t published_ns);
+
+    // Formats p50/p99/max per ID and stage, then starts a new interval
+    std::string Report();
+
+    // Percentiles per ID since the tracker was created, sorted by ID
+    std::vector<CanIdLatency> Summaries() const;
+
+private:
+    std::unordered_map<canid_t, StageLatency> stages_; // Since the last Report()
+    std::unordered_map<canid_t, StageLatency> totals_;
+};
+
+}  // namespace tcc::aaos::can
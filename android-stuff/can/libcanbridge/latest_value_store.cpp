@@ -0,0 +1,32 @@
+#include "latest_value_store.h"
+
+namespace tcc::aaos::can {
+
+static uint64_t KeyOf(int32_t prop_id, int32_t area_id) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(prop_id)) << 32) | static_cast<uint32_t>(area_id);
+}
+
+LatestValueStore::LatestValueStore(size_t capacity) : slots_(capacity) {
+    index_.reserve(capacity);
+}
+
+bool LatestValueStore::Put(PropertyValue const& value) {
+    size_t slot;
+    auto it = index_.find(KeyOf(value.prop_id, value.area_id));
+    if (it != index_.end()) {
+        slot = it->second;
+    } else if (size_ < slots_.size()) {
+        slot = size_++;
+        index_.emplace(KeyOf(value.prop_id, value.area_id), slot);
+    } else {
+        rejected_++;
+        return false;
+    }
+    Slot &held = slots_[slot];
+    held.value = value;
+    held.text.assign(value.string_value);
+    held.value.string_value = held.text;
+    return true;
+}
+
+}  // namespace tcc::aaos::can
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "property_sink.h"
+
+namespace tcc::aaos::can {
+
+struct LatestValueStoreStats {
+    size_t size;       // (property, area) pairs held
+    uint64_t rejected; // New pairs refused because the store was full
+};
+
+// Last value handed to the sink per (property, area), so everything can be
+// republished at once when the receiver comes back after a restart. Bounded:
+// the slots are allocated up front and a full store keeps what it has
+// instead of growing.
+class LatestValueStore {
+public:
+    explicit LatestValueStore(size_t capacity);
+
+    // Replaces the held value of (prop_id, area_id). Returns false when the
+    // pair is new and the store is full.
+    bool Put(PropertyValue const& value);
+
+    // Calls visit(PropertyValue const&) for every held value, oldest pair
+    // first. string_value points into the store.
+    template <typename VISITOR>
+    void ForEach(VISITOR &&visit) const {
+        for (size_t i = 0; i < size_; i++) {
+            visit(static_cast<PropertyValue const&>(slots_[i].value));
+        }
+    }
+
+    LatestValueStoreStats Stats() const { return {size_, rejected_}; }
+
+private:
+    struct Slot {
+        PropertyValue value;
+        std::string text; // Owns value.string_value
+    };
+
+    std::vector<Slot> slots_;
+    std::unordered_map<uint64_t, size_t> index_;
+    size_t size_ = 0;
+    uint64_t rejected_ = 0;
+};
+
+}  // namespace tcc::aaos::can
@@ -0,0 +1,7 @@
+#include "async_log.h"
+
+// Socket-level diagnostics, now routed through the asynchronous log. LOG_CAN
+// is DEBUG and compiled out unless CAN_LOG_MIN_LEVEL allows it; errors are
+// always kept. msg must be a C string.
+#define LOG_CAN(tag, msg) CAN_LOG(DEBUG, tag, "%s:%d %s", __FILE__, __LINE__, msg)
+#define LOG_CAN_ERROR(tag, msg) CAN_LOG(ERROR, tag, "%s:%d %s", __FILE__, __LINE__, msg)
\ No newline at end of file
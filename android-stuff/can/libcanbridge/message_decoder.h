@@ -0,0 +1,44 @@
+#pragma once
+
+#include <linux/can.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "can_signal.h"
+
+namespace tcc::aaos::can {
+
+// Message set the gateway decodes: the compile-time VehicleSignals table or
+// a SignalDatabase loaded from a DBC file.
+class MessageDecoder {
+public:
+    virtual ~MessageDecoder() = default;
+
+    // Decodes a classic or CAN FD frame and returns the number of samples
+    // written to out (MessageInfo::sample_count); 0 when the frame is not in
+    // the set or is shorter than its DLC. May read every data byte of frame,
+    // past frame.len.
+    virtual size_t Decode(canfd_frame const& frame, DecodedSamples &out) const = 0;
+
+    // Type-erased message views, indexed like DecodedFrame::message
+    virtual MessageInfo const* Messages() const = 0;
+    virtual size_t MessageCount() const = 0;
+
+    // CAN_RAW_FILTER entries matching exactly the set's data frames
+    virtual std::vector<can_filter> Filters() const = 0;
+};
+
+// Adapts a SignalTable<...> to MessageDecoder
+template <typename TABLE>
+class StaticDecoder : public MessageDecoder {
+public:
+    size_t Decode(canfd_frame const& frame, DecodedSamples &out) const override {
+        return TABLE::Decode(frame, out);
+    }
+    MessageInfo const* Messages() const override { return TABLE::MESSAGES_INFO; }
+    size_t MessageCount() const override { return TABLE::MESSAGE_COUNT; }
+    std::vector<can_filter> Filters() const override { return TABLE::Filters(); }
+};
+
+}  // namespace tcc::aaos::can
@@ -0,0 +1,418 @@
+#include "metrics.h"
+
+#include "async_log.h"
+#include "realtime.h"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+namespace tcc::aaos::can {
+
+constexpr static char TAG[] = "METRICS";
+
+constexpr static size_t MAX_COMMAND = 64;
+// A client that neither sends its command nor reads the reply in time is dropped
+constexpr static int CLIENT_TIMEOUT_MS = 1000;
+constexpr static int LISTEN_BACKLOG = 4;
+
+static int64_t MonotonicNowNs() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1'000'000'000 + now.tv_nsec;
+}
+
+static bool MakeAddress(std::string const& path, sockaddr_un &address) {
+    address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        CAN_LOG(ERROR, TAG, "Socket path too long: %s", path.c_str());
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+static void SetTimeouts(int fd) {
+    timeval timeout = {CLIENT_TIMEOUT_MS / 1000, (CLIENT_TIMEOUT_MS % 1000) * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+static bool WriteAll(int fd, std::string const& text) {
+    size_t written = 0;
+    while (written < text.size()) {
+        ssize_t n = send(fd, text.data() + written, text.size() - written, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        written += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+MetricsSnapshot CollectMetrics(MetricsSources const& sources) {
+    MetricsSnapshot snapshot = {};
+    snapshot.rx = sources.gateway->Stats();
+    for (MessageRxStats const& message : sources.gateway->MessageStats()) {
+        snapshot.can_ids.push_back({message.can_id, message.frames, message.decode_failures, 0});
+    }
+    snapshot.buses = sources.gateway->GetBusStats();
+    snapshot.queue = sources.publisher->Stats();
+    snapshot.queue_capacity = Publisher::QUEUE_CAPACITY;
+    snapshot.sink = sources.sink->Stats();
+    snapshot.latency = sources.publisher->LatencySummaries();
+    if (sources.fusion != nullptr) {
+        snapshot.has_fusion = true;
+        snapshot.fusion = sources.fusion->Stats();
+    }
+    if (sources.transmitter != nullptr) {
+        snapshot.has_tx = true;
+        snapshot.tx = sources.transmitter->Stats();
+    }
+    return snapshot;
+}
+
+// snprintf into a string; every line of both formats is short
+template <typename... Args>
+static void Append(std::string &out, char const* format, Args... args) {
+    char line[256];
+    snprintf(line, sizeof(line), format, args...);
+    out += line;
+}
+
+static unsigned long long U(uint64_t value) {
+    return static_cast<unsigned long long>(value);
+}
+
+static double Us(int64_t ns) {
+    return static_cast<double>(ns) / 1000.0;
+}
+
+static void AppendStage(std::string &out, canid_t can_id, char const* stage, LatencyPercentiles const& latency) {
+    Append(out, "  0x%03X  %-17s %10llu %9.1f %9.1f %9.1f %9.1f\n", can_id, stage, U(latency.count),
+           Us(latency.p50_ns), Us(latency.p99_ns), Us(latency.p999_ns), Us(latency.max_ns));
+}
+
+std::string FormatDump(MetricsSnapshot const& snapshot) {
+    std::string out;
+    Append(out, "CAN -> VHAL gateway (uptime %.3f s)\n\n", static_cast<double>(snapshot.uptime_ns) / 1e9);
+
+    MetricsSnapshot const& s = snapshot;
+    Append(out, "RX:\n");
+    Append(out, "  frames=%llu decoded=%llu decode_failures=%llu read_errors=%llu\n", U(s.rx.frames),
+           U(s.rx.decoded), U(s.rx.decode_failures), U(s.rx.read_errors));
+    Append(out, "  kernel_drops=%llu error_frames=%llu isotp_pdus=%llu\n\n", U(s.rx.rx_queue_drops),
+           U(s.rx.error_frames), U(s.rx.pdus));
+
+    Append(out, "CAN IDs:\n");
+    Append(out, "  %-6s %12s %10s %10s\n", "id", "frames", "failures", "frames/s");
+    for (CanIdMetrics const& id : s.can_ids) {
+        Append(out, "  0x%03X  %12llu %10llu %10.1f\n", id.can_id, U(id.frames), U(id.decode_failures),
+               id.frames_per_second);
+    }
+    out += "\n";
+
+    Append(out, "Buses:\n");
+    for (BusStats const& bus : s.buses) {
+        Append(out, "  %s: %s, error_frames=%llu tec=%u rec=%u bus_off=%llu restarts=%llu failed=%llu\n",
+               bus.interface_name.c_str(), BusStateName(bus.state), U(bus.error_frames), bus.tx_errors,
+               bus.rx_errors, U(bus.bus_offs), U(bus.restarts), U(bus.restart_failures));
+        Append(out, "    error_passive=%lldms bus_off=%lldms last_recovery=%lldus max_recovery=%lldus\n",
+               static_cast<long long>(bus.error_passive_ns / 1'000'000),
+               static_cast<long long>(bus.bus_off_ns / 1'000'000),
+               static_cast<long long>(bus.last_recovery_ns / 1'000),
+               static_cast<long long>(bus.max_recovery_ns / 1'000));
+    }
+    out += "\n";
+
+    Append(out, "Publisher queue:\n");
+    Append(out, "  depth=%zu/%zu high_water=%zu enqueued=%llu dropped=%llu overflows=%llu\n\n", s.queue.depth,
+           s.queue_capacity, s.queue.high_water, U(s.queue.enqueued), U(s.queue.dropped), U(s.queue.overflows));
+
+    Append(out, "VHAL:\n");
+    Append(out, "  transactions=%llu values=%llu errors=%llu reconnects=%llu resumed=%llu\n\n",
+           U(s.sink.transactions), U(s.sink.values), U(s.sink.errors), U(s.sink.reconnects), U(s.queue.resumed));
+
+    if (s.has_fusion) {
+        Append(out, "Fusion:\n");
+        Append(out, "  snapshots=%llu samples=%llu late=%llu skipped=%llu\n\n", U(s.fusion.snapshots),
+               U(s.fusion.samples), U(s.fusion.late), U(s.fusion.skipped));
+    }
+
+    if (s.has_tx) {
+        Append(out, "TX:\n");
+        Append(out, "  depth=%zu queued=%llu replaced=%llu dropped=%llu sent=%llu batches=%llu\n", s.tx.depth,
+               U(s.tx.queued), U(s.tx.replaced), U(s.tx.dropped), U(s.tx.sent), U(s.tx.batches));
+        Append(out, "  paced=%llu busy=%llu errors=%llu\n\n", U(s.tx.paced), U(s.tx.busy), U(s.tx.errors));
+    }
+
+    Append(out, "Publish latency (us, since start):\n");
+    Append(out, "  %-6s %-17s %10s %9s %9s %9s %9s\n", "id", "stage", "count", "p50", "p99", "p99.9", "max");
+    for (CanIdLatency const& latency : s.latency) {
+        AppendStage(out, latency.can_id, "rx->decode", latency.rx_to_decode);
+        AppendStage(out, latency.can_id, "decode->publish", latency.decode_to_publish);
+        AppendStage(out, latency.can_id, "publish", latency.publish);
+    }
+    return out;
+}
+
+static void AppendLatency(std::string &out, canid_t can_id, char const* stage, LatencyPercentiles const& latency) {
+    constexpr char NAME[] = "can2vhal_publish_latency_seconds";
+    struct {
+        char const* quantile;
+        int64_t ns;
+    } const quantiles[] = {{"0.5", latency.p50_ns}, {"0.99", latency.p99_ns}, {"0.999", latency.p999_ns}};
+    for (auto const& q : quantiles) {
+        Append(out, "%s{can_id=\"0x%03X\",stage=\"%s\",quantile=\"%s\"} %.9f\n", NAME, can_id, stage, q.quantile,
+               static_cast<double>(q.ns) / 1e9);
+    }
+    Append(out, "%s_max{can_id=\"0x%03X\",stage=\"%s\"} %.9f\n", NAME, can_id, stage,
+           static_cast<double>(latency.max_ns) / 1e9);
+    Append(out, "%s_count{can_id=\"0x%03X\",stage=\"%s\"} %llu\n", NAME, can_id, stage, U(latency.count));
+}
+
+std::string FormatMetrics(MetricsSnapshot const& snapshot) {
+    std::string out;
+    MetricsSnapshot const& s = snapshot;
+    Append(out, "can2vhal_uptime_seconds %.3f\n", static_cast<double>(s.uptime_ns) / 1e9);
+    Append(out, "can2vhal_rx_frames_total %llu\n", U(s.rx.frames));
+    Append(out, "can2vhal_rx_decoded_total %llu\n", U(s.rx.decoded));
+    Append(out, "can2vhal_rx_decode_failures_total %llu\n", U(s.rx.decode_failures));
+    Append(out, "can2vhal_rx_read_errors_total %llu\n", U(s.rx.read_errors));
+    Append(out, "can2vhal_rx_kernel_drops_total %llu\n", U(s.rx.rx_queue_drops));
+    Append(out, "can2vhal_rx_error_frames_total %llu\n", U(s.rx.error_frames));
+    Append(out, "can2vhal_rx_isotp_pdus_total %llu\n", U(s.rx.pdus));
+    for (CanIdMetrics const& id : s.can_ids) {
+        Append(out, "can2vhal_can_id_frames_total{can_id=\"0x%03X\"} %llu\n", id.can_id, U(id.frames));
+        Append(out, "can2vhal_can_id_decode_failures_total{can_id=\"0x%03X\"} %llu\n", id.can_id,
+               U(id.decode_failures));
+        Append(out, "can2vhal_can_id_frames_per_second{can_id=\"0x%03X\"} %.1f\n", id.can_id,
+               id.frames_per_second);
+    }
+    for (BusStats const& bus : s.buses) {
+        char const* name = bus.interface_name.c_str();
+        Append(out, "can2vhal_bus_state{interface=\"%s\",state=\"%s\"} 1\n", name, BusStateName(bus.state));
+        Append(out, "can2vhal_bus_error_frames_total{interface=\"%s\"} %llu\n", name, U(bus.error_frames));
+        Append(out, "can2vhal_bus_off_total{interface=\"%s\"} %llu\n", name, U(bus.bus_offs));
+        Append(out, "can2vhal_bus_restarts_total{interface=\"%s\"} %llu\n", name, U(bus.restarts));
+    }
+    Append(out, "can2vhal_queue_depth %zu\n", s.queue.depth);
+    Append(out, "can2vhal_queue_capacity %zu\n", s.queue_capacity);
+    Append(out, "can2vhal_queue_high_water %zu\n", s.queue.high_water);
+    Append(out, "can2vhal_queue_enqueued_total %llu\n", U(s.queue.enqueued));
+    Append(out, "can2vhal_queue_dropped_total %llu\n", U(s.queue.dropped));
+    Append(out, "can2vhal_vhal_transactions_total %llu\n", U(s.sink.transactions));
+    Append(out, "can2vhal_vhal_values_total %llu\n", U(s.sink.values));
+    Append(out, "can2vhal_vhal_errors_total %llu\n", U(s.sink.errors));
+    Append(out, "can2vhal_vhal_reconnects_total %llu\n", U(s.sink.reconnects));
+    if (s.has_fusion) {
+        Append(out, "can2vhal_fusion_snapshots_total %llu\n", U(s.fusion.snapshots));
+        Append(out, "can2vhal_fusion_samples_total %llu\n", U(s.fusion.samples));
+        Append(out, "can2vhal_fusion_late_samples_total %llu\n", U(s.fusion.late));
+        Append(out, "can2vhal_fusion_skipped_total %llu\n", U(s.fusion.skipped));
+    }
+    if (s.has_tx) {
+        Append(out, "can2vhal_tx_depth %zu\n", s.tx.depth);
+        Append(out, "can2vhal_tx_queued_total %llu\n", U(s.tx.queued));
+        Append(out, "can2vhal_tx_replaced_total %llu\n", U(s.tx.replaced));
+        Append(out, "can2vhal_tx_dropped_total %llu\n", U(s.tx.dropped));
+        Append(out, "can2vhal_tx_sent_total %llu\n", U(s.tx.sent));
+        Append(out, "can2vhal_tx_batches_total %llu\n", U(s.tx.batches));
+        Append(out, "can2vhal_tx_paced_total %llu\n", U(s.tx.paced));
+        Append(out, "can2vhal_tx_busy_total %llu\n", U(s.tx.busy));
+        Append(out, "can2vhal_tx_errors_total %llu\n", U(s.tx.errors));
+    }
+    for (CanIdLatency const& latency : s.latency) {
+        AppendLatency(out, latency.can_id, "rx_to_decode", latency.rx_to_decode);
+        AppendLatency(out, latency.can_id, "decode_to_publish", latency.decode_to_publish);
+        AppendLatency(out, latency.can_id, "publish", latency.publish);
+    }
+    return out;
+}
+
+std::string FormatFusion(FusionSnapshot const& snapshot) {
+    std::string out;
+    Append(out, "%llu %lld", U(snapshot.sequence), static_cast<long long>(snapshot.timestamp_ns));
+    for (size_t i = 0; i < snapshot.count; i++) {
+        if (snapshot.Valid(i)) {
+            Append(out, " %.6g", snapshot.values[i]);
+        } else {
+            out += " -";
+        }
+    }
+    out += "\n";
+    return out;
+}
+
+MetricsServer::MetricsServer(std::string path, MetricsSources sources)
+        : path_(std::move(path)), sources_(sources) {}
+
+MetricsServer::~MetricsServer() {
+    Stop();
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+        unlink(path_.c_str());
+    }
+}
+
+bool MetricsServer::Init() {
+    sockaddr_un address;
+    if (!MakeAddress(path_, address)) {
+        return false;
+    }
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        CAN_LOG(ERROR, TAG, "Failed to create metrics socket: %s", strerror(errno));
+        return false;
+    }
+    // Left behind by a previous instance that did not exit cleanly
+    unlink(path_.c_str());
+    if (bind(listen_fd_, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+        CAN_LOG(ERROR, TAG, "Failed to bind %s: %s", path_.c_str(), strerror(errno));
+        return false;
+    }
+    chmod(path_.c_str(), 0660);
+    if (listen(listen_fd_, LISTEN_BACKLOG) < 0) {
+        CAN_LOG(ERROR, TAG, "Failed to listen on %s: %s", path_.c_str(), strerror(errno));
+        return false;
+    }
+    if (!loop_.Init() || !loop_.AddFd(listen_fd_, [this](uint32_t) { OnConnection(); })) {
+        return false;
+    }
+    start_ns_ = MonotonicNowNs();
+    last_sample_ns_ = start_ns_;
+    Sample();
+    return loop_.AddTimer(SAMPLE_PERIOD_NS, [this] { Sample(); }) >= 0;
+}
+
+void MetricsServer::Start() {
+    thread_ = std::thread([this] {
+        // Default scheduling, whatever the creating thread runs with
+        ApplyThreadConfig(ThreadConfig{}, "can-metrics");
+        loop_.Run();
+    });
+}
+
+void MetricsServer::Stop() {
+    if (thread_.joinable()) {
+        loop_.Stop();
+        thread_.join();
+    }
+}
+
+void MetricsServer::Sample() {
+    int64_t now_ns = MonotonicNowNs();
+    std::vector<MessageRxStats> messages = sources_.gateway->MessageStats();
+    double elapsed_s = static_cast<double>(now_ns - last_sample_ns_) / 1e9;
+    rates_.assign(messages.size(), 0);
+    if (last_frames_.size() == messages.size() && elapsed_s > 0) {
+        for (size_t i = 0; i < messages.size(); i++) {
+            rates_[i] = static_cast<double>(messages[i].frames - last_frames_[i]) / elapsed_s;
+        }
+    }
+    last_frames_.resize(messages.size());
+    for (size_t i = 0; i < messages.size(); i++) {
+        last_frames_[i] = messages[i].frames;
+    }
+    last_sample_ns_ = now_ns;
+}
+
+MetricsSnapshot MetricsServer::Collect() const {
+    MetricsSnapshot snapshot = CollectMetrics(sources_);
+    snapshot.uptime_ns = MonotonicNowNs() - start_ns_;
+    for (size_t i = 0; i < snapshot.can_ids.size() && i < rates_.size(); i++) {
+        snapshot.can_ids[i].frames_per_second = rates_[i];
+    }
+    return snapshot;
+}
+
+std::string MetricsServer::Handle(std::string const& command) const {
+    if (command.empty() || command == "dump") {
+        return FormatDump(Collect());
+    }
+    if (command == "metrics") {
+        return FormatMetrics(Collect());
+    }
+    if (command == "fusion") {
+        FusionSnapshot snapshot;
+        if (sources_.fusion == nullptr || !sources_.fusion->Latest(snapshot)) {
+            return "No fusion snapshot\n";
+        }
+        return FormatFusion(snapshot);
+    }
+    return "Unknown command '" + command + "'; use dump, metrics or fusion\n";
+}
+
+void MetricsServer::OnConnection() {
+    int client;
+    while ((client = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC)) >= 0) {
+        SetTimeouts(client);
+        // One command line; EOF or a timeout before the newline ends it
+        char buffer[MAX_COMMAND];
+        size_t length = 0;
+        while (length < sizeof(buffer)) {
+            ssize_t n = recv(client, buffer + length, sizeof(buffer) - length, 0);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            length += static_cast<size_t>(n);
+            if (std::memchr(buffer, '\n', length) != nullptr) {
+                break;
+            }
+        }
+        std::string command(buffer, length);
+        command.erase(0, command.find_first_not_of(" \t\r\n"));
+        size_t end = command.find_first_of(" \t\r\n");
+        if (end != std::string::npos) {
+            command.erase(end);
+        }
+        if (!WriteAll(client, Handle(command))) {
+            CAN_LOG(WARN, TAG, "Metrics client went away: %s", strerror(errno));
+        }
+        close(client);
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        CAN_LOG(ERROR, TAG, "accept failed: %s", strerror(errno));
+    }
+}
+
+bool QueryMetrics(std::string const& path, std::string const& command, std::string &reply) {
+    sockaddr_un address;
+    if (!MakeAddress(path, address)) {
+        return false;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+    SetTimeouts(fd);
+    if (connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || !WriteAll(fd, command + "\n")) {
+        close(fd);
+        return false;
+    }
+    reply.clear();
+    char buffer[4096];
+    ssize_t n;
+    while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0 || (n < 0 && errno == EINTR)) {
+        if (n > 0) {
+            reply.append(buffer, static_cast<size_t>(n));
+        }
+    }
+    close(fd);
+    return n == 0;
+}
+
+}  // namespace tcc::aaos::can
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bus_monitor.h"
+#include "can_gateway.h"
+#include "can_transmitter.h"
+#include "event_loop.h"
+#include "fusion.h"
+#include "latency_histogram.h"
+#include "property_sink.h"
+#include "publisher.h"
+
+namespace tcc::aaos::can {
+
+struct CanIdMetrics {
+    canid_t can_id;
+    uint64_t frames;
+    uint64_t decode_failures;
+    double frames_per_second; // Over the last MetricsServer sampling period
+};
+
+// Everything the metrics endpoint reports, read from the gateway stages
+// without stopping them
+struct MetricsSnapshot {
+    int64_t uptime_ns;
+    GatewayStats rx;
+    std::vector<CanIdMetrics> can_ids;
+    std::vector<BusStats> buses;
+    PublisherStats queue;
+    size_t queue_capacity;
+    SinkStats sink;
+    std::vector<CanIdLatency> latency; // VHAL publish latency per CAN ID
+    bool has_fusion;
+    FusionStats fusion;
+    bool has_tx;
+    TxStats tx;
+};
+
+// Stages the snapshot is read from; all must outlive the MetricsServer and
+// be fully set up (interfaces added) before it starts
+struct MetricsSources {
+    CanGateway const* gateway;
+    Publisher const* publisher;
+    PropertySink const* sink;
+    FusionStage const* fusion = nullptr; // Optional
+    CanTransmitter const* transmitter = nullptr; // Optional
+};
+
+// Reads every counter; uptime and frame rates are left 0
+MetricsSnapshot CollectMetrics(MetricsSources const& sources);
+
+// dumpsys-style report: one section per stage, aligned tables
+std::string FormatDump(MetricsSnapshot const& snapshot);
+// One "name{labels} value" sample per line (Prometheus text format), for
+// scripts and collectors
+std::string FormatMetrics(MetricsSnapshot const& snapshot);
+// One line "<sequence> <timestamp_ns> <value>..." per fusion snapshot, "-"
+// for an input without a value
+std::string FormatFusion(FusionSnapshot const& snapshot);
+
+// Serves the metrics on a local SOCK_STREAM Unix socket from its own thread,
+// so a slow or stuck client never delays the RX or publisher threads. A
+// client sends one command line, "dump" (the default on an empty line or
+// EOF), "metrics" or "fusion" (the newest fusion snapshot), reads the reply
+// until EOF and is disconnected.
+class MetricsServer {
+public:
+    constexpr static int64_t SAMPLE_PERIOD_NS = 1'000'000'000;
+
+    MetricsServer(std::string path, MetricsSources sources);
+    ~MetricsServer();
+    MetricsServer(MetricsServer const&) = delete;
+    MetricsServer& operator=(MetricsServer const&) = delete;
+
+    // Replaces a stale socket file at path and starts listening
+    bool Init();
+    void Start();
+    void Stop();
+
+    // Snapshot with uptime and per-ID rates, as served to clients
+    MetricsSnapshot Collect() const;
+    // Reply to one command line
+    std::string Handle(std::string const& command) const;
+
+private:
+    void OnConnection();
+    // Per CAN ID frame rates since the previous sample
+    void Sample();
+
+    std::string path_;
+    MetricsSources sources_;
+    int64_t start_ns_ = 0;
+    int listen_fd_ = -1;
+    EventLoop loop_;
+    std::thread thread_;
+    // Metrics thread only once started
+    int64_t last_sample_ns_ = 0;
+    std::vector<uint64_t> last_frames_;
+    std::vector<double> rates_;
+};
+
+// Client side: sends command to the server at path and returns its reply in
+// reply. False when the server cannot be reached.
+bool QueryMetrics(std::string const& path, std::string const& command, std::string &reply);
+
+}  // namespace tcc::aaos::can
@@ -0,0 +1,141 @@
+#include "packet_ring.h"
+
+#include <arpa/inet.h>
+#include <linux/filter.h>
+#include <linux/if_ether.h>
+#include <net/if.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "async_log.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+
+namespace tcc::aaos::can {
+
+constexpr static char TAG[] = "PACKET_RING";
+// tp_frame_size only matters for TPACKET_V1/V2; V3 packs frames back to back
+constexpr static uint32_t FRAME_SIZE = 2048;
+
+PacketRing::PacketRing(std::string const& interface_name, PacketRingConfig const& config)
+        : interface_name_(interface_name), config_(config) {}
+
+PacketRing::~PacketRing() {
+    if (ring_ != nullptr) {
+        munmap(ring_, ring_size_);
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+bool PacketRing::Init() {
+    unsigned int ifindex = if_nametoindex(interface_name_.c_str());
+    if (ifindex == 0) {
+        CAN_LOG(ERROR, TAG, "Unknown interface %s", interface_name_.c_str());
+        return false;
+    }
+    // ETH_P_ALL: classic frames are ETH_P_CAN, CAN FD frames ETH_P_CANFD
+    fd_ = socket(PF_PACKET, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, htons(ETH_P_ALL));
+    if (fd_ < 0) {
+        CAN_LOG(ERROR, TAG, "Failed to open packet socket: %s", strerror(errno));
+        return false;
+    }
+    // Filter before the ring exists so unwanted frames never occupy it
+    // Always attached: like CAN_RAW, error frames are dropped unless asked for
+    if (!AttachFilter()) {
+        return false;
+    }
+    // Not fatal: Poll() also skips PACKET_OUTGOING (kernels before 4.20)
+    int ignore = 1;
+    setsockopt(fd_, SOL_PACKET, PACKET_IGNORE_OUTGOING, &ignore, sizeof(ignore));
+
+    int version = TPACKET_V3;
+    if (setsockopt(fd_, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) {
+        CAN_LOG(ERROR, TAG, "TPACKET_V3 not supported: %s", strerror(errno));
+        return false;
+    }
+    tpacket_req3 request = {};
+    request.tp_block_size = config_.block_size;
+    request.tp_block_nr = config_.block_count;
+    request.tp_frame_size = FRAME_SIZE;
+    request.tp_frame_nr = config_.block_size / FRAME_SIZE * config_.block_count;
+    request.tp_retire_blk_tov = config_.retire_timeout_ms;
+    if (setsockopt(fd_, SOL_PACKET, PACKET_RX_RING, &request, sizeof(request)) < 0) {
+        CAN_LOG(ERROR, TAG, "Failed to create RX ring: %s", strerror(errno));
+        return false;
+    }
+    ring_size_ = static_cast<size_t>(config_.block_size) * config_.block_count;
+    void *ring = mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED, fd_, 0);
+    if (ring == MAP_FAILED) {
+        // MAP_LOCKED needs CAP_IPC_LOCK or enough RLIMIT_MEMLOCK; the ring works without it
+        ring = mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    }
+    if (ring == MAP_FAILED) {
+        CAN_LOG(ERROR, TAG, "Failed to map RX ring: %s", strerror(errno));
+        return false;
+    }
+    ring_ = static_cast<uint8_t *>(ring);
+
+    sockaddr_ll address = {};
+    address.sll_family = AF_PACKET;
+    address.sll_protocol = htons(ETH_P_ALL);
+    address.sll_ifindex = static_cast<int>(ifindex);
+    if (bind(fd_, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+        CAN_LOG(ERROR, TAG, "Failed to bind to %s: %s", interface_name_.c_str(), strerror(errno));
+        return false;
+    }
+    CAN_LOG(INFO, TAG, "%s: %u blocks of %u bytes", interface_name_.c_str(), config_.block_count,
+            config_.block_size);
+    return true;
+}
+
+bool PacketRing::AttachFilter() {
+    // BPF_ABS word loads are big-endian while canfd_frame::can_id is in host
+    // order, so ids and masks are compared byte-swapped. Error frames only
+    // go through the error mask, as on CAN_RAW:
+    //   A = can_id; if (A & CAN_ERR_FLAG) { accept if (A & err_mask) != 0 }
+    // then per filter:
+    //   A = can_id; A &= mask; if (A == id & mask) accept
+    std::vector<sock_filter> program;
+    program.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(canfd_frame, can_id)));
+    program.push_back(BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, ntohl(CAN_ERR_FLAG), 0, 4));
+    program.push_back(BPF_STMT(BPF_ALU | BPF_AND | BPF_K, ntohl(err_mask_ & CAN_ERR_MASK)));
+    program.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0, 0, 1));
+    program.push_back(BPF_STMT(BPF_RET | BPF_K, 0));
+    program.push_back(BPF_STMT(BPF_RET | BPF_K, 0xffff));
+    if (filters_.empty()) {
+        program.push_back(BPF_STMT(BPF_RET | BPF_K, 0xffff));
+    }
+    for (can_filter const& filter : filters_) {
+        uint32_t mask = ntohl(filter.can_mask);
+        uint32_t id = ntohl(filter.can_id & filter.can_mask);
+        program.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(canfd_frame, can_id)));
+        program.push_back(BPF_STMT(BPF_ALU | BPF_AND | BPF_K, mask));
+        program.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, id, 0, 1));
+        program.push_back(BPF_STMT(BPF_RET | BPF_K, 0xffff));
+    }
+    program.push_back(BPF_STMT(BPF_RET | BPF_K, 0));
+
+    sock_fprog fprog = {static_cast<unsigned short>(program.size()), program.data()};
+    if (setsockopt(fd_, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog)) < 0) {
+        CAN_LOG(ERROR, TAG, "Failed to attach CAN filter: %s", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+uint64_t PacketRing::Drops() {
+    // Reading the statistics resets them, hence the running total
+    tpacket_stats_v3 stats = {};
+    socklen_t length = sizeof(stats);
+    if (fd_ >= 0 && getsockopt(fd_, SOL_PACKET, PACKET_STATISTICS, &stats, &length) == 0) {
+        drops_ += stats.tp_drops;
+    }
+    return drops_;
+}
+
+}  // namespace tcc::aaos::can
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <linux/can.h>
+#include <linux/if_packet.h>
+
+#include "socket_can.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace tcc::aaos::can {
+
+struct PacketRingConfig {
+    uint32_t block_size = 1 << 16; // Bytes per block, a multiple of the page size
+    uint32_t block_count = 16;
+    // A block is handed to user space when it is full or this many ms after
+    // its first frame, whichever comes first: the upper bound on the latency
+    // the ring adds on a quiet bus
+    uint32_t retire_timeout_ms = 1;
+};
+
+// Zero-copy receive backend: a PF_PACKET socket bound to the CAN netdev with
+// a TPACKET_V3 RX ring mapped into the process. The kernel fills whole
+// blocks of frames; Poll() walks them in place and hands every frame to the
+// caller straight from the ring, with the kernel RX timestamp, without a
+// copy or a syscall per frame.
+//
+// PF_PACKET has no CAN_RAW_FILTER, so SetFilters() and SetErrorMask()
+// compile the id/mask pairs and error classes into a classic BPF socket
+// filter with the same matching rules.
+// Frames this host transmits are skipped, like on a CAN_RAW socket; local
+// loopback frames from other sockets are kept. Classic and CAN FD frames are
+// both delivered, as on a SocketCan; anything else (CAN XL) is counted in
+// Skipped(). Opening the socket needs CAP_NET_RAW.
+class PacketRing {
+public:
+    explicit PacketRing(std::string const& interface_name, PacketRingConfig const& config = {});
+    ~PacketRing();
+    PacketRing(PacketRing const&) = delete;
+    PacketRing& operator=(PacketRing const&) = delete;
+
+    // Same semantics as SocketCan::SetFilters; call before Init()
+    void SetFilters(std::vector<can_filter> const& filters) { filters_ = filters; }
+    // Same semantics as SocketCan::SetErrorMask; call before Init()
+    void SetErrorMask(can_err_mask_t mask) { err_mask_ = mask; }
+    bool Init();
+
+    // For an EventLoop; readable once a block has been retired to user space
+    int GetFd() const { return fd_; }
+    std::string const& GetInterfaceName() const { return interface_name_; }
+
+    // Calls visit(canfd_frame const&, int64_t timestamp_ns) for every frame
+    // in the blocks the kernel has handed over, then returns those blocks to
+    // the kernel. frame.flags is normalized like CanRxFrame::frame. CAN FD
+    // frames are visited in place; classic frames, which take only CAN_MTU
+    // bytes of the ring, through a copy, so visit may always read the whole
+    // canfd_frame. The reference is only valid during the call. Never
+    // blocks; returns the number of frames visited.
+    template <typename VISITOR>
+    size_t Poll(VISITOR &&visit);
+
+    // Frames the kernel dropped because the ring was full (PACKET_STATISTICS),
+    // cumulative since Init()
+    uint64_t Drops();
+    // Outgoing, truncated or non-CAN packets ignored by Poll()
+    uint64_t Skipped() const { return skipped_; }
+
+private:
+    bool AttachFilter();
+    tpacket_block_desc *Block(size_t index) const {
+        return reinterpret_cast<tpacket_block_desc *>(ring_ + index * config_.block_size);
+    }
+
+    std::string interface_name_;
+    PacketRingConfig config_;
+    std::vector<can_filter> filters_;
+    can_err_mask_t err_mask_ = 0;
+    int fd_ = -1;
+    uint8_t *ring_ = nullptr;
+    size_t ring_size_ = 0;
+    size_t next_block_ = 0;
+    uint64_t drops_ = 0;
+    uint64_t skipped_ = 0;
+};
+
+template <typename VISITOR>
+size_t PacketRing::Poll(VISITOR &&visit) {
+    size_t frames = 0;
+    for (;;) {
+        tpacket_block_desc *block = Block(next_block_);
+        // Acquire: the frames of the block are visible once TP_STATUS_USER is
+        if ((__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0) {
+            break;
+        }
+        uint32_t count = block->hdr.bh1.num_pkts;
+        uint8_t *packet = reinterpret_cast<uint8_t *>(block) + block->hdr.bh1.offset_to_first_pkt;
+        for (uint32_t i = 0; i < count; i++) {
+            auto const* header = reinterpret_cast<tpacket3_hdr const*>(packet);
+            auto const* address = reinterpret_cast<sockaddr_ll const*>(packet + TPACKET_ALIGN(sizeof(tpacket3_hdr)));
+            if (address->sll_pkttype == PACKET_OUTGOING ||
+                (header->tp_snaplen != CAN_MTU && header->tp_snaplen != CANFD_MTU)) {
+                skipped_++;
+            } else {
+                int64_t timestamp_ns = static_cast<int64_t>(header->tp_sec) * 1'000'000'000 + header->tp_nsec;
+                if (header->tp_snaplen == CANFD_MTU) {
+                    // The block is ours until it is released; flag it in place
+                    auto *frame = reinterpret_cast<canfd_frame *>(packet + header->tp_mac);
+                    frame->flags |= CANFD_FDF;
+                    visit(static_cast<canfd_frame const&>(*frame), timestamp_ns);
+                } else {
+                    canfd_frame frame;
+                    std::memcpy(&frame, packet + header->tp_mac, CAN_MTU);
+                    frame.flags = 0;
+                    visit(static_cast<canfd_frame const&>(frame), timestamp_ns);
+                }
+                frames++;
+            }
+            packet += header->tp_next_offset;
+        }
+        // Release: the kernel may reuse the block only after we are done with it
+        __atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+        next_block_ = (next_block_ + 1) % config_.block_count;
+    }
+    return frames;
+}
+
+}  // namespace tcc::aaos::can
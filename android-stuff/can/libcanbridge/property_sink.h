@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+#include "can_signal.h"
+
+namespace tcc::aaos::can {
+
+constexpr static size_t MAX_PROPERTY_VALUES = MAX_SIGNALS_PER_MESSAGE;
+
+// One property update handed to a PropertySink. Which array is meaningful
+// follows TypeOf(prop_id): int32_values for INT32/INT32_VEC, float_values for
+// FLOAT/FLOAT_VEC, string_value for STRING.
+struct PropertyValue {
+    int32_t prop_id;
+    int32_t area_id;
+    size_t count; // Elements used in int32_values / float_values
+    std::array<int32_t, MAX_PROPERTY_VALUES> int32_values;
+    std::array<float, MAX_PROPERTY_VALUES> float_values;
+    std::string_view string_value; // Only valid during PropertySink::Add()
+};
+
+struct SinkStats {
+    uint64_t transactions; // Flush() calls that sent something
+    uint64_t values;       // Property values sent
+    uint64_t errors;       // Failed transactions plus values rejected by the receiver
+    uint64_t reconnects;   // Times the receiver was lost and reconnected
+};
+
+// Where the publisher delivers property updates: the VHAL on the target, a
+// fake in tests. All calls except Stats() come from the publisher thread.
+class PropertySink {
+public:
+    virtual ~PropertySink() = default;
+
+    // Highest publication rate of each property in Hz, 0 when unlimited
+    // or unknown. Called once before publishing starts.
+    virtual std::vector<float> MaxSampleRates(std::vector<int32_t> const& prop_ids) = 0;
+
+    // Copies the value into the pending transaction
+    virtual void Add(PropertyValue const& value) = 0;
+    virtual size_t Pending() const = 0;
+    // Sends every pending value as one transaction. Returns false on error.
+    virtual bool Flush() = 0;
+
+    virtual SinkStats Stats() const = 0;
+
+    // Sinks whose receiver can go away (the VHAL restarting) report it here:
+    // false from the moment the sink notices until Reconnect() succeeds.
+    // Values added meanwhile may be dropped.
+    virtual bool Connected() const { return true; }
+    // callback is called from any thread once a new receiver is available;
+    // set once before publishing starts
+    virtual void SetReconnectCallback(std::function<void()> callback) { (void)callback; }
+    // Switches to the new receiver; false when there is none yet
+    virtual bool Reconnect() { return true; }
+};
+
+}  // namespace tcc::aaos::can
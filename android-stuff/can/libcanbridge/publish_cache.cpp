@@ -0,0 +1,80 @@
+#include "publish_cache.h"
+
+#include <cmath>
+
+namespace tcc::aaos::can {
+
+void PublishCache::SetPolicy(int32_t prop_id, PublishPolicy policy) {
+    policies_[prop_id] = policy;
+}
+
+PublishCache::Entry& PublishCache::Lookup(int32_t prop_id, int32_t area_id) {
+    uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(prop_id)) << 32) |
+                   static_cast<uint32_t>(area_id);
+    return entries_[key];
+}
+
+PublishPolicy const& PublishCache::Policy(int32_t prop_id) const {
+    auto it = policies_.find(prop_id);
+    return it == policies_.end() ? default_policy_ : it->second;
+}
+
+bool PublishCache::RefreshDue(Entry const& entry, int32_t prop_id, int64_t now_ns) const {
+    int64_t interval = Policy(prop_id).refresh_interval_ns;
+    return interval > 0 && now_ns - entry.published_ns >= interval;
+}
+
+bool PublishCache::Decide(Entry &entry, bool publish, int64_t now_ns) {
+    if (!publish) {
+        suppressed_++;
+        return false;
+    }
+    entry.valid = true;
+    entry.published_ns = now_ns;
+    published_++;
+    return true;
+}
+
+template <typename T>
+bool PublishCache::ShouldPublishNumeric(int32_t prop_id, int32_t area_id, T const* values,
+                                        size_t count, int64_t now_ns) {
+    Entry &entry = Lookup(prop_id, area_id);
+    if (count > MAX_CACHED_VALUES) {
+        entry.count = 0;
+        return Decide(entry, true, now_ns);
+    }
+    bool publish = !entry.valid || entry.count != count || RefreshDue(entry, prop_id, now_ns);
+    double deadband = Policy(prop_id).deadband;
+    for (size_t i = 0; i < count && !publish; i++) {
+        publish = std::fabs(static_cast<double>(values[i]) - entry.numeric[i]) > deadband;
+    }
+    if (publish) {
+        entry.count = count;
+        for (size_t i = 0; i < count; i++) {
+            entry.numeric[i] = static_cast<double>(values[i]);
+        }
+    }
+    return Decide(entry, publish, now_ns);
+}
+
+bool PublishCache::ShouldPublish(int32_t prop_id, int32_t area_id, int32_t const* values,
+                                 size_t count, int64_t now_ns) {
+    return ShouldPublishNumeric(prop_id, area_id, values, count, now_ns);
+}
+
+bool PublishCache::ShouldPublish(int32_t prop_id, int32_t area_id, float const* values,
+                                 size_t count, int64_t now_ns) {
+    return ShouldPublishNumeric(prop_id, area_id, values, count, now_ns);
+}
+
+bool PublishCache::ShouldPublish(int32_t prop_id, int32_t area_id, std::string_view value,
+                                 int64_t now_ns) {
+    Entry &entry = Lookup(prop_id, area_id);
+    bool publish = !entry.valid || entry.text != value || RefreshDue(entry, prop_id, now_ns);
+    if (publish) {
+        entry.text.assign(value.data(), value.size());
+    }
+    return Decide(entry, publish, now_ns);
+}
+
+}  // namespace tcc::aaos::can
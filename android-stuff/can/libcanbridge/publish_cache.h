@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace tcc::aaos::can {
+
+struct PublishPolicy {
+    // Numeric properties: publish only when some element moved by more than
+    // this from the last published value. 0 publishes on any change.
+    double deadband = 0;
+    // Republish an unchanged value after this long (0 = only on change)
+    int64_t refresh_interval_ns = 0;
+};
+
+struct PublishCacheStats {
+    uint64_t published;
+    uint64_t suppressed;
+};
+
+// Last published value per (property, area). Numeric values honour the
+// property's deadband; string and enum values are published on transition.
+// Both are republished once refresh_interval_ns has elapsed, so CONTINUOUS
+// subscribers still see the property at least at that rate.
+class PublishCache {
+public:
+    // Vectors longer than this are not cached and always published
+    constexpr static size_t MAX_CACHED_VALUES = 8;
+
+    void SetPolicy(int32_t prop_id, PublishPolicy policy);
+
+    // Each returns true when the value must be published, and then records it
+    // as the last published value.
+    bool ShouldPublish(int32_t prop_id, int32_t area_id, int32_t const* values, size_t count,
+                       int64_t now_ns);
+    bool ShouldPublish(int32_t prop_id, int32_t area_id, float const* values, size_t count,
+                       int64_t now_ns);
+    bool ShouldPublish(int32_t prop_id, int32_t area_id, std::string_view value, int64_t now_ns);
+
+    PublishCacheStats Stats() const { return {published_, suppressed_}; }
+
+private:
+    struct Entry {
+        bool valid = false;
+        int64_t published_ns = 0;
+        size_t count = 0;
+        std::array<double, MAX_CACHED_VALUES> numeric{};
+        std::string text;
+    };
+
+    Entry& Lookup(int32_t prop_id, int32_t area_id);
+    PublishPolicy const& Policy(int32_t prop_id) const;
+    bool RefreshDue(Entry const& entry, int32_t prop_id, int64_t now_ns) const;
+    template <typename T>
+    bool ShouldPublishNumeric(int32_t prop_id, int32_t area_id, T const* values, size_t count,
+                              int64_t now_ns);
+    bool Decide(Entry &entry, bool publish, int64_t now_ns);
+
+    std::unordered_map<int32_t, PublishPolicy> policies_;
+    std::unordered_map<uint64_t, Entry> entries_;
+    PublishPolicy default_policy_;
+    uint64_t published_ = 0;
+    uint64_t suppressed_ = 0;
+};
+
+}  // namespace tcc::aaos::can
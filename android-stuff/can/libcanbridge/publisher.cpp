@@ -0,0 +1,333 @@
+#include "publisher.h"
+#include "socket_can.h"
+#include "async_log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace tcc::aaos::can {
+
+constexpr static char TAG[] = "PUBLISHER";
+
+// VHAL minSampleRate is 1 Hz for every sensor property: an unchanged value is
+// still republished once per second.
+constexpr static int64_t REFRESH_INTERVAL_NS = 1'000'000'000;
+// Poll interval of EnqueueWait()/WaitEmpty() while the ring is full/busy
+constexpr static std::chrono::microseconds QUEUE_WAIT{50};
+
+static std::vector<canid_t> CanIdsOf(MessageInfo const* messages, size_t count) {
+    std::vector<canid_t> ids;
+    for (size_t i = 0; i < count; i++) {
+        ids.push_back(messages[i].can_id);
+    }
+    return ids;
+}
+
+Publisher::Publisher(PropertySink &sink, MessageInfo const* messages, size_t message_count,
+                     int64_t report_interval_ns)
+        : sink_(sink),
+          messages_(messages),
+          message_count_(message_count),
+          latency_(CanIdsOf(messages, message_count).data(), message_count),
+          report_interval_ns_(report_interval_ns) {}
+
+Publisher::~Publisher() {
+    Stop();
+}
+
+void Publisher::SetPolicy(int32_t prop_id, DecimationMode mode, double deadband) {
+    policies_[prop_id] = {mode, deadband};
+}
+
+Publisher::Policy Publisher::PolicyFor(int32_t prop_id) const {
+    auto it = policies_.find(prop_id);
+    return it == policies_.end() ? Policy{DecimationMode::LATEST, 0} : it->second;
+}
+
+bool Publisher::Init() {
+    // Propriedades publicadas, derivadas da tabela de mensagens; várias
+    // mensagens podem publicar a mesma (ex.: 0x123 e a rajada 0x125)
+    auto add_prop = [this](int32_t prop_id) {
+        if (std::find(published_props_.begin(), published_props_.end(), prop_id) == published_props_.end()) {
+            published_props_.push_back(prop_id);
+        }
+    };
+    for (size_t m = 0; m < message_count_; m++) {
+        MessageInfo const& message = messages_[m];
+        for (size_t i = 0; i < message.property_count; i++) {
+            add_prop(message.properties[i].prop_id);
+        }
+        if (message.fault != nullptr) {
+            add_prop(message.fault->prop_id);
+        }
+    }
+    for (int32_t prop_id : published_props_) {
+        cache_.SetPolicy(prop_id, {PolicyFor(prop_id).deadband, REFRESH_INTERVAL_NS});
+    }
+
+    ConfigureRateLimits();
+
+    if (!loop_.Init()) {
+        return false;
+    }
+    wake_fd_ = loop_.AddEvent([this] { Drain(); });
+    if (wake_fd_ < 0) {
+        return false;
+    }
+    // O sink avisa de qualquer thread (binder) que há um novo receptor
+    reconnect_fd_ = loop_.AddEvent([this] { Resume(); });
+    if (reconnect_fd_ < 0) {
+        return false;
+    }
+    sink_.SetReconnectCallback([fd = reconnect_fd_] { EventLoop::Notify(fd); });
+    // Publica valores retidos pelo limitador mesmo sem novos frames
+    int64_t min_period_ns = rate_limiter_.MinPeriodNs();
+    if (min_period_ns > 0 && loop_.AddTimer(min_period_ns, [this] { FlushDue(); }) < 0) {
+        return false;
+    }
+    // Copia as latências para leitura de outras threads (métricas) sem
+    // tocar nos histogramas durante a publicação
+    if (loop_.AddTimer(LATENCY_SNAPSHOT_INTERVAL_NS, [this] { SnapshotLatency(); }) < 0) {
+        return false;
+    }
+    return report_interval_ns_ <= 0 || loop_.AddTimer(report_interval_ns_, [this] { Report(); }) >= 0;
+}
+
+void Publisher::ConfigureRateLimits() {
+    std::vector<float> rates = sink_.MaxSampleRates(published_props_);
+    for (size_t i = 0; i < published_props_.size() && i < rates.size(); i++) {
+        rate_limiter_.Configure(published_props_[i], rates[i], PolicyFor(published_props_[i]).mode);
+        CAN_LOG(INFO, TAG, "Property %d limited to %.1f Hz", published_props_[i], static_cast<double>(rates[i]));
+    }
+}
+
+void Publisher::Start() {
+    thread_ = std::thread([this] {
+        ApplyThreadConfig(thread_config_, "can-publisher");
+        loop_.Run();
+    });
+}
+
+void Publisher::Stop() {
+    if (thread_.joinable()) {
+        loop_.Stop();
+        thread_.join();
+    }
+}
+
+bool Publisher::Enqueue(DecodedFrame const& frame) {
+    if (!queue_.TryPush(frame)) {
+        reader_counters_.dropped.Add();
+        reader_counters_.dropped_in_batch = true;
+        return false;
+    }
+    Enqueued();
+    return true;
+}
+
+void Publisher::EnqueueWait(DecodedFrame const& frame) {
+    while (!queue_.TryPush(frame)) {
+        EventLoop::Notify(wake_fd_);
+        std::this_thread::sleep_for(QUEUE_WAIT);
+    }
+    Enqueued();
+}
+
+void Publisher::WaitEmpty() {
+    while (queue_.Size() > 0) {
+        EventLoop::Notify(wake_fd_);
+        std::this_thread::sleep_for(QUEUE_WAIT);
+    }
+}
+
+void Publisher::Enqueued() {
+    reader_counters_.enqueued.Add();
+    size_t depth = queue_.Size();
+    if (depth > reader_counters_.high_water.Load()) {
+        reader_counters_.high_water.Set(depth);
+    }
+}
+
+void Publisher::Notify() {
+    if (reader_counters_.dropped_in_batch) {
+        reader_counters_.overflows.Add();
+        reader_counters_.dropped_in_batch = false;
+    }
+    EventLoop::Notify(wake_fd_);
+}
+
+PublisherStats Publisher::Stats() const {
+    return PublisherStats{
+        reader_counters_.enqueued.Load(),
+        reader_counters_.dropped.Load(),
+        reader_counters_.overflows.Load(),
+        queue_.Size(),
+        static_cast<size_t>(reader_counters_.high_water.Load()),
+        publisher_counters_.resumed.Load(),
+    };
+}
+
+std::vector<CanIdLatency> Publisher::LatencySummaries() const {
+    std::lock_guard<std::mutex> lock(latency_mutex_);
+    return latency_snapshot_;
+}
+
+void Publisher::SnapshotLatency() {
+    std::vector<CanIdLatency> summaries = latency_.Summaries();
+    std::lock_guard<std::mutex> lock(latency_mutex_);
+    latency_snapshot_.swap(summaries);
+}
+
+void Publisher::Drain() {
+    size_t count = 0;
+    do {
+        count = 0;
+        while (count < batch_.size() && queue_.TryPop(batch_[count])) {
+            Accept(batch_[count]);
+            if (fusion_ != nullptr) {
+                fusion_->Add(batch_[count]);
+            }
+            count++;
+        }
+        size_t pending = sink_.Pending();
+        EmitDue(RealtimeNowNs());
+        if (sink_.Pending() == pending) {
+            continue;
+        }
+
+        int64_t publish_start_ns = RealtimeNowNs();
+        sink_.Flush();
+        int64_t published_ns = RealtimeNowNs();
+        for (size_t i = 0; i < count; i++) {
+            latency_.Record(batch_[i].can_id, batch_[i].rx_ns, batch_[i].decoded_ns,
+                            publish_start_ns, published_ns);
+        }
+    } while (count == batch_.size());
+}
+
+void Publisher::FlushDue() {
+    EmitDue(RealtimeNowNs());
+    sink_.Flush();
+}
+
+void Publisher::Emit(PropertyValue const& value) {
+    latest_.Put(value);
+    if (sink_.Connected()) {
+        sink_.Add(value);
+    }
+}
+
+void Publisher::Resume() {
+    if (!sink_.Reconnect()) {
+        return;
+    }
+    latest_.ForEach([this](PropertyValue const& value) { sink_.Add(value); });
+    size_t count = sink_.Pending();
+    if (sink_.Flush()) {
+        publisher_counters_.resumed.Add();
+        CAN_LOG(INFO, TAG, "Sink reconnected, republished %zu held values", count);
+    }
+}
+
+void Publisher::Accept(DecodedFrame const& frame) {
+    MessageInfo const& message = messages_[frame.message];
+
+    for (size_t i = 0; i < message.signal_count; i++) {
+        CAN_LOG(DEBUG, TAG, "0x%03x %s=%g", frame.can_id, message.signals[i].name, frame.values[i]);
+    }
+
+    // Leituras de falha do sensor são publicadas como vieram (os apps detectam a
+    // falha pelo valor sentinela), mas não entram na média do limitador
+    bool fault = message.fault != nullptr && message.fault->IsFault(frame.values.data(), message.signal_count);
+    for (size_t i = 0; i < message.property_count; i++) {
+        PropertyMapping const& property = message.properties[i];
+        if (fault) {
+            rate_limiter_.Hold(property.prop_id, &frame.values[property.first_signal], property.signal_count);
+        } else {
+            rate_limiter_.Add(property.prop_id, &frame.values[property.first_signal], property.signal_count);
+        }
+    }
+    if (message.fault != nullptr) {
+        rate_limiter_.Add(message.fault->prop_id, fault ? message.fault->fault_code : message.fault->ok_code);
+    }
+}
+
+void Publisher::EmitDue(int64_t now_ns) {
+    double values[RateLimiter::MAX_VALUES];
+    PropertyValue value = {};
+
+    for (int32_t prop_id : published_props_) {
+        value.prop_id = prop_id;
+        value.area_id = 0;
+        value.count = 0;
+        value.string_value = {};
+        switch (TypeOf(prop_id)) {
+            case PropertyType::STRING: {
+                // Códigos de falha: o cache só deixa passar transições (e o refresh periódico)
+                std::string const* text = rate_limiter_.TakeText(prop_id, now_ns);
+                if (text != nullptr && cache_.ShouldPublish(prop_id, 0, *text, now_ns)) {
+                    value.string_value = *text;
+                    Emit(value);
+                }
+                break;
+            }
+            case PropertyType::INT32:
+            case PropertyType::INT32_VEC: {
+                value.count = std::min(rate_limiter_.Take(prop_id, now_ns, values), MAX_PROPERTY_VALUES);
+                for (size_t i = 0; i < value.count; i++) {
+                    value.int32_values[i] = static_cast<int32_t>(std::lround(values[i]));
+                }
+                if (value.count > 0 &&
+                    cache_.ShouldPublish(prop_id, 0, value.int32_values.data(), value.count, now_ns)) {
+                    Emit(value);
+                }
+                break;
+            }
+            case PropertyType::FLOAT:
+            case PropertyType::FLOAT_VEC: {
+                value.count = std::min(rate_limiter_.Take(prop_id, now_ns, values), MAX_PROPERTY_VALUES);
+                for (size_t i = 0; i < value.count; i++) {
+                    value.float_values[i] = static_cast<float>(values[i]);
+                }
+                if (value.count > 0 &&
+                    cache_.ShouldPublish(prop_id, 0, value.float_values.data(), value.count, now_ns)) {
+                    Emit(value);
+                }
+                break;
+            }
+        }
+    }
+}
+
+void Publisher::Report() {
+    PublisherStats stats = Stats();
+    SinkStats sink = sink_.Stats();
+    PublishCacheStats cache = cache_.Stats();
+    RateLimiterStats rate = rate_limiter_.Stats();
+    std::string report = latency_.Report();
+    CAN_LOG(INFO, TAG, "Queue: enqueued=%llu dropped=%llu overflows=%llu depth=%zu high_water=%zu",
+            static_cast<unsigned long long>(stats.enqueued), static_cast<unsigned long long>(stats.dropped),
+            static_cast<unsigned long long>(stats.overflows), stats.depth, stats.high_water);
+    LatestValueStoreStats held = latest_.Stats();
+    CAN_LOG(INFO, TAG, "Sink: transactions=%llu values=%llu errors=%llu reconnects=%llu held=%zu",
+            static_cast<unsigned long long>(sink.transactions), static_cast<unsigned long long>(sink.values),
+            static_cast<unsigned long long>(sink.errors), static_cast<unsigned long long>(sink.reconnects),
+            held.size);
+    CAN_LOG(INFO, TAG, "Cache: published=%llu suppressed=%llu",
+            static_cast<unsigned long long>(cache.published), static_cast<unsigned long long>(cache.suppressed));
+    CAN_LOG(INFO, TAG, "Rate limiter: accepted=%llu emitted=%llu",
+            static_cast<unsigned long long>(rate.accepted), static_cast<unsigned long long>(rate.emitted));
+    // Uma linha por registro: cada registro do log tem tamanho limitado
+    size_t start = 0;
+    while (start < report.size()) {
+        size_t end = report.find('\n', start);
+        if (end == std::string::npos) {
+            end = report.size();
+        }
+        CAN_LOG(INFO, TAG, "Latency %s", report.substr(start, end - start).c_str());
+        start = end + 1;
+    }
+}
+
+}  // namespace tcc::aaos::can
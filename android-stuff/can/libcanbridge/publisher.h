@@ -0,0 +1,160 @@
+#pragma once
+
+#include <linux/can.h>
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "can_signal.h"
+#include "counter.h"
+#include "event_loop.h"
+#include "fusion.h"
+#include "latency_histogram.h"
+#include "latest_value_store.h"
+#include "property_sink.h"
+#include "publish_cache.h"
+#include "rate_limiter.h"
+#include "realtime.h"
+#include "spsc_ring.h"
+
+namespace tcc::aaos::can {
+
+struct PublisherStats {
+    uint64_t enqueued;   // Frames accepted into the ring
+    uint64_t dropped;    // Frames rejected because the ring was full
+    uint64_t overflows;  // Batches during which at least one frame was dropped
+    size_t depth;        // Current ring occupancy
+    size_t high_water;   // Highest occupancy seen by the reader
+    uint64_t resumed;    // Sink reconnections after which the held values were republished
+};
+
+// Publisher stage of the gateway: owns the thread that talks to the
+// PropertySink. The reader thread only decodes and calls Enqueue()/Notify(),
+// so a slow sink can no longer back up the CAN socket. Property updates are
+// capped at the sink's max sample rate, filtered by the change cache, and
+// everything produced by one drain of the queue goes out in a single
+// PropertySink::Flush(). The published properties come from the message
+// table (VehicleSignals or a SignalDatabase).
+//
+// The last value of every property is also kept in a LatestValueStore.
+// While the sink is disconnected nothing is sent; once it reconnects the
+// whole store is republished in one transaction, so the new receiver starts
+// from the latest state, including the batch that was in flight when the
+// old one died.
+class Publisher {
+public:
+    constexpr static size_t QUEUE_CAPACITY = 1024;
+    // Upper bound on frames per sink transaction
+    constexpr static size_t MAX_PUBLISH_BATCH = 64;
+    // (property, area) pairs held for republishing after a reconnection
+    constexpr static size_t MAX_HELD_VALUES = 256;
+
+    // sink and messages must outlive the publisher; DecodedFrame::message
+    // indexes messages. A report_interval_ns of 0 disables the stats report.
+    Publisher(PropertySink &sink, MessageInfo const* messages, size_t message_count,
+              int64_t report_interval_ns);
+    ~Publisher();
+
+    // How prop_id is decimated down to its max rate and how far a numeric
+    // value must move before it is republished. Call before Init(); the
+    // default is LATEST with no deadband.
+    void SetPolicy(int32_t prop_id, DecimationMode mode, double deadband);
+
+    // Scheduling of the publisher thread; call before Start()
+    void SetThreadConfig(ThreadConfig const& config) { thread_config_ = config; }
+
+    // Also feeds every dequeued frame into fusion, on the publisher thread.
+    // Call before Start(); fusion must outlive the publisher.
+    void SetFusion(FusionStage *fusion) { fusion_ = fusion; }
+
+    // Queries the sink's rates and creates the publisher event loop
+    bool Init();
+    void Start();
+    void Stop();
+
+    // Reader thread only. Returns false (and counts a drop) when the ring is full.
+    bool Enqueue(DecodedFrame const& frame);
+    // Reader thread only. Waits for room instead of dropping, for sources
+    // that can simply be paused such as a log replay.
+    void EnqueueWait(DecodedFrame const& frame);
+    // Reader thread only; returns once the publisher took every queued frame
+    void WaitEmpty();
+    // Reader thread only; wakes the publisher once per received batch
+    void Notify();
+
+    PublisherStats Stats() const;
+    // Publish latency per CAN ID since Start(), refreshed by the publisher
+    // thread every LATENCY_SNAPSHOT_INTERVAL_NS; safe from any thread
+    std::vector<CanIdLatency> LatencySummaries() const;
+
+    constexpr static int64_t LATENCY_SNAPSHOT_INTERVAL_NS = 1'000'000'000;
+
+private:
+    struct Policy {
+        DecimationMode mode;
+        double deadband;
+    };
+
+    Policy PolicyFor(int32_t prop_id) const;
+    void ConfigureRateLimits();
+    void Enqueued();
+    void Drain();
+    // Feeds the property values of one frame into the rate limiter
+    void Accept(DecodedFrame const& frame);
+    // Moves every property whose rate-limit period elapsed through the
+    // change cache into the pending sink transaction
+    void EmitDue(int64_t now_ns);
+    // Records value in latest_ and adds it to the sink when connected
+    void Emit(PropertyValue const& value);
+    void FlushDue();
+    // Publisher thread, after the sink signalled a new receiver
+    void Resume();
+    void Report();
+    void SnapshotLatency();
+
+    PropertySink &sink_;
+    MessageInfo const* messages_;
+    size_t message_count_;
+    std::unordered_map<int32_t, Policy> policies_;
+    std::vector<int32_t> published_props_;
+
+    SpscRing<DecodedFrame, QUEUE_CAPACITY> queue_;
+    PublishCache cache_;
+    RateLimiter rate_limiter_;
+    std::array<DecodedFrame, MAX_PUBLISH_BATCH> batch_;
+    LatestValueStore latest_{MAX_HELD_VALUES};
+    LatencyTracker latency_;
+    FusionStage *fusion_ = nullptr;
+    int64_t report_interval_ns_;
+
+    ThreadConfig thread_config_;
+    EventLoop loop_;
+    int wake_fd_ = -1;
+    int reconnect_fd_ = -1;
+    std::thread thread_;
+
+    // Written by the reader thread only, read by Stats()
+    struct alignas(CACHE_LINE_SIZE) ReaderCounters {
+        LocalCounter enqueued;
+        LocalCounter dropped;
+        LocalCounter overflows;
+        LocalCounter high_water;
+        bool dropped_in_batch = false;
+    };
+    // Written by the publisher thread only
+    struct alignas(CACHE_LINE_SIZE) PublisherCounters {
+        LocalCounter resumed;
+    };
+    ReaderCounters reader_counters_;
+    PublisherCounters publisher_counters_;
+
+    mutable std::mutex latency_mutex_;
+    std::vector<CanIdLatency> latency_snapshot_;
+};
+
+}  // namespace tcc::aaos::can
@@ -0,0 +1,91 @@
+#include "rate_limiter.h"
+
+#include <algorithm>
+
+namespace tcc::aaos::can {
+
+void RateLimiter::Configure(int32_t prop_id, float max_rate_hz, DecimationMode mode) {
+    Slot &slot = slots_[prop_id];
+    slot.period_ns = max_rate_hz > 0 ? static_cast<int64_t>(1e9 / max_rate_hz) : 0;
+    slot.mode = mode;
+}
+
+void RateLimiter::Add(int32_t prop_id, double const* values, size_t count) {
+    Slot &slot = slots_[prop_id];
+    count = std::min(count, MAX_VALUES);
+    accepted_++;
+    // A shape change restarts the window instead of averaging mismatched vectors
+    if (slot.mode == DecimationMode::LATEST || slot.samples == 0 || slot.held || slot.count != count) {
+        std::copy(values, values + count, slot.values.begin());
+        slot.count = count;
+        slot.samples = 1;
+        slot.held = false;
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        slot.values[i] += values[i];
+    }
+    slot.samples++;
+}
+
+void RateLimiter::Hold(int32_t prop_id, double const* values, size_t count) {
+    Slot &slot = slots_[prop_id];
+    count = std::min(count, MAX_VALUES);
+    accepted_++;
+    std::copy(values, values + count, slot.values.begin());
+    slot.count = count;
+    slot.samples = 1;
+    slot.held = true;
+}
+
+void RateLimiter::Add(int32_t prop_id, std::string_view text) {
+    Slot &slot = slots_[prop_id];
+    accepted_++;
+    slot.text.assign(text.data(), text.size());
+    slot.samples = 1;
+}
+
+bool RateLimiter::Due(Slot const& slot, int64_t now_ns) const {
+    return slot.samples > 0 && (slot.period_ns == 0 || now_ns - slot.emitted_ns >= slot.period_ns);
+}
+
+size_t RateLimiter::Take(int32_t prop_id, int64_t now_ns, double *out) {
+    auto it = slots_.find(prop_id);
+    if (it == slots_.end() || !Due(it->second, now_ns)) {
+        return 0;
+    }
+    Slot &slot = it->second;
+    bool average = slot.mode == DecimationMode::AVERAGE && !slot.held;
+    for (size_t i = 0; i < slot.count; i++) {
+        out[i] = average ? slot.values[i] / slot.samples : slot.values[i];
+    }
+    slot.samples = 0;
+    slot.held = false;
+    slot.emitted_ns = now_ns;
+    emitted_++;
+    return slot.count;
+}
+
+std::string const* RateLimiter::TakeText(int32_t prop_id, int64_t now_ns) {
+    auto it = slots_.find(prop_id);
+    if (it == slots_.end() || !Due(it->second, now_ns)) {
+        return nullptr;
+    }
+    Slot &slot = it->second;
+    slot.samples = 0;
+    slot.emitted_ns = now_ns;
+    emitted_++;
+    return &slot.text;
+}
+
+int64_t RateLimiter::MinPeriodNs() const {
+    int64_t min_period = 0;
+    for (auto const& [prop_id, slot] : slots_) {
+        if (slot.period_ns > 0 && (min_period == 0 || slot.period_ns < min_period)) {
+            min_period = slot.period_ns;
+        }
+    }
+    return min_period;
+}
+
+}  // namespace tcc::aaos::can
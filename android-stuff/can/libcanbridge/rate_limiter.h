@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace tcc::aaos::can {
+
+enum class DecimationMode {
+    LATEST,  // Publish the most recent value of the window
+    AVERAGE, // Publish the element-wise mean of the window (numeric only)
+};
+
+struct RateLimiterStats {
+    uint64_t accepted; // Values offered with Add()
+    uint64_t emitted;  // Values handed out by Take()/TakeText()
+};
+
+// Caps how often each property is published. Values offered faster than the
+// property's max rate are merged per DecimationMode and handed out once the
+// period since the last emission has elapsed. Properties that were never
+// configured, or have a max rate of 0, pass straight through.
+class RateLimiter {
+public:
+    constexpr static size_t MAX_VALUES = 8;
+
+    void Configure(int32_t prop_id, float max_rate_hz, DecimationMode mode);
+
+    void Add(int32_t prop_id, double const* values, size_t count);
+    void Add(int32_t prop_id, std::string_view text);
+    // Like Add(), but values stay out of the decimation: they replace the
+    // pending window and are handed out as-is, the next Add() starts a new
+    // window. For sentinels such as a sensor fault reading.
+    void Hold(int32_t prop_id, double const* values, size_t count);
+
+    // When prop_id has a pending value and is due, writes it to out and
+    // returns the element count; returns 0 otherwise.
+    size_t Take(int32_t prop_id, int64_t now_ns, double *out);
+    // Same for string properties; nullptr when nothing is due
+    std::string const* TakeText(int32_t prop_id, int64_t now_ns);
+
+    // Shortest configured period, 0 when nothing is rate limited
+    int64_t MinPeriodNs() const;
+
+    RateLimiterStats Stats() const { return {accepted_, emitted_}; }
+
+private:
+    struct Slot {
+        int64_t period_ns = 0;
+        DecimationMode mode = DecimationMode::LATEST;
+        int64_t emitted_ns = 0;
+        size_t samples = 0;
+        bool held = false; // The window holds a Hold() value
+        size_t count = 0;
+        std::array<double, MAX_VALUES> values{};
+        std::string text;
+    };
+
+    bool Due(Slot const& slot, int64_t now_ns) const;
+
+    std::unordered_map<int32_t, Slot> slots_;
+    uint64_t accepted_ = 0;
+    uint64_t emitted_ = 0;
+};
+
+}  // namespace tcc::aaos::can
@@ -0,0 +1,154 @@
+#include "realtime.h"
+
+#include <alloca.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "async_log.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+namespace tcc::aaos::can {
+
+constexpr static char TAG[] = "REALTIME";
+
+// Left untouched below the prefaulted area for the frames of the caller
+constexpr static size_t STACK_RESERVE = 64 * 1024;
+
+bool ApplyThreadConfig(ThreadConfig const& config, char const* name) {
+    bool ok = true;
+    if (name != nullptr) {
+        char short_name[16] = {};
+        std::strncpy(short_name, name, sizeof(short_name) - 1);
+        pthread_setname_np(pthread_self(), short_name);
+    }
+    if (config.cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(config.cpu, &cpus);
+        if (sched_setaffinity(0, sizeof(cpus), &cpus) < 0) {
+            CAN_LOG(ERROR, TAG, "%s: failed to pin to CPU %d: %s", name, config.cpu, strerror(errno));
+            ok = false;
+        }
+    }
+    if (config.fifo_priority > 0) {
+        sched_param param = {};
+        param.sched_priority = config.fifo_priority;
+        int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (error != 0) {
+            CAN_LOG(ERROR, TAG, "%s: failed to set SCHED_FIFO %d: %s", name, config.fifo_priority,
+                    strerror(error));
+            ok = false;
+        }
+    }
+    PrefaultStack(config.prefault_stack);
+    return ok;
+}
+
+__attribute__((noinline)) void PrefaultStack(size_t bytes) {
+    if (bytes == 0) {
+        return;
+    }
+    // Never more than the thread's stack can take
+    pthread_attr_t attr;
+    if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+        size_t stack_size = 0;
+        pthread_attr_getstacksize(&attr, &stack_size);
+        pthread_attr_destroy(&attr);
+        if (stack_size > 0 && bytes + STACK_RESERVE > stack_size) {
+            bytes = stack_size > 2 * STACK_RESERVE ? stack_size - 2 * STACK_RESERVE : 0;
+        }
+    }
+    // alloca: the pages touched are the ones the thread's deeper frames use
+    auto *stack = static_cast<volatile char *>(alloca(bytes));
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    for (size_t offset = 0; offset < bytes; offset += page) {
+        stack[offset] = 0;
+    }
+}
+
+bool LockMemory() {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+        CAN_LOG(ERROR, TAG, "mlockall failed: %s", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+void UnlockMemory() {
+    munlockall();
+}
+
+static bool ParseInt(char const* text, long min, long max, int &out) {
+    char *end = nullptr;
+    errno = 0;
+    long value = std::strtol(text, &end, 10);
+    if (errno != 0 || end == text || *end != '\0' || value < min || value > max) {
+        return false;
+    }
+    out = static_cast<int>(value);
+    return true;
+}
+
+bool ParseRealtimeOption(std::string const& arg, RealtimeConfig &config, bool &valid) {
+    auto value = [&arg](char const* option) -> char const* {
+        size_t length = std::strlen(option);
+        return arg.compare(0, length, option) == 0 ? arg.c_str() + length : nullptr;
+    };
+    int cpu_count = static_cast<int>(sysconf(_SC_NPROCESSORS_CONF));
+    char const* v;
+    int kib = 0;
+    if ((v = value("--rx-priority=")) != nullptr) {
+        valid = ParseInt(v, 1, 99, config.rx.fifo_priority);
+    } else if ((v = value("--publisher-priority=")) != nullptr) {
+        valid = ParseInt(v, 1, 99, config.publisher.fifo_priority);
+    } else if ((v = value("--rx-cpu=")) != nullptr) {
+        valid = ParseInt(v, 0, cpu_count - 1, config.rx.cpu);
+    } else if ((v = value("--publisher-cpu=")) != nullptr) {
+        valid = ParseInt(v, 0, cpu_count - 1, config.publisher.cpu);
+    } else if ((v = value("--prefault-stack=")) != nullptr) {
+        valid = ParseInt(v, 0, 64 * 1024, kib);
+        config.rx.prefault_stack = static_cast<size_t>(kib) * 1024;
+        config.publisher.prefault_stack = config.rx.prefault_stack;
+    } else if (arg == "--mlock") {
+        valid = true;
+        config.lock_memory = true;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static void Describe(std::string &out, char const* name, ThreadConfig const& config) {
+    if (config.fifo_priority == 0 && config.cpu < 0) {
+        return;
+    }
+    out += out.empty() ? "" : ", ";
+    out += name;
+    if (config.fifo_priority > 0) {
+        out += " fifo:" + std::to_string(config.fifo_priority);
+    }
+    if (config.cpu >= 0) {
+        out += " cpu:" + std::to_string(config.cpu);
+    }
+}
+
+std::string DescribeRealtime(RealtimeConfig const& config) {
+    std::string out;
+    Describe(out, "rx", config.rx);
+    Describe(out, "publisher", config.publisher);
+    if (config.rx.prefault_stack > 0) {
+        out += out.empty() ? "" : ", ";
+        out += "prefault " + std::to_string(config.rx.prefault_stack / 1024) + " KiB";
+    }
+    if (config.lock_memory) {
+        out += out.empty() ? "mlock" : ", mlock";
+    }
+    return out.empty() ? "cfs" : out;
+}
+
+}  // namespace tcc::aaos::can
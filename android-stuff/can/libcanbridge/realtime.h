@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace tcc::aaos::can {
+
+// How one gateway thread is scheduled. The defaults leave the thread as it
+// was created (SCHED_OTHER, inherited affinity).
+struct ThreadConfig {
+    int fifo_priority = 0;     // SCHED_FIFO priority 1-99; 0 keeps SCHED_OTHER
+    int cpu = -1;              // Pin the thread to this CPU; -1 keeps the inherited mask
+    size_t prefault_stack = 0; // Bytes of stack touched before the thread starts working
+
+    bool IsDefault() const { return fifo_priority == 0 && cpu < 0 && prefault_stack == 0; }
+};
+
+// Real-time mode of the gateway: the RX thread (the EventLoop reading the
+// buses) and the publisher thread, plus process-wide memory locking so
+// neither ever takes a page fault on the hot path.
+struct RealtimeConfig {
+    ThreadConfig rx;
+    ThreadConfig publisher;
+    bool lock_memory = false; // mlockall(MCL_CURRENT | MCL_FUTURE)
+
+    bool IsDefault() const { return rx.IsDefault() && publisher.IsDefault() && !lock_memory; }
+};
+
+// Applies config to the calling thread and names it (at most 15 characters
+// show in top and /proc). SCHED_FIFO needs CAP_SYS_NICE or an RLIMIT_RTPRIO
+// large enough. Returns false if any part failed; the rest is still applied.
+bool ApplyThreadConfig(ThreadConfig const& config, char const* name);
+
+// Touches bytes of the calling thread's stack so its pages are resident
+// before the first deadline; with lock_memory they then stay resident
+void PrefaultStack(size_t bytes);
+
+// mlockall(MCL_CURRENT | MCL_FUTURE): needs CAP_IPC_LOCK or a large enough
+// RLIMIT_MEMLOCK
+bool LockMemory();
+void UnlockMemory();
+
+// Parses one real-time command line option into config:
+//   --rx-priority=<1-99>         SCHED_FIFO priority of the RX thread
+//   --publisher-priority=<1-99>  SCHED_FIFO priority of the publisher thread
+//   --rx-cpu=<n>                 CPU the RX thread is pinned to
+//   --publisher-cpu=<n>          CPU the publisher thread is pinned to
+//   --prefault-stack=<KiB>       Stack prefaulted by both threads
+//   --mlock                      Lock all current and future memory
+// Returns false when arg is not one of them; valid is false when it is but
+// its value is out of range.
+bool ParseRealtimeOption(std::string const& arg, RealtimeConfig &config, bool &valid);
+
+// One-line summary for logs, e.g. "rx fifo:50 cpu:3, publisher cpu:2, mlock"
+std::string DescribeRealtime(RealtimeConfig const& config);
+
+}  // namespace tcc::aaos::can
@@ -0,0 +1,564 @@
+#include "signal_database.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "async_log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <type_traits>
+
+namespace tcc::aaos::can {
+
+constexpr static char TAG[] = "SIGNAL_DATABASE";
+
+constexpr static char IMAGE_MAGIC[8] = {'C', 'A', 'N', 'S', 'I', 'G', 'D', 'B'};
+// Bump whenever a packed struct below changes
+constexpr static uint32_t IMAGE_VERSION = 2;
+constexpr static uint32_t MAX_HASH_BITS = 16;
+constexpr static uint32_t HASH_SEED_ATTEMPTS = 4096;
+
+struct SignalDatabase::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t size; // Whole image, header included
+    // Identity of the DBC file the image was compiled from
+    uint64_t source_size;
+    int64_t source_mtime_ns;
+    uint32_t hash_seed;
+    uint32_t hash_bits;
+    uint32_t message_count;
+    uint32_t signal_count;
+    uint32_t property_count;
+    uint32_t string_size;
+    uint32_t messages_offset;
+    uint32_t signals_offset;
+    uint32_t properties_offset;
+    uint32_t slots_offset;
+    uint32_t strings_offset;
+    uint32_t reserved;
+};
+
+// Fields read by Decode() come first so they share a cache line
+struct SignalDatabase::PackedSignal {
+    uint64_t mask;
+    double scale;
+    double offset;
+    uint8_t shift;      // Within the 8 bytes loaded at window
+    uint8_t sign_shift; // 64 - length for SIGNED signals, 0 otherwise
+    ByteOrder byte_order;
+    ValueType type;
+    uint16_t start_bit;
+    uint8_t length;
+    uint8_t window; // See SignalDef::Window()
+    uint32_t name; // Offset into the string pool
+    uint32_t reserved2;
+};
+
+struct SignalDatabase::PackedMessage {
+    canid_t can_id;
+    uint8_t dlc;
+    uint8_t signal_count;
+    uint8_t property_count;
+    uint8_t has_fault;
+    uint8_t sample_count;
+    uint8_t sample_stride;
+    uint16_t reserved;
+    uint32_t first_signal;
+    uint32_t first_property;
+    int32_t fault_prop_id;
+    uint32_t ok_code;    // String pool offsets
+    uint32_t fault_code;
+    uint32_t name;
+    double fault_threshold;
+    int64_t sample_period_ns;
+};
+
+static_assert(std::is_trivially_copyable_v<PropertyMapping> && sizeof(PropertyMapping) == 8,
+              "PropertyMapping is stored verbatim in the image");
+
+static size_t Align8(size_t offset) {
+    return (offset + 7) & ~size_t{7};
+}
+
+SignalDatabase::~SignalDatabase() {
+    Unmap();
+}
+
+void SignalDatabase::Unmap() {
+    if (mapping_ != nullptr) {
+        munmap(mapping_, mapping_size_);
+        mapping_ = nullptr;
+        mapping_size_ = 0;
+    }
+}
+
+bool SignalDatabase::Load(std::string const& dbc_path, std::string const& cache_path) {
+    int fd = open(dbc_path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        CAN_LOG(ERROR, TAG, "Failed to open %s: %s", dbc_path.c_str(), strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+    uint64_t source_size = static_cast<uint64_t>(st.st_size);
+    int64_t source_mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1'000'000'000 + st.st_mtim.tv_nsec;
+
+    if (!cache_path.empty() && MapCache(cache_path, source_size, source_mtime_ns)) {
+        close(fd);
+        CAN_LOG(INFO, TAG, "Loaded %zu messages from cache %s", infos_.size(), cache_path.c_str());
+        return true;
+    }
+
+    std::string text(source_size, '\0');
+    size_t done = 0;
+    while (done < text.size()) {
+        ssize_t n = read(fd, text.data() + done, text.size() - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        done += static_cast<size_t>(n);
+    }
+    close(fd);
+    if (done != text.size()) {
+        CAN_LOG(ERROR, TAG, "Failed to read %s", dbc_path.c_str());
+        return false;
+    }
+
+    DbcFile file;
+    std::vector<uint8_t> image;
+    if (!ParseDbc(text, file) || !Compile(file, source_size, source_mtime_ns, image)) {
+        return false;
+    }
+    Unmap();
+    image_ = std::move(image);
+    Attach(image_.data());
+    CAN_LOG(INFO, TAG, "Compiled %zu messages from %s", infos_.size(), dbc_path.c_str());
+
+    if (!cache_path.empty() && !WriteCache(cache_path, image_)) {
+        CAN_LOG(WARN, TAG, "Failed to write cache %s: %s", cache_path.c_str(), strerror(errno));
+    }
+    return true;
+}
+
+bool SignalDatabase::Build(DbcFile const& file) {
+    std::vector<uint8_t> image;
+    if (!Compile(file, 0, 0, image)) {
+        return false;
+    }
+    Unmap();
+    image_ = std::move(image);
+    Attach(image_.data());
+    return true;
+}
+
+bool SignalDatabase::FindPerfectHash(std::vector<canid_t> const& ids, uint32_t &seed, uint32_t &bits) {
+    uint32_t min_bits = 1;
+    while ((size_t{1} << min_bits) < ids.size()) {
+        min_bits++;
+    }
+    std::vector<bool> used;
+    for (bits = min_bits; bits <= MAX_HASH_BITS; bits++) {
+        for (seed = 0; seed < HASH_SEED_ATTEMPTS; seed++) {
+            used.assign(size_t{1} << bits, false);
+            bool collision = false;
+            for (canid_t id : ids) {
+                uint32_t slot = Hash(id, seed, bits);
+                if (used[slot]) {
+                    collision = true;
+                    break;
+                }
+                used[slot] = true;
+            }
+            if (!collision) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool SignalDatabase::Compile(DbcFile const& file, uint64_t source_size, int64_t source_mtime_ns,
+                             std::vector<uint8_t> &image) {
+    std::vector<PackedMessage> messages;
+    std::vector<PackedSignal> signals;
+    std::vector<PropertyMapping> properties;
+    std::vector<char> strings(1, '\0'); // Offset 0 is the empty string
+    std::vector<canid_t> ids;
+
+    auto add_string = [&strings](std::string const& text) {
+        uint32_t offset = static_cast<uint32_t>(strings.size());
+        strings.insert(strings.end(), text.begin(), text.end());
+        strings.push_back('\0');
+        return offset;
+    };
+
+    for (DbcMessage const& dbc_message : file.messages) {
+        // Only published signals are kept, grouped so each property is a
+        // consecutive run of signals in DBC definition order
+        std::vector<int32_t> prop_ids;
+        for (DbcSignal const& signal : dbc_message.signals) {
+            if (signal.prop_id != 0 &&
+                std::find(prop_ids.begin(), prop_ids.end(), signal.prop_id) == prop_ids.end()) {
+                prop_ids.push_back(signal.prop_id);
+            }
+        }
+        if (prop_ids.empty() && dbc_message.fault_prop_id == 0) {
+            continue;
+        }
+        for (canid_t id : ids) {
+            if (id == dbc_message.can_id) {
+                CAN_LOG(ERROR, TAG, "Duplicate CAN ID 0x%x", dbc_message.can_id);
+                return false;
+            }
+        }
+        if (dbc_message.fault_prop_id != 0 &&
+            (dbc_message.ok_code.empty() || dbc_message.fault_code.empty())) {
+            CAN_LOG(ERROR, TAG, "Message %s: VhalFaultProperty needs VhalOkCode and VhalFaultCode",
+                    dbc_message.name.c_str());
+            return false;
+        }
+
+        if (dbc_message.sample_count == 0 || dbc_message.sample_count > MAX_SAMPLES_PER_FRAME ||
+            dbc_message.sample_stride > CANFD_MAX_DLEN) {
+            CAN_LOG(ERROR, TAG, "Message %s: %u samples of %u bytes are not supported",
+                    dbc_message.name.c_str(), dbc_message.sample_count, dbc_message.sample_stride);
+            return false;
+        }
+        MessageInfo layout = {};
+        layout.dlc = dbc_message.dlc;
+        layout.sample_count = static_cast<uint8_t>(dbc_message.sample_count);
+        layout.sample_stride = static_cast<uint8_t>(dbc_message.sample_stride);
+
+        PackedMessage message = {};
+        message.can_id = dbc_message.can_id;
+        message.dlc = dbc_message.dlc;
+        message.sample_count = layout.sample_count;
+        message.sample_stride = layout.sample_stride;
+        message.sample_period_ns = dbc_message.sample_period_ns;
+        message.first_signal = static_cast<uint32_t>(signals.size());
+        message.first_property = static_cast<uint32_t>(properties.size());
+        message.name = add_string(dbc_message.name);
+
+        for (int32_t prop_id : prop_ids) {
+            PropertyMapping property = {prop_id, static_cast<uint8_t>(signals.size() - message.first_signal), 0};
+            for (DbcSignal const& signal : dbc_message.signals) {
+                if (signal.prop_id != prop_id) {
+                    continue;
+                }
+                SignalDef def = {nullptr, signal.start_bit, signal.length, signal.byte_order,
+                                 signal.type, signal.scale, signal.offset};
+                if (layout.LastWindow() < 0 || !layout.Fits(def)) {
+                    CAN_LOG(ERROR, TAG, "Signal %s does not fit message %s", signal.name.c_str(),
+                            dbc_message.name.c_str());
+                    return false;
+                }
+                if (signals.size() - message.first_signal >= MAX_SIGNALS_PER_MESSAGE) {
+                    CAN_LOG(ERROR, TAG, "Message %s publishes more than %zu signals",
+                            dbc_message.name.c_str(), MAX_SIGNALS_PER_MESSAGE);
+                    return false;
+                }
+                PackedSignal packed = {};
+                packed.mask = def.Mask();
+                packed.scale = def.scale;
+                packed.offset = def.offset;
+                packed.window = static_cast<uint8_t>(def.Window(layout.LastWindow()));
+                packed.shift = static_cast<uint8_t>(def.Shift(packed.window));
+                packed.sign_shift = def.type == ValueType::SIGNED ? static_cast<uint8_t>(64 - def.length) : 0;
+                packed.byte_order = def.byte_order;
+                packed.type = def.type;
+                packed.start_bit = def.start_bit;
+                packed.length = def.length;
+                packed.name = add_string(signal.name);
+                signals.push_back(packed);
+                property.signal_count++;
+            }
+            properties.push_back(property);
+        }
+        message.signal_count = static_cast<uint8_t>(signals.size() - message.first_signal);
+        message.property_count = static_cast<uint8_t>(properties.size() - message.first_property);
+        if (dbc_message.fault_prop_id != 0) {
+            message.has_fault = 1;
+            message.fault_prop_id = dbc_message.fault_prop_id;
+            message.ok_code = add_string(dbc_message.ok_code);
+            message.fault_code = add_string(dbc_message.fault_code);
+            message.fault_threshold = dbc_message.fault_threshold;
+        }
+        messages.push_back(message);
+        ids.push_back(message.can_id);
+    }
+
+    if (messages.empty()) {
+        CAN_LOG(ERROR, TAG, "No message is mapped to a VHAL property");
+        return false;
+    }
+    uint32_t seed;
+    uint32_t bits;
+    if (!FindPerfectHash(ids, seed, bits)) {
+        CAN_LOG(ERROR, TAG, "No perfect hash found for %zu CAN IDs", ids.size());
+        return false;
+    }
+    std::vector<uint32_t> slots(size_t{1} << bits, 0);
+    for (size_t i = 0; i < ids.size(); i++) {
+        slots[Hash(ids[i], seed, bits)] = static_cast<uint32_t>(i + 1);
+    }
+
+    Header header = {};
+    std::memcpy(header.magic, IMAGE_MAGIC, sizeof(header.magic));
+    header.version = IMAGE_VERSION;
+    header.source_size = source_size;
+    header.source_mtime_ns = source_mtime_ns;
+    header.hash_seed = seed;
+    header.hash_bits = bits;
+    header.message_count = static_cast<uint32_t>(messages.size());
+    header.signal_count = static_cast<uint32_t>(signals.size());
+    header.property_count = static_cast<uint32_t>(properties.size());
+    header.string_size = static_cast<uint32_t>(strings.size());
+
+    size_t offset = Align8(sizeof(Header));
+    header.messages_offset = static_cast<uint32_t>(offset);
+    offset = Align8(offset + messages.size() * sizeof(PackedMessage));
+    header.signals_offset = static_cast<uint32_t>(offset);
+    offset = Align8(offset + signals.size() * sizeof(PackedSignal));
+    header.properties_offset = static_cast<uint32_t>(offset);
+    offset = Align8(offset + properties.size() * sizeof(PropertyMapping));
+    header.slots_offset = static_cast<uint32_t>(offset);
+    offset = Align8(offset + slots.size() * sizeof(uint32_t));
+    header.strings_offset = static_cast<uint32_t>(offset);
+    header.size = static_cast<uint32_t>(offset + strings.size());
+
+    image.assign(header.size, 0);
+    std::memcpy(image.data(), &header, sizeof(header));
+    std::memcpy(image.data() + header.messages_offset, messages.data(), messages.size() * sizeof(PackedMessage));
+    std::memcpy(image.data() + header.signals_offset, signals.data(), signals.size() * sizeof(PackedSignal));
+    std::memcpy(image.data() + header.properties_offset, properties.data(),
+                properties.size() * sizeof(PropertyMapping));
+    std::memcpy(image.data() + header.slots_offset, slots.data(), slots.size() * sizeof(uint32_t));
+    std::memcpy(image.data() + header.strings_offset, strings.data(), strings.size());
+    return true;
+}
+
+bool SignalDatabase::Validate(uint8_t const* data, size_t size) {
+    if (size < sizeof(Header)) {
+        return false;
+    }
+    Header const& header = *reinterpret_cast<Header const*>(data);
+    if (std::memcmp(header.magic, IMAGE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != IMAGE_VERSION || header.size != size ||
+        header.hash_bits == 0 || header.hash_bits > MAX_HASH_BITS) {
+        return false;
+    }
+    auto fits = [size](uint32_t offset, size_t count, size_t element) {
+        return offset % 8 == 0 && offset <= size && count <= (size - offset) / element;
+    };
+    if (!fits(header.messages_offset, header.message_count, sizeof(PackedMessage)) ||
+        !fits(header.signals_offset, header.signal_count, sizeof(PackedSignal)) ||
+        !fits(header.properties_offset, header.property_count, sizeof(PropertyMapping)) ||
+        !fits(header.slots_offset, size_t{1} << header.hash_bits, sizeof(uint32_t)) ||
+        !fits(header.strings_offset, header.string_size, 1) || header.string_size == 0 ||
+        data[header.strings_offset + header.string_size - 1] != '\0') {
+        return false;
+    }
+
+    auto messages = reinterpret_cast<PackedMessage const*>(data + header.messages_offset);
+    auto signals = reinterpret_cast<PackedSignal const*>(data + header.signals_offset);
+    auto properties = reinterpret_cast<PropertyMapping const*>(data + header.properties_offset);
+    auto slots = reinterpret_cast<uint32_t const*>(data + header.slots_offset);
+
+    for (uint32_t i = 0; i < header.message_count; i++) {
+        PackedMessage const& message = messages[i];
+        if (message.signal_count > MAX_SIGNALS_PER_MESSAGE || message.dlc > CANFD_MAX_DLEN ||
+            message.sample_count == 0 || message.sample_count > MAX_SAMPLES_PER_FRAME ||
+            message.first_signal > header.signal_count ||
+            message.signal_count > header.signal_count - message.first_signal ||
+            message.first_property > header.property_count ||
+            message.property_count > header.property_count - message.first_property ||
+            message.name >= header.string_size || message.ok_code >= header.string_size ||
+            message.fault_code >= header.string_size) {
+            return false;
+        }
+        // Decode() loads 8 bytes at every window of every sample: all of
+        // them must stay inside canfd_frame::data
+        for (uint32_t j = 0; j < message.signal_count; j++) {
+            PackedSignal const& signal = signals[message.first_signal + j];
+            if (signal.window + size_t{message.sample_count - 1u} * message.sample_stride + 8 > CANFD_MAX_DLEN) {
+                return false;
+            }
+        }
+        for (uint32_t p = 0; p < message.property_count; p++) {
+            PropertyMapping const& property = properties[message.first_property + p];
+            if (property.first_signal + property.signal_count > message.signal_count) {
+                return false;
+            }
+        }
+    }
+    for (uint32_t i = 0; i < header.signal_count; i++) {
+        PackedSignal const& signal = signals[i];
+        if (signal.shift >= 64 || signal.sign_shift >= 64 || signal.name >= header.string_size ||
+            signal.byte_order > ByteOrder::LITTLE_ENDIAN_ORDER || signal.type > ValueType::FLOAT32) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < (size_t{1} << header.hash_bits); i++) {
+        if (slots[i] > header.message_count) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SignalDatabase::MapCache(std::string const& cache_path, uint64_t source_size, int64_t source_mtime_ns) {
+    int fd = open(cache_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < static_cast<off_t>(sizeof(Header))) {
+        close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    auto data = static_cast<uint8_t const*>(mapping);
+    auto header = reinterpret_cast<Header const*>(data);
+    if (!Validate(data, size) || header->source_size != source_size ||
+        header->source_mtime_ns != source_mtime_ns) {
+        CAN_LOG(INFO, TAG, "Cache %s is stale, recompiling", cache_path.c_str());
+        munmap(mapping, size);
+        return false;
+    }
+
+    Unmap();
+    image_.clear();
+    mapping_ = mapping;
+    mapping_size_ = size;
+    Attach(data);
+    return true;
+}
+
+bool SignalDatabase::WriteCache(std::string const& cache_path, std::vector<uint8_t> const& image) {
+    // Written beside the cache and renamed, so a reader never maps a partial file
+    std::string temp_path = cache_path + ".tmp";
+    int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0640);
+    if (fd < 0) {
+        return false;
+    }
+    size_t done = 0;
+    while (done < image.size()) {
+        ssize_t n = write(fd, image.data() + done, image.size() - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        done += static_cast<size_t>(n);
+    }
+    bool ok = done == image.size() && fsync(fd) == 0;
+    close(fd);
+    if (!ok || rename(temp_path.c_str(), cache_path.c_str()) < 0) {
+        unlink(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+void SignalDatabase::Attach(uint8_t const* data) {
+    header_ = reinterpret_cast<Header const*>(data);
+    messages_ = reinterpret_cast<PackedMessage const*>(data + header_->messages_offset);
+    signals_ = reinterpret_cast<PackedSignal const*>(data + header_->signals_offset);
+    slots_ = reinterpret_cast<uint32_t const*>(data + header_->slots_offset);
+    strings_ = reinterpret_cast<char const*>(data + header_->strings_offset);
+    auto properties = reinterpret_cast<PropertyMapping const*>(data + header_->properties_offset);
+
+    // The views point into the image; faults_ is reserved so its pointers stay valid
+    signal_defs_.clear();
+    faults_.clear();
+    infos_.clear();
+    signal_defs_.reserve(header_->signal_count);
+    faults_.reserve(header_->message_count);
+    for (uint32_t i = 0; i < header_->signal_count; i++) {
+        PackedSignal const& signal = signals_[i];
+        signal_defs_.push_back({strings_ + signal.name, signal.start_bit, signal.length,
+                                signal.byte_order, signal.type, signal.scale, signal.offset});
+    }
+    for (uint32_t i = 0; i < header_->message_count; i++) {
+        PackedMessage const& message = messages_[i];
+        FaultCode const* fault = nullptr;
+        if (message.has_fault) {
+            faults_.push_back({message.fault_prop_id, strings_ + message.ok_code,
+                               strings_ + message.fault_code, message.fault_threshold});
+            fault = &faults_.back();
+        }
+        infos_.push_back({message.can_id, message.dlc, signal_defs_.data() + message.first_signal,
+                          message.signal_count, properties + message.first_property,
+                          message.property_count, fault, message.sample_count, message.sample_stride,
+                          message.sample_period_ns});
+    }
+}
+
+size_t SignalDatabase::Decode(canfd_frame const& frame, DecodedSamples &out) const {
+    if (header_ == nullptr || (frame.can_id & (CAN_RTR_FLAG | CAN_ERR_FLAG))) {
+        return 0;
+    }
+    canid_t key = frame.can_id & (CAN_EFF_FLAG | CAN_EFF_MASK);
+    uint32_t slot = slots_[Hash(key, header_->hash_seed, header_->hash_bits)];
+    if (slot == 0) {
+        return 0;
+    }
+    PackedMessage const& message = messages_[slot - 1];
+    if (message.can_id != key || frame.len < message.dlc) {
+        return 0;
+    }
+
+    for (uint8_t k = 0; k < message.sample_count; k++) {
+        uint8_t const* data = frame.data + k * message.sample_stride;
+        DecodedFrame &sample = out[k];
+        PackedSignal const* signal = signals_ + message.first_signal;
+        for (uint8_t i = 0; i < message.signal_count; i++, signal++) {
+            uint64_t word = signal_detail::LoadPayload(data + signal->window, signal->byte_order);
+            uint64_t raw = (word >> signal->shift) & signal->mask;
+            double value;
+            if (signal->type == ValueType::FLOAT32) {
+                uint32_t bits = static_cast<uint32_t>(raw);
+                float f;
+                std::memcpy(&f, &bits, sizeof(f));
+                value = f;
+            } else if (signal->type == ValueType::SIGNED) {
+                value = static_cast<double>(static_cast<int64_t>(raw << signal->sign_shift) >> signal->sign_shift);
+            } else {
+                value = static_cast<double>(raw);
+            }
+            sample.values[i] = value * signal->scale + signal->offset;
+        }
+        sample.can_id = frame.can_id;
+        sample.message = static_cast<uint16_t>(slot - 1);
+        sample.count = message.signal_count;
+    }
+    return message.sample_count;
+}
+
+std::vector<can_filter> SignalDatabase::Filters() const {
+    std::vector<can_filter> filters;
+    for (MessageInfo const& info : infos_) {
+        canid_t id_mask = (info.can_id & CAN_EFF_FLAG) ? CAN_EFF_MASK : CAN_SFF_MASK;
+        filters.push_back({info.can_id, id_mask | CAN_EFF_FLAG | CAN_RTR_FLAG});
+    }
+    return filters;
+}
+
+}  // namespace tcc::aaos::can
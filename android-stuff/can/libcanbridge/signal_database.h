@@ -0,0 +1,86 @@
+#pragma once
+
+#include <linux/can.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "can_signal.h"
+#include "dbc_parser.h"
+#include "message_decoder.h"
+
+namespace tcc::aaos::can {
+
+// Runtime counterpart of SignalTable, loaded from a DBC file at startup.
+//
+// The database is compiled into one position-independent image: contiguous
+// message and signal arrays with shift, mask and scale precomputed, and a
+// perfect hash from CAN ID to message so a lookup is one multiply and one
+// compare. The image is written as-is to a cache file; on the next start it
+// is mmap'd and used in place, with no parsing and no allocation on the
+// decode path.
+class SignalDatabase : public MessageDecoder {
+public:
+    SignalDatabase() = default;
+    ~SignalDatabase() override;
+
+    SignalDatabase(SignalDatabase const&) = delete;
+    SignalDatabase& operator=(SignalDatabase const&) = delete;
+
+    // Maps cache_path if it was compiled from the current dbc_path, otherwise
+    // parses dbc_path and rewrites the cache. An empty cache_path disables
+    // caching; failing to write the cache is not an error.
+    bool Load(std::string const& dbc_path, std::string const& cache_path);
+
+    // Compiles a parsed database into this object (no cache involved)
+    bool Build(DbcFile const& file);
+
+    // Returns the number of samples decoded into out; 0 when the frame is
+    // not in the database or is shorter than its DLC
+    size_t Decode(canfd_frame const& frame, DecodedSamples &out) const override;
+
+    MessageInfo const* Messages() const override { return infos_.data(); }
+    size_t MessageCount() const override { return infos_.size(); }
+    std::vector<can_filter> Filters() const override;
+
+    bool LoadedFromCache() const { return mapping_ != nullptr; }
+
+private:
+    struct Header;
+    struct PackedMessage;
+    struct PackedSignal;
+
+    // Fills image_ from file; slots are sized by FindPerfectHash
+    static bool Compile(DbcFile const& file, uint64_t source_size, int64_t source_mtime_ns,
+                        std::vector<uint8_t> &image);
+    static bool FindPerfectHash(std::vector<canid_t> const& ids, uint32_t &seed, uint32_t &bits);
+    static uint32_t Hash(canid_t key, uint32_t seed, uint32_t bits) {
+        return ((key ^ seed) * 0x9E3779B1u) >> (32 - bits);
+    }
+
+    bool MapCache(std::string const& cache_path, uint64_t source_size, int64_t source_mtime_ns);
+    static bool WriteCache(std::string const& cache_path, std::vector<uint8_t> const& image);
+    // Checks every count and offset in the image before it is used
+    static bool Validate(uint8_t const* data, size_t size);
+    // Points the accessors below at data and rebuilds the MessageInfo views
+    void Attach(uint8_t const* data);
+    void Unmap();
+
+    Header const* header_ = nullptr;
+    PackedMessage const* messages_ = nullptr;
+    PackedSignal const* signals_ = nullptr;
+    uint32_t const* slots_ = nullptr;
+    char const* strings_ = nullptr;
+
+    std::vector<uint8_t> image_; // Owned image when not mapped from the cache
+    void *mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+
+    std::vector<SignalDef> signal_defs_;
+    std::vector<FaultCode> faults_;
+    std::vector<MessageInfo> infos_;
+};
+
+}  // namespace tcc::aaos::can
@@ -0,0 +1,394 @@
+#include "socket_can.h"
+#include "logging.h"
+
+#include <algorithm>
+#include <climits>
+
+namespace tcc::aaos::can {
+
+SocketCan::SocketCan(std::string const& interface_name) : interface_name_(interface_name) {
+    memset(&addr_can_, 0, sizeof(addr_can_));
+    memset(&interface_request_, 0, sizeof(interface_request_));
+    memset(rx_msgs_.data(), 0, sizeof(rx_msgs_));
+    memset(tx_msgs_.data(), 0, sizeof(tx_msgs_));
+}
+
+SocketCan::~SocketCan() {
+    if (can_socket_ >= 0) {
+        CloseCanSocket();
+    }
+}
+
+bool SocketCan::ReadCanMessage(canfd_frame &frame) {
+    int nbytes = read(can_socket_, &frame, sizeof(struct canfd_frame));
+    if (nbytes < 0) {
+        // std::cerr << "Failed to read CAN message" << std::endl;
+        LOG_CAN_ERROR(TAG_SOCKET_CAN, "Failed to read CAN message");
+        return false;
+    }
+    if (nbytes == CANFD_MTU) {
+        frame.flags |= CANFD_FDF;
+    } else if (nbytes == CAN_MTU) {
+        frame.flags = 0;
+    } else {
+        LOG_CAN_ERROR(TAG_SOCKET_CAN, "Incomplete CAN frame");
+        return false;
+    }
+    return true;
+}
+
+int64_t RealtimeNowNs() {
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+int SocketCan::ReadCanMessages(CanRxFrame *frames, size_t max_frames) {
+    if (max_frames > MAX_RX_BATCH) {
+        max_frames = MAX_RX_BATCH;
+    }
+    for (size_t i = 0; i < max_frames; i++) {
+        rx_iov_[i].iov_base = &frames[i].frame;
+        rx_iov_[i].iov_len = sizeof(struct canfd_frame);
+        msghdr &hdr = rx_msgs_[i].msg_hdr;
+        hdr.msg_name = &rx_addr_[i];
+        hdr.msg_namelen = sizeof(rx_addr_[i]);
+        hdr.msg_iov = &rx_iov_[i];
+        hdr.msg_iovlen = 1;
+        hdr.msg_control = rx_cmsg_[i].data();
+        hdr.msg_controllen = rx_cmsg_[i].size();
+        hdr.msg_flags = 0;
+    }
+
+    // MSG_WAITFORONE: block for the first frame, then take whatever is queued
+    int count = recvmmsg(can_socket_, rx_msgs_.data(), max_frames, MSG_WAITFORONE, nullptr);
+    if (count < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return 0;
+        }
+        // errno survives for the caller: ENETDOWN after the link was cycled
+        int error = errno;
+        LOG_CAN_ERROR(TAG_SOCKET_CAN, "Failed to read CAN messages");
+        errno = error;
+        return -1;
+    }
+
+    int valid = 0;
+    uint32_t kernel_drops = kernel_drops_;
+    for (int i = 0; i < count; i++) {
+        unsigned int length = rx_msgs_[i].msg_len;
+        if (length != CAN_MTU && length != CANFD_MTU) {
+            LOG_CAN_ERROR(TAG_SOCKET_CAN, "Incomplete CAN frame");
+            continue;
+        }
+        if (valid != i) {
+            frames[valid].frame = frames[i].frame;
+        }
+        // Classic frames leave __pad in flags; FD frames only carry CANFD_FDF
+        // from kernels that set it
+        if (length == CANFD_MTU) {
+            frames[valid].frame.flags |= CANFD_FDF;
+        } else {
+            frames[valid].frame.flags = 0;
+        }
+        frames[valid].ifindex = rx_addr_[i].can_ifindex;
+        frames[valid].flags = rx_msgs_[i].msg_hdr.msg_flags;
+        frames[valid].timestamp_ns = 0;
+        msghdr &hdr = rx_msgs_[i].msg_hdr;
+        for (cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                timespec ts;
+                memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                frames[valid].timestamp_ns = static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+            } else if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) {
+                memcpy(&kernel_drops, CMSG_DATA(cmsg), sizeof(kernel_drops));
+            }
+        }
+        // Without a kernel timestamp fall back to the time the batch was read
+        if (frames[valid].timestamp_ns == 0) {
+            frames[valid].timestamp_ns = RealtimeNowNs();
+        }
+        valid++;
+    }
+    // Unsigned subtraction also covers the kernel counter wrapping
+    last_batch_drops_ = kernel_drops - kernel_drops_;
+    kernel_drops_ = kernel_drops;
+    rx_queue_drops_ += last_batch_drops_;
+    return valid;
+}
+
+bool SocketCan::SendCanMessage(can_frame const& frame) {
+    int nbytes = write(can_socket_, &frame, sizeof(struct can_frame));
+    if (nbytes < 0) {
+        // std::cerr << "Failed to send CAN message" << std::endl;
+        LOG_CAN_ERROR(TAG_SOCKET_CAN, "Failed to send CAN message");
+        return false;
+    }
+    return true;
+}
+
+size_t SocketCan::PrepareTx(canfd_frame const& frame, canfd_frame &out) const {
+    out = {};
+    out.can_id = frame.can_id;
+    if ((frame.flags & CANFD_FDF) == 0 && frame.len <= CAN_MAX_DLEN) {
+        // can_frame has the same layout up to its 8 data bytes
+        out.len = frame.len;
+        memcpy(out.data, frame.data, frame.len);
+        return CAN_MTU;
+    }
+    out.flags = frame.flags | CANFD_FDF;
+    if (bit_rate_switch_) {
+        out.flags |= CANFD_BRS;
+    }
+    // Payloads between the FD lengths are zero-padded, as the kernel would
+    out.len = CanFdPaddedLength(frame.len);
+    memcpy(out.data, frame.data, std::min<size_t>(frame.len, CANFD_MAX_DLEN));
+    return CANFD_MTU;
+}
+
+bool SocketCan::SendCanMessage(canfd_frame const& frame) {
+    canfd_frame wire;
+    size_t length = PrepareTx(frame, wire);
+    int nbytes = write(can_socket_, &wire, length);
+    if (nbytes < 0) {
+        LOG_CAN_ERROR(TAG_SOCKET_CAN,
+                      length == CANFD_MTU ? "Failed to send CAN FD message" : "Failed to send CAN message");
+        return false;
+    }
+    return true;
+}
+
+int SocketCan::SendCanMessages(canfd_frame const* frames, size_t count) {
+    if (count > MAX_TX_BATCH) {
+        count = MAX_TX_BATCH;
+    }
+    for (size_t i = 0; i < count; i++) {
+        tx_iov_[i].iov_base = &tx_frames_[i];
+        tx_iov_[i].iov_len = PrepareTx(frames[i], tx_frames_[i]);
+        msghdr &hdr = tx_msgs_[i].msg_hdr;
+        hdr = {};
+        hdr.msg_iov = &tx_iov_[i];
+        hdr.msg_iovlen = 1;
+    }
+    int sent = sendmmsg(can_socket_, tx_msgs_.data(), count, 0);
+    if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != ENOBUFS) {
+        int error = errno;
+        LOG_CAN_ERROR(TAG_SOCKET_CAN, "Failed to send CAN messages");
+        errno = error;
+    }
+    return sent;
+}
+
+bool SocketCan::SetFilters(std::vector<can_filter> const& filters) {
+    filters_ = filters;
+    if (can_socket_ < 0) {
+        return true;
+    }
+    return ApplyFilters();
+}
+
+bool SocketCan::ApplyFilters() {
+    // No filters: keep the kernel default of accepting every ID
+    can_filter accept_all = {0, 0};
+    can_filter const* filters = filters_.empty() ? &accept_all : filters_.data();
+    size_t count = filters_.empty() ? 1 : filters_.size();
+    if (setsockopt(can_socket_, SOL_CAN_RAW, CAN_RAW_FILTER, filters, count * sizeof(can_filter)) < 0) {
+        LOG_CAN_ERROR(TAG_SOCKET_CAN, "Failed to set CAN_RAW_FILTER");
+        return false;
+    }
+    return true;
+}
+
+bool SocketCan::SetErrorMask(can_err_mask_t mask) {
+    err_mask_ = mask;
+    if (can_socket_ < 0) {
+        return true;
+    }
+    return ApplyErrorMask();
+}
+
+bool SocketCan::ApplyErrorMask() {
+    if (setsockopt(can_socket_, SOL_CAN_RAW, CAN_RAW_ERR_FILTER, &err_mask_, sizeof(err_mask_)) < 0) {
+        LOG_CAN_ERROR(TAG_SOCKET_CAN, "Failed to set CAN_RAW_ERR_FILTER");
+        return false;
+    }
+    return true;
+}
+
+bool SocketCan::SetBufferSizes(int receive_bytes, int send_bytes) {
+    receive_buffer_ = receive_bytes;
+    send_buffer_ = send_bytes;
+    if (can_socket_ < 0) {
+        return true;
+    }
+    return ApplyBufferSizes();
+}
+
+static bool SetBufferSize(int fd, int force_option, int option, int bytes) {
+    if (bytes <= 0) {
+        return true;
+    }
+    return setsockopt(fd, SOL_SOCKET, force_option, &bytes, sizeof(bytes)) == 0 ||
+           setsockopt(fd, SOL_SOCKET, option, &bytes, sizeof(bytes)) == 0;
+}
+
+bool SocketCan::ApplyBufferSizes() {
+    if (!SetBufferSize(can_socket_, SO_RCVBUFFORCE, SO_RCVBUF, receive_buffer_)) {
+        LOG_CAN_ERROR(TAG_SOCKET_CAN, "Failed to set SO_RCVBUF");
+        return false;
+    }
+    if (!SetBufferSize(can_socket_, SO_SNDBUFFORCE, SO_SNDBUF, send_buffer_)) {
+        LOG_CAN_ERROR(TAG_SOCKET_CAN, "Failed to set SO_SNDBUF");
+        return false;
+    }
+    return true;
+}
+
+static int GetBufferSize(int fd, int option) {
+    int bytes = 0;
+    socklen_t length = sizeof(bytes);
+    if (fd < 0 || getsockopt(fd, SOL_SOCKET, option, &bytes, &length) < 0) {
+        return 0;
+    }
+    return bytes;
+}
+
+int SocketCan::ReceiveBufferSize() const {
+    return GetBufferSize(can_socket_, SO_RCVBUF);
+}
+
+int SocketCan::SendBufferSize() const {
+    return GetBufferSize(can_socket_, SO_SNDBUF);
+}
+
+bool SocketCan::SetNonBlocking(bool enable) {
+    int flags = fcntl(can_socket_, F_GETFL, 0);
+    if (flags < 0) {
+        LOG_CAN_ERROR(TAG_SOCKET_CAN, "Failed to get CAN socket flags");
+        return false;
+    }
+    flags = enable ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+    if (fcntl(can_socket_, F_SETFL, flags) < 0) {
+        LOG_CAN_ERROR(TAG_SOCKET_CAN, "Failed to set CAN socket flags");
+        return false;
+    }
+    return true;
+}
+
+bool SocketCan::EnableTimestamps() {
+    int enable = 1;
+    if (setsockopt(can_socket_, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)) < 0) {
+        LOG_CAN_ERROR(TAG_SOCKET_CAN, "Failed to enable SO_TIMESTAMPNS");
+        return false;
+    }
+    return true;
+}
+
+bool SocketCan::EnableDropCounter() {
+    int enable = 1;
+    if (setsockopt(can_socket_, SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(enable)) < 0) {
+        LOG_CAN_ERROR(TAG_SOCKET_CAN, "Failed to enable SO_RXQ_OVFL");
+        return false;
+    }
+    return true;
+}
+
+bool SocketCan::EnableFdFrames() {
+    int enable = 1;
+    if (setsockopt(can_socket_, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &enable, sizeof(enable)) < 0) {
+        LOG_CAN_ERROR(TAG_SOCKET_CAN, "Failed to enable CAN_RAW_FD_FRAMES");
+        return false;
+    }
+    return true;
+}
+
+bool SocketCan::OpenCanSocket() {
+    can_socket_ = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    if (can_socket_ < 0) {
+        LOG_CAN_ERROR(TAG_SOCKET_CAN, "Failed to open CAN socket");
+        return false;
+    }
+    return true;
+}
+
+bool SocketCan::Init() {
+    if (!OpenCanSocket()) {
+        LOG_CAN_ERROR(TAG_SOCKET_CAN, "Failed to open CAN socket");
+        return false;
+    }
+    // Filter before bind so unwanted frames never reach the socket queue
+    if (!filters_.empty() && !ApplyFilters()) {
+        LOG_CAN_ERROR(TAG_SOCKET_CAN, "Failed to apply CAN filters");
+        return false;
+    }
+    if (err_mask_ != 0 && !ApplyErrorMask()) {
+        LOG_CAN_ERROR(TAG_SOCKET_CAN, "Failed to apply CAN error filter");
+        return false;
+    }
+    // Sized before bind so the first burst already has the whole buffer
+    if (!ApplyBufferSizes()) {
+        LOG_CAN_ERROR(TAG_SOCKET_CAN, "Failed to size CAN socket buffers");
+        return false;
+    }
+    // Not fatal: ReadCanMessages falls back to user-space timestamps
+    EnableTimestamps();
+    // Not fatal either: RxQueueDrops() then stays at 0
+    EnableDropCounter();
+    // Without it (kernels before 3.6) the socket only sees classic frames
+    EnableFdFrames();
+    if (!BindCanSocket()) {
+        LOG_CAN_ERROR(TAG_SOCKET_CAN, "Failed to bind CAN socket");
+        return false;
+    }
+    return true;
+}
+
+bool SocketCan::BindCanSocket() {
+    strncpy(interface_request_.ifr_name, interface_name_.c_str(), IFNAMSIZ - 1);
+
+    if (ioctl(can_socket_, SIOCGIFINDEX, &interface_request_) < 0) {
+        // std::cerr << "Failed to get CAN interface index" << std::endl;
+        LOG_CAN_ERROR(TAG_SOCKET_CAN, "Failed to get CAN interface index");
+        return false;
+    }
+
+    // CAN FD interfaces advertise the larger MTU; clobbers ifr_ifindex, so
+    // read it into a copy
+    ifreq mtu_request = interface_request_;
+    fd_capable_ = ioctl(can_socket_, SIOCGIFMTU, &mtu_request) == 0 && mtu_request.ifr_mtu == CANFD_MTU;
+
+    // ifindex only valid after SIOCGIFINDEX; 0 would bind to every CAN interface
+    addr_can_.can_family = AF_CAN;
+    addr_can_.can_ifindex = interface_request_.ifr_ifindex;
+    if (bind(can_socket_, (struct sockaddr*)&addr_can_, sizeof(addr_can_)) < 0) {
+        // std::cerr << "Failed to bind CAN socket" << std::endl;
+        LOG_CAN_ERROR(TAG_SOCKET_CAN, "Failed to bind CAN socket");
+        return false;
+    }
+    return true;
+}
+
+bool SocketCan::CloseCanSocket() {
+    if (close(can_socket_) < 0) {
+        // std::cerr << "Failed to close CAN socket" << std::endl;
+        LOG_CAN_ERROR(TAG_SOCKET_CAN, "Failed to close CAN socket");
+        return false;
+    }
+    return true;
+}
+
+bool ParseBufferSizeOption(std::string const& text, int &bytes) {
+    char *end = nullptr;
+    errno = 0;
+    long kib = std::strtol(text.c_str(), &end, 10);
+    if (errno != 0 || text.empty() || *end != '\0' || kib < 1 || kib > INT_MAX / 1024) {
+        return false;
+    }
+    bytes = static_cast<int>(kib) * 1024;
+    return true;
+}
+
+}  // namespace tcc::aaos::can
+
+
+// Path: device/snappautomotive/rpi4_car/can/can-vhal-tcc/SocketCan.h
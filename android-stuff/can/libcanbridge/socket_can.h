@@ -0,0 +1,184 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <iostream>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cerrno>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TAG_SOCKET_CAN "SOCKET_CAN"
+
+// #ifdef DEBUG
+//     #define LOG(msg) std::cout << msg << std::endl
+//     #define LOG_ERROR(msg) std::cerr << msg << std::endl
+// #endif
+
+namespace tcc::aaos::can {
+
+// Maximum number of frames drained by a single ReadCanMessages() call
+constexpr static size_t MAX_RX_BATCH = 32;
+// Maximum number of frames sent by a single SendCanMessages() call
+constexpr static size_t MAX_TX_BATCH = 32;
+
+// canfd_frame::flags marking a CAN FD frame; older uapi headers lack it
+#ifndef CANFD_FDF
+#define CANFD_FDF 0x04
+#endif
+
+// Smallest CAN FD payload length (0-8, 12, 16, 20, 24, 32, 48, 64) that holds
+// len bytes
+constexpr uint8_t CanFdPaddedLength(uint8_t len) {
+    constexpr uint8_t LENGTHS[] = {12, 16, 20, 24, 32, 48, 64};
+    if (len <= CAN_MAX_DLEN) {
+        return len;
+    }
+    for (uint8_t length : LENGTHS) {
+        if (len <= length) {
+            return length;
+        }
+    }
+    return CANFD_MAX_DLEN;
+}
+
+// Control message buffer for recvmmsg. CMSG_FIRSTHDR/CMSG_NXTHDR read a
+// cmsghdr at its start, so it needs cmsghdr's alignment, like the union in
+// the cmsg(3) example.
+template <size_t SIZE>
+struct alignas(cmsghdr) CmsgBuffer : std::array<char, SIZE> {};
+
+// Frame received by ReadCanMessages() plus the metadata returned by recvmmsg.
+// Classic frames use the first CAN_MTU bytes with frame.flags 0; CAN FD
+// frames have CANFD_FDF set in frame.flags, plus CANFD_BRS / CANFD_ESI as
+// received.
+struct CanRxFrame {
+    canfd_frame frame;
+    int ifindex;          // Interface the frame arrived on
+    unsigned int flags;   // msg_flags: MSG_DONTROUTE = local loopback, MSG_CONFIRM = own TX echo
+    int64_t timestamp_ns; // Kernel RX time (SO_TIMESTAMPNS, CLOCK_REALTIME)
+};
+
+// Same clock as the SO_TIMESTAMPNS receive timestamps
+int64_t RealtimeNowNs();
+
+struct SocketCan {
+public:
+    SocketCan(std::string const& interface_name = "can0");
+    ~SocketCan();
+    SocketCan(SocketCan const&) = delete;
+    SocketCan& operator=(SocketCan const&) = delete;
+    bool SendCanMessage(can_frame const& frame);
+    // Sends frame as CAN FD when it has CANFD_FDF set or more than 8 bytes,
+    // otherwise as a classic frame. CANFD_BRS is forced on for FD frames
+    // while SetBitRateSwitch(true); the interface must be FdCapable().
+    bool SendCanMessage(canfd_frame const& frame);
+    // Sends up to count frames (capped at MAX_TX_BATCH), each as
+    // SendCanMessage(canfd_frame) would, with a single sendmmsg call.
+    // Returns how many the kernel took, in order; fewer than count when the
+    // interface queue fills up (ENOBUFS, or EAGAIN in non-blocking mode).
+    // -1 with errno set when it took none.
+    int SendCanMessages(canfd_frame const* frames, size_t count);
+    // Reads one classic or CAN FD frame; FD frames get CANFD_FDF in flags
+    bool ReadCanMessage(canfd_frame &frame);
+    // Blocks until at least one frame is available, then drains up to
+    // max_frames (capped at MAX_RX_BATCH) with a single recvmmsg call.
+    // Returns the number of frames written to frames, or -1 with errno set.
+    // In non-blocking mode returns 0 when the socket queue is empty.
+    int ReadCanMessages(CanRxFrame *frames, size_t max_frames);
+    // Installs CAN_RAW_FILTER so the kernel drops every frame that does not
+    // match one of the id/mask pairs. May be called before Init(), in which
+    // case the filters are applied before the socket is bound. An empty list
+    // restores the default accept-all filter.
+    bool SetFilters(std::vector<can_filter> const& filters);
+    // Installs CAN_RAW_ERR_FILTER: error frames (CAN_ERR_FLAG, see
+    // linux/can/error.h) of the classes in mask are delivered alongside data
+    // frames. 0, the kernel default, delivers none. Same Init() rules as
+    // SetFilters().
+    bool SetErrorMask(can_err_mask_t mask);
+    // Socket receive and send buffer sizes in bytes; 0 keeps the kernel
+    // default (net.core.rmem_default / wmem_default). SO_RCVBUFFORCE and
+    // SO_SNDBUFFORCE are tried first: they go past net.core.rmem_max /
+    // wmem_max but need CAP_NET_ADMIN; without it the plain option is used
+    // and the kernel caps the size at the sysctl. Every queued frame is
+    // charged its skb truesize (about 1 KiB on 64-bit), not its 16 or 72
+    // bytes. Same Init() rules as SetFilters().
+    bool SetBufferSizes(int receive_bytes, int send_bytes);
+    // Effective sizes as read back from the kernel, which doubles the
+    // request for its bookkeeping. Valid after Init().
+    int ReceiveBufferSize() const;
+    int SendBufferSize() const;
+    // O_NONBLOCK, for sockets driven by an EventLoop
+    bool SetNonBlocking(bool enable);
+    // Transmit CAN FD data phases at the data bit rate (CANFD_BRS)
+    void SetBitRateSwitch(bool enable) { bit_rate_switch_ = enable; }
+    bool Init();
+    int GetFd() const { return can_socket_; }
+    // Whether the interface MTU is CANFD_MTU, i.e. it was configured with
+    // "ip link set ... type can fd on" (or is an FD vcan). Valid after Init().
+    bool FdCapable() const { return fd_capable_; }
+    // Frames the kernel dropped because this socket's receive queue was full
+    // (SO_RXQ_OVFL). Cumulative since Init(); updated by ReadCanMessages()
+    // whenever a frame arrives.
+    uint64_t RxQueueDrops() const { return rx_queue_drops_; }
+    // Frames dropped between the previous ReadCanMessages() batch and the
+    // last one, i.e. right before the frames it returned
+    uint32_t LastBatchDrops() const { return last_batch_drops_; }
+    std::string const& GetInterfaceName() const { return interface_name_; }
+private:
+    bool OpenCanSocket();
+    bool ApplyFilters();
+    bool ApplyErrorMask();
+    bool ApplyBufferSizes();
+    bool EnableTimestamps();
+    bool EnableDropCounter();
+    bool EnableFdFrames();
+    bool BindCanSocket();
+    bool CloseCanSocket();
+    // Copies frame into out as it goes on the wire and returns the bytes to
+    // write: CAN_MTU for a classic frame, CANFD_MTU for an FD one
+    size_t PrepareTx(canfd_frame const& frame, canfd_frame &out) const;
+private:
+    sockaddr_can addr_can_;
+    ifreq interface_request_;
+    std::string interface_name_;
+    int can_socket_ = -1;
+    std::vector<can_filter> filters_;
+    can_err_mask_t err_mask_ = 0;
+    int receive_buffer_ = 0;
+    int send_buffer_ = 0;
+    // SO_RXQ_OVFL is the socket's 32-bit drop counter; rx_queue_drops_
+    // accumulates its deltas so it never wraps
+    uint32_t kernel_drops_ = 0;
+    uint32_t last_batch_drops_ = 0;
+    uint64_t rx_queue_drops_ = 0;
+    bool fd_capable_ = false;
+    bool bit_rate_switch_ = false;
+    // recvmmsg bookkeeping, kept here so the batch path does not allocate
+    std::array<mmsghdr, MAX_RX_BATCH> rx_msgs_;
+    std::array<iovec, MAX_RX_BATCH> rx_iov_;
+    std::array<sockaddr_can, MAX_RX_BATCH> rx_addr_;
+    std::array<CmsgBuffer<CMSG_SPACE(sizeof(timespec)) + CMSG_SPACE(sizeof(uint32_t))>, MAX_RX_BATCH> rx_cmsg_;
+    // sendmmsg bookkeeping
+    std::array<mmsghdr, MAX_TX_BATCH> tx_msgs_;
+    std::array<iovec, MAX_TX_BATCH> tx_iov_;
+    std::array<canfd_frame, MAX_TX_BATCH> tx_frames_;
+};
+
+// Parses a --rcvbuf/--sndbuf size in KiB (1 to INT_MAX / 1024) into bytes
+// for SocketCan::SetBufferSizes(). False on malformed or out-of-range input.
+bool ParseBufferSizeOption(std::string const& text, int &bytes);
+
+}  // namespace tcc::aaos::can
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace tcc::aaos::can {
+
+// Bounded single-producer/single-consumer ring. TryPush() must only be
+// called from one thread and TryPop() from one other thread; neither blocks
+// nor allocates. Each side caches the other's index so the shared cache
+// line is only touched when the ring looks full (producer) or empty (consumer).
+template <typename T, size_t CAPACITY>
+class SpscRing {
+    static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0,
+                  "SpscRing capacity must be a power of two");
+
+public:
+    bool TryPush(T const& item) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_cache_ == CAPACITY) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head - tail_cache_ == CAPACITY) {
+                return false;
+            }
+        }
+        slots_[head & MASK] = item;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool TryPop(T &item) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_cache_) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail == head_cache_) {
+                return false;
+            }
+        }
+        item = slots_[tail & MASK];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when called concurrently with push/pop
+    size_t Size() const {
+        size_t tail = tail_.load(std::memory_order_acquire);
+        return head_.load(std::memory_order_acquire) - tail;
+    }
+
+    constexpr static size_t Capacity() { return CAPACITY; }
+
+private:
+    constexpr static size_t MASK = CAPACITY - 1;
+
+    // Producer side
+    alignas(64) std::atomic<size_t> head_{0};
+    size_t tail_cache_ = 0;
+    // Consumer side
+    alignas(64) std::atomic<size_t> tail_{0};
+    size_t head_cache_ = 0;
+
+    alignas(64) std::array<T, CAPACITY> slots_{};
+};
+
+}  // namespace tcc::aaos::can
@@ -0,0 +1,244 @@
+#include <gtest/gtest.h>
+
+#include <linux/can/error.h>
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "batch_decoder.h"
+#include "can_gateway.h"
+#include "can_log.h"
+#include "dbc_parser.h"
+#include "event_loop.h"
+#include "fake_property_sink.h"
+#include "message_decoder.h"
+#include "publisher.h"
+#include "signal_database.h"
+#include "vehicle_signals.h"
+
+namespace tcc::aaos::can {
+namespace {
+
+// Mixed layouts: whole fields in both byte orders and every width, plus bit
+// fields and a multi-sample message; only signals with a VHAL property are
+// decoded
+constexpr char MIXED_DBC[] =
+        "BO_ 256 Fields: 16 X\n"
+        " SG_ U8 : 0|8@1+ (1,0) [0|0] \"\" X\n"
+        " SG_ S8 : 15|8@0- (0.5,1) [0|0] \"\" X\n"
+        " SG_ U16 : 16|16@1+ (0.01,-40) [0|0] \"\" X\n"
+        " SG_ S16 : 39|16@0- (1,0) [0|0] \"\" X\n"
+        " SG_ S32 : 55|32@0- (0.001,0) [0|0] \"\" X\n"
+        " SG_ U32 : 80|32@1+ (1,0) [0|0] \"\" X\n"
+        " SG_ Bits : 112|12@1- (1,0) [0|0] \"\" X\n"
+        " SG_ Motorola : 127|3@0+ (1,0) [0|0] \"\" X\n"
+        "BO_ 2147487744 Ext: 8 X\n"
+        " SG_ Big : 7|32@0+ (2,0) [0|0] \"\" X\n"
+        " SG_ Little : 32|32@1- (1,0) [0|0] \"\" X\n"
+        "BO_ 1 Burst: 64 X\n"
+        " SG_ A : 0|16@1- (1,0) [0|0] \"\" X\n"
+        " SG_ B : 23|16@0+ (0.25,0) [0|0] \"\" X\n"
+        "BA_ \"VhalProperty\" SG_ 256 U8 291504647;\n"
+        "BA_ \"VhalProperty\" SG_ 256 S8 291504648;\n"
+        "BA_ \"VhalProperty\" SG_ 256 U16 291504649;\n"
+        "BA_ \"VhalProperty\" SG_ 256 S16 291504650;\n"
+        "BA_ \"VhalProperty\" SG_ 256 S32 291504651;\n"
+        "BA_ \"VhalProperty\" SG_ 256 U32 291504652;\n"
+        "BA_ \"VhalProperty\" SG_ 256 Bits 291504653;\n"
+        "BA_ \"VhalProperty\" SG_ 256 Motorola 291504654;\n"
+        "BA_ \"VhalProperty\" SG_ 2147487744 Big 291504655;\n"
+        "BA_ \"VhalProperty\" SG_ 2147487744 Little 291504656;\n"
+        "BA_ \"VhalProperty\" SG_ 1 A 291504657;\n"
+        "BA_ \"VhalProperty\" SG_ 1 B 291504658;\n"
+        "BA_ \"VhalSampleCount\" BO_ 1 14;\n"
+        "BA_ \"VhalSampleStride\" BO_ 1 4;\n";
+
+bool SameValue(double a, double b) {
+    return (std::isnan(a) && std::isnan(b)) || a == b;
+}
+
+std::vector<DecodeKernel> SupportedKernels() {
+    std::vector<DecodeKernel> kernels;
+    for (DecodeKernel kernel : {DecodeKernel::SCALAR, DecodeKernel::SSE2, DecodeKernel::AVX2, DecodeKernel::NEON}) {
+        if (KernelSupported(kernel)) {
+            kernels.push_back(kernel);
+        }
+    }
+    return kernels;
+}
+
+// Random frames of every message in the set, plus ones the decoders reject
+std::vector<CanRxFrame> RandomFrames(MessageInfo const* messages, size_t message_count, size_t count,
+                                     std::mt19937 &random) {
+    std::vector<CanRxFrame> frames(count);
+    for (size_t i = 0; i < frames.size(); i++) {
+        CanRxFrame &rx = frames[i];
+        rx = {};
+        for (uint8_t &byte : rx.frame.data) {
+            byte = static_cast<uint8_t>(random());
+        }
+        MessageInfo const& info = messages[random() % message_count];
+        rx.frame.can_id = info.can_id;
+        rx.frame.len = info.dlc;
+        rx.timestamp_ns = static_cast<int64_t>(i);
+        switch (random() % 10) {
+            case 0:
+                rx.frame.len = info.dlc - 1; // Short
+                break;
+            case 1:
+                rx.frame.can_id = 0x7FF; // Not in the set
+                break;
+            case 2:
+                rx.frame.can_id = CAN_ERR_FLAG | CAN_ERR_BUSOFF;
+                break;
+            default:
+                break;
+        }
+    }
+    return frames;
+}
+
+// Decodes frames with batch and compares every sample with decoder
+void CrossCheck(MessageDecoder const& decoder, BatchDecoder &batch, std::vector<CanRxFrame> const& frames) {
+    size_t done = 0;
+    while (done < frames.size()) {
+        size_t taken = batch.Decode(frames.data() + done, frames.size() - done);
+        ASSERT_GT(taken, 0u);
+        for (size_t i = 0; i < taken; i++) {
+            DecodedSamples expected;
+            size_t count = decoder.Decode(frames[done + i].frame, expected);
+            BatchDecoder::FrameResult const& result = batch.Result(i);
+            ASSERT_EQ(result.count, count) << "frame " << done + i;
+            for (size_t k = 0; k < count; k++) {
+                DecodedFrame const& sample = batch.Samples()[result.first + k];
+                ASSERT_EQ(sample.can_id, expected[k].can_id);
+                ASSERT_EQ(sample.message, expected[k].message);
+                ASSERT_EQ(sample.count, expected[k].count);
+                for (size_t s = 0; s < sample.count; s++) {
+                    ASSERT_TRUE(SameValue(sample.values[s], expected[k].values[s]))
+                            << "frame " << done + i << " sample " << k << " signal " << s << ": "
+                            << sample.values[s] << " != " << expected[k].values[s];
+                }
+            }
+        }
+        done += taken;
+    }
+}
+
+TEST(BatchDecoderTest, KernelsMatchTheScalarConversion) {
+    std::mt19937 random(1);
+    std::vector<uint8_t> raw(4 * 67);
+    for (uint8_t &byte : raw) {
+        byte = static_cast<uint8_t>(random());
+    }
+    // Extremes of every width land in the vector part, not only the tail
+    std::memset(raw.data(), 0xFF, 8);
+    std::memset(raw.data() + 8, 0x80, 8);
+
+    std::vector<ColumnFormat> formats;
+    for (uint8_t width : {1, 2, 4}) {
+        for (bool big_endian : {false, true}) {
+            for (ValueType type : {ValueType::UNSIGNED, ValueType::SIGNED, ValueType::FLOAT32}) {
+                if (type == ValueType::FLOAT32 && width != 4) {
+                    continue;
+                }
+                formats.push_back({width, big_endian, type, 1.0, 0.0});
+                formats.push_back({width, big_endian, type, 0.125, -40.0});
+            }
+        }
+    }
+    for (ColumnFormat const& format : formats) {
+        std::vector<double> expected(67);
+        ConvertColumn(DecodeKernel::SCALAR, format, raw.data(), expected.size(), expected.data());
+        for (DecodeKernel kernel : SupportedKernels()) {
+            // Lengths around the vector widths exercise the scalar tail
+            for (size_t n : {size_t{0}, size_t{3}, size_t{8}, size_t{13}, size_t{67}}) {
+                std::vector<double> out(n);
+                ConvertColumn(kernel, format, raw.data(), n, out.data());
+                for (size_t i = 0; i < n; i++) {
+                    ASSERT_TRUE(SameValue(out[i], expected[i]))
+                            << KernelName(kernel) << " width " << int{format.width} << " lane " << i;
+                }
+            }
+        }
+    }
+}
+
+TEST(BatchDecoderTest, MatchesTheStaticTable) {
+    StaticDecoder<VehicleSignals> decoder;
+    std::mt19937 random(2);
+    std::vector<CanRxFrame> frames = RandomFrames(decoder.Messages(), decoder.MessageCount(), 500, random);
+    for (DecodeKernel kernel : SupportedKernels()) {
+        SCOPED_TRACE(KernelName(kernel));
+        BatchDecoder batch(decoder.Messages(), decoder.MessageCount(), kernel);
+        EXPECT_EQ(batch.Kernel(), kernel);
+        CrossCheck(decoder, batch, frames);
+    }
+}
+
+TEST(BatchDecoderTest, MatchesTheDatabaseOnMixedLayouts) {
+    DbcFile file;
+    ASSERT_TRUE(ParseDbc(MIXED_DBC, file));
+    SignalDatabase database;
+    ASSERT_TRUE(database.Build(file));
+    ASSERT_EQ(database.MessageCount(), 3u);
+    std::mt19937 random(3);
+    std::vector<CanRxFrame> frames = RandomFrames(database.Messages(), database.MessageCount(), 500, random);
+    for (DecodeKernel kernel : SupportedKernels()) {
+        SCOPED_TRACE(KernelName(kernel));
+        BatchDecoder batch(database.Messages(), database.MessageCount(), kernel);
+        CrossCheck(database, batch, frames);
+    }
+}
+
+TEST(BatchDecoderTest, SplitsBatchesAtMaxSamples) {
+    StaticDecoder<VehicleSignals> decoder;
+    // 0x125 carries 10 samples: 25 frames fill MAX_SAMPLES
+    std::vector<CanRxFrame> frames(MAX_RX_BATCH);
+    for (CanRxFrame &rx : frames) {
+        rx = {};
+        rx.frame.can_id = 0x125;
+        rx.frame.len = CANFD_MAX_DLEN;
+    }
+    BatchDecoder batch(decoder.Messages(), decoder.MessageCount());
+    EXPECT_EQ(batch.Decode(frames.data(), frames.size()), BatchDecoder::MAX_SAMPLES / 10);
+    EXPECT_EQ(batch.Result(24).first, 240u);
+}
+
+TEST(BatchDecoderTest, GatewayPublishesTheSameValues) {
+    constexpr char LOG[] =
+            "(1700000000.000100) can0 123#0064FF384000\n"
+            "(1700000000.000200) can0 124#0000C841\n"
+            "(1700000000.000300) can0 123#00\n" // Shorter than the DLC
+            "(1700000000.000400) can0 123#FF9C00C8FFFF\n";
+    std::vector<FakePropertySink::Value> published[2];
+    GatewayStats stats[2];
+    for (int batched = 0; batched < 2; batched++) {
+        FakePropertySink sink;
+        StaticDecoder<VehicleSignals> decoder;
+        Publisher publisher(sink, decoder.Messages(), decoder.MessageCount(), 0);
+        ASSERT_TRUE(publisher.Init());
+        publisher.Start();
+        EventLoop loop;
+        CanGateway gateway(loop, decoder, publisher);
+        gateway.SetBatchDecode(batched == 1);
+        CanLogReader reader;
+        ASSERT_TRUE(reader.OpenBuffer(LOG));
+        gateway.ReplayLog(reader, 0);
+        publisher.Stop();
+        published[batched] = sink.Published(INFO_ACCELEROMETER_MPU6050);
+        stats[batched] = gateway.Stats();
+    }
+    EXPECT_EQ(stats[1].frames, 4u);
+    EXPECT_EQ(stats[1].decoded, stats[0].decoded);
+    EXPECT_EQ(stats[1].decode_failures, 1u);
+    ASSERT_EQ(published[1].size(), published[0].size());
+    ASSERT_FALSE(published[1].empty());
+    EXPECT_EQ(published[1].back().int32_values, published[0].back().int32_values);
+    EXPECT_EQ(published[1].back().int32_values, (std::vector<int32_t>{-100, 200, -1}));
+}
+
+}  // namespace
+}  // namespace tcc::aaos::can
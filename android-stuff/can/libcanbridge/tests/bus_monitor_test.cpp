@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+
+#include <linux/can/error.h>
+
+#include <cerrno>
+#include <chrono>
+#include <memory>
+
+#include "bus_monitor.h"
+#include "can_netlink.h"
+#include "event_loop.h"
+
+namespace tcc::aaos::can {
+namespace {
+
+// Any interface works: the monitor only needs its index
+constexpr char INTERFACE[] = "lo";
+
+class FakeLinkControl : public CanLinkControl {
+public:
+    int Restart(int) override {
+        restarts++;
+        if (restart_result == 0) {
+            state.state = CAN_STATE_ERROR_ACTIVE;
+        }
+        return restart_result;
+    }
+    int CycleLink(int) override {
+        cycles++;
+        if (cycle_result == 0) {
+            state.state = CAN_STATE_ERROR_ACTIVE;
+        }
+        return cycle_result;
+    }
+    int GetState(int, CanLinkState &out) override {
+        out = state;
+        return 0;
+    }
+
+    CanLinkState state = {CAN_STATE_ERROR_ACTIVE, 0, 0};
+    int restart_result = 0;
+    int cycle_result = 0;
+    int restarts = 0;
+    int cycles = 0;
+};
+
+canfd_frame ErrorFrame(canid_t classes, uint8_t controller = 0) {
+    canfd_frame frame = {};
+    frame.can_id = CAN_ERR_FLAG | classes;
+    frame.len = CAN_ERR_DLC;
+    frame.data[1] = controller;
+    return frame;
+}
+
+class BusMonitorTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_TRUE(loop_.Init());
+    }
+
+    void Start(BusRecoveryConfig const& config = {}) {
+        monitor_ = std::make_unique<BusMonitor>(loop_, link_, INTERFACE, config);
+        ASSERT_TRUE(monitor_->Init());
+    }
+
+    EventLoop loop_;
+    FakeLinkControl link_;
+    std::unique_ptr<BusMonitor> monitor_;
+};
+
+TEST(ClassifyErrorFrameTest, DecodesControllerStateAndCounters) {
+    canfd_frame frame = ErrorFrame(CAN_ERR_CRTL | CAN_ERR_CNT, CAN_ERR_CRTL_TX_PASSIVE | CAN_ERR_CRTL_RX_OVERFLOW);
+    frame.data[6] = 130;
+    frame.data[7] = 12;
+    ErrorFrameInfo info = ClassifyErrorFrame(frame);
+    EXPECT_EQ(info.classes, static_cast<uint32_t>(CAN_ERR_CRTL | CAN_ERR_CNT));
+    EXPECT_TRUE(info.has_state);
+    EXPECT_EQ(info.state, BusState::ERROR_PASSIVE);
+    EXPECT_TRUE(info.rx_overflow);
+    EXPECT_FALSE(info.tx_overflow);
+    EXPECT_TRUE(info.has_counters);
+    EXPECT_EQ(info.tx_errors, 130);
+    EXPECT_EQ(info.rx_errors, 12);
+
+    EXPECT_EQ(ClassifyErrorFrame(ErrorFrame(CAN_ERR_BUSOFF)).state, BusState::BUS_OFF);
+    EXPECT_EQ(ClassifyErrorFrame(ErrorFrame(CAN_ERR_RESTARTED)).state, BusState::ERROR_ACTIVE);
+    EXPECT_EQ(ClassifyErrorFrame(ErrorFrame(CAN_ERR_CRTL, CAN_ERR_CRTL_RX_WARNING)).state, BusState::ERROR_WARNING);
+    EXPECT_FALSE(ClassifyErrorFrame(ErrorFrame(CAN_ERR_PROT | CAN_ERR_ACK)).has_state);
+}
+
+TEST_F(BusMonitorTest, TracksErrorStatesAndTimeErrorPassive) {
+    Start();
+    monitor_->OnErrorFrame(ErrorFrame(CAN_ERR_CRTL, CAN_ERR_CRTL_TX_WARNING));
+    EXPECT_EQ(monitor_->State(), BusState::ERROR_WARNING);
+    monitor_->OnErrorFrame(ErrorFrame(CAN_ERR_CRTL, CAN_ERR_CRTL_TX_PASSIVE));
+    EXPECT_EQ(monitor_->State(), BusState::ERROR_PASSIVE);
+    monitor_->OnErrorFrame(ErrorFrame(CAN_ERR_PROT | CAN_ERR_ACK));
+    monitor_->OnErrorFrame(ErrorFrame(CAN_ERR_CRTL, CAN_ERR_CRTL_ACTIVE));
+
+    BusStats stats = monitor_->Stats();
+    EXPECT_EQ(stats.state, BusState::ERROR_ACTIVE);
+    EXPECT_EQ(stats.error_frames, 4u);
+    EXPECT_EQ(stats.controller_errors, 3u);
+    EXPECT_EQ(stats.protocol_errors, 1u);
+    EXPECT_EQ(stats.ack_errors, 1u);
+    EXPECT_EQ(stats.error_warnings, 1u);
+    EXPECT_EQ(stats.error_passives, 1u);
+    EXPECT_GT(stats.error_passive_ns, 0);
+    EXPECT_EQ(stats.bus_offs, 0u);
+    EXPECT_EQ(link_.restarts, 0);
+}
+
+TEST_F(BusMonitorTest, RestartsImmediatelyAfterBusOff) {
+    Start();
+    monitor_->OnErrorFrame(ErrorFrame(CAN_ERR_BUSOFF));
+    EXPECT_EQ(link_.restarts, 1);
+    EXPECT_EQ(monitor_->State(), BusState::BUS_OFF);
+
+    // The kernel confirms the restart with CAN_ERR_RESTARTED
+    monitor_->OnErrorFrame(ErrorFrame(CAN_ERR_RESTARTED));
+    BusStats stats = monitor_->Stats();
+    EXPECT_EQ(stats.state, BusState::ERROR_ACTIVE);
+    EXPECT_EQ(stats.bus_offs, 1u);
+    EXPECT_EQ(stats.restarts, 1u);
+    EXPECT_GT(stats.bus_off_ns, 0);
+    EXPECT_GT(stats.last_recovery_ns, 0);
+    EXPECT_LT(stats.last_recovery_ns, 100'000'000);
+
+    // Recovered: the retry timer is disarmed
+    loop_.RunOnce(20);
+    EXPECT_EQ(link_.restarts, 1);
+}
+
+TEST_F(BusMonitorTest, DataFramesConfirmRecovery) {
+    Start();
+    monitor_->OnErrorFrame(ErrorFrame(CAN_ERR_BUSOFF));
+    monitor_->OnDataFrames();
+    EXPECT_EQ(monitor_->State(), BusState::ERROR_ACTIVE);
+    EXPECT_EQ(monitor_->Stats().bus_offs, 1u);
+}
+
+TEST_F(BusMonitorTest, CyclesTheLinkWhenRestartIsRefused) {
+    link_.restart_result = -EINVAL; // restart-ms is set
+    Start();
+    monitor_->OnErrorFrame(ErrorFrame(CAN_ERR_BUSOFF));
+    EXPECT_EQ(link_.restarts, 1);
+    EXPECT_EQ(link_.cycles, 1);
+    EXPECT_EQ(monitor_->Stats().restarts, 1u);
+}
+
+TEST_F(BusMonitorTest, RetriesWithBackoffWhileBusOff) {
+    link_.restart_result = -EPERM;
+    link_.cycle_result = -EPERM;
+    link_.state.state = CAN_STATE_BUS_OFF;
+    BusRecoveryConfig config;
+    config.initial_backoff_ns = 1'000'000;
+    config.max_backoff_ns = 4'000'000;
+    // Already bus-off when the monitor starts
+    Start(config);
+    EXPECT_EQ(link_.restarts, 1);
+
+    // 1 + 2 + 4 + 4 ms of backoff
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (link_.restarts < 5 && std::chrono::steady_clock::now() < deadline) {
+        loop_.RunOnce(10);
+    }
+    EXPECT_EQ(link_.restarts, 5);
+    EXPECT_EQ(monitor_->Stats().restart_failures, 5u);
+
+    // The controller comes back on its own; the next retry notices
+    link_.state.state = CAN_STATE_ERROR_ACTIVE;
+    deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (monitor_->State() == BusState::BUS_OFF && std::chrono::steady_clock::now() < deadline) {
+        loop_.RunOnce(10);
+    }
+    BusStats stats = monitor_->Stats();
+    EXPECT_EQ(stats.state, BusState::ERROR_ACTIVE);
+    EXPECT_EQ(link_.restarts, 5);
+    EXPECT_GE(stats.last_recovery_ns, 11'000'000);
+}
+
+}  // namespace
+}  // namespace tcc::aaos::can
@@ -0,0 +1,235 @@
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <string>
+
+#include "can_gateway.h"
+#include "can_log.h"
+#include "event_loop.h"
+#include "fake_property_sink.h"
+#include "message_decoder.h"
+#include "publisher.h"
+#include "vehicle_signals.h"
+
+namespace tcc::aaos::can {
+namespace {
+
+constexpr char ASCII_LOG[] =
+        "(1700000000.000100) can0 123#0064FF384000\n"
+        "(1700000000.000200) can0 124#0000C441\r\n"
+        "\n"
+        "(1700000000.5) vcan1 12345678#DE.AD.BE.EF\n"
+        "(1700000001.000000) can0 321#R\n"
+        "(1700000001.000001) can0 321#R4\n"
+        "(1700000001.000002) can0 20000004#0004000000000000\n"
+        "(1700000001.000003) can0 123##1112233\n"   // CAN FD, BRS
+        "(1700000001.000004) can0 125##0"
+        "000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F"
+        "202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F\n"
+        "(1700000001.000005) can0 123##01122334455667788990011\n" // 11 bytes: not an FD length
+        "garbage\n"
+        "(1700000001.000004) can0 123#123\n"        // Odd nibble count
+        "(1700000001.000005) can0 123#112233445566778899\n"
+        "(1700000001.000006) can0 123#1122334455667788_C";
+
+TEST(CanLogReaderTest, ParsesCandumpAscii) {
+    CanLogReader reader;
+    ASSERT_TRUE(reader.OpenBuffer(ASCII_LOG));
+    EXPECT_EQ(reader.Format(), CanLogFormat::ASCII);
+
+    CanRxFrame frames[16];
+    size_t count = reader.Read(frames, 16);
+    ASSERT_EQ(count, 9u);
+
+    EXPECT_EQ(frames[0].timestamp_ns, 1700000000'000100000);
+    EXPECT_EQ(frames[0].frame.can_id, 0x123u);
+    EXPECT_EQ(frames[0].frame.len, 6);
+    EXPECT_EQ(frames[0].frame.data[1], 0x64);
+
+    EXPECT_EQ(frames[1].frame.can_id, 0x124u);
+    EXPECT_EQ(frames[2].timestamp_ns, 1700000000'500000000);
+    EXPECT_EQ(frames[2].frame.can_id, 0x12345678u | CAN_EFF_FLAG);
+    EXPECT_EQ(frames[2].frame.len, 4);
+    EXPECT_EQ(frames[2].frame.data[3], 0xef);
+
+    EXPECT_EQ(frames[3].frame.can_id, 0x321u | CAN_RTR_FLAG);
+    EXPECT_EQ(frames[3].frame.len, 0);
+    EXPECT_EQ(frames[4].frame.len, 4);
+    EXPECT_EQ(frames[5].frame.can_id, 0x00000004u | CAN_ERR_FLAG);
+    EXPECT_EQ(frames[6].frame.can_id, 0x123u);
+    EXPECT_EQ(frames[6].frame.len, 3);
+    EXPECT_EQ(frames[6].frame.flags, CANFD_FDF | CANFD_BRS);
+    EXPECT_EQ(frames[6].frame.data[2], 0x33);
+    EXPECT_EQ(frames[7].frame.len, 64);
+    EXPECT_EQ(frames[7].frame.flags, CANFD_FDF);
+    EXPECT_EQ(frames[7].frame.data[63], 0x3f);
+    EXPECT_EQ(frames[8].frame.len, 8);
+
+    EXPECT_EQ(reader.Read(frames, 16), 0u);
+    CanLogStats stats = reader.Stats();
+    EXPECT_EQ(stats.frames, 9u);
+    EXPECT_EQ(stats.skipped, 4u);
+
+    reader.Rewind();
+    EXPECT_EQ(reader.Read(frames, 2), 2u);
+}
+
+TEST(CanLogReaderTest, BinaryRoundTrip) {
+    char path[] = "/tmp/can_log_testXXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    close(fd);
+
+    CanLogReader ascii;
+    ASSERT_TRUE(ascii.OpenBuffer(ASCII_LOG));
+    CanRxFrame expected[16];
+    size_t count = ascii.Read(expected, 16);
+
+    CanLogWriter writer;
+    ASSERT_TRUE(writer.Open(path));
+    for (size_t i = 0; i < count; i++) {
+        ASSERT_TRUE(writer.Write(expected[i]));
+    }
+    ASSERT_TRUE(writer.Close());
+
+    CanLogReader binary;
+    ASSERT_TRUE(binary.Open(std::string(path)));
+    EXPECT_EQ(binary.Format(), CanLogFormat::BINARY);
+    CanRxFrame actual[16];
+    ASSERT_EQ(binary.Read(actual, 16), count);
+    for (size_t i = 0; i < count; i++) {
+        EXPECT_EQ(actual[i].timestamp_ns, expected[i].timestamp_ns);
+        EXPECT_EQ(actual[i].frame.can_id, expected[i].frame.can_id);
+        EXPECT_EQ(actual[i].frame.len, expected[i].frame.len);
+        EXPECT_EQ(actual[i].frame.flags, expected[i].frame.flags);
+        EXPECT_EQ(std::memcmp(actual[i].frame.data, expected[i].frame.data, expected[i].frame.len), 0);
+    }
+    unlink(path);
+}
+
+TEST(CanLogReaderTest, ReadsVersion1BinaryLogs) {
+    // Header and one 24-byte classic record as the version 1 writer laid them out
+    std::string data(sizeof(BinaryLogHeader) + 24, '\0');
+    std::memcpy(data.data(), BinaryLogHeader::MAGIC, sizeof(BinaryLogHeader::MAGIC));
+    data[8] = 1;
+    data[12] = 24;
+    data[16] = 1;           // timestamp_ns
+    data[24] = 0x24;        // can_id 0x124
+    data[25] = 0x01;
+    data[28] = 4;           // len
+    data[32 + 3] = 0x41;    // 8.0f, little-endian
+    CanLogReader reader;
+    ASSERT_TRUE(reader.OpenBuffer(data));
+    CanRxFrame frame;
+    ASSERT_EQ(reader.Read(&frame, 1), 1u);
+    EXPECT_EQ(frame.timestamp_ns, 1);
+    EXPECT_EQ(frame.frame.can_id, 0x124u);
+    EXPECT_EQ(frame.frame.len, 4);
+    EXPECT_EQ(frame.frame.flags, 0);
+    EXPECT_EQ(frame.frame.data[3], 0x41);
+    EXPECT_EQ(reader.Read(&frame, 1), 0u);
+}
+
+TEST(CanLogReaderTest, RejectsUnknownBinaryVersion) {
+    std::string data(sizeof(BinaryLogHeader), '\0');
+    std::memcpy(data.data(), BinaryLogHeader::MAGIC, sizeof(BinaryLogHeader::MAGIC));
+    data[8] = 9;
+    CanLogReader reader;
+    EXPECT_FALSE(reader.OpenBuffer(data));
+}
+
+TEST(CanGatewayReplayTest, ReplaysEveryFrameThroughThePublisher) {
+    // Far more frames than the publisher queue holds: replay must wait, not drop
+    std::string log;
+    size_t const frame_count = Publisher::QUEUE_CAPACITY * 4;
+    for (size_t i = 0; i < frame_count; i++) {
+        char line[64];
+        std::snprintf(line, sizeof(line), "(1700000000.%06zu) can0 123#0000%04zX0001\n", i, i);
+        log += line;
+    }
+    log += "(1700000001.000000) can0 456#00\n";
+
+    FakePropertySink sink;
+    StaticDecoder<VehicleSignals> decoder;
+    Publisher publisher(sink, decoder.Messages(), decoder.MessageCount(), 0);
+    ASSERT_TRUE(publisher.Init());
+    publisher.Start();
+    EventLoop loop;
+    CanGateway gateway(loop, decoder, publisher);
+
+    CanLogReader reader;
+    ASSERT_TRUE(reader.OpenBuffer(log));
+    gateway.ReplayLog(reader, 0);
+    publisher.Stop();
+
+    GatewayStats gateway_stats = gateway.Stats();
+    EXPECT_EQ(gateway_stats.frames, frame_count + 1);
+    EXPECT_EQ(gateway_stats.decoded, frame_count);
+    PublisherStats publisher_stats = publisher.Stats();
+    EXPECT_EQ(publisher_stats.enqueued, frame_count);
+    EXPECT_EQ(publisher_stats.dropped, 0u);
+
+    // The last frame is always published: nothing after it supersedes it
+    auto values = sink.Published(INFO_ACCELEROMETER_MPU6050);
+    ASSERT_FALSE(values.empty());
+    EXPECT_EQ(values.back().int32_values,
+              (std::vector<int32_t>{0, static_cast<int32_t>(frame_count - 1), 1}));
+}
+
+TEST(CanGatewayReplayTest, PublishesEverySampleOfAnFdFrame) {
+    // One 0x125 burst: reading k is (k, 2k, 3k)
+    std::string log = "(1700000000.000000) can0 125##1";
+    for (int k = 0; k < 10; k++) {
+        char sample[16];
+        std::snprintf(sample, sizeof(sample), "%04X%04X%04X", k, 2 * k, 3 * k);
+        log += sample;
+    }
+    log += "00000000\n";
+
+    FakePropertySink sink;
+    StaticDecoder<VehicleSignals> decoder;
+    Publisher publisher(sink, decoder.Messages(), decoder.MessageCount(), 0);
+    ASSERT_TRUE(publisher.Init());
+    publisher.Start();
+    EventLoop loop;
+    CanGateway gateway(loop, decoder, publisher);
+
+    CanLogReader reader;
+    ASSERT_TRUE(reader.OpenBuffer(log));
+    gateway.ReplayLog(reader, 0);
+    publisher.Stop();
+
+    EXPECT_EQ(gateway.Stats().decoded, 1u);
+    EXPECT_EQ(publisher.Stats().enqueued, 10u);
+    auto values = sink.Published(INFO_ACCELEROMETER_MPU6050);
+    ASSERT_FALSE(values.empty());
+    EXPECT_EQ(values.back().int32_values, (std::vector<int32_t>{9, 18, 27}));
+}
+
+TEST(CanGatewayReplayTest, KeepsRecordedTiming) {
+    CanLogReader reader;
+    ASSERT_TRUE(reader.OpenBuffer("(10.000000) can0 124#00000000\n"
+                                  "(10.050000) can0 124#0000803F\n"
+                                  "(10.100000) can0 124#00000040\n"));
+    FakePropertySink sink;
+    StaticDecoder<VehicleSignals> decoder;
+    Publisher publisher(sink, decoder.Messages(), decoder.MessageCount(), 0);
+    ASSERT_TRUE(publisher.Init());
+    publisher.Start();
+    EventLoop loop;
+    CanGateway gateway(loop, decoder, publisher);
+
+    auto start = std::chrono::steady_clock::now();
+    gateway.ReplayLog(reader, 1.0);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    publisher.Stop();
+    EXPECT_GE(elapsed, std::chrono::milliseconds(100));
+    EXPECT_LT(elapsed, std::chrono::milliseconds(1000));
+    EXPECT_EQ(gateway.Stats().decoded, 3u);
+}
+
+}  // namespace
+}  // namespace tcc::aaos::can
@@ -0,0 +1,255 @@
+#include <gtest/gtest.h>
+
+#include <net/if.h>
+
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "can_transmitter.h"
+#include "command_encoder.h"
+#include "dbc_parser.h"
+#include "event_loop.h"
+#include "signal_database.h"
+#include "vehicle_signals.h"
+
+namespace tcc::aaos::can {
+namespace {
+
+constexpr char INTERFACE[] = "vcan0";
+
+canfd_frame Frame(canid_t can_id, uint8_t first_byte = 0) {
+    canfd_frame frame = {};
+    frame.can_id = can_id;
+    frame.len = 1;
+    frame.data[0] = first_byte;
+    return frame;
+}
+
+std::vector<canid_t> FrontIds(TxQueue const& queue, int64_t now_ns) {
+    std::vector<canfd_frame> frames(MAX_TX_BATCH);
+    frames.resize(queue.Front(now_ns, frames.data(), frames.size()));
+    std::vector<canid_t> ids;
+    for (canfd_frame const& frame : frames) {
+        ids.push_back(frame.can_id);
+    }
+    return ids;
+}
+
+TEST(CommandEncoderTest, EncodesTheCommandTable) {
+    CommandEncoder encoder(VehicleCommands::MESSAGES_INFO, VehicleCommands::MESSAGE_COUNT);
+    EXPECT_EQ(encoder.PropIds(), (std::vector<int32_t>{CONTROL_SELF_TEST, CONTROL_SAMPLE_RATE_MPU6050}));
+
+    canfd_frame frame;
+    double rate = 400;
+    ASSERT_TRUE(encoder.Encode(CONTROL_SAMPLE_RATE_MPU6050, &rate, 1, frame));
+    EXPECT_EQ(frame.can_id, 0x101u);
+    EXPECT_EQ(frame.len, 2);
+    EXPECT_EQ(frame.flags, 0);
+    EXPECT_EQ(frame.data[0], 0x01);
+    EXPECT_EQ(frame.data[1], 0x90);
+
+    // Saturated to the signal's range rather than wrapped
+    double mask = 0x1FF;
+    ASSERT_TRUE(encoder.Encode(CONTROL_SELF_TEST, &mask, 1, frame));
+    EXPECT_EQ(frame.data[0], 0xFF);
+
+    double two[] = {1, 2};
+    EXPECT_FALSE(encoder.Encode(CONTROL_SELF_TEST, two, 2, frame));
+    EXPECT_FALSE(encoder.Encode(INFO_TEMPERATURE_DHT22, &rate, 1, frame));
+    double nan = NAN;
+    EXPECT_FALSE(encoder.Encode(CONTROL_SAMPLE_RATE_MPU6050, &nan, 1, frame));
+}
+
+TEST(CommandEncoderTest, RoundTripsThroughTheDecoder) {
+    // Bit fields in both byte orders, signed and scaled values, floats
+    constexpr char DBC[] =
+            "BO_ 512 Command: 12 X\n"
+            " SG_ Mode : 0|3@1+ (1,0) [0|0] \"\" X\n"
+            " SG_ Level : 3|12@1- (0.5,-10) [0|0] \"\" X\n"
+            " SG_ Target : 23|16@0- (0.01,0) [0|0] \"\" X\n"
+            " SG_ Flag : 39|1@0+ (1,0) [0|0] \"\" X\n"
+            " SG_ Gain : 64|32@1- (1,0) [0|0] \"\" X\n"
+            "SIG_VALTYPE_ 512 Gain : 1;\n"
+            "BA_ \"VhalProperty\" SG_ 512 Mode 291504647;\n"
+            "BA_ \"VhalProperty\" SG_ 512 Level 291504648;\n"
+            "BA_ \"VhalProperty\" SG_ 512 Target 291504649;\n"
+            "BA_ \"VhalProperty\" SG_ 512 Flag 291504650;\n"
+            "BA_ \"VhalProperty\" SG_ 512 Gain 291504651;\n";
+    DbcFile file;
+    ASSERT_TRUE(ParseDbc(DBC, file));
+    SignalDatabase database;
+    ASSERT_TRUE(database.Build(file));
+    ASSERT_EQ(database.MessageCount(), 1u);
+    MessageInfo const& info = database.Messages()[0];
+    ASSERT_EQ(info.signal_count, 5u);
+
+    double values[] = {5, -1000.5, -123.45, 1, 0.15625};
+    canfd_frame frame;
+    ASSERT_TRUE(EncodeMessage(info, values, 5, frame));
+    EXPECT_EQ(frame.len, 12);
+    EXPECT_EQ(frame.flags, CANFD_FDF);
+    DecodedSamples decoded;
+    ASSERT_EQ(database.Decode(frame, decoded), 1u);
+    for (size_t i = 0; i < 5; i++) {
+        EXPECT_DOUBLE_EQ(decoded[0].values[i], values[i]) << info.signals[i].name;
+    }
+
+    // Out of range: clamped to the raw limits
+    double limits[] = {9, 5000, -1e9, 0, 0};
+    ASSERT_TRUE(EncodeMessage(info, limits, 5, frame));
+    ASSERT_EQ(database.Decode(frame, decoded), 1u);
+    EXPECT_EQ(decoded[0].values[0], 7);
+    EXPECT_EQ(decoded[0].values[1], 2047 * 0.5 - 10);
+    EXPECT_DOUBLE_EQ(decoded[0].values[2], -327.68);
+}
+
+TEST(CommandEncoderTest, KeepsTheOtherPropertiesOfAMessage) {
+    constexpr static SignalDef SIGNALS[] = {
+        {"A", 0, 8, ByteOrder::LITTLE_ENDIAN_ORDER, ValueType::UNSIGNED, 1.0, 0.0},
+        {"B", 8, 8, ByteOrder::LITTLE_ENDIAN_ORDER, ValueType::UNSIGNED, 1.0, 0.0},
+    };
+    constexpr static PropertyMapping PROPERTIES[] = {{1, 0, 1}, {2, 1, 1}};
+    MessageInfo info = {0x200, 2, SIGNALS, 2, PROPERTIES, 2, nullptr, 1, 0, 0};
+    CommandEncoder encoder(&info, 1);
+    canfd_frame frame;
+    double a = 7;
+    double b = 9;
+    ASSERT_TRUE(encoder.Encode(1, &a, 1, frame));
+    ASSERT_TRUE(encoder.Encode(2, &b, 1, frame));
+    EXPECT_EQ(frame.data[0], 7);
+    EXPECT_EQ(frame.data[1], 9);
+}
+
+TEST(TxQueueTest, SendsInArbitrationOrder) {
+    EXPECT_LT(ArbitrationKey(0x100), ArbitrationKey(0x101));
+    // Same base bits: standard before extended
+    EXPECT_LT(ArbitrationKey(0x100), ArbitrationKey(CAN_EFF_FLAG | (0x100 << 18)));
+    EXPECT_LT(ArbitrationKey(CAN_EFF_FLAG | (0x100 << 18) | 0x3FFFF), ArbitrationKey(0x101));
+
+    TxQueue queue({64, 0, 1});
+    for (canid_t id : {canid_t{0x300}, canid_t{0x101}, CAN_EFF_FLAG | 1, canid_t{0x100}}) {
+        ASSERT_TRUE(queue.Push(Frame(id)));
+    }
+    EXPECT_EQ(FrontIds(queue, 0), (std::vector<canid_t>{CAN_EFF_FLAG | 1, 0x100, 0x101, 0x300}));
+    queue.Consume(2, 0);
+    EXPECT_EQ(FrontIds(queue, 0), (std::vector<canid_t>{0x101, 0x300}));
+    EXPECT_EQ(queue.Stats().sent, 2u);
+}
+
+TEST(TxQueueTest, NewerFrameReplacesAWaitingOne) {
+    TxQueue queue({2, 0, 1});
+    ASSERT_TRUE(queue.Push(Frame(0x101, 1)));
+    ASSERT_TRUE(queue.Push(Frame(0x300)));
+    EXPECT_FALSE(queue.Push(Frame(0x200)));
+    // Full, but 0x101 is already waiting
+    ASSERT_TRUE(queue.Push(Frame(0x101, 2)));
+    canfd_frame front[2];
+    ASSERT_EQ(queue.Front(0, front, 2), 2u);
+    EXPECT_EQ(front[0].data[0], 2);
+
+    TxStats stats = queue.Stats();
+    EXPECT_EQ(stats.queued, 3u);
+    EXPECT_EQ(stats.replaced, 1u);
+    EXPECT_EQ(stats.dropped, 1u);
+    EXPECT_EQ(stats.depth, 2u);
+}
+
+TEST(TxQueueTest, RestoresUnsentFramesUnlessSuperseded) {
+    TxQueue queue({64, 0, 1});
+    for (canid_t id : {canid_t{0x100}, canid_t{0x101}, canid_t{0x102}}) {
+        ASSERT_TRUE(queue.Push(Frame(id, 1)));
+    }
+    canfd_frame batch[MAX_TX_BATCH];
+    ASSERT_EQ(queue.Pop(0, batch, MAX_TX_BATCH), 3u);
+    EXPECT_EQ(queue.Depth(), 0u);
+
+    // While the batch is out: a newer 0x102 and a higher-priority 0x050
+    ASSERT_TRUE(queue.Push(Frame(0x102, 2)));
+    ASSERT_TRUE(queue.Push(Frame(0x050)));
+    // Only 0x100 went out
+    queue.Sent(1, 0);
+    queue.Restore(batch + 1, 2);
+
+    EXPECT_EQ(FrontIds(queue, 0), (std::vector<canid_t>{0x050, 0x101, 0x102}));
+    canfd_frame front[3];
+    ASSERT_EQ(queue.Front(0, front, 3), 3u);
+    EXPECT_EQ(front[2].data[0], 2);
+    TxStats stats = queue.Stats();
+    EXPECT_EQ(stats.sent, 1u);
+    EXPECT_EQ(stats.replaced, 1u);
+}
+
+TEST(TxQueueTest, PacesBurstsOfCommands) {
+    constexpr int64_t GAP = 1'000'000;
+    TxQueue queue({64, GAP, 4});
+    EXPECT_EQ(queue.NextDueNs(0), -1);
+    for (canid_t id = 0x100; id < 0x10A; id++) {
+        ASSERT_TRUE(queue.Push(Frame(id)));
+    }
+    int64_t now = 5 * GAP;
+    EXPECT_EQ(FrontIds(queue, now).size(), 4u);
+    queue.Consume(4, now);
+    EXPECT_TRUE(FrontIds(queue, now).empty());
+    EXPECT_EQ(queue.NextDueNs(now), now + GAP);
+    EXPECT_EQ(FrontIds(queue, now + GAP - 1).size(), 0u);
+    EXPECT_EQ(FrontIds(queue, now + GAP), (std::vector<canid_t>{0x104}));
+    // An idle bucket refills up to the burst, no further
+    EXPECT_EQ(FrontIds(queue, now + 100 * GAP).size(), 4u);
+}
+
+TEST(TxQueueTest, ParsesPacingOption) {
+    std::string interface;
+    TxConfig config;
+    ASSERT_TRUE(ParseTxOption("can0", interface, config));
+    EXPECT_EQ(interface, "can0");
+    EXPECT_EQ(config.frame_gap_ns, TxConfig{}.frame_gap_ns);
+    ASSERT_TRUE(ParseTxOption("can1:250:8", interface, config));
+    EXPECT_EQ(interface, "can1");
+    EXPECT_EQ(config.frame_gap_ns, 250'000);
+    EXPECT_EQ(config.burst, 8u);
+    ASSERT_TRUE(ParseTxOption("can1:0", interface, config));
+    EXPECT_EQ(config.frame_gap_ns, 0);
+
+    EXPECT_FALSE(ParseTxOption("", interface, config));
+    EXPECT_FALSE(ParseTxOption(":100", interface, config));
+    EXPECT_FALSE(ParseTxOption("can0:x", interface, config));
+    EXPECT_FALSE(ParseTxOption("can0:100:0", interface, config));
+}
+
+// Needs vcan0, like vcan_integration_test.cpp
+TEST(CanTransmitterTest, SendsPacedFramesOnTheBus) {
+    if (if_nametoindex(INTERFACE) == 0) {
+        GTEST_SKIP() << INTERFACE << " is not available";
+    }
+    SocketCan receiver(INTERFACE);
+    ASSERT_TRUE(receiver.Init());
+    ASSERT_TRUE(receiver.SetNonBlocking(true));
+
+    EventLoop loop;
+    ASSERT_TRUE(loop.Init());
+    CanTransmitter transmitter(loop, INTERFACE, {64, 1'000'000, 2});
+    ASSERT_TRUE(transmitter.Init());
+    for (canid_t id : {canid_t{0x103}, canid_t{0x102}, canid_t{0x101}}) {
+        ASSERT_TRUE(transmitter.Send(Frame(id)));
+    }
+    std::vector<canid_t> received;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (received.size() < 3 && std::chrono::steady_clock::now() < deadline) {
+        loop.RunOnce(10);
+        CanRxFrame frames[MAX_RX_BATCH];
+        int count = receiver.ReadCanMessages(frames, MAX_RX_BATCH);
+        for (int i = 0; i < count; i++) {
+            received.push_back(frames[i].frame.can_id);
+        }
+    }
+    EXPECT_EQ(received, (std::vector<canid_t>{0x101, 0x102, 0x103}));
+    TxStats stats = transmitter.Stats();
+    EXPECT_EQ(stats.sent, 3u);
+    EXPECT_EQ(stats.depth, 0u);
+    // The third frame had to wait for the pacing
+    EXPECT_GE(stats.paced, 1u);
+}
+
+}  // namespace
+}  // namespace tcc::aaos::can
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "property_sink.h"
+
+namespace tcc::aaos::can {
+
+// PropertySink that records every flushed value. The publisher calls it from
+// its own thread; tests wait on it with WaitFor().
+class FakePropertySink : public PropertySink {
+public:
+    struct Value {
+        int32_t prop_id;
+        std::vector<int32_t> int32_values;
+        std::vector<float> float_values;
+        std::string string_value;
+    };
+
+    // Max sample rate reported for prop_id; unlisted properties are unlimited
+    void SetMaxSampleRate(int32_t prop_id, float rate_hz) { rates_[prop_id] = rate_hz; }
+
+    std::vector<float> MaxSampleRates(std::vector<int32_t> const& prop_ids) override {
+        queried_ = prop_ids;
+        std::vector<float> rates;
+        for (int32_t prop_id : prop_ids) {
+            auto it = rates_.find(prop_id);
+            rates.push_back(it == rates_.end() ? 0.0f : it->second);
+        }
+        return rates;
+    }
+
+    void Add(PropertyValue const& value) override {
+        Value copy{value.prop_id, {}, {}, std::string(value.string_value)};
+        copy.int32_values.assign(value.int32_values.begin(), value.int32_values.begin() + value.count);
+        copy.float_values.assign(value.float_values.begin(), value.float_values.begin() + value.count);
+        pending_.push_back(std::move(copy));
+    }
+
+    size_t Pending() const override { return pending_.size(); }
+
+    bool Flush() override {
+        if (pending_.empty()) {
+            return true;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.transactions++;
+        stats_.values += pending_.size();
+        published_.insert(published_.end(), pending_.begin(), pending_.end());
+        pending_.clear();
+        changed_.notify_all();
+        return true;
+    }
+
+    SinkStats Stats() const override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    bool Connected() const override { return connected_; }
+    void SetReconnectCallback(std::function<void()> callback) override { reconnect_ = std::move(callback); }
+    bool Reconnect() override {
+        if (!available_) {
+            return false;
+        }
+        pending_.clear();
+        connected_ = true;
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.reconnects++;
+        return true;
+    }
+
+    // Simulates the receiver dying...
+    void Disconnect() {
+        available_ = false;
+        connected_ = false;
+    }
+    // ...and a new one being registered
+    void Restart() {
+        available_ = true;
+        reconnect_();
+    }
+
+    // Properties passed to the last MaxSampleRates() call
+    std::vector<int32_t> const& Queried() const { return queried_; }
+
+    // Every value of prop_id published so far
+    std::vector<Value> Published(int32_t prop_id) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<Value> values;
+        for (Value const& value : published_) {
+            if (value.prop_id == prop_id) {
+                values.push_back(value);
+            }
+        }
+        return values;
+    }
+
+    // Waits until prop_id has been published at least count times
+    bool WaitFor(int32_t prop_id, size_t count,
+                 std::chrono::milliseconds timeout = std::chrono::milliseconds(2000)) const {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return changed_.wait_for(lock, timeout, [&] {
+            size_t seen = 0;
+            for (Value const& value : published_) {
+                seen += value.prop_id == prop_id;
+            }
+            return seen >= count;
+        });
+    }
+
+private:
+    std::unordered_map<int32_t, float> rates_;
+    std::vector<int32_t> queried_;
+    std::vector<Value> pending_; // Publisher thread only
+    std::function<void()> reconnect_;
+    std::atomic<bool> connected_{true};
+    std::atomic<bool> available_{true};
+
+    mutable std::mutex mutex_;
+    mutable std::condition_variable changed_;
+    std::vector<Value> published_;
+    SinkStats stats_ = {};
+};
+
+}  // namespace tcc::aaos::can
@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "fusion.h"
+
+namespace tcc::aaos::can {
+namespace {
+
+constexpr int32_t VECTOR_PROP = 0x21411002;
+constexpr int32_t SCALAR_PROP = 0x21601000;
+constexpr int64_t MS = 1'000'000;
+constexpr int64_t BASE_NS = 1'000 * MS;
+
+constexpr PropertyMapping VECTOR_PROPERTIES[] = {{VECTOR_PROP, 0, 2}};
+constexpr PropertyMapping SCALAR_PROPERTIES[] = {{SCALAR_PROP, 0, 1}};
+constexpr FaultCode SCALAR_FAULT = {0x21101001, "OK", "ERR", -273};
+constexpr MessageInfo MESSAGES[] = {
+    {0x123, 8, nullptr, 2, VECTOR_PROPERTIES, 1, nullptr, 1, 8, 0},
+    {0x124, 8, nullptr, 1, SCALAR_PROPERTIES, 1, &SCALAR_FAULT, 1, 8, 0},
+};
+
+DecodedFrame Frame(uint16_t message, int64_t rx_ns, double first, double second = 0) {
+    DecodedFrame frame = {};
+    frame.can_id = MESSAGES[message].can_id;
+    frame.message = message;
+    frame.count = static_cast<uint8_t>(MESSAGES[message].signal_count);
+    frame.rx_ns = rx_ns;
+    frame.values[0] = first;
+    frame.values[1] = second;
+    return frame;
+}
+
+FusionConfig Config(FusionInterpolation interpolation) {
+    FusionConfig config;
+    config.inputs = {{VECTOR_PROP, 1, 10 * MS}, {SCALAR_PROP, 0, 10 * MS}};
+    config.period_ns = 10 * MS;
+    config.delay_ns = 20 * MS;
+    config.interpolation = interpolation;
+    return config;
+}
+
+// Samples first to last of a vector stream every 10 ms from BASE_NS
+// (element 1 = ms offset) and a scalar stream every 10 ms from BASE_NS + 5 ms
+// (100, 200, ...)
+void Feed(FusionStage &stage, int first, int last) {
+    for (int i = first; i <= last; i++) {
+        stage.Add(Frame(0, BASE_NS + i * 10 * MS, -1, i * 10.0));
+        stage.Add(Frame(1, BASE_NS + i * 10 * MS + 5 * MS, (i + 1) * 100.0));
+    }
+}
+
+TEST(FusionTest, AlignsStreamsOnTheGrid) {
+    FusionStage stage(Config(FusionInterpolation::LINEAR), MESSAGES, 2);
+    FusionSnapshot snapshot;
+    EXPECT_FALSE(stage.Latest(snapshot));
+
+    // Newest sample at BASE + 35 ms: only the grid point at 10 ms is due
+    Feed(stage, 0, 3);
+    ASSERT_TRUE(stage.Latest(snapshot));
+    EXPECT_EQ(snapshot.sequence, 1u);
+    EXPECT_EQ(snapshot.timestamp_ns, BASE_NS + 10 * MS);
+    ASSERT_EQ(snapshot.count, 2u);
+    EXPECT_EQ(snapshot.valid_mask, 0b11u);
+    EXPECT_DOUBLE_EQ(snapshot.values[0], 10.0);
+    EXPECT_DOUBLE_EQ(snapshot.values[1], 150.0); // Between 100 at 5 ms and 200 at 15 ms
+
+    Feed(stage, 4, 5);
+    ASSERT_TRUE(stage.Latest(snapshot));
+    EXPECT_EQ(snapshot.timestamp_ns, BASE_NS + 30 * MS);
+    EXPECT_EQ(stage.Stats().snapshots, 3u);
+    EXPECT_EQ(snapshot.sequence, 3u);
+    EXPECT_EQ(stage.Stats().late, 0u);
+}
+
+TEST(FusionTest, HoldAndNearestUseOneSample) {
+    FusionStage hold(Config(FusionInterpolation::HOLD), MESSAGES, 2);
+    FusionStage nearest(Config(FusionInterpolation::NEAREST), MESSAGES, 2);
+    Feed(hold, 0, 3);
+    Feed(nearest, 0, 3);
+    FusionSnapshot snapshot;
+    ASSERT_TRUE(hold.Latest(snapshot));
+    EXPECT_DOUBLE_EQ(snapshot.values[1], 100.0);
+    ASSERT_TRUE(nearest.Latest(snapshot));
+    EXPECT_DOUBLE_EQ(snapshot.values[1], 100.0); // 5 ms on either side: the earlier one
+}
+
+TEST(FusionTest, InputOutsideItsWindowIsInvalid) {
+    FusionStage stage(Config(FusionInterpolation::LINEAR), MESSAGES, 2);
+    stage.Add(Frame(1, BASE_NS, 100.0));
+    for (int i = 0; i < 6; i++) {
+        stage.Add(Frame(0, BASE_NS + i * 10 * MS, -1, i * 10.0));
+    }
+    FusionSnapshot snapshot;
+    ASSERT_TRUE(stage.Latest(snapshot));
+    EXPECT_EQ(snapshot.timestamp_ns, BASE_NS + 30 * MS);
+    EXPECT_TRUE(snapshot.Valid(0));
+    EXPECT_FALSE(snapshot.Valid(1)); // Last scalar sample 30 ms before
+    EXPECT_EQ(snapshot.values[1], 0.0);
+}
+
+TEST(FusionTest, IgnoresLateSamplesAndFaults) {
+    FusionStage stage(Config(FusionInterpolation::HOLD), MESSAGES, 2);
+    stage.Add(Frame(1, BASE_NS + 5 * MS, 100.0));
+    stage.Add(Frame(1, BASE_NS, 50.0));          // Older than the stream's newest
+    stage.Add(Frame(1, BASE_NS + 8 * MS, -300)); // Fault reading
+    for (int i = 0; i < 4; i++) {
+        stage.Add(Frame(0, BASE_NS + i * 10 * MS, -1, i * 10.0));
+    }
+    FusionSnapshot snapshot;
+    ASSERT_TRUE(stage.Latest(snapshot));
+    EXPECT_DOUBLE_EQ(snapshot.values[1], 100.0);
+    EXPECT_EQ(stage.Stats().late, 1u);
+    EXPECT_EQ(stage.Stats().samples, 5u);
+}
+
+TEST(FusionTest, SkipsGridPointsAfterAGap) {
+    FusionStage stage(Config(FusionInterpolation::HOLD), MESSAGES, 2);
+    stage.Add(Frame(0, BASE_NS, -1, 0));
+    stage.Add(Frame(0, BASE_NS + 10'000 * MS, -1, 1));
+    FusionStats stats = stage.Stats();
+    EXPECT_GT(stats.skipped, 0u);
+    EXPECT_LT(stats.snapshots, 100u);
+    FusionSnapshot snapshot;
+    ASSERT_TRUE(stage.Latest(snapshot));
+    EXPECT_EQ(snapshot.timestamp_ns, BASE_NS + 9'980 * MS);
+}
+
+TEST(FusionTest, WaitNextReturnsANewerSnapshot) {
+    FusionStage stage(Config(FusionInterpolation::LINEAR), MESSAGES, 2);
+    FusionSnapshot snapshot;
+    EXPECT_FALSE(stage.WaitNext(0, std::chrono::milliseconds(1), snapshot));
+
+    std::thread producer([&stage] { Feed(stage, 0, 3); });
+    ASSERT_TRUE(stage.WaitNext(0, std::chrono::milliseconds(5000), snapshot));
+    producer.join();
+    EXPECT_GE(snapshot.sequence, 1u);
+    EXPECT_EQ(snapshot.count, 2u);
+}
+
+TEST(FusionTest, ParsesOption) {
+    FusionConfig config;
+    ASSERT_TRUE(ParseFusionOption("5", config));
+    EXPECT_EQ(config.period_ns, 5 * MS);
+    EXPECT_EQ(config.interpolation, FusionInterpolation::LINEAR);
+    ASSERT_TRUE(ParseFusionOption("2.5:hold", config));
+    EXPECT_EQ(config.period_ns, 2'500'000);
+    EXPECT_EQ(config.interpolation, FusionInterpolation::HOLD);
+    ASSERT_TRUE(ParseFusionOption("20:nearest", config));
+    EXPECT_EQ(config.interpolation, FusionInterpolation::NEAREST);
+
+    EXPECT_FALSE(ParseFusionOption("", config));
+    EXPECT_FALSE(ParseFusionOption("0", config));
+    EXPECT_FALSE(ParseFusionOption("10:cubic", config));
+    EXPECT_FALSE(ParseFusionOption("10ms", config));
+    EXPECT_FALSE(ParseFusionOption("10linear", config));
+    // Would be a 0 ns grid
+    EXPECT_FALSE(ParseFusionOption("0.0000001", config));
+    EXPECT_FALSE(ParseFusionOption("nan", config));
+    EXPECT_FALSE(ParseFusionOption("inf", config));
+}
+
+}  // namespace
+}  // namespace tcc::aaos::can
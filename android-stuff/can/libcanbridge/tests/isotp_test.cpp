@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include <set>
+
+#include "buffer_pool.h"
+#include "can_gateway.h"
+#include "dbc_parser.h"
+#include "event_loop.h"
+#include "fake_property_sink.h"
+#include "isotp_socket.h"
+#include "publisher.h"
+#include "signal_database.h"
+
+namespace tcc::aaos::can {
+namespace {
+
+TEST(IsoTpTest, EncodesStMin) {
+    EXPECT_EQ(EncodeStMin(0), 0x00);
+    EXPECT_EQ(EncodeStMin(100), 0xF1);
+    EXPECT_EQ(EncodeStMin(150), 0xF2); // Never shorter than asked
+    EXPECT_EQ(EncodeStMin(900), 0xF9);
+    EXPECT_EQ(EncodeStMin(901), 0x01); // 0xFA-0xFF are reserved
+    EXPECT_EQ(EncodeStMin(1000), 0x01);
+    EXPECT_EQ(EncodeStMin(2500), 0x03);
+    EXPECT_EQ(EncodeStMin(500'000), 0x7F);
+}
+
+TEST(IsoTpTest, ParsesChannelOption) {
+    std::string interface;
+    IsoTpConfig config;
+    ASSERT_TRUE(ParseIsoTpOption("can0:700:701:123", interface, config));
+    EXPECT_EQ(interface, "can0");
+    EXPECT_EQ(config.rx_id, 0x700u);
+    EXPECT_EQ(config.tx_id, 0x701u);
+    EXPECT_EQ(config.message_id, 0x123u);
+    EXPECT_EQ(config.block_size, 0);
+    EXPECT_FALSE(config.fd);
+
+    ASSERT_TRUE(ParseIsoTpOption("can1:18DA10F1:18DAF110:125:8:200:fd", interface, config));
+    EXPECT_EQ(config.rx_id, 0x18DA10F1u | CAN_EFF_FLAG);
+    EXPECT_EQ(config.tx_id, 0x18DAF110u | CAN_EFF_FLAG);
+    EXPECT_EQ(config.block_size, 8);
+    EXPECT_EQ(config.stmin_us, 200u);
+    EXPECT_TRUE(config.fd);
+
+    EXPECT_FALSE(ParseIsoTpOption("can0:700:701", interface, config));
+    EXPECT_FALSE(ParseIsoTpOption("can0:700:701:123:256", interface, config));
+    EXPECT_FALSE(ParseIsoTpOption("can0:7zz:701:123", interface, config));
+    EXPECT_FALSE(ParseIsoTpOption("can0:700:701:123:0:0:xl", interface, config));
+}
+
+TEST(IsoTpTest, ExtendedMessageIdMatchesTheDecoder) {
+    // DBC extended messages keep CAN_EFF_FLAG, as does the parsed message_id
+    constexpr char DBC[] =
+            "BO_ 2566848528 Records: 8 X\n"
+            " SG_ Level : 0|16@1+ (1,0) [0|0] \"\" X\n"
+            "BA_ \"VhalProperty\" SG_ 2566848528 Level 291504647;\n";
+    DbcFile file;
+    ASSERT_TRUE(ParseDbc(DBC, file));
+    SignalDatabase database;
+    ASSERT_TRUE(database.Build(file));
+
+    std::string interface;
+    IsoTpConfig config;
+    ASSERT_TRUE(ParseIsoTpOption("can0:18DA10F1:18DAF110:18FF0010", interface, config));
+    EXPECT_EQ(config.message_id, 0x18FF0010u | CAN_EFF_FLAG);
+
+    FakePropertySink sink;
+    Publisher publisher(sink, database.Messages(), database.MessageCount(), 0);
+    EventLoop loop;
+    CanGateway gateway(loop, database, publisher);
+    EXPECT_EQ(gateway.MessageIndexOf(config.message_id), 0);
+    EXPECT_EQ(gateway.MessageIndexOf(0x18FF0010), -1);
+}
+
+TEST(IsoTpTest, RejectsMessagesWithoutPayload) {
+    // Fault-only message: kept by the database, but a PDU cannot be split
+    // into zero-byte records
+    constexpr char DBC[] =
+            "BO_ 512 Status: 0 X\n"
+            "BA_ \"VhalFaultProperty\" BO_ 512 289410580;\n"
+            "BA_ \"VhalOkCode\" BO_ 512 \"OK\";\n"
+            "BA_ \"VhalFaultCode\" BO_ 512 \"E1\";\n";
+    DbcFile file;
+    ASSERT_TRUE(ParseDbc(DBC, file));
+    SignalDatabase database;
+    ASSERT_TRUE(database.Build(file));
+    ASSERT_EQ(database.MessageCount(), 1u);
+    ASSERT_EQ(database.Messages()[0].dlc, 0);
+
+    FakePropertySink sink;
+    Publisher publisher(sink, database.Messages(), database.MessageCount(), 0);
+    EventLoop loop;
+    CanGateway gateway(loop, database, publisher);
+    IsoTpConfig config;
+    config.rx_id = 0x700;
+    config.tx_id = 0x701;
+    config.message_id = 0x200;
+    ASSERT_EQ(gateway.MessageIndexOf(config.message_id), 0);
+    EXPECT_FALSE(gateway.AddIsoTp("lo", config));
+}
+
+TEST(BufferPoolTest, HandsOutDistinctBuffersUntilExhausted) {
+    BufferPool pool(64, 3);
+    std::set<uint8_t *> buffers;
+    for (int i = 0; i < 3; i++) {
+        uint8_t *buffer = pool.Acquire();
+        ASSERT_NE(buffer, nullptr);
+        buffers.insert(buffer);
+    }
+    EXPECT_EQ(buffers.size(), 3u);
+    EXPECT_EQ(pool.Acquire(), nullptr);
+    EXPECT_EQ(pool.Exhausted(), 1u);
+
+    pool.Release(*buffers.begin());
+    EXPECT_EQ(pool.Available(), 1u);
+    EXPECT_EQ(pool.Acquire(), *buffers.begin());
+}
+
+}  // namespace
+}  // namespace tcc::aaos::can
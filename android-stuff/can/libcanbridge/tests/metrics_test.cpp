@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <string>
+
+#include "can_gateway.h"
+#include "can_log.h"
+#include "event_loop.h"
+#include "fake_property_sink.h"
+#include "message_decoder.h"
+#include "metrics.h"
+#include "publisher.h"
+#include "vehicle_signals.h"
+
+namespace tcc::aaos::can {
+namespace {
+
+constexpr char LOG[] =
+        "(1700000000.000100) can0 123#0064FF384000\n"
+        "(1700000000.000200) can0 123#0065FF384000\n"
+        "(1700000000.000300) can0 123#00\n"  // Shorter than the DLC
+        "(1700000000.000400) can0 456#00\n"; // Not in the set
+
+class MetricsTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_TRUE(publisher_.Init());
+        publisher_.Start();
+        CanLogReader reader;
+        ASSERT_TRUE(reader.OpenBuffer(LOG));
+        gateway_.ReplayLog(reader, 0);
+        publisher_.Stop();
+    }
+
+    FakePropertySink sink_;
+    StaticDecoder<VehicleSignals> decoder_;
+    Publisher publisher_{sink_, decoder_.Messages(), decoder_.MessageCount(), 0};
+    EventLoop loop_;
+    CanGateway gateway_{loop_, decoder_, publisher_};
+};
+
+TEST_F(MetricsTest, CountsFramesAndDecodeFailuresPerCanId) {
+    MetricsSnapshot snapshot = CollectMetrics({&gateway_, &publisher_, &sink_});
+    EXPECT_EQ(snapshot.rx.frames, 4u);
+    EXPECT_EQ(snapshot.rx.decoded, 2u);
+    EXPECT_EQ(snapshot.rx.decode_failures, 2u);
+    EXPECT_EQ(snapshot.queue.enqueued, 2u);
+    EXPECT_EQ(snapshot.queue_capacity, Publisher::QUEUE_CAPACITY);
+
+    ASSERT_EQ(snapshot.can_ids.size(), decoder_.MessageCount());
+    for (CanIdMetrics const& id : snapshot.can_ids) {
+        if (id.can_id == 0x123) {
+            EXPECT_EQ(id.frames, 3u);
+            EXPECT_EQ(id.decode_failures, 1u);
+        } else {
+            EXPECT_EQ(id.frames, 0u);
+        }
+    }
+}
+
+TEST_F(MetricsTest, ServesDumpAndMetricsOverUnixSocket) {
+    std::string path = "/tmp/canbridge-metrics-" + std::to_string(getpid()) + ".sock";
+    MetricsServer server(path, {&gateway_, &publisher_, &sink_});
+    ASSERT_TRUE(server.Init());
+    server.Start();
+
+    std::string reply;
+    ASSERT_TRUE(QueryMetrics(path, "metrics", reply));
+    EXPECT_NE(reply.find("can2vhal_rx_frames_total 4\n"), std::string::npos) << reply;
+    EXPECT_NE(reply.find("can2vhal_rx_decode_failures_total 2\n"), std::string::npos);
+    EXPECT_NE(reply.find("can2vhal_can_id_frames_total{can_id=\"0x123\"} 3\n"), std::string::npos);
+    EXPECT_NE(reply.find("can2vhal_queue_capacity 1024\n"), std::string::npos);
+
+    ASSERT_TRUE(QueryMetrics(path, "dump", reply));
+    EXPECT_NE(reply.find("RX:\n  frames=4 decoded=2 decode_failures=2"), std::string::npos) << reply;
+    EXPECT_NE(reply.find("Publish latency"), std::string::npos);
+
+    ASSERT_TRUE(QueryMetrics(path, "bogus", reply));
+    EXPECT_EQ(reply, "Unknown command 'bogus'; use dump, metrics or fusion\n");
+
+    server.Stop();
+}
+
+TEST_F(MetricsTest, ReportsTransmitQueueWhenPresent) {
+    EventLoop loop;
+    CanTransmitter transmitter(loop, "vcan0");
+    canfd_frame frame = {};
+    frame.can_id = 0x101;
+    ASSERT_TRUE(transmitter.Send(frame));
+    MetricsSnapshot snapshot = CollectMetrics({&gateway_, &publisher_, &sink_, nullptr, &transmitter});
+    ASSERT_TRUE(snapshot.has_tx);
+    EXPECT_EQ(snapshot.tx.depth, 1u);
+    EXPECT_NE(FormatDump(snapshot).find("TX:\n  depth=1 queued=1"), std::string::npos);
+    EXPECT_NE(FormatMetrics(snapshot).find("can2vhal_tx_queued_total 1\n"), std::string::npos);
+    EXPECT_EQ(FormatMetrics(CollectMetrics({&gateway_, &publisher_, &sink_})).find("can2vhal_tx_"),
+              std::string::npos);
+}
+
+TEST(FusionFormatTest, OneLinePerSnapshot) {
+    FusionSnapshot snapshot = {};
+    snapshot.sequence = 7;
+    snapshot.timestamp_ns = 1'700'000'000'010'000'000;
+    snapshot.count = 3;
+    snapshot.valid_mask = 0b101;
+    snapshot.values = {1.5, 0, -12};
+    EXPECT_EQ(FormatFusion(snapshot), "7 1700000000010000000 1.5 - -12\n");
+}
+
+}  // namespace
+}  // namespace tcc::aaos::can
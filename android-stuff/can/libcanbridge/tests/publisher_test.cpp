@@ -0,0 +1,192 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+#include "fake_property_sink.h"
+#include "publisher.h"
+#include "socket_can.h"
+#include "vehicle_signals.h"
+
+namespace tcc::aaos::can {
+namespace {
+
+constexpr size_t ACCELEROMETER = 0;
+constexpr size_t TEMPERATURE = 1;
+
+DecodedFrame Frame(size_t message, std::initializer_list<double> values) {
+    DecodedFrame frame = {};
+    frame.can_id = VehicleSignals::MESSAGES_INFO[message].can_id;
+    frame.message = static_cast<uint16_t>(message);
+    frame.count = static_cast<uint8_t>(values.size());
+    std::copy(values.begin(), values.end(), frame.values.begin());
+    frame.rx_ns = RealtimeNowNs();
+    frame.decoded_ns = frame.rx_ns;
+    return frame;
+}
+
+class PublisherTest : public ::testing::Test {
+protected:
+    void Start() {
+        ASSERT_TRUE(publisher_.Init());
+        publisher_.Start();
+    }
+
+    void Send(DecodedFrame const& frame) {
+        ASSERT_TRUE(publisher_.Enqueue(frame));
+        publisher_.Notify();
+    }
+
+    FakePropertySink sink_;
+    Publisher publisher_{sink_, VehicleSignals::MESSAGES_INFO, VehicleSignals::MESSAGE_COUNT, 0};
+};
+
+TEST_F(PublisherTest, PublishesPropertyValuesByType) {
+    Start();
+    Send(Frame(ACCELEROMETER, {100, -200, 16384}));
+    Send(Frame(TEMPERATURE, {23.5}));
+
+    ASSERT_TRUE(sink_.WaitFor(INFO_ACCELEROMETER_MPU6050, 1));
+    ASSERT_TRUE(sink_.WaitFor(INFO_TEMPERATURE_DHT22, 1));
+    EXPECT_EQ(sink_.Published(INFO_ACCELEROMETER_MPU6050)[0].int32_values,
+              (std::vector<int32_t>{100, -200, 16384}));
+    EXPECT_EQ(sink_.Published(INFO_TEMPERATURE_DHT22)[0].float_values, std::vector<float>{23.5f});
+}
+
+TEST_F(PublisherTest, QueriesEachPropertyOnce) {
+    // The classic and the burst accelerometer frames share their properties
+    Start();
+    EXPECT_EQ(sink_.Queried(), (std::vector<int32_t>{INFO_ACCELEROMETER_MPU6050, FAULT_CODE_ACCELEROMETER_MPU6050,
+                                                     INFO_TEMPERATURE_DHT22, FAULT_CODE_TEMPERATURE_DHT22}));
+}
+
+TEST_F(PublisherTest, FaultFramesPublishTheSentinelAndTheFaultCode) {
+    Start();
+    Send(Frame(ACCELEROMETER, {1, 2, 3}));
+    ASSERT_TRUE(sink_.WaitFor(FAULT_CODE_ACCELEROMETER_MPU6050, 1));
+    Send(Frame(ACCELEROMETER, {INT16_MIN, INT16_MIN, INT16_MIN}));
+    ASSERT_TRUE(sink_.WaitFor(FAULT_CODE_ACCELEROMETER_MPU6050, 2));
+    ASSERT_TRUE(sink_.WaitFor(INFO_ACCELEROMETER_MPU6050, 2));
+
+    auto codes = sink_.Published(FAULT_CODE_ACCELEROMETER_MPU6050);
+    EXPECT_EQ(codes[0].string_value, "ACC-0");
+    EXPECT_EQ(codes[1].string_value, "ACC-E1");
+    // The app detects the fault from the sentinel on all three axes
+    auto values = sink_.Published(INFO_ACCELEROMETER_MPU6050);
+    ASSERT_EQ(values.size(), 2u);
+    EXPECT_EQ(values[1].int32_values, (std::vector<int32_t>{-32768, -32768, -32768}));
+}
+
+TEST_F(PublisherTest, TemperatureFaultPublishesTheSentinel) {
+    Start();
+    Send(Frame(TEMPERATURE, {-273.15}));
+    ASSERT_TRUE(sink_.WaitFor(FAULT_CODE_TEMPERATURE_DHT22, 1));
+    ASSERT_TRUE(sink_.WaitFor(INFO_TEMPERATURE_DHT22, 1));
+
+    EXPECT_EQ(sink_.Published(FAULT_CODE_TEMPERATURE_DHT22)[0].string_value, "TMP-E1");
+    EXPECT_EQ(sink_.Published(INFO_TEMPERATURE_DHT22)[0].float_values, std::vector<float>{-273.15f});
+}
+
+TEST_F(PublisherTest, FaultSentinelStaysOutOfTheAverage) {
+    sink_.SetMaxSampleRate(INFO_ACCELEROMETER_MPU6050, 10.0f);
+    publisher_.SetPolicy(INFO_ACCELEROMETER_MPU6050, DecimationMode::AVERAGE, 0);
+    Start();
+    Send(Frame(ACCELEROMETER, {0, 0, 0}));
+    ASSERT_TRUE(sink_.WaitFor(INFO_ACCELEROMETER_MPU6050, 1));
+    Send(Frame(ACCELEROMETER, {10, 20, 30}));
+    Send(Frame(ACCELEROMETER, {INT16_MIN, INT16_MIN, INT16_MIN}));
+    ASSERT_TRUE(sink_.WaitFor(INFO_ACCELEROMETER_MPU6050, 2));
+    Send(Frame(ACCELEROMETER, {30, 40, 50}));
+    Send(Frame(ACCELEROMETER, {50, 60, 70}));
+    ASSERT_TRUE(sink_.WaitFor(INFO_ACCELEROMETER_MPU6050, 3));
+
+    // The sentinel replaces the window and goes out as-is; the next window
+    // averages only valid readings
+    auto values = sink_.Published(INFO_ACCELEROMETER_MPU6050);
+    ASSERT_EQ(values.size(), 3u);
+    EXPECT_EQ(values[1].int32_values, (std::vector<int32_t>{-32768, -32768, -32768}));
+    EXPECT_EQ(values[2].int32_values, (std::vector<int32_t>{40, 50, 60}));
+}
+
+TEST_F(PublisherTest, DeadbandSuppressesSmallChanges) {
+    publisher_.SetPolicy(INFO_TEMPERATURE_DHT22, DecimationMode::LATEST, 0.5);
+    Start();
+    Send(Frame(TEMPERATURE, {20.0}));
+    ASSERT_TRUE(sink_.WaitFor(INFO_TEMPERATURE_DHT22, 1));
+    Send(Frame(TEMPERATURE, {20.1}));
+    Send(Frame(TEMPERATURE, {21.0}));
+    ASSERT_TRUE(sink_.WaitFor(INFO_TEMPERATURE_DHT22, 2));
+
+    auto values = sink_.Published(INFO_TEMPERATURE_DHT22);
+    ASSERT_EQ(values.size(), 2u);
+    EXPECT_EQ(values[1].float_values, std::vector<float>{21.0f});
+}
+
+TEST_F(PublisherTest, RateLimitAveragesHeldValues) {
+    // 10 Hz: everything after the first frame is held for ~100 ms and then
+    // published once by the flush timer
+    sink_.SetMaxSampleRate(INFO_ACCELEROMETER_MPU6050, 10.0f);
+    publisher_.SetPolicy(INFO_ACCELEROMETER_MPU6050, DecimationMode::AVERAGE, 0);
+    Start();
+    auto start = std::chrono::steady_clock::now();
+    Send(Frame(ACCELEROMETER, {0, 0, 0}));
+    ASSERT_TRUE(sink_.WaitFor(INFO_ACCELEROMETER_MPU6050, 1));
+    Send(Frame(ACCELEROMETER, {10, 20, 30}));
+    Send(Frame(ACCELEROMETER, {30, 40, 50}));
+    ASSERT_TRUE(sink_.WaitFor(INFO_ACCELEROMETER_MPU6050, 2));
+
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(90));
+    auto values = sink_.Published(INFO_ACCELEROMETER_MPU6050);
+    ASSERT_EQ(values.size(), 2u);
+    EXPECT_EQ(values[1].int32_values, (std::vector<int32_t>{20, 30, 40}));
+}
+
+TEST_F(PublisherTest, RepublishesLatestValuesAfterReconnecting) {
+    Start();
+    Send(Frame(TEMPERATURE, {20.0}));
+    ASSERT_TRUE(sink_.WaitFor(INFO_TEMPERATURE_DHT22, 1));
+
+    // Nothing reaches the sink while it is disconnected; only the last
+    // value of each property is held
+    sink_.Disconnect();
+    Send(Frame(TEMPERATURE, {21.0}));
+    Send(Frame(TEMPERATURE, {22.0}));
+    Send(Frame(ACCELEROMETER, {1, 2, 3}));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(sink_.Published(INFO_TEMPERATURE_DHT22).size(), 1u);
+    EXPECT_TRUE(sink_.Published(INFO_ACCELEROMETER_MPU6050).empty());
+
+    sink_.Restart();
+    ASSERT_TRUE(sink_.WaitFor(INFO_TEMPERATURE_DHT22, 2));
+    ASSERT_TRUE(sink_.WaitFor(INFO_ACCELEROMETER_MPU6050, 1));
+    auto temperatures = sink_.Published(INFO_TEMPERATURE_DHT22);
+    ASSERT_EQ(temperatures.size(), 2u);
+    EXPECT_EQ(temperatures[1].float_values, std::vector<float>{22.0f});
+    EXPECT_EQ(sink_.Published(INFO_ACCELEROMETER_MPU6050)[0].int32_values, (std::vector<int32_t>{1, 2, 3}));
+    EXPECT_EQ(sink_.Stats().reconnects, 1u);
+
+    // Publishing carries on as before
+    Send(Frame(TEMPERATURE, {25.0}));
+    ASSERT_TRUE(sink_.WaitFor(INFO_TEMPERATURE_DHT22, 3));
+    EXPECT_EQ(publisher_.Stats().resumed, 1u);
+}
+
+TEST_F(PublisherTest, CountsDropsWhenTheQueueIsFull) {
+    // Not started: nothing drains the ring
+    ASSERT_TRUE(publisher_.Init());
+    DecodedFrame frame = Frame(TEMPERATURE, {1.0});
+    size_t accepted = 0;
+    for (size_t i = 0; i < Publisher::QUEUE_CAPACITY + 10; i++) {
+        accepted += publisher_.Enqueue(frame);
+    }
+    publisher_.Notify();
+
+    PublisherStats stats = publisher_.Stats();
+    EXPECT_EQ(stats.enqueued, accepted);
+    EXPECT_EQ(stats.dropped, Publisher::QUEUE_CAPACITY + 10 - accepted);
+    EXPECT_GT(stats.dropped, 0u);
+    EXPECT_EQ(stats.overflows, 1u);
+}
+
+}  // namespace
+}  // namespace tcc::aaos::can
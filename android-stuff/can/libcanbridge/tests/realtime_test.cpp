@@ -0,0 +1,54 @@
+#include <gtest/gtest.h>
+
+#include <sched.h>
+
+#include <thread>
+
+#include "realtime.h"
+
+namespace tcc::aaos::can {
+namespace {
+
+TEST(RealtimeTest, ParsesOptions) {
+    RealtimeConfig config;
+    bool valid = false;
+    EXPECT_TRUE(ParseRealtimeOption("--rx-priority=50", config, valid));
+    EXPECT_TRUE(valid);
+    EXPECT_TRUE(ParseRealtimeOption("--publisher-cpu=0", config, valid));
+    EXPECT_TRUE(valid);
+    EXPECT_TRUE(ParseRealtimeOption("--prefault-stack=64", config, valid));
+    EXPECT_TRUE(valid);
+    EXPECT_TRUE(ParseRealtimeOption("--mlock", config, valid));
+    EXPECT_TRUE(valid);
+    EXPECT_EQ(config.rx.fifo_priority, 50);
+    EXPECT_EQ(config.rx.cpu, -1);
+    EXPECT_EQ(config.publisher.cpu, 0);
+    EXPECT_EQ(config.publisher.prefault_stack, 64u * 1024);
+    EXPECT_TRUE(config.lock_memory);
+    EXPECT_EQ(DescribeRealtime(config), "rx fifo:50, publisher cpu:0, prefault 64 KiB, mlock");
+    EXPECT_EQ(DescribeRealtime(RealtimeConfig{}), "cfs");
+
+    EXPECT_TRUE(ParseRealtimeOption("--rx-priority=100", config, valid));
+    EXPECT_FALSE(valid);
+    EXPECT_TRUE(ParseRealtimeOption("--rx-cpu=x", config, valid));
+    EXPECT_FALSE(valid);
+    EXPECT_FALSE(ParseRealtimeOption("--rx-ring", config, valid));
+}
+
+TEST(RealtimeTest, PinsAndPrefaultsTheCallingThread) {
+    ThreadConfig config;
+    config.cpu = 0;
+    config.prefault_stack = 256 * 1024;
+    bool applied = false;
+    int cpu = -1;
+    std::thread thread([&] {
+        applied = ApplyThreadConfig(config, "realtime-test");
+        cpu = sched_getcpu();
+    });
+    thread.join();
+    EXPECT_TRUE(applied);
+    EXPECT_EQ(cpu, 0);
+}
+
+}  // namespace
+}  // namespace tcc::aaos::can
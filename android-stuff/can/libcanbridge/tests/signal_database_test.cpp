@@ -0,0 +1,234 @@
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+
+#include "dbc_parser.h"
+#include "signal_database.h"
+#include "vehicle_signals.h"
+
+#ifndef VEHICLE_DBC_PATH
+#define VEHICLE_DBC_PATH "vehicle.dbc"
+#endif
+
+namespace tcc::aaos::can {
+namespace {
+
+class SignalDatabaseTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        char dir[] = "/tmp/signal_database_testXXXXXX";
+        ASSERT_NE(mkdtemp(dir), nullptr);
+        dir_ = dir;
+        cache_ = dir_ + "/vehicle.cache";
+    }
+
+    void TearDown() override {
+        unlink(cache_.c_str());
+        rmdir(dir_.c_str());
+    }
+
+    std::string dir_;
+    std::string cache_;
+};
+
+TEST_F(SignalDatabaseTest, VehicleDbcDecodesLikeVehicleSignals) {
+    SignalDatabase db;
+    ASSERT_TRUE(db.Load(VEHICLE_DBC_PATH, ""));
+    ASSERT_EQ(db.MessageCount(), VehicleSignals::MESSAGE_COUNT);
+
+    std::mt19937 rng(1);
+    canid_t const ids[] = {0x123, 0x124, 0x125};
+    for (int n = 0; n < 20000; n++) {
+        canfd_frame frame = {};
+        frame.can_id = n % 7 == 0 ? rng() & CAN_SFF_MASK : ids[n % 3];
+        frame.len = n % 3 == 2 ? rng() % (CANFD_MAX_DLEN + 1) : rng() % (CAN_MAX_DLEN + 1);
+        for (uint8_t &byte : frame.data) {
+            byte = static_cast<uint8_t>(rng());
+        }
+
+        DecodedSamples expected;
+        DecodedSamples actual;
+        size_t decoded = VehicleSignals::Decode(frame, expected);
+        ASSERT_EQ(db.Decode(frame, actual), decoded);
+        for (size_t k = 0; k < decoded; k++) {
+            MessageInfo const& info = VehicleSignals::MESSAGES_INFO[expected[k].message];
+            MessageInfo const& loaded = db.Messages()[actual[k].message];
+            ASSERT_EQ(loaded.can_id, info.can_id);
+            ASSERT_EQ(loaded.sample_count, info.sample_count);
+            ASSERT_EQ(loaded.sample_period_ns, info.sample_period_ns);
+            ASSERT_EQ(actual[k].count, expected[k].count);
+            ASSERT_EQ(loaded.properties[0].prop_id, info.properties[0].prop_id);
+            ASSERT_STREQ(loaded.fault->fault_code, info.fault->fault_code);
+            for (size_t i = 0; i < expected[k].count; i++) {
+                if (std::isnan(expected[k].values[i])) {
+                    EXPECT_TRUE(std::isnan(actual[k].values[i]));
+                } else {
+                    EXPECT_EQ(actual[k].values[i], expected[k].values[i]) << info.signals[i].name;
+                }
+            }
+        }
+    }
+}
+
+TEST_F(SignalDatabaseTest, DecodesEverySampleOfAnFdFrame) {
+    // 10 readings of (x, y, z) = (k, -k, 1000 + k), int16 big-endian
+    canfd_frame frame = {};
+    frame.can_id = 0x125;
+    frame.len = CANFD_MAX_DLEN;
+    frame.flags = CANFD_FDF | CANFD_BRS;
+    for (int k = 0; k < 10; k++) {
+        int16_t axes[] = {static_cast<int16_t>(k), static_cast<int16_t>(-k), static_cast<int16_t>(1000 + k)};
+        for (int axis = 0; axis < 3; axis++) {
+            frame.data[k * 6 + axis * 2] = static_cast<uint8_t>(static_cast<uint16_t>(axes[axis]) >> 8);
+            frame.data[k * 6 + axis * 2 + 1] = static_cast<uint8_t>(axes[axis]);
+        }
+    }
+
+    SignalDatabase db;
+    ASSERT_TRUE(db.Load(VEHICLE_DBC_PATH, ""));
+    DecodedSamples samples;
+    ASSERT_EQ(VehicleSignals::Decode(frame, samples), 10u);
+    for (int k = 0; k < 10; k++) {
+        EXPECT_EQ(samples[k].can_id, 0x125u);
+        ASSERT_EQ(samples[k].count, 3);
+        EXPECT_EQ(samples[k].values[0], k);
+        EXPECT_EQ(samples[k].values[1], -k);
+        EXPECT_EQ(samples[k].values[2], 1000 + k);
+    }
+    ASSERT_EQ(db.Decode(frame, samples), 10u);
+    EXPECT_EQ(samples[9].values[2], 1009);
+
+    // A frame cut short of the last sample is not decoded at all
+    frame.len = 48;
+    EXPECT_EQ(VehicleSignals::Decode(frame, samples), 0u);
+    EXPECT_EQ(db.Decode(frame, samples), 0u);
+}
+
+TEST_F(SignalDatabaseTest, SecondLoadMapsTheCache) {
+    SignalDatabase first;
+    ASSERT_TRUE(first.Load(VEHICLE_DBC_PATH, cache_));
+    EXPECT_FALSE(first.LoadedFromCache());
+
+    SignalDatabase second;
+    ASSERT_TRUE(second.Load(VEHICLE_DBC_PATH, cache_));
+    EXPECT_TRUE(second.LoadedFromCache());
+    EXPECT_EQ(second.MessageCount(), first.MessageCount());
+
+    std::vector<can_filter> filters = second.Filters();
+    ASSERT_EQ(filters.size(), 3u);
+    EXPECT_EQ(filters[0].can_id, 0x123u);
+    EXPECT_EQ(filters[1].can_id, 0x124u);
+    EXPECT_EQ(filters[2].can_id, 0x125u);
+}
+
+TEST_F(SignalDatabaseTest, CorruptCacheIsRebuilt) {
+    SignalDatabase first;
+    ASSERT_TRUE(first.Load(VEHICLE_DBC_PATH, cache_));
+
+    FILE *file = fopen(cache_.c_str(), "r+b");
+    ASSERT_NE(file, nullptr);
+    fseek(file, 100, SEEK_SET);
+    for (int i = 0; i < 4; i++) {
+        fputc(0xff, file);
+    }
+    fclose(file);
+
+    SignalDatabase second;
+    ASSERT_TRUE(second.Load(VEHICLE_DBC_PATH, cache_));
+    EXPECT_EQ(second.MessageCount(), VehicleSignals::MESSAGE_COUNT);
+    canfd_frame frame = {};
+    frame.can_id = 0x124;
+    frame.len = 4;
+    float temperature = 21.5f;
+    std::memcpy(frame.data, &temperature, sizeof(temperature));
+    DecodedSamples decoded;
+    ASSERT_EQ(second.Decode(frame, decoded), 1u);
+    EXPECT_EQ(decoded[0].values[0], 21.5);
+}
+
+TEST(DbcParserTest, ExtendedIntelAndMultiplexedSignals) {
+    DbcFile file;
+    ASSERT_TRUE(ParseDbc("BO_ 2147487744 Ext: 8 X\n"
+                         " SG_ Mux M : 0|8@1+ (1,0) [0|0] \"\" X\n"
+                         " SG_ Muxed m1 : 8|8@1+ (1,0) [0|0] \"\" X\n"
+                         " SG_ Speed : 16|12@1+ (0.5,-10) [0|0] \"\" X\n"
+                         "BA_ \"VhalProperty\" SG_ 2147487744 Speed 291504647;\n",
+                         file));
+    ASSERT_EQ(file.messages.size(), 1u);
+    EXPECT_EQ(file.messages[0].can_id, 0x1000u | CAN_EFF_FLAG);
+
+    SignalDatabase db;
+    ASSERT_TRUE(db.Build(file));
+    canfd_frame frame = {};
+    frame.can_id = 0x1000 | CAN_EFF_FLAG;
+    frame.len = 8;
+    frame.data[2] = 0x34;
+    frame.data[3] = 0x12;
+    DecodedSamples decoded;
+    ASSERT_EQ(db.Decode(frame, decoded), 1u);
+    EXPECT_EQ(decoded[0].values[decoded[0].count - 1], 0x234 * 0.5 - 10);
+
+    // Same numeric ID as a standard frame is a different message
+    frame.can_id = 0x1000;
+    EXPECT_EQ(db.Decode(frame, decoded), 0u);
+}
+
+TEST(DbcParserTest, FdSignalsAtTheEndOfTheFrame) {
+    DbcFile file;
+    ASSERT_TRUE(ParseDbc("BO_ 512 Fd: 64 X\n"
+                         " SG_ Tail : 496|16@1+ (1,0) [0|0] \"\" X\n"
+                         " SG_ Motorola : 455|12@0- (1,0) [0|0] \"\" X\n"
+                         "BA_ \"VhalProperty\" SG_ 512 Tail 291504647;\n"
+                         "BA_ \"VhalProperty\" SG_ 512 Motorola 291504648;\n",
+                         file));
+    SignalDatabase db;
+    ASSERT_TRUE(db.Build(file));
+    canfd_frame frame = {};
+    frame.can_id = 0x200;
+    frame.len = CANFD_MAX_DLEN;
+    frame.flags = CANFD_FDF;
+    frame.data[62] = 0xcd;
+    frame.data[63] = 0xab;
+    frame.data[56] = 0xff; // Motorola: byte 56 then the top nibble of byte 57
+    frame.data[57] = 0xe0;
+    DecodedSamples decoded;
+    ASSERT_EQ(db.Decode(frame, decoded), 1u);
+    EXPECT_EQ(decoded[0].values[0], 0xabcd);
+    EXPECT_EQ(decoded[0].values[1], -2);
+
+    // A classic frame shorter than the DLC does not match
+    frame.len = CAN_MAX_DLEN;
+    EXPECT_EQ(db.Decode(frame, decoded), 0u);
+}
+
+TEST(DbcParserTest, RejectsSamplesPastTheFrame) {
+    DbcFile file;
+    ASSERT_TRUE(ParseDbc("BO_ 1 Burst: 16 X\n"
+                         " SG_ A : 0|16@1+ (1,0) [0|0] \"\" X\n"
+                         "BA_ \"VhalProperty\" SG_ 1 A 291504647;\n"
+                         "BA_ \"VhalSampleCount\" BO_ 1 9;\n"
+                         "BA_ \"VhalSampleStride\" BO_ 1 2;\n",
+                         file));
+    ASSERT_EQ(file.messages[0].sample_count, 9u);
+    SignalDatabase db;
+    EXPECT_FALSE(db.Build(file));
+
+    file.messages[0].sample_count = 8;
+    ASSERT_TRUE(db.Build(file));
+    EXPECT_EQ(db.Messages()[0].sample_count, 8);
+}
+
+TEST(DbcParserTest, RejectsInvalidByteOrder) {
+    DbcFile file;
+    EXPECT_FALSE(ParseDbc("BO_ 1 X: 8 Y\n SG_ Bad : 0|8@2+ (1,0) [0|0] \"\" X\n", file));
+}
+
+}  // namespace
+}  // namespace tcc::aaos::can
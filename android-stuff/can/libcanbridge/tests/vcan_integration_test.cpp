@@ -0,0 +1,233 @@
+#include <gtest/gtest.h>
+
+#include <linux/can/isotp.h>
+#include <net/if.h>
+#include <unistd.h>
+
+#include <climits>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "can_gateway.h"
+#include "event_loop.h"
+#include "fake_property_sink.h"
+#include "message_decoder.h"
+#include "publisher.h"
+#include "socket_can.h"
+#include "vehicle_signals.h"
+
+namespace tcc::aaos::can {
+namespace {
+
+// Runs the full reader -> decoder -> publisher -> sink pipeline on a virtual
+// CAN bus. Needs vcan0 to be up:
+//   ip link add dev vcan0 type vcan && ip link set up vcan0
+constexpr char INTERFACE[] = "vcan0";
+
+class VcanIntegrationTest : public ::testing::TestWithParam<RxBackend> {
+protected:
+    void SetUp() override {
+        if (if_nametoindex(INTERFACE) == 0) {
+            GTEST_SKIP() << INTERFACE << " is not available";
+        }
+        ASSERT_TRUE(publisher_.Init());
+        publisher_.Start();
+        ASSERT_TRUE(loop_.Init());
+        ASSERT_TRUE(gateway_.AddInterface(INTERFACE, GetParam()));
+        reader_ = std::thread([this] { loop_.Run(); });
+        ASSERT_TRUE(sender_.Init());
+    }
+
+    void TearDown() override {
+        if (reader_.joinable()) {
+            loop_.Stop();
+            reader_.join();
+        }
+        publisher_.Stop();
+    }
+
+    FakePropertySink sink_;
+    StaticDecoder<VehicleSignals> decoder_;
+    Publisher publisher_{sink_, decoder_.Messages(), decoder_.MessageCount(), 0};
+    EventLoop loop_;
+    CanGateway gateway_{loop_, decoder_, publisher_};
+    std::thread reader_;
+    SocketCan sender_{INTERFACE};
+};
+
+TEST_P(VcanIntegrationTest, FramesReachTheSink) {
+    can_frame accel = {};
+    accel.can_id = 0x123;
+    accel.can_dlc = 6;
+    uint8_t const payload[] = {0x00, 0x64, 0xff, 0x38, 0x40, 0x00}; // 100, -200, 16384
+    std::memcpy(accel.data, payload, sizeof(payload));
+    ASSERT_TRUE(sender_.SendCanMessage(accel));
+
+    can_frame temperature = {};
+    temperature.can_id = 0x124;
+    temperature.can_dlc = 4;
+    float celsius = 24.5f;
+    std::memcpy(temperature.data, &celsius, sizeof(celsius));
+    ASSERT_TRUE(sender_.SendCanMessage(temperature));
+
+    ASSERT_TRUE(sink_.WaitFor(INFO_ACCELEROMETER_MPU6050, 1));
+    ASSERT_TRUE(sink_.WaitFor(INFO_TEMPERATURE_DHT22, 1));
+    EXPECT_EQ(sink_.Published(INFO_ACCELEROMETER_MPU6050)[0].int32_values,
+              (std::vector<int32_t>{100, -200, 16384}));
+    EXPECT_EQ(sink_.Published(INFO_TEMPERATURE_DHT22)[0].float_values, std::vector<float>{24.5f});
+}
+
+TEST_P(VcanIntegrationTest, UnknownIdsAreFilteredByTheKernel) {
+    can_frame unknown = {};
+    unknown.can_id = 0x321;
+    unknown.can_dlc = 8;
+    ASSERT_TRUE(sender_.SendCanMessage(unknown));
+
+    can_frame temperature = {};
+    temperature.can_id = 0x124;
+    temperature.can_dlc = 4;
+    ASSERT_TRUE(sender_.SendCanMessage(temperature));
+    ASSERT_TRUE(sink_.WaitFor(INFO_TEMPERATURE_DHT22, 1));
+
+    // Only the known frame ever reached user space (CAN_RAW_FILTER / BPF)
+    GatewayStats stats = gateway_.Stats();
+    EXPECT_EQ(stats.frames, 1u);
+    EXPECT_EQ(stats.decoded, 1u);
+}
+
+TEST_P(VcanIntegrationTest, FdBurstPublishesEverySample) {
+    // vcan is FD-capable once its MTU is raised: ip link set vcan0 mtu 72
+    if (!sender_.FdCapable()) {
+        GTEST_SKIP() << INTERFACE << " is not a CAN FD interface";
+    }
+    sender_.SetBitRateSwitch(true);
+    canfd_frame burst = {};
+    burst.can_id = 0x125;
+    burst.len = CANFD_MAX_DLEN;
+    for (int k = 0; k < 10; k++) {
+        burst.data[k * 6 + 1] = static_cast<uint8_t>(k); // AccelX = k
+    }
+    ASSERT_TRUE(sender_.SendCanMessage(burst));
+
+    ASSERT_TRUE(sink_.WaitFor(INFO_ACCELEROMETER_MPU6050, 1));
+    EXPECT_EQ(gateway_.Stats().decoded, 1u);
+    publisher_.WaitEmpty();
+    EXPECT_EQ(publisher_.Stats().enqueued, 10u);
+}
+
+TEST(SocketCanBufferTest, ParsesBufferSizeOption) {
+    int bytes = 0;
+    ASSERT_TRUE(ParseBufferSizeOption("512", bytes));
+    EXPECT_EQ(bytes, 512 * 1024);
+    ASSERT_TRUE(ParseBufferSizeOption(std::to_string(INT_MAX / 1024), bytes));
+    EXPECT_EQ(bytes, INT_MAX / 1024 * 1024);
+
+    EXPECT_FALSE(ParseBufferSizeOption("", bytes));
+    EXPECT_FALSE(ParseBufferSizeOption("abc", bytes));
+    EXPECT_FALSE(ParseBufferSizeOption("64k", bytes));
+    EXPECT_FALSE(ParseBufferSizeOption("0", bytes));
+    EXPECT_FALSE(ParseBufferSizeOption("-4", bytes));
+    EXPECT_FALSE(ParseBufferSizeOption(std::to_string(INT_MAX / 1024 + 1), bytes));
+    EXPECT_FALSE(ParseBufferSizeOption("99999999999999999999", bytes));
+}
+
+TEST(SocketCanBufferTest, ReportsDropsPerBatch) {
+    if (if_nametoindex(INTERFACE) == 0) {
+        GTEST_SKIP() << INTERFACE << " is not available";
+    }
+    // The kernel raises a tiny request to its minimum, a few frames' worth
+    SocketCan receiver{INTERFACE};
+    receiver.SetBufferSizes(1, 0);
+    ASSERT_TRUE(receiver.Init());
+    ASSERT_TRUE(receiver.SetNonBlocking(true));
+    SocketCan sender{INTERFACE};
+    ASSERT_TRUE(sender.Init());
+    EXPECT_GT(receiver.ReceiveBufferSize(), 0);
+
+    can_frame frame = {};
+    frame.can_id = 0x123;
+    frame.can_dlc = 8;
+    constexpr int SENT = 200;
+    for (int i = 0; i < SENT; i++) {
+        ASSERT_TRUE(sender.SendCanMessage(frame));
+    }
+    CanRxFrame frames[MAX_RX_BATCH];
+    uint64_t received = 0;
+    uint64_t batch_drops = 0;
+    auto drain = [&] {
+        int count;
+        while ((count = receiver.ReadCanMessages(frames, MAX_RX_BATCH)) > 0) {
+            received += static_cast<uint64_t>(count);
+            batch_drops += receiver.LastBatchDrops();
+        }
+    };
+    drain();
+    // Drops after the last queued frame show up with the next one
+    ASSERT_TRUE(sender.SendCanMessage(frame));
+    drain();
+
+    EXPECT_GT(receiver.RxQueueDrops(), 0u);
+    EXPECT_EQ(batch_drops, receiver.RxQueueDrops());
+    EXPECT_EQ(received + receiver.RxQueueDrops(), static_cast<uint64_t>(SENT + 1));
+}
+
+TEST(IsoTpIntegrationTest, PduRecordsReachTheSink) {
+    if (if_nametoindex(INTERFACE) == 0) {
+        GTEST_SKIP() << INTERFACE << " is not available";
+    }
+    int sender = socket(PF_CAN, SOCK_DGRAM, CAN_ISOTP);
+    if (sender < 0) {
+        GTEST_SKIP() << "no CAN_ISOTP support";
+    }
+    sockaddr_can address = {};
+    address.can_family = AF_CAN;
+    address.can_ifindex = static_cast<int>(if_nametoindex(INTERFACE));
+    address.can_addr.tp.rx_id = 0x701;
+    address.can_addr.tp.tx_id = 0x700;
+    ASSERT_EQ(bind(sender, reinterpret_cast<sockaddr *>(&address), sizeof(address)), 0);
+
+    FakePropertySink sink;
+    StaticDecoder<VehicleSignals> decoder;
+    Publisher publisher(sink, decoder.Messages(), decoder.MessageCount(), 0);
+    ASSERT_TRUE(publisher.Init());
+    publisher.Start();
+    EventLoop loop;
+    ASSERT_TRUE(loop.Init());
+    CanGateway gateway(loop, decoder, publisher);
+    IsoTpConfig config;
+    config.rx_id = 0x700;
+    config.tx_id = 0x701;
+    config.message_id = 0x123;
+    config.block_size = 8;
+    ASSERT_TRUE(gateway.AddIsoTp(INTERFACE, config));
+    std::thread reader([&loop] { loop.Run(); });
+
+    // 100 accelerometer readings (AccelX = k) plus 2 stray bytes
+    uint8_t pdu[100 * 6 + 2] = {};
+    for (int k = 0; k < 100; k++) {
+        pdu[k * 6 + 1] = static_cast<uint8_t>(k);
+    }
+    EXPECT_EQ(write(sender, pdu, sizeof(pdu)), static_cast<ssize_t>(sizeof(pdu)));
+
+    EXPECT_TRUE(sink.WaitFor(INFO_ACCELEROMETER_MPU6050, 1));
+    publisher.WaitEmpty();
+    loop.Stop();
+    reader.join();
+    publisher.Stop();
+    close(sender);
+
+    GatewayStats stats = gateway.Stats();
+    EXPECT_EQ(stats.pdus, 1u);
+    EXPECT_EQ(stats.decoded, 100u);
+    EXPECT_EQ(stats.decode_failures, 1u);
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, VcanIntegrationTest,
+                         ::testing::Values(RxBackend::SOCKET, RxBackend::PACKET_RING),
+                         [](::testing::TestParamInfo<RxBackend> const& info) {
+                             return info.param == RxBackend::SOCKET ? "Socket" : "PacketRing";
+                         });
+
+}  // namespace
+}  // namespace tcc::aaos::can
@@ -0,0 +1,41 @@
+#include <cinttypes>
+#include <cstdio>
+
+#include "can_log.h"
+
+// Converts a candump log (candump -l, canlogserver) into the binary log
+// format read by CanLogReader, for replays that skip text parsing.
+//
+// Usage: log2bin <candump.log> <out.bin>
+
+using ::tcc::aaos::can::CanLogReader;
+using ::tcc::aaos::can::CanLogWriter;
+using ::tcc::aaos::can::CanRxFrame;
+using ::tcc::aaos::can::MAX_RX_BATCH;
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        std::fprintf(stderr, "Usage: %s <candump.log> <out.bin>\n", argv[0]);
+        return 2;
+    }
+    CanLogReader reader;
+    CanLogWriter writer;
+    if (!reader.Open(argv[1]) || !writer.Open(argv[2])) {
+        return 1;
+    }
+
+    CanRxFrame frames[MAX_RX_BATCH];
+    size_t count;
+    while ((count = reader.Read(frames, MAX_RX_BATCH)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            writer.Write(frames[i]);
+        }
+    }
+    if (!writer.Close()) {
+        std::fprintf(stderr, "Failed to write %s\n", argv[2]);
+        return 1;
+    }
+    std::fprintf(stderr, "%" PRIu64 " frames written, %" PRIu64 " lines skipped\n", reader.Stats().frames,
+                 reader.Stats().skipped);
+    return 0;
+}
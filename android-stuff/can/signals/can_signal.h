@@ -0,0 +1,359 @@
+#pragma once
+
+#include <endian.h>
+#include <linux/can.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace tcc::aaos::can {
+
+// Bit numbering follows the DBC convention: for BIG_ENDIAN (Motorola)
+// signals start_bit is the most significant bit, for LITTLE_ENDIAN (Intel)
+// signals it is the least significant bit. Bit n is bit (n % 8) of byte n / 8.
+enum class ByteOrder : uint8_t {
+    BIG_ENDIAN_ORDER,
+    LITTLE_ENDIAN_ORDER,
+};
+
+enum class ValueType : uint8_t {
+    UNSIGNED,
+    SIGNED,
+    FLOAT32, // IEEE 754 single, length must be 32
+};
+
+struct SignalDef {
+    char const* name;
+    uint16_t start_bit;
+    uint8_t length;
+    ByteOrder byte_order;
+    ValueType type;
+    double scale;
+    double offset;
+
+    // Right shift that moves the signal's LSB to bit 0 of the 64-bit word
+    // loaded in this signal's byte order from payload byte window
+    constexpr int Shift(int window = 0) const {
+        if (byte_order == ByteOrder::LITTLE_ENDIAN_ORDER) {
+            return start_bit - window * 8;
+        }
+        int msb_from_top = (start_bit / 8 - window) * 8 + (7 - start_bit % 8);
+        return 63 - (msb_from_top + length - 1);
+    }
+    constexpr uint64_t Mask() const {
+        return length >= 64 ? ~uint64_t{0} : (uint64_t{1} << length) - 1;
+    }
+    // First payload byte the signal touches, in either byte order
+    constexpr int FirstByte() const {
+        return start_bit / 8;
+    }
+    // Number of payload bytes the signal needs
+    constexpr int EndByte() const {
+        if (byte_order == ByteOrder::LITTLE_ENDIAN_ORDER) {
+            return (start_bit + length + 7) / 8;
+        }
+        return FirstByte() + (63 - Shift(FirstByte())) / 8 + 1;
+    }
+    // Payload byte the signal's 8-byte load window starts at, no later than
+    // last_window (see MessageInfo::LastWindow()). Windows are 8-byte aligned
+    // when the signal fits, so signals sharing a word share one load and a
+    // classic frame is always loaded from byte 0.
+    constexpr int Window(int last_window) const {
+        int aligned = FirstByte() / 8 * 8;
+        if (aligned <= last_window && Fits(aligned)) {
+            return aligned;
+        }
+        return FirstByte() < last_window ? FirstByte() : last_window;
+    }
+    // Whether the whole signal lies inside the 8 bytes loaded at window
+    constexpr bool Fits(int window) const {
+        return Shift(window) >= 0 && Shift(window) + length <= 64;
+    }
+};
+
+// VehiclePropertyType, bits 16-23 of a property ID
+enum class PropertyType : int32_t {
+    STRING = 0x00100000,
+    INT32 = 0x00400000,
+    INT32_VEC = 0x00410000,
+    FLOAT = 0x00600000,
+    FLOAT_VEC = 0x00610000,
+};
+
+constexpr PropertyType TypeOf(int32_t prop_id) {
+    return static_cast<PropertyType>(prop_id & 0x00ff0000);
+}
+
+// Consecutive signals of a message that form one VHAL property value
+// (element i of the property is signal first_signal + i)
+struct PropertyMapping {
+    int32_t prop_id;
+    uint8_t first_signal;
+    uint8_t signal_count;
+};
+
+// String property derived from a message, e.g. a sensor fault code. Sensor
+// nodes report a failed read with an out-of-range sentinel, so a frame is a
+// fault when every signal is at or below fault_threshold.
+struct FaultCode {
+    int32_t prop_id;
+    char const* ok_code;
+    char const* fault_code;
+    double fault_threshold;
+
+    bool IsFault(double const* values, size_t count) const {
+        for (size_t i = 0; i < count; i++) {
+            if (values[i] > fault_threshold) {
+                return false;
+            }
+        }
+        return count > 0;
+    }
+};
+
+// Upper bounds of a CAN FD message: signals decoded per sample, samples
+// packed in one frame
+constexpr static size_t MAX_SIGNALS_PER_MESSAGE = 8;
+constexpr static size_t MAX_SAMPLES_PER_FRAME = 32;
+
+// Type-erased view of a message definition.
+//
+// A message may pack several samples of the same signals into one frame,
+// e.g. a CAN FD frame carrying 10 accelerometer readings. Signals are then
+// defined for sample 0; sample k is the same layout sample_stride * k bytes
+// further into the payload. The node takes sample k sample_period_ns after
+// sample k - 1 and sends the frame right after the last one.
+struct MessageInfo {
+    canid_t can_id;
+    uint8_t dlc; // Bytes, up to CANFD_MAX_DLEN
+    SignalDef const* signals;
+    size_t signal_count;
+    PropertyMapping const* properties;
+    size_t property_count;
+    FaultCode const* fault; // nullptr when the message has no fault code
+    uint8_t sample_count;   // 1 for a message with one value per signal
+    uint8_t sample_stride;  // Bytes between samples
+    int64_t sample_period_ns;
+
+    // Latest byte a signal window of sample 0 may start at so the window of
+    // the last sample still ends inside canfd_frame::data. Decoders may read
+    // all CANFD_MAX_DLEN data bytes of a frame whatever its len; the bytes
+    // past len are masked out. Negative when the samples leave no room.
+    constexpr int LastWindow() const {
+        return static_cast<int>(CANFD_MAX_DLEN) - 8 - (sample_count - 1) * sample_stride;
+    }
+    // Whether the signal fits sample 0 of this message and its 8-byte window
+    constexpr bool Fits(SignalDef const& signal) const {
+        return signal.length > 0 && signal.length <= 64 && signal.Fits(signal.Window(LastWindow())) &&
+               signal.EndByte() + (sample_count - 1) * sample_stride <= dlc &&
+               (signal.type != ValueType::FLOAT32 || signal.length == 32);
+    }
+};
+
+// Physical values of one decoded sample, indexed like MessageInfo::signals
+struct DecodedFrame {
+    canid_t can_id;
+    uint16_t message; // Index into the table's MESSAGES_INFO
+    uint8_t count;
+    int64_t rx_ns;      // Kernel RX timestamp, back-dated for earlier samples of a frame
+    int64_t decoded_ns; // When decoding finished
+    std::array<double, MAX_SIGNALS_PER_MESSAGE> values;
+};
+
+// Every sample of one frame, in the order the node took them
+using DecodedSamples = std::array<DecodedFrame, MAX_SAMPLES_PER_FRAME>;
+
+namespace signal_detail {
+
+inline uint64_t LoadPayload(uint8_t const* data, ByteOrder order) {
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    return order == ByteOrder::BIG_ENDIAN_ORDER ? be64toh(word) : le64toh(word);
+}
+
+template <typename MESSAGE, typename = void>
+struct HasFault : std::false_type {};
+template <typename MESSAGE>
+struct HasFault<MESSAGE, std::void_t<decltype(MESSAGE::FAULT)>> : std::true_type {};
+
+// Multi-sample messages define SAMPLE_COUNT, SAMPLE_STRIDE and SAMPLE_PERIOD_NS
+template <typename MESSAGE, typename = void>
+struct HasSamples : std::false_type {};
+template <typename MESSAGE>
+struct HasSamples<MESSAGE, std::void_t<decltype(MESSAGE::SAMPLE_COUNT)>> : std::true_type {};
+
+template <typename MESSAGE>
+constexpr MessageInfo MakeInfo() {
+    FaultCode const* fault = nullptr;
+    if constexpr (HasFault<MESSAGE>::value) {
+        fault = &MESSAGE::FAULT;
+    }
+    MessageInfo info{MESSAGE::CAN_ID, MESSAGE::DLC,
+                     MESSAGE::SIGNALS, std::size(MESSAGE::SIGNALS),
+                     MESSAGE::PROPERTIES, std::size(MESSAGE::PROPERTIES),
+                     fault, 1, 0, 0};
+    if constexpr (HasSamples<MESSAGE>::value) {
+        info.sample_count = MESSAGE::SAMPLE_COUNT;
+        info.sample_stride = MESSAGE::SAMPLE_STRIDE;
+        info.sample_period_ns = MESSAGE::SAMPLE_PERIOD_NS;
+    }
+    return info;
+}
+
+template <typename MESSAGE, size_t I>
+inline double DecodeSignal(uint8_t const* data) {
+    constexpr SignalDef signal = MESSAGE::SIGNALS[I];
+    constexpr int window = signal.Window(MakeInfo<MESSAGE>().LastWindow());
+    constexpr int shift = signal.Shift(window);
+    constexpr uint64_t mask = signal.Mask();
+    // Signals sharing a window and byte order load the same word; the
+    // compiler keeps one load per distinct window
+    uint64_t raw = (LoadPayload(data + window, signal.byte_order) >> shift) & mask;
+
+    double value;
+    if constexpr (signal.type == ValueType::FLOAT32) {
+        static_assert(signal.length == 32, "FLOAT32 signals must be 32 bits long");
+        uint32_t bits = static_cast<uint32_t>(raw);
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        value = f;
+    } else if constexpr (signal.type == ValueType::SIGNED) {
+        constexpr int unused = 64 - signal.length;
+        value = static_cast<double>(static_cast<int64_t>(raw << unused) >> unused);
+    } else {
+        value = static_cast<double>(raw);
+    }
+
+    if constexpr (signal.scale == 1.0 && signal.offset == 0.0) {
+        return value;
+    } else {
+        return value * signal.scale + signal.offset;
+    }
+}
+
+template <typename MESSAGE, size_t... I>
+inline void DecodeSignals(uint8_t const* data, double *out, std::index_sequence<I...>) {
+    ((out[I] = DecodeSignal<MESSAGE, I>(data)), ...);
+}
+
+// Decoder specialized for one message: every window, shift, mask and scale
+// is a compile-time constant. Decodes every sample of the frame into out.
+template <typename MESSAGE>
+void DecodeMessage(uint8_t const* data, DecodedFrame *out) {
+    constexpr MessageInfo info = MakeInfo<MESSAGE>();
+    for (size_t k = 0; k < info.sample_count; k++) {
+        DecodeSignals<MESSAGE>(data + k * info.sample_stride, out[k].values.data(),
+                               std::make_index_sequence<std::size(MESSAGE::SIGNALS)>{});
+    }
+}
+
+template <typename MESSAGE>
+constexpr bool IsValid() {
+    constexpr MessageInfo info = MakeInfo<MESSAGE>();
+    if (MESSAGE::CAN_ID > CAN_SFF_MASK || MESSAGE::DLC > CANFD_MAX_DLEN ||
+        std::size(MESSAGE::SIGNALS) > MAX_SIGNALS_PER_MESSAGE ||
+        info.sample_count == 0 || info.sample_count > MAX_SAMPLES_PER_FRAME || info.LastWindow() < 0) {
+        return false;
+    }
+    for (SignalDef const& signal : MESSAGE::SIGNALS) {
+        if (!info.Fits(signal)) {
+            return false;
+        }
+    }
+    for (PropertyMapping const& property : MESSAGE::PROPERTIES) {
+        if (property.first_signal + property.signal_count > std::size(MESSAGE::SIGNALS)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace signal_detail
+
+// Compile-time signal table. Builds a flat dispatch array indexed by the
+// 11-bit CAN ID, so decoding a frame is one table load and a call into a
+// decoder specialized for that message; no switch, no search. Messages may
+// be CAN FD frames of up to 64 bytes and pack several samples per frame.
+template <typename... MESSAGES>
+class SignalTable {
+public:
+    constexpr static size_t MESSAGE_COUNT = sizeof...(MESSAGES);
+    constexpr static MessageInfo MESSAGES_INFO[] = {signal_detail::MakeInfo<MESSAGES>()...};
+
+    // Decodes every sample of a classic or CAN FD frame into out and returns
+    // the sample count; 0 when the frame is not in the table or is shorter
+    // than its DLC. A classic frame is read through the same struct, its
+    // len being can_frame::can_dlc; either way frame must be a whole
+    // canfd_frame (see MessageInfo::LastWindow()).
+    static size_t Decode(canfd_frame const& frame, DecodedSamples &out) {
+        if (frame.can_id & (CAN_EFF_FLAG | CAN_RTR_FLAG | CAN_ERR_FLAG)) {
+            return 0;
+        }
+        Dispatch const& dispatch = DISPATCH[frame.can_id & CAN_SFF_MASK];
+        if (dispatch.decode == nullptr) {
+            return 0;
+        }
+        MessageInfo const& info = MESSAGES_INFO[dispatch.message];
+        if (frame.len < info.dlc) {
+            return 0;
+        }
+        dispatch.decode(frame.data, out.data());
+        for (size_t k = 0; k < info.sample_count; k++) {
+            out[k].can_id = frame.can_id;
+            out[k].message = dispatch.message;
+            out[k].count = static_cast<uint8_t>(info.signal_count);
+        }
+        return info.sample_count;
+    }
+
+    constexpr static std::array<canid_t, MESSAGE_COUNT> CanIds() {
+        return {MESSAGES::CAN_ID...};
+    }
+
+    // CAN_RAW_FILTER entries matching exactly the table's standard data frames
+    static std::vector<can_filter> Filters() {
+        return {can_filter{MESSAGES::CAN_ID, CAN_SFF_MASK | CAN_EFF_FLAG | CAN_RTR_FLAG}...};
+    }
+
+private:
+    using DecodeFn = void (*)(uint8_t const* data, DecodedFrame *out);
+    struct Dispatch {
+        DecodeFn decode;
+        uint8_t message;
+    };
+
+    constexpr static std::array<Dispatch, CAN_SFF_MASK + 1> BuildDispatch() {
+        std::array<Dispatch, CAN_SFF_MASK + 1> table{};
+        DecodeFn decoders[] = {&signal_detail::DecodeMessage<MESSAGES>...};
+        canid_t ids[] = {MESSAGES::CAN_ID...};
+        for (size_t i = 0; i < MESSAGE_COUNT; i++) {
+            table[ids[i]] = Dispatch{decoders[i], static_cast<uint8_t>(i)};
+        }
+        return table;
+    }
+
+    constexpr static bool UniqueIds() {
+        canid_t ids[] = {MESSAGES::CAN_ID...};
+        for (size_t i = 0; i < MESSAGE_COUNT; i++) {
+            for (size_t j = i + 1; j < MESSAGE_COUNT; j++) {
+                if (ids[i] == ids[j]) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    static_assert((signal_detail::IsValid<MESSAGES>() && ...),
+                  "Signal exceeds its message DLC or the message is not a standard CAN or CAN FD frame");
+    static_assert(UniqueIds(), "CAN IDs in a SignalTable must be unique");
+
+    constexpr static std::array<Dispatch, CAN_SFF_MASK + 1> DISPATCH = BuildDispatch();
+};
+
+}  // namespace tcc::aaos::can
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+
+#include "can_signal.h"
+
+namespace tcc::aaos::can {
+
+// Vendor properties added by hardware.interfaces.patch to VehicleProperty.aidl,
+// composed the same way: id + VehiclePropertyGroup:VENDOR + VehicleArea:GLOBAL
+// + VehiclePropertyType. Kept here so the gateways do not need the patched
+// AIDL headers just to name them.
+enum VendorProperty : int32_t {
+    INFO_TEMPERATURE_DHT22 = 0x1000 + 0x20000000 + 0x01000000 + 0x00600000,           // FLOAT
+    FAULT_CODE_TEMPERATURE_DHT22 = 0x1001 + 0x20000000 + 0x01000000 + 0x00100000,     // STRING
+    INFO_ACCELEROMETER_MPU6050 = 0x1002 + 0x20000000 + 0x01000000 + 0x00410000,       // INT32_VEC
+    FAULT_CODE_ACCELEROMETER_MPU6050 = 0x1003 + 0x20000000 + 0x01000000 + 0x00100000, // STRING
+    // Writable (READ_WRITE, ON_CHANGE): set by apps, sent to the nodes
+    // (VehicleCommands). Declared by ID in the patched DefaultConfig.h only,
+    // the frozen VehicleProperty.aidl does not list them.
+    CONTROL_SELF_TEST = 0x1004 + 0x20000000 + 0x01000000 + 0x00400000,                // INT32
+    CONTROL_SAMPLE_RATE_MPU6050 = 0x1005 + 0x20000000 + 0x01000000 + 0x00400000,      // INT32
+};
+
+// MPU6050 raw acceleration, int16 big-endian per axis (esp32-can main_send.cpp).
+// The node sends INT16_MIN on all three axes when the sensor cannot be read.
+struct AccelerometerMessage {
+    constexpr static canid_t CAN_ID = 0x123;
+    constexpr static uint8_t DLC = 6;
+    constexpr static SignalDef SIGNALS[] = {
+        {"AccelX", 7, 16, ByteOrder::BIG_ENDIAN_ORDER, ValueType::SIGNED, 1.0, 0.0},
+        {"AccelY", 23, 16, ByteOrder::BIG_ENDIAN_ORDER, ValueType::SIGNED, 1.0, 0.0},
+        {"AccelZ", 39, 16, ByteOrder::BIG_ENDIAN_ORDER, ValueType::SIGNED, 1.0, 0.0},
+    };
+    constexpr static PropertyMapping PROPERTIES[] = {
+        {INFO_ACCELEROMETER_MPU6050, 0, 3},
+    };
+    constexpr static FaultCode FAULT = {FAULT_CODE_ACCELEROMETER_MPU6050, "ACC-0", "ACC-E1", INT16_MIN};
+};
+
+// Next-gen MPU6050 node: 10 consecutive readings in one 64-byte CAN FD
+// frame, each laid out like AccelerometerMessage (6 bytes, int16 big-endian
+// per axis), taken 1 ms apart; bytes 60-63 are padding. Published to the
+// same properties as the classic frame, one value per reading.
+struct AccelerometerBurstMessage {
+    constexpr static canid_t CAN_ID = 0x125;
+    constexpr static uint8_t DLC = 64;
+    constexpr static uint8_t SAMPLE_COUNT = 10;
+    constexpr static uint8_t SAMPLE_STRIDE = 6;
+    constexpr static int64_t SAMPLE_PERIOD_NS = 1'000'000;
+    constexpr static SignalDef SIGNALS[] = {
+        {"AccelX", 7, 16, ByteOrder::BIG_ENDIAN_ORDER, ValueType::SIGNED, 1.0, 0.0},
+        {"AccelY", 23, 16, ByteOrder::BIG_ENDIAN_ORDER, ValueType::SIGNED, 1.0, 0.0},
+        {"AccelZ", 39, 16, ByteOrder::BIG_ENDIAN_ORDER, ValueType::SIGNED, 1.0, 0.0},
+    };
+    constexpr static PropertyMapping PROPERTIES[] = {
+        {INFO_ACCELEROMETER_MPU6050, 0, 3},
+    };
+    constexpr static FaultCode FAULT = {FAULT_CODE_ACCELEROMETER_MPU6050, "ACC-0", "ACC-E1", INT16_MIN};
+};
+
+// DHT22 temperature in ºC, IEEE 754 float copied in the node's (little-endian)
+// byte order. The node sends -273.15 when the sensor cannot be read.
+struct TemperatureMessage {
+    constexpr static canid_t CAN_ID = 0x124;
+    constexpr static uint8_t DLC = 4;
+    constexpr static SignalDef SIGNALS[] = {
+        {"Temperature", 0, 32, ByteOrder::LITTLE_ENDIAN_ORDER, ValueType::FLOAT32, 1.0, 0.0},
+    };
+    constexpr static PropertyMapping PROPERTIES[] = {
+        {INFO_TEMPERATURE_DHT22, 0, 1},
+    };
+    constexpr static FaultCode FAULT = {FAULT_CODE_TEMPERATURE_DHT22, "TMP-0", "TMP-E1", -273};
+};
+
+// Every frame the gateways decode. Adding a message here also adds it to the
+// kernel CAN_RAW_FILTER and the published property set. vehicle.dbc describes
+// the same messages for can2vhal --dbc; keep the two in sync.
+using VehicleSignals = SignalTable<AccelerometerMessage, TemperatureMessage, AccelerometerBurstMessage>;
+
+// Commands sent by the gateway (can2vhal --tx) when an app writes a
+// CONTROL_* property. Their IDs are below the sensor frames, so a command
+// wins arbitration against sensor traffic; the transmitter paces them so a
+// burst of commands cannot starve it.
+
+// Runs the self-test of the sensors in the mask: bit 0 DHT22, bit 1
+// MPU6050. Nodes ignore a mask without their bit, so 0 is a no-op.
+struct SelfTestCommand {
+    constexpr static canid_t CAN_ID = 0x100;
+    constexpr static uint8_t DLC = 1;
+    constexpr static SignalDef SIGNALS[] = {
+        {"SelfTestSensors", 0, 8, ByteOrder::LITTLE_ENDIAN_ORDER, ValueType::UNSIGNED, 1.0, 0.0},
+    };
+    constexpr static PropertyMapping PROPERTIES[] = {
+        {CONTROL_SELF_TEST, 0, 1},
+    };
+};
+
+// MPU6050 sampling rate in Hz, uint16 big-endian like the readings
+struct AccelerometerRateCommand {
+    constexpr static canid_t CAN_ID = 0x101;
+    constexpr static uint8_t DLC = 2;
+    constexpr static SignalDef SIGNALS[] = {
+        {"SampleRateHz", 7, 16, ByteOrder::BIG_ENDIAN_ORDER, ValueType::UNSIGNED, 1.0, 0.0},
+    };
+    constexpr static PropertyMapping PROPERTIES[] = {
+        {CONTROL_SAMPLE_RATE_MPU6050, 0, 1},
+    };
+};
+
+// Every frame the gateway encodes. Kept apart from VehicleSignals so the
+// commands stay out of the receive filters; vehicle.dbc does not describe
+// them.
+using VehicleCommands = SignalTable<SelfTestCommand, AccelerometerRateCommand>;
+
+}  // namespace tcc::aaos::can